@@ -0,0 +1,250 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import brr;
+
+static const unsigned
+    endFlag(1),
+    loopFlag(2);
+
+// The block's samples after the shift, before the filter, sixteen at a time. For shifts 13 to 15 the DSP gives 0 or -800h by sign
+static __m256i unpackBlock(const std::uint8_t* p_block) noexcept
+{
+    const unsigned shift(p_block[0] >> 4);
+
+    // Each byte twice, as 16-bit lanes. Multiplying moves the high nibble of even lanes and the low nibble of odd lanes to the top four bits
+    const __m128i bytes(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_block + 1)));
+    const __m256i lanes(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(bytes, bytes)));
+    const __m256i nibbles(_mm256_and_si256
+    (
+        _mm256_mullo_epi16(lanes, _mm256_setr_epi16(0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000, 0x100, 0x1000)),
+        _mm256_set1_epi16(std::int16_t(0xF000))
+    ));
+
+    // (nibble << shift) >> 1, with the nibble already shifted up by 12
+    if (shift <= 12)
+        return _mm256_sra_epi16(nibbles, _mm_cvtsi32_si128(int(13 - shift)));
+
+    return _mm256_and_si256(_mm256_srai_epi16(nibbles, 15), _mm256_set1_epi16(-0x800));
+}
+
+// Decodes one block to sixteen samples. `p1` and `p2` are the previous two samples, and are updated.
+// Filter 0 doesn't depend on previous samples and is done entirely in vector registers, the other filters are recursive and are applied a sample at a time
+static void decodeBlock(const std::uint8_t* p_block, std::int16_t* p_out, std::int16_t& p1, std::int16_t& p2) noexcept
+{
+    const unsigned filter(p_block[0] >> 2 & 3);
+    const __m256i unfiltered(unpackBlock(p_block));
+    if (filter == 0)
+    {
+        // No filter means nothing to clamp, the DSP's 15-bit wrap is a shift
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_out), _mm256_slli_epi16(unfiltered, 1));
+        p1 = p_out[brrBlockSamples - 1];
+        p2 = p_out[brrBlockSamples - 2];
+        return;
+    }
+
+    alignas(32) std::int16_t samples[brrBlockSamples];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(samples), unfiltered);
+    for (index_t i{}; i < brrBlockSamples; ++i)
+    {
+        // Coefficients 15/16, 61/32 and -15/16, 115/64 and -13/16, with the rounding the DSP does.
+        // The DSP takes the older sample at 15 bits and the previous one at 16
+        int s(samples[i]);
+        const int older(p2 >> 1);
+        switch (filter)
+        {
+        case 1:
+            s += (p1 >> 1) + (-p1 >> 5);
+            break;
+
+        case 2:
+            s += p1 - older + (older >> 4) + (p1 * -3 >> 6);
+            break;
+
+        case 3:
+            s += p1 - older + (p1 * -13 >> 7) + (older * 3 >> 4);
+            break;
+        }
+
+        s = std::clamp(s, -0x8000, 0x7FFF);
+        p2 = p1;
+        p1 = std::int16_t(std::uint16_t(s << 1));
+        p_out[i] = p1;
+    }
+}
+
+n_t brrSize(std::span<const std::uint8_t> brr)
+try
+{
+    for (index_t i{}; i + brrBlockSize <= std::size(brr); i += brrBlockSize)
+        if (brr[i] & endFlag)
+            return i + brrBlockSize;
+
+    throw std::runtime_error(LOG_INFO "BRR sample has no end block in "s + std::to_string(std::size(brr)) + " bytes"s);
+}
+LOG_RETHROW
+
+std::vector<std::int16_t> decodeBrr(std::span<const std::uint8_t> brr)
+try
+{
+    const n_t n_blocks(brrSize(brr) / brrBlockSize);
+    std::vector<std::int16_t> ret(n_blocks * brrBlockSamples);
+    std::int16_t p1{}, p2{};
+    for (index_t i_block{}; i_block < n_blocks; ++i_block)
+        decodeBlock(&brr[i_block * brrBlockSize], &ret[i_block * brrBlockSamples], p1, p2);
+
+    return ret;
+}
+LOG_RETHROW
+
+PcmRing::PcmRing(std::span<std::int16_t> samples_in)
+try
+    : samples(samples_in)
+{
+    if (!std::has_single_bit(std::size(samples)))
+        throw std::runtime_error(LOG_INFO "PCM ring capacity "s + std::to_string(std::size(samples)) + " isn't a power of two"s);
+}
+LOG_RETHROW
+
+n_t PcmRing::capacity() const noexcept
+{
+    return std::size(samples);
+}
+
+n_t PcmRing::n_available() const noexcept
+{
+    return i_write.load(std::memory_order_acquire) - i_read.load(std::memory_order_acquire);
+}
+
+n_t PcmRing::n_free() const noexcept
+{
+    return capacity() - n_available();
+}
+
+void PcmRing::push(std::span<const std::int16_t> pcm)
+try
+{
+    if (std::size(pcm) > n_free())
+        throw std::runtime_error(LOG_INFO "Pushing "s + std::to_string(std::size(pcm)) + " samples to a PCM ring with room for "s + std::to_string(n_free()));
+
+    const index_t i(i_write.load(std::memory_order_relaxed));
+    const index_t i_begin(i & (capacity() - 1));
+    const n_t n_first(std::min(std::size(pcm), capacity() - i_begin));
+    std::copy_n(std::begin(pcm), n_first, std::begin(samples) + i_begin);
+    std::copy(std::begin(pcm) + n_first, std::end(pcm), std::begin(samples));
+    i_write.store(i + std::size(pcm), std::memory_order_release);
+}
+LOG_RETHROW
+
+n_t PcmRing::pop(std::span<std::int16_t> pcm) noexcept
+{
+    const index_t i(i_read.load(std::memory_order_relaxed));
+    const n_t n(std::min(std::size(pcm), i_write.load(std::memory_order_acquire) - i));
+    const index_t i_begin(i & (capacity() - 1));
+    const n_t n_first(std::min(n, capacity() - i_begin));
+    std::copy_n(std::begin(samples) + i_begin, n_first, std::begin(pcm));
+    std::copy_n(std::begin(samples), n - n_first, std::begin(pcm) + n_first);
+    i_read.store(i + n, std::memory_order_release);
+    return n;
+}
+
+BrrDecoder::BrrDecoder(std::span<const std::uint8_t> brr_in, std::optional<index_t> loopOffset)
+try
+    : brr(brr_in)
+{
+    if (loopOffset)
+    {
+        if (*loopOffset % brrBlockSize || *loopOffset >= std::size(brr))
+            throw std::runtime_error(LOG_INFO "BRR loop offset "s + std::to_string(*loopOffset) + " isn't the start of a block of the sample"s);
+
+        i_loopBlock = *loopOffset / brrBlockSize;
+    }
+}
+LOG_RETHROW
+
+n_t BrrDecoder::decode(PcmRing& ring)
+try
+{
+    n_t ret{};
+    std::int16_t block[brrBlockSamples];
+    while (!isFinished_ && ring.n_free() >= brrBlockSamples)
+    {
+        const index_t i_byte(i_block * brrBlockSize);
+        if (i_byte + brrBlockSize > std::size(brr))
+            throw std::runtime_error(LOG_INFO "BRR sample runs past its "s + std::to_string(std::size(brr)) + " bytes without an end block"s);
+
+        decodeBlock(&brr[i_byte], block, p1, p2);
+        ring.push(block);
+        ret += brrBlockSamples;
+
+        const unsigned header(brr[i_byte]);
+        if (!(header & endFlag))
+            ++i_block;
+        else if (header & loopFlag && i_loopBlock)
+            i_block = *i_loopBlock;
+        else
+            isFinished_ = true;
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+bool BrrDecoder::isFinished() const noexcept
+{
+    return isFinished_;
+}
+
+WaveformOverview makeWaveformOverview(std::span<const std::int16_t> pcm, n_t n_columns)
+try
+{
+    WaveformOverview ret{std::vector<std::int16_t>(n_columns), std::vector<std::int16_t>(n_columns)};
+    for (index_t i_column{}; i_column < n_columns; ++i_column)
+    {
+        const index_t i_begin(i_column * std::size(pcm) / n_columns), i_end((i_column + 1) * std::size(pcm) / n_columns);
+        if (i_begin == i_end)
+            continue;
+
+        const auto [it_min, it_max](std::minmax_element(std::begin(pcm) + i_begin, std::begin(pcm) + i_end));
+        ret.minimums[i_column] = *it_min;
+        ret.maximums[i_column] = *it_max;
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<DecodedSample> decodeBrrBatch(std::span<const std::span<const std::uint8_t>> samples, n_t n_overviewColumns)
+try
+{
+    std::vector<DecodedSample> ret(std::size(samples));
+    std::vector<std::string> errors(std::size(samples));
+    std::vector<index_t> indices(std::size(samples));
+    std::iota(std::begin(indices), std::end(indices), 0);
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i)
+    {
+        // A sample that fails to decode is left empty
+        try
+        {
+            ret[i].pcm = decodeBrr(samples[i]);
+            ret[i].overview = makeWaveformOverview(ret[i].pcm, n_overviewColumns);
+        }
+        catch (const std::exception& e)
+        {
+            errors[i] = e.what();
+        }
+    });
+
+    // Logged once the workers are done, so the log isn't interleaved
+    if (std::ranges::any_of(errors, [](const std::string& error) { return !std::empty(error); }))
+    {
+        DebugFile debugFile(DebugFile::warning);
+        for (index_t i{}; i < std::size(errors); ++i)
+            if (!std::empty(errors[i]))
+                debugFile << LOG_INFO "Failed to decode BRR sample "s << i << ": "s << errors[i] << '\n';
+    }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,76 @@
+module;
+
+#include "../global.h"
+
+export module brr;
+
+// SNES BRR samples. A block is a header byte, ssssffle (shift, filter, loop, end), followed by sixteen signed 4-bit samples, high nibble first.
+// Decoded samples are 16-bit PCM as the DSP produces it, at 32000Hz at the base pitch
+export const n_t
+    brrBlockSize{9},
+    brrBlockSamples{16},
+    brrSampleRate{32000};
+
+// Size in bytes of the sample starting at the start of `brr`, up to and including its end block
+export n_t brrSize(std::span<const std::uint8_t> brr);
+
+// Decodes up to the end block, without looping
+export std::vector<std::int16_t> decodeBrr(std::span<const std::uint8_t> brr);
+
+// Samples owned by the caller, e.g. shared with an audio callback. The capacity must be a power of two.
+// Indices increase without wrapping, one producer and one consumer can use it from different threads
+export class PcmRing
+{
+    std::span<std::int16_t> samples;
+    std::atomic<index_t> i_write{}, i_read{};
+
+public:
+    explicit PcmRing(std::span<std::int16_t> samples);
+
+    n_t capacity() const noexcept;
+    n_t n_available() const noexcept;
+    n_t n_free() const noexcept;
+
+    // Producer
+    void push(std::span<const std::int16_t> pcm);
+
+    // Consumer. Returns the number of samples read
+    n_t pop(std::span<std::int16_t> pcm) noexcept;
+};
+
+// Decodes a sample a block at a time into a ring, so a preview can start playing before the whole sample's decoded and a looping sample can play indefinitely
+export class BrrDecoder
+{
+    std::span<const std::uint8_t> brr;
+    std::optional<index_t> i_loopBlock;
+    index_t i_block{};
+    std::int16_t p1{}, p2{};
+    bool isFinished_{};
+
+public:
+    // `loopOffset` is the byte offset into `brr` to go back to after an end block with the loop flag, as given by the sample directory
+    explicit BrrDecoder(std::span<const std::uint8_t> brr, std::optional<index_t> loopOffset = std::nullopt);
+
+    // Decodes whole blocks while there's room in the ring. Returns the number of samples decoded
+    n_t decode(PcmRing& ring);
+
+    // Reached an end block without the loop flag, or one with it when there's no loop offset
+    bool isFinished() const noexcept;
+};
+
+// Lowest and highest sample in each column of a fixed width overview of the waveform
+export struct WaveformOverview
+{
+    std::vector<std::int16_t> minimums, maximums;
+};
+
+export WaveformOverview makeWaveformOverview(std::span<const std::int16_t> pcm, n_t n_columns);
+
+export struct DecodedSample
+{
+    std::vector<std::int16_t> pcm;
+    WaveformOverview overview;
+};
+
+// Decodes each sample on its own task across all cores
+export std::vector<DecodedSample> decodeBrrBatch(std::span<const std::span<const std::uint8_t>> samples, n_t n_overviewColumns);
@@ -0,0 +1,63 @@
+#include "../global.h"
+
+import wav;
+
+static void write16(std::ostream& out, std::uint16_t v)
+try
+{
+    const char bytes[]{char(v), char(v >> 8)};
+    out.write(bytes, std::size(bytes));
+}
+LOG_RETHROW
+
+static void write32(std::ostream& out, std::uint32_t v)
+try
+{
+    write16(out, std::uint16_t(v));
+    write16(out, std::uint16_t(v >> 16));
+}
+LOG_RETHROW
+
+void writeWav(std::ostream& out, std::span<const std::int16_t> pcm, n_t sampleRate)
+try
+{
+    const n_t
+        bytesPerSample(2),
+        formatSize(16),
+        dataSize(std::size(pcm) * bytesPerSample);
+
+    if (dataSize > 0xFFFFFFFF - 36)
+        throw std::runtime_error(LOG_INFO "Too many samples for a WAV file: "s + std::to_string(std::size(pcm)));
+
+    // RIFF header, then a PCM format chunk and the data chunk
+    out.write("RIFF", 4);
+    write32(out, std::uint32_t(4 + 8 + formatSize + 8 + dataSize));
+    out.write("WAVE", 4);
+
+    out.write("fmt ", 4);
+    write32(out, std::uint32_t(formatSize));
+    write16(out, 1); // PCM
+    write16(out, 1); // Channels
+    write32(out, std::uint32_t(sampleRate));
+    write32(out, std::uint32_t(sampleRate * bytesPerSample));
+    write16(out, std::uint16_t(bytesPerSample));
+    write16(out, std::uint16_t(bytesPerSample * 8));
+
+    out.write("data", 4);
+    write32(out, std::uint32_t(dataSize));
+    if constexpr (std::endian::native == std::endian::little)
+        out.write(reinterpret_cast<const char*>(std::data(pcm)), std::streamsize(dataSize));
+    else
+        for (std::int16_t sample : pcm)
+            write16(out, std::uint16_t(sample));
+}
+LOG_RETHROW
+
+void writeWav(const std::filesystem::path& filepath, std::span<const std::int16_t> pcm, n_t sampleRate)
+try
+{
+    std::ofstream out(filepath, std::ios::binary);
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+    writeWav(out, pcm, sampleRate);
+}
+LOG_RETHROW
@@ -0,0 +1,9 @@
+module;
+
+#include "../global.h"
+
+export module wav;
+
+// Writes 16-bit mono PCM as a WAV file, throws on I/O error
+export void writeWav(std::ostream& out, std::span<const std::int16_t> pcm, n_t sampleRate);
+export void writeWav(const std::filesystem::path& filepath, std::span<const std::int16_t> pcm, n_t sampleRate);
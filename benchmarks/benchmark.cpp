@@ -0,0 +1,368 @@
+#include "../global.h"
+
+import benchmark;
+
+// Bumped if the meaning of a result changes, so old baselines aren't compared against new results
+static const unsigned jsonVersion(1);
+
+double BenchmarkResult::nanosecondsPerUnit() const noexcept
+{
+    return size ? nanoseconds / double(size) : nanoseconds;
+}
+
+static double timeIterations(const BenchmarkBody& body, n_t n_iterations, std::uint64_t& checksum)
+try
+{
+    const auto startTime(std::chrono::steady_clock::now());
+    for (index_t i{}; i < n_iterations; ++i)
+        checksum += body();
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+}
+LOG_RETHROW
+
+static BenchmarkResult runBenchmark(const BenchmarkCase& benchmarkCase, n_t size, const BenchmarkOptions& options, std::uint64_t& checksum)
+try
+{
+    const BenchmarkBody body(benchmarkCase.setUp(size));
+
+    // The warm up run also sets the number of iterations per sample
+    const double minSampleTime(std::chrono::duration<double, std::nano>(options.minSampleTime).count());
+    const double warmUpTime(std::max(timeIterations(body, 1, checksum), 1.));
+    const n_t n_iterations(std::max(n_t(std::ceil(minSampleTime / warmUpTime)), n_t(1)));
+
+    std::vector<double> samples;
+    for (index_t i_sample{}; i_sample < std::max(options.n_samples, n_t(1)); ++i_sample)
+        samples.push_back(timeIterations(body, n_iterations, checksum) / double(n_iterations));
+
+    std::ranges::nth_element(samples, std::begin(samples) + std::size(samples) / 2);
+    return {benchmarkCase.name, size, benchmarkCase.unit, n_iterations, samples[std::size(samples) / 2]};
+}
+LOG_RETHROW
+
+std::vector<BenchmarkResult> runBenchmarks(std::span<const BenchmarkCase> cases, const BenchmarkOptions& options, std::ostream& progress)
+try
+{
+    // Benchmarks are run one at a time so that they don't compete for cores or cache
+    std::vector<BenchmarkResult> ret;
+    std::uint64_t checksum{};
+    progress << std::fixed;
+    for (const BenchmarkCase& benchmarkCase : cases)
+    {
+        if (!benchmarkCase.name.contains(options.filter))
+            continue;
+
+        for (n_t size : benchmarkCase.sizes)
+        {
+            const BenchmarkResult& result(ret.emplace_back(runBenchmark(benchmarkCase, size, options, checksum)));
+            progress
+                << std::left << std::setw(32) << result.name << std::right << std::setw(10) << result.size << ' ' << std::left << std::setw(10) << result.unit << std::right
+                << std::setprecision(0) << std::setw(14) << result.nanoseconds << " ns"s
+                << std::setprecision(3) << std::setw(14) << result.nanosecondsPerUnit() << " ns/"s << result.unit << '\n';
+        }
+    }
+
+    progress << "Checksum: "s << toHexString(checksum) << '\n';
+    return ret;
+}
+LOG_RETHROW
+
+static std::string escapeJson(std::string_view s)
+try
+{
+    std::string ret;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            ret += '\\';
+
+        ret += c;
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+void writeBenchmarkJson(std::ostream& out, std::span<const BenchmarkResult> results)
+try
+{
+    out << "{\n"s;
+    out << "    \"version\": "s << jsonVersion << ",\n"s;
+    out << "    \"results\": [\n"s;
+    out << std::setprecision(6);
+    for (index_t i{}; i < std::size(results); ++i)
+    {
+        const BenchmarkResult& result(results[i]);
+        out
+            << "        {\"name\": \""s << escapeJson(result.name) << "\", \"size\": "s << result.size << ", \"unit\": \""s << escapeJson(result.unit)
+            << "\", \"iterations\": "s << result.n_iterations << ", \"nanoseconds\": "s << result.nanoseconds << ", \"nanosecondsPerUnit\": "s << result.nanosecondsPerUnit() << '}'
+            << (i + 1 < std::size(results) ? ",\n"s : "\n"s);
+    }
+
+    out << "    ]\n"s;
+    out << "}\n"s;
+}
+LOG_RETHROW
+
+// Just enough JSON for the results file: objects, arrays, strings and numbers
+class JsonReader
+{
+    std::string text;
+    index_t i{};
+
+public:
+    explicit JsonReader(std::istream& in)
+    try
+        : text(std::istreambuf_iterator<char>(in), {})
+    {}
+    LOG_RETHROW
+
+    char peek()
+    try
+    {
+        while (i < std::size(text) && std::isspace(static_cast<unsigned char>(text[i])))
+            ++i;
+
+        if (i == std::size(text))
+            throw std::runtime_error(LOG_INFO "Unexpected end of benchmark JSON"s);
+
+        return text[i];
+    }
+    LOG_RETHROW
+
+    void expect(char c)
+    try
+    {
+        if (peek() != c)
+            throw std::runtime_error(LOG_INFO "Expected '"s + c + "' at offset "s + std::to_string(i) + " of benchmark JSON"s);
+
+        ++i;
+    }
+    LOG_RETHROW
+
+    // Consumes `c` if it's next
+    bool accept(char c)
+    try
+    {
+        if (peek() != c)
+            return false;
+
+        ++i;
+        return true;
+    }
+    LOG_RETHROW
+
+    std::string readString()
+    try
+    {
+        expect('"');
+        std::string ret;
+        while (i < std::size(text) && text[i] != '"')
+        {
+            if (text[i] == '\\')
+                ++i;
+
+            if (i < std::size(text))
+                ret += text[i++];
+        }
+
+        expect('"');
+        return ret;
+    }
+    LOG_RETHROW
+
+    double readNumber()
+    try
+    {
+        peek();
+        const char* const p_begin(text.data() + i);
+        double ret{};
+        const auto [p_end, error](std::from_chars(p_begin, text.data() + std::size(text), ret));
+        if (error != std::errc())
+            throw std::runtime_error(LOG_INFO "Expected a number at offset "s + std::to_string(i) + " of benchmark JSON"s);
+
+        i += p_end - p_begin;
+        return ret;
+    }
+    LOG_RETHROW
+
+    // Skips a value of any type
+    void skip()
+    try
+    {
+        const char c(peek());
+        if (c == '"')
+            readString();
+        else if (c == '{' || c == '[')
+        {
+            const char close(c == '{' ? '}' : ']');
+            ++i;
+            if (accept(close))
+                return;
+
+            do
+            {
+                if (close == '}')
+                {
+                    readString();
+                    expect(':');
+                }
+
+                skip();
+            } while (accept(','));
+
+            expect(close);
+        }
+        else if (std::isalpha(static_cast<unsigned char>(c)))
+            while (i < std::size(text) && std::isalpha(static_cast<unsigned char>(text[i])))
+                ++i;
+        else
+            readNumber();
+    }
+    LOG_RETHROW
+
+    // Calls `onMember` for each key, which reads or skips the value
+    void readObject(FunctionRef<void(const std::string& key)> onMember)
+    try
+    {
+        expect('{');
+        if (accept('}'))
+            return;
+
+        do
+        {
+            const std::string key(readString());
+            expect(':');
+            onMember(key);
+        } while (accept(','));
+
+        expect('}');
+    }
+    LOG_RETHROW
+};
+
+std::vector<BenchmarkResult> readBenchmarkJson(std::istream& in)
+try
+{
+    JsonReader reader(in);
+    std::vector<BenchmarkResult> ret;
+    std::optional<unsigned> version;
+    reader.readObject([&](const std::string& key)
+    {
+        if (key == "version"s)
+        {
+            version = unsigned(reader.readNumber());
+            return;
+        }
+
+        if (key != "results"s)
+        {
+            reader.skip();
+            return;
+        }
+
+        reader.expect('[');
+        if (reader.accept(']'))
+            return;
+
+        do
+        {
+            BenchmarkResult result{};
+            reader.readObject([&](const std::string& resultKey)
+            {
+                if (resultKey == "name"s)
+                    result.name = reader.readString();
+                else if (resultKey == "unit"s)
+                    result.unit = reader.readString();
+                else if (resultKey == "size"s)
+                    result.size = n_t(reader.readNumber());
+                else if (resultKey == "iterations"s)
+                    result.n_iterations = n_t(reader.readNumber());
+                else if (resultKey == "nanoseconds"s)
+                    result.nanoseconds = reader.readNumber();
+                else
+                    reader.skip();
+            });
+
+            ret.push_back(std::move(result));
+        } while (reader.accept(','));
+
+        reader.expect(']');
+    });
+
+    if (version != jsonVersion)
+        throw std::runtime_error(LOG_INFO "Benchmark JSON is version "s + (version ? std::to_string(*version) : "(none)"s) + ", expected version "s + std::to_string(jsonVersion));
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<BenchmarkComparison> compareBenchmarks(std::span<const BenchmarkResult> baseline, std::span<const BenchmarkResult> current, double threshold)
+try
+{
+    const double missing(std::numeric_limits<double>::quiet_NaN());
+    const auto find([](std::span<const BenchmarkResult> results, const BenchmarkResult& result) -> const BenchmarkResult*
+    {
+        const auto it(std::ranges::find_if(results, [&](const BenchmarkResult& other)
+        {
+            return other.name == result.name && other.size == result.size;
+        }));
+
+        return it == std::end(results) ? nullptr : &*it;
+    });
+
+    // Current results in order, then baseline results that are no longer run
+    std::vector<BenchmarkComparison> ret;
+    for (const BenchmarkResult& result : current)
+    {
+        const BenchmarkResult* const p_baseline(find(baseline, result));
+        if (!p_baseline)
+        {
+            ret.push_back({result.name, result.size, missing, result.nanoseconds, false});
+            continue;
+        }
+
+        const bool isRegression(result.nanoseconds > p_baseline->nanoseconds * (1 + threshold / 100));
+        ret.push_back({result.name, result.size, p_baseline->nanoseconds, result.nanoseconds, isRegression});
+    }
+
+    for (const BenchmarkResult& result : baseline)
+        if (!find(current, result))
+            ret.push_back({result.name, result.size, result.nanoseconds, missing, false});
+
+    return ret;
+}
+LOG_RETHROW
+
+void writeBenchmarkComparison(std::ostream& out, std::span<const BenchmarkComparison> comparisons)
+try
+{
+    out << std::left << std::setw(32) << "Benchmark"s << std::right << std::setw(10) << "Size"s << std::setw(16) << "Baseline (ns)"s << std::setw(16) << "Current (ns)"s << std::setw(10) << "Change"s << '\n';
+    out << std::fixed;
+    n_t n_regressions{};
+    for (const BenchmarkComparison& comparison : comparisons)
+    {
+        out << std::left << std::setw(32) << comparison.name << std::right << std::setw(10) << comparison.size << std::setprecision(0);
+        if (std::isnan(comparison.baseline))
+        {
+            out << std::setw(16) << "-"s << std::setw(16) << comparison.current << std::setw(10) << "new"s << '\n';
+            continue;
+        }
+
+        if (std::isnan(comparison.current))
+        {
+            out << std::setw(16) << comparison.baseline << std::setw(16) << "-"s << std::setw(10) << "removed"s << '\n';
+            continue;
+        }
+
+        const double change((comparison.current / comparison.baseline - 1) * 100);
+        out
+            << std::setw(16) << comparison.baseline << std::setw(16) << comparison.current
+            << std::setprecision(1) << std::setw(9) << std::showpos << change << std::noshowpos << '%' << (comparison.isRegression ? "  REGRESSION"s : ""s) << '\n';
+
+        n_regressions += comparison.isRegression;
+    }
+
+    out << n_regressions << " regression(s)\n"s;
+}
+LOG_RETHROW
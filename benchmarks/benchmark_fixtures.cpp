@@ -0,0 +1,406 @@
+#include "../global.h"
+
+import benchmark_fixtures;
+
+import address_mapping;
+import compress;
+import tile_format;
+
+static const std::uint32_t
+    roomBank(0x8F'0000),
+    doorBank(0x83'0000),
+    tilesetTableAddress(0x8F'E6A2),
+    creTilesAddress(0xB9'8000),
+    creTileTableAddress(0xB9'A09D),
+    tileTableAddress(0xBA'8000),
+    tilesAddress(0xBB'8000),
+    paletteAddress(0xBC'8000),
+    levelDataAddress(0xBD'8000);
+
+static const std::uint16_t
+    landingSiteAddress(0x91F8),
+    ceresAddress(0xDF45),
+    firstRoomAddress(0x9240),
+    roomSpacing(0x40),
+    defaultStateCondition(0xE5E6);
+
+static const n_t
+    maxRooms(0x100),
+    n_tilesets(0x1D),
+    n_creTiles(0x180),
+    n_sceTiles(0x280),
+    n_creMetatiles(0x100),
+    n_sceMetatiles(0x300),
+    doorSize(12);
+
+// std::mt19937 is specified to give the same sequence everywhere, unlike the standard distributions, so values are taken from it by modulo
+using Random = std::mt19937;
+
+std::vector<std::uint8_t> makeCompressibleBytes(n_t size, std::uint32_t seed)
+try
+{
+    Random random(seed);
+    std::vector<std::uint8_t> ret;
+    ret.reserve(size);
+    while (std::size(ret) < size)
+    {
+        const n_t n(std::min<n_t>(random() % 0x20 + 2, size - std::size(ret)));
+        switch (random() % 8)
+        {
+        case 0:
+        case 1:
+        case 2:
+            for (index_t i{}; i < n; ++i)
+                ret.push_back(std::uint8_t(random()));
+
+            break;
+
+        case 3:
+        case 4:
+            ret.insert(std::end(ret), n, std::uint8_t(random()));
+            break;
+
+        case 5:
+        {
+            const std::uint8_t v(std::uint8_t(random()));
+            for (index_t i{}; i < n; ++i)
+                ret.push_back(std::uint8_t(v + i));
+
+            break;
+        }
+
+        default:
+        {
+            // A repeat of something recent, or noise if there's nothing to repeat yet
+            if (std::size(ret) < n)
+            {
+                ret.push_back(std::uint8_t(random()));
+                break;
+            }
+
+            const index_t i_from(std::size(ret) - n - random() % std::min<n_t>(std::size(ret) - n + 1, 0x1000));
+            for (index_t i{}; i < n; ++i)
+                ret.push_back(ret[i_from + i]);
+        }
+        }
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> makeTiles4bpp(n_t n_tiles, std::uint32_t seed)
+try
+{
+    Random random(seed);
+    std::vector<std::uint8_t> pixels(n_tiles * 0x40);
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+    {
+        const std::span<std::uint8_t> tile(std::span(pixels).subspan(i_tile * 0x40, 0x40));
+        if (i_tile == 0 || random() % 4 == 0)
+        {
+            // A fresh tile uses a few colours of one palette row, as a tile drawn for the SNES would
+            const unsigned i_firstColour(random() % 12);
+            for (std::uint8_t& pixel : tile)
+                pixel = std::uint8_t(i_firstColour + random() % 4);
+
+            continue;
+        }
+
+        // An edit of a recent tile, a row changed
+        const index_t i_from(i_tile - 1 - random() % std::min<n_t>(i_tile, 0x20));
+        std::copy_n(std::begin(pixels) + i_from * 0x40, 0x40, std::begin(tile));
+        const index_t y(random() % 8);
+        for (index_t x{}; x < 8; ++x)
+            tile[y * 8 + x] = std::uint8_t(random() % 0x10);
+    }
+
+    return encodeTiles<SnesTile4bpp>(pixels);
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> makePalette(n_t n_colours, std::uint32_t seed)
+try
+{
+    // Ramps of each palette row's base colour, light to dark
+    Random random(seed);
+    std::vector<std::uint8_t> ret;
+    unsigned r{}, g{}, b{};
+    for (index_t i{}; i < n_colours; ++i)
+    {
+        if (i % 0x10 == 0)
+        {
+            r = random() % 0x20;
+            g = random() % 0x20;
+            b = random() % 0x20;
+        }
+
+        const unsigned shade(unsigned(i % 0x10));
+        const std::uint16_t colour(std::uint16_t(r * shade / 0xF | (g * shade / 0xF) << 5 | (b * shade / 0xF) << 10));
+        ret.push_back(std::uint8_t(colour));
+        ret.push_back(std::uint8_t(colour >> 8));
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> makeLevelData(n_t width, n_t height, std::uint32_t seed)
+try
+{
+    const n_t
+        blocksWide(width * 0x10),
+        blocksHigh(height * 0x10),
+        n_blocks(blocksWide * blocksHigh);
+
+    const std::uint16_t
+        air(0x00FF),
+        solid(0x8000),
+        door(0x9000),
+        xFlip(0x400);
+
+    Random random(seed);
+    std::vector<std::uint16_t> layer1(n_blocks, air), layer2(n_blocks);
+    std::vector<std::uint8_t> bts(n_blocks);
+
+    // Ground as a random walk, with a surface metatile over ground fill
+    index_t groundY(blocksHigh - 4);
+    for (index_t x{}; x < blocksWide; ++x)
+    {
+        if (random() % 4 == 0)
+            groundY = std::clamp<index_t>(groundY + random() % 3 - 1, blocksHigh / 2, blocksHigh - 2);
+
+        layer1[groundY * blocksWide + x] = std::uint16_t(solid | (0x110 + random() % 4) | (random() % 8 == 0 ? xFlip : 0));
+        for (index_t y(groundY + 1); y < blocksHigh; ++y)
+            layer1[y * blocksWide + x] = std::uint16_t(solid | (0x120 + (x + y) % 2));
+    }
+
+    // Walls at the room's edges with a door in each screen row, the door's BTS is its index in the door list
+    for (index_t y{}; y < blocksHigh; ++y)
+        for (index_t x : {index_t(0), blocksWide - 1})
+        {
+            const bool isDoor(y % 0x10 >= 6 && y % 0x10 < 10);
+            layer1[y * blocksWide + x] = std::uint16_t(isDoor ? door | 0x40 : solid | 0x130 | (x ? xFlip : 0));
+            bts[y * blocksWide + x] = std::uint8_t(isDoor ? (x ? 0 : 1) : 0);
+        }
+
+    // Floating platforms
+    for (index_t i_platform{}; i_platform < n_blocks / 0x40; ++i_platform)
+    {
+        const index_t
+            y(random() % (blocksHigh / 2) + 1),
+            x_begin(random() % (blocksWide - 2) + 1),
+            x_end(std::min<index_t>(x_begin + random() % 6 + 2, blocksWide - 1));
+
+        for (index_t x(x_begin); x < x_end; ++x)
+            layer1[y * blocksWide + x] = std::uint16_t(solid | (0x140 + (x == x_begin ? 0 : x + 1 == x_end ? 2 : 1)));
+    }
+
+    // Layer 2 is a background pattern four blocks square
+    for (index_t y{}; y < blocksHigh; ++y)
+        for (index_t x{}; x < blocksWide; ++x)
+            layer2[y * blocksWide + x] = std::uint16_t(0x200 + y % 4 * 4 + x % 4);
+
+    std::vector<std::uint8_t> ret;
+    ret.reserve(2 + n_blocks * 5);
+    const auto push16([&](std::uint16_t v)
+    {
+        ret.push_back(std::uint8_t(v));
+        ret.push_back(std::uint8_t(v >> 8));
+    });
+
+    push16(std::uint16_t(n_blocks * 2));
+    for (std::uint16_t block : layer1)
+        push16(block);
+
+    ret.insert(std::end(ret), std::begin(bts), std::end(bts));
+    for (std::uint16_t block : layer2)
+        push16(block);
+
+    return ret;
+}
+LOG_RETHROW
+
+// Tile table entries in metatile order, four per metatile. Each metatile draws four consecutive tiles in one palette row, as most do
+static std::vector<std::uint8_t> makeTileTable(n_t n_metatiles, std::uint32_t seed)
+try
+{
+    Random random(seed);
+    std::vector<std::uint8_t> ret;
+    for (index_t i_metatile{}; i_metatile < n_metatiles; ++i_metatile)
+    {
+        const unsigned
+            i_tile(unsigned(random() % ((n_sceTiles + n_creTiles) / 4) * 4)),
+            i_palette(random() % 8),
+            flips(random() % 8 == 0 ? unsigned(random() % 4) : 0);
+
+        for (unsigned i{}; i < 4; ++i)
+        {
+            const std::uint16_t entry(std::uint16_t(flips << 14 | i_palette << 10 | (i_tile + i)));
+            ret.push_back(std::uint8_t(entry));
+            ret.push_back(std::uint8_t(entry >> 8));
+        }
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+class FixtureWriter
+{
+    std::vector<std::uint8_t> rom;
+    std::uint32_t nextLevelDataAddress{levelDataAddress};
+
+public:
+    explicit FixtureWriter(n_t romSize)
+        : rom(romSize)
+    {}
+
+    std::span<std::uint8_t> bytes(std::uint32_t address, n_t size)
+    {
+        const index_t i(LoRomMapping::toPc(address));
+        if (i + size > std::size(rom))
+            throw std::runtime_error(LOG_INFO "Fixture data at $"s + toHexString(address, 3) + " runs past the end of a "s + toHexString(std::size(rom), 3) + " byte ROM"s);
+
+        return std::span(rom).subspan(i, size);
+    }
+
+    void write(std::uint32_t address, std::span<const std::uint8_t> data)
+    {
+        std::ranges::copy(data, std::begin(bytes(address, std::size(data))));
+    }
+
+    void write8(std::uint32_t address, unsigned v)
+    {
+        bytes(address, 1)[0] = std::uint8_t(v);
+    }
+
+    void write16(std::uint32_t address, unsigned v)
+    {
+        write8(address, v);
+        write8(address + 1, v >> 8);
+    }
+
+    void write24(std::uint32_t address, std::uint32_t v)
+    {
+        write16(address, v);
+        write8(address + 2, v >> 16);
+    }
+
+    // Compressed data doesn't cross banks, as the game's level data never does
+    std::uint32_t writeLevelData(std::span<const std::uint8_t> levelData)
+    {
+        const std::vector<std::uint8_t> compressed(compress(levelData));
+        if ((nextLevelDataAddress & 0xFFFF) + std::size(compressed) > 0x10000)
+            nextLevelDataAddress = (nextLevelDataAddress & 0xFF'0000) + 0x1'8000;
+
+        const std::uint32_t ret(nextLevelDataAddress);
+        write(ret, compressed);
+        nextLevelDataAddress += std::uint32_t(std::size(compressed));
+        return ret;
+    }
+
+    // `doors` are destination room addresses
+    void writeRoom(std::uint16_t address, index_t i_room, n_t width, n_t height, std::span<const std::uint16_t> doors, std::uint32_t& nextDoorAddress, std::uint32_t seed)
+    {
+        const std::uint32_t header(roomBank | address);
+        const std::uint16_t doorListPointer(std::uint16_t(address + 11 + 2 + 26));
+        const std::uint8_t headerBytes[]
+        {
+            std::uint8_t(i_room), std::uint8_t(i_room % 6), std::uint8_t(i_room % 0x40), std::uint8_t(i_room / 0x40 * 8),
+            std::uint8_t(width), std::uint8_t(height), 0x70, 0xA0, 0, std::uint8_t(doorListPointer), std::uint8_t(doorListPointer >> 8)
+        };
+
+        write(header, headerBytes);
+        write16(header + 11, defaultStateCondition);
+
+        // Default state: level data, tileset 0, nothing else
+        const std::uint32_t state(header + 13);
+        write24(state, writeLevelData(makeLevelData(width, height, seed)));
+
+        // Door list, then a zero entry to end it
+        for (index_t i_door{}; i_door < std::size(doors); ++i_door)
+        {
+            write16(roomBank | std::uint32_t(doorListPointer + i_door * 2), nextDoorAddress & 0xFFFF);
+            write16(nextDoorAddress, doors[i_door]);
+            write8(nextDoorAddress + 3, i_door % 2 ? 4 : 5);
+            write8(nextDoorAddress + 4, i_door % 2 ? 0xE : 1);
+            write8(nextDoorAddress + 5, 6);
+            write16(nextDoorAddress + 8, 0x8000);
+            nextDoorAddress += doorSize;
+        }
+    }
+
+    void save(const std::filesystem::path& filepath) const
+    {
+        std::ofstream file(filepath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(std::data(rom)), std::streamsize(std::size(rom)));
+        if (!file)
+            throw std::runtime_error(LOG_INFO "Failed to write fixture ROM "s + filepath.string());
+    }
+};
+
+std::filesystem::path writeFixtureRom(const std::filesystem::path& directory, n_t n_rooms, n_t romSize)
+try
+{
+    if (n_rooms == 0 || n_rooms > maxRooms)
+        throw std::runtime_error(LOG_INFO "Fixture ROMs have 1 to "s + std::to_string(maxRooms) + " rooms, not "s + std::to_string(n_rooms));
+
+    if (romSize < LoRomMapping::toPc(levelDataAddress) || romSize > LoRomMapping::romSizeLimit || romSize % 0x8000)
+        throw std::runtime_error(LOG_INFO "Invalid fixture ROM size "s + toHexString(romSize, 3));
+
+    FixtureWriter writer(romSize);
+
+    // Internal header. `identifyGame` goes by the title
+    const std::string_view title("Super Metroid fixture"sv);
+    writer.write(0x80'FFC0, std::span(reinterpret_cast<const std::uint8_t*>(std::data(title)), std::size(title)));
+    writer.write8(0x80'FFD5, 0x30);
+    writer.write8(0x80'FFD7, unsigned(std::bit_width(romSize / 0x400) - 1));
+
+    // Every tileset uses the same graphics
+    const std::vector<std::uint8_t> creTiles(compress(makeTiles4bpp(n_creTiles, 1)));
+    if (std::size(creTiles) > creTileTableAddress - creTilesAddress)
+        throw std::runtime_error(LOG_INFO "Fixture common tiles compressed to "s + toHexString(std::size(creTiles), 2) + " bytes, which overruns the common tile table"s);
+
+    writer.write(creTilesAddress, creTiles);
+    writer.write(creTileTableAddress, compress(makeTileTable(n_creMetatiles, 2)));
+    writer.write(tileTableAddress, compress(makeTileTable(n_sceMetatiles, 3)));
+    writer.write(tilesAddress, compress(makeTiles4bpp(n_sceTiles, 4)));
+    writer.write(paletteAddress, compress(makePalette(0x80, 5)));
+    for (index_t i_tileset{}; i_tileset < n_tilesets; ++i_tileset)
+    {
+        const std::uint32_t entry(tilesetTableAddress + std::uint32_t(i_tileset) * 9);
+        writer.write24(entry, tileTableAddress);
+        writer.write24(entry + 3, tilesAddress);
+        writer.write24(entry + 6, paletteAddress);
+    }
+
+    // Room i links to rooms i - 1 and i + 1
+    const auto roomAddress([](index_t i_room) -> std::uint16_t
+    {
+        return i_room == 0 ? landingSiteAddress : std::uint16_t(firstRoomAddress + (i_room - 1) * roomSpacing);
+    });
+
+    Random random(6);
+    std::uint32_t nextDoorAddress(doorBank | 0x8000);
+    for (index_t i_room{}; i_room < n_rooms; ++i_room)
+    {
+        std::vector<std::uint16_t> doors;
+        if (i_room + 1 < n_rooms)
+            doors.push_back(roomAddress(i_room + 1));
+
+        if (i_room > 0)
+            doors.push_back(roomAddress(i_room - 1));
+
+        const n_t width(random() % 4 + 1), height(random() % 2 + 1);
+        writer.writeRoom(roomAddress(i_room), i_room, width, height, doors, nextDoorAddress, std::uint32_t(random()));
+    }
+
+    writer.writeRoom(ceresAddress, n_rooms, 1, 1, {}, nextDoorAddress, std::uint32_t(random()));
+
+    std::filesystem::create_directories(directory);
+    const std::filesystem::path filepath(directory / ("fixture_"s + std::to_string(n_rooms) + "_rooms_"s + std::to_string(romSize / 0x400) + "_KiB.sfc"s));
+    writer.save(filepath);
+    return filepath;
+}
+LOG_RETHROW
@@ -0,0 +1,25 @@
+module;
+
+#include "../global.h"
+
+export module benchmark_fixtures;
+
+// Synthetic data shaped like the game's, generated rather than taken from a ROM so there's no copyrighted data in it.
+// Generation is deterministic: the same arguments always give the same bytes, so results are comparable between runs and machines
+
+// Runs, repeated sequences and noise in about the proportions of level data and tile tables, so it compresses about as well as they do
+export std::vector<std::uint8_t> makeCompressibleBytes(n_t size, std::uint32_t seed);
+
+// SNES 4bpp planar tiles, 20h bytes each. Most tiles are small edits of earlier ones, as in real tilesets
+export std::vector<std::uint8_t> makeTiles4bpp(n_t n_tiles, std::uint32_t seed);
+
+// Little endian BGR555
+export std::vector<std::uint8_t> makePalette(n_t n_colours, std::uint32_t seed);
+
+// Level data in the uncompressed format `LevelData` reads, with layer 2. `width` and `height` are in screens. Terrain of solid ground, walls and platforms over air
+export std::vector<std::uint8_t> makeLevelData(n_t width, n_t height, std::uint32_t seed);
+
+// A LoROM with a Super Metroid style header, a full tileset table, and `n_rooms` rooms of 1 to 8 screens linked by doors in a chain from the Landing Site room ($91F8).
+// The Ceres room ($DF45) is included as `findRooms` starts there too. `romSize` is in bytes and is at least 200000h (the common tiles are in bank $B9).
+// Written to `directory`, returns its path
+export std::filesystem::path writeFixtureRom(const std::filesystem::path& directory, n_t n_rooms, n_t romSize = 0x40'0000);
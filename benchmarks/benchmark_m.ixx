@@ -0,0 +1,68 @@
+module;
+
+#include "../global.h"
+
+export module benchmark;
+
+// The work timed for one size. Returns something computed from its output, which is folded into a checksum so the work can't be optimised away
+export using BenchmarkBody = std::function<std::uint64_t()>;
+
+export struct BenchmarkCase
+{
+    std::string name;
+
+    // What the size counts, e.g. bytes or rooms
+    std::string unit;
+
+    std::vector<n_t> sizes;
+
+    // Untimed. Builds the input for the size and returns the timed body
+    std::function<BenchmarkBody(n_t size)> setUp;
+};
+
+export struct BenchmarkResult
+{
+    std::string name;
+    n_t size;
+    std::string unit;
+    n_t n_iterations;
+
+    // Median over the samples, per iteration
+    double nanoseconds;
+
+    double nanosecondsPerUnit() const noexcept;
+};
+
+export struct BenchmarkOptions
+{
+    // Each sample runs the body at least this long, after one untimed warm up run
+    std::chrono::milliseconds minSampleTime{20};
+    n_t n_samples{5};
+
+    // Only cases whose name contains this are run
+    std::string filter;
+};
+
+export std::vector<BenchmarkResult> runBenchmarks(std::span<const BenchmarkCase> cases, const BenchmarkOptions& options, std::ostream& progress);
+
+// One object per result, so baselines diff line by line
+export void writeBenchmarkJson(std::ostream& out, std::span<const BenchmarkResult> results);
+
+// Reads what `writeBenchmarkJson` writes, whitespace and key order don't matter. Unknown keys are ignored
+export std::vector<BenchmarkResult> readBenchmarkJson(std::istream& in);
+
+export struct BenchmarkComparison
+{
+    std::string name;
+    n_t size;
+
+    // Nanoseconds per iteration. Missing results are NaN
+    double baseline, current;
+
+    bool isRegression;
+};
+
+// A result is a regression if it's slower than its baseline by more than `threshold` percent. Results missing from either side are listed but never regressions
+export std::vector<BenchmarkComparison> compareBenchmarks(std::span<const BenchmarkResult> baseline, std::span<const BenchmarkResult> current, double threshold);
+
+export void writeBenchmarkComparison(std::ostream& out, std::span<const BenchmarkComparison> comparisons);
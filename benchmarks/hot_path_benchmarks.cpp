@@ -0,0 +1,439 @@
+#include "../global.h"
+
+import hot_path_benchmarks;
+
+import address_mapping;
+import benchmark_fixtures;
+import block_search;
+import compress;
+import config;
+import decompress;
+import game_traits;
+import os_linux;
+import progressive_room;
+import room_renderer;
+import scene_preview;
+import snes_graphics;
+import string;
+import window;
+
+// Most benchmarks that need a ROM use one of this many rooms, the size of the game
+static const n_t n_fixtureRooms(0x100);
+
+static BenchmarkCase configBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"config/save-load"s, "files"s, {8, 64, 512}, [=](n_t size) -> BenchmarkBody
+    {
+        auto p_config(std::make_shared<Config>(workDirectory));
+        for (index_t i{}; i < size; ++i)
+            p_config->recentFiles.push_back(workDirectory / "roms"s / ("hack "s + std::to_string(i) + ".sfc"s));
+
+        return [p_config, workDirectory]()
+        {
+            p_config->save();
+            Config loaded(workDirectory);
+            loaded.load();
+            return std::uint64_t(std::size(loaded.recentFiles));
+        };
+    }};
+}
+
+static BenchmarkCase utfBenchmark()
+{
+    return {"string/utf8-round-trip"s, "bytes"s, {0x100, 0x4000, 0x40000}, [](n_t size) -> BenchmarkBody
+    {
+        // Mostly ASCII, as paths and ROM names are, with two, three and four byte sequences
+        static const std::string_view pieces[]{"Metroid"sv, " "sv, "\xC3\xA9"sv, "\xE3\x83\xA1\xE3\x83\x88"sv, "\xF0\x9F\x9A\x80"sv, "/roms/"sv};
+        std::string text;
+        for (index_t i{}; std::size(text) < size; ++i)
+            text += pieces[i * 7 % std::size(pieces)];
+
+        return [text]()
+        {
+            return std::uint64_t(std::size(toString(toWstring(text))));
+        };
+    }};
+}
+
+// Finds the target menu as the Windows backend does for a menu command, walking the tree from the root with a stack.
+// Submenus are numbered in the order the walk visits them, standing in for their menu handles
+static Menu& findMenu(Menu& root, index_t i_target)
+{
+    std::stack<Menu*> menus;
+    menus.push(&root);
+    for (index_t i_menu{};; ++i_menu)
+    {
+        Menu* const p_menu(menus.top());
+        if (i_menu == i_target)
+            return *p_menu;
+
+        menus.pop();
+        for (MenuEntry& entry : p_menu->entries)
+            if (entry.isSubmenu())
+                menus.push(&entry.asSubmenu());
+
+        if (std::empty(menus))
+            throw std::runtime_error(LOG_INFO "Menu "s + std::to_string(i_target) + " not found"s);
+    }
+}
+
+static BenchmarkCase menuBenchmark()
+{
+    return {"menu/dispatch"s, "items"s, {0x10, 0x100, 0x1000}, [](n_t size) -> BenchmarkBody
+    {
+        struct Dispatch
+        {
+            Linux os;
+            Window window{os};
+            std::uint64_t n_actions{};
+
+            // Submenu number and entry index of each command sent
+            std::vector<std::pair<index_t, index_t>> commands;
+        };
+
+        // Eight entries per menu, leaves first so submenus go as deep as the size needs
+        auto p_dispatch(std::make_shared<Dispatch>());
+        const n_t n_entriesPerMenu(8);
+        p_dispatch->window.menu.emplace();
+        std::vector<Menu*> menus{&*p_dispatch->window.menu};
+        n_t n_items{};
+        for (index_t i_menu{}; n_items < size; ++i_menu)
+            for (index_t i_entry{}; i_entry < n_entriesPerMenu && n_items < size; ++i_entry)
+            {
+                const bool isSubmenu(i_entry + 1 == n_entriesPerMenu && n_items + n_entriesPerMenu < size);
+                MenuEntry& entry(menus[i_menu]->entries.emplace_back(isSubmenu ? MenuEntry::makeSubmenu() : MenuEntry::makeItem()));
+                entry.text = "Entry "s + std::to_string(i_entry);
+                if (isSubmenu)
+                {
+                    menus.push_back(&entry.asSubmenu());
+                    continue;
+                }
+
+                entry.asItem().action = [p_n_actions = &p_dispatch->n_actions](Window&)
+                {
+                    ++*p_n_actions;
+                };
+
+                ++n_items;
+            }
+
+        // Commands for every item, in a scattered order. Walk order numbers the submenus by their depth in the tree, as they're chained
+        std::mt19937 random(0);
+        for (index_t i_menu{}; i_menu < std::size(menus); ++i_menu)
+            for (index_t i_entry{}; i_entry < std::size(menus[i_menu]->entries); ++i_entry)
+                if (!menus[i_menu]->entries[i_entry].isSubmenu())
+                    p_dispatch->commands.push_back({i_menu, i_entry});
+
+        std::ranges::shuffle(p_dispatch->commands, random);
+        return [p_dispatch]()
+        {
+            for (const auto& [i_menu, i_entry] : p_dispatch->commands)
+                findMenu(*p_dispatch->window.menu, i_menu).entries[i_entry].asItem().action(p_dispatch->window);
+
+            return p_dispatch->n_actions;
+        };
+    }};
+}
+
+static BenchmarkCase mappingBenchmark()
+{
+    return {"mapping/lorom-to-pc"s, "addresses"s, {0x1000, 0x10000, 0x100000}, [](n_t size) -> BenchmarkBody
+    {
+        // One in sixteen is invalid, as a fuzzy pointer scan would see
+        struct Mapping
+        {
+            std::vector<std::uint32_t> addresses;
+            std::vector<index_t> pcAddresses;
+            std::vector<std::uint64_t> invalid;
+        };
+
+        auto p_mapping(std::make_shared<Mapping>());
+        std::mt19937 random(0);
+        for (index_t i{}; i < size; ++i)
+            p_mapping->addresses.push_back(random() % 0x10 ? std::uint32_t(0x80'8000 | random() % 0x80 << 16 | random() % 0x8000) : std::uint32_t((random() % 0x100'0000) & ~0x8000u));
+
+        p_mapping->pcAddresses.resize(size);
+        p_mapping->invalid.resize(invalidMaskSize(size));
+        return [p_mapping]()
+        {
+            LoRomMapping::toPc(p_mapping->addresses, p_mapping->pcAddresses, p_mapping->invalid, 0x40'0000);
+            return std::uint64_t(p_mapping->pcAddresses.back() + std::accumulate(std::begin(p_mapping->invalid), std::end(p_mapping->invalid), std::uint64_t{}, std::bit_xor()));
+        };
+    }};
+}
+
+static BenchmarkCase romValidationBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"rom/load-and-validate"s, "bytes"s, {0x20'0000, 0x30'0000, 0x40'0000}, [=](n_t size) -> BenchmarkBody
+    {
+        // Loading, identifying, and finding which addresses of the room bank could be room headers, as opening a ROM does
+        const std::filesystem::path filepath(writeFixtureRom(workDirectory, 0x10, size));
+        return [filepath]()
+        {
+            const Rom rom(filepath);
+            std::uint64_t ret(identifyGame(rom.bytes()).has_value());
+            for (std::uint32_t address(0x8000); address <= 0xFFFF; ++address)
+                ret += Room::isValid(rom, std::uint16_t(address));
+
+            return ret;
+        };
+    }};
+}
+
+static BenchmarkCase decompressBenchmark()
+{
+    return {"rom/decompress"s, "bytes"s, {0x400, 0x2000, 0x10000}, [](n_t size) -> BenchmarkBody
+    {
+        const std::vector<std::uint8_t> compressed(compress(makeCompressibleBytes(size, 0)));
+        return [compressed]()
+        {
+            return std::uint64_t(std::size(decompress(compressed).data));
+        };
+    }};
+}
+
+static BenchmarkCase compressBenchmark()
+{
+    return {"rom/compress"s, "bytes"s, {0x400, 0x2000, 0x10000}, [](n_t size) -> BenchmarkBody
+    {
+        const std::vector<std::uint8_t> data(makeCompressibleBytes(size, 0));
+        return [data]()
+        {
+            return std::uint64_t(std::size(compress(data)));
+        };
+    }};
+}
+
+static BenchmarkCase tileDecodeBenchmark()
+{
+    return {"graphics/decode-tiles-4bpp"s, "tiles"s, {0x40, 0x400, 0x2000}, [](n_t size) -> BenchmarkBody
+    {
+        const std::vector<std::uint8_t> tiles(makeTiles4bpp(size, 0));
+        return [tiles]()
+        {
+            return std::uint64_t(decodeTiles4bpp(tiles).back());
+        };
+    }};
+}
+
+static BenchmarkCase paletteBenchmark()
+{
+    return {"graphics/palette-round-trip"s, "colours"s, {0x10, 0x80, 0x1000}, [](n_t size) -> BenchmarkBody
+    {
+        // Decoding for display and reducing back to BGR555, as a palette edit does
+        const std::vector<std::uint8_t> palette(makePalette(size, 0));
+        return [palette]()
+        {
+            std::uint64_t ret{};
+            for (const Pixel& pixel : decodePalette(palette))
+                ret += pixelToBgr555(pixel);
+
+            return ret;
+        };
+    }};
+}
+
+static BenchmarkCase renderBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"graphics/render-room"s, "screens"s, {1, 8, 32}, [=](n_t size) -> BenchmarkBody
+    {
+        // Rooms twice as wide as they're high, rendered a screen at a time
+        struct Render
+        {
+            Tileset tileset;
+            LevelData levelData;
+            Image screen;
+        };
+
+        const n_t height(std::max(n_t(std::sqrt(double(size) / 2)), n_t(1))), width(size / height);
+        const std::vector<std::uint8_t> levelData(makeLevelData(width, height, 0));
+        const n_t n_blocks(width * height * screenSize * screenSize);
+        const std::span<const std::uint8_t> blocks(std::span(levelData).subspan(2));
+        const Rom rom(writeFixtureRom(workDirectory, 0x10));
+        auto p_render(std::make_shared<Render>
+        (
+            Tileset(rom, 0),
+            LevelData(width * screenSize, height * screenSize, blocks.first(n_blocks * 2), blocks.subspan(n_blocks * 2, n_blocks), blocks.subspan(n_blocks * 3)),
+            Image(screenSize * blockSize, screenSize * blockSize)
+        ));
+
+        return [p_render, width, height]()
+        {
+            const RoomRenderer renderer(p_render->tileset, p_render->levelData);
+            std::uint64_t ret{};
+            for (index_t y_screen{}; y_screen < height; ++y_screen)
+                for (index_t x_screen{}; x_screen < width; ++x_screen)
+                {
+                    renderer.renderScreen(x_screen, y_screen, p_render->screen);
+                    ret += p_render->screen.data()[x_screen + y_screen].r;
+                }
+
+            return ret;
+        };
+    }};
+}
+
+static BenchmarkCase firstScreenBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"graphics/progressive-first-screen"s, "screens"s, {1, 8, 32}, [=](n_t size) -> BenchmarkBody
+    {
+        // Time from starting a room load to the screen in view being published, which shouldn't grow with the size of the room
+        struct Load
+        {
+            Tileset tileset;
+            std::vector<std::uint8_t> compressed;
+        };
+
+        const n_t height(std::max(n_t(std::sqrt(double(size) / 2)), n_t(1))), width(size / height);
+        const Rom rom(writeFixtureRom(workDirectory, 0x10));
+        auto p_load(std::make_shared<const Load>(Tileset(rom, 0), compress(makeLevelData(width, height, 0))));
+        return [p_load, width, height]()
+        {
+            std::promise<void> shown;
+            std::atomic_flag isShown;
+            ProgressiveRoomLoad load(p_load->tileset, p_load->compressed, width, height, RoomViewport{0, 0, 0x100, 0xE0}, {}, [&](index_t, index_t, bool)
+            {
+                if (!isShown.test_and_set())
+                    shown.set_value();
+            });
+
+            shown.get_future().wait();
+            return std::uint64_t(load.screen(0, 0).p_image != nullptr);
+        };
+    }};
+}
+
+static BenchmarkCase sceneComposeBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"graphics/scene-compose"s, "frames"s, {1, 60, 600}, [=](n_t size) -> BenchmarkBody
+    {
+        // Composing the frames of a camera sweep through a 4x2 screen room with layer 2 at half speed, after the layers are rendered once
+        struct Scene
+        {
+            Tileset tileset;
+            LevelData levelData;
+            std::optional<ScenePreview> preview;
+            Image frame;
+        };
+
+        const n_t width(4), height(2);
+        const std::vector<std::uint8_t> levelData(makeLevelData(width, height, 0));
+        const n_t n_blocks(width * height * screenSize * screenSize);
+        const std::span<const std::uint8_t> blocks(std::span(levelData).subspan(2));
+        const Rom rom(writeFixtureRom(workDirectory, 0x10));
+        auto p_scene(std::make_shared<Scene>
+        (
+            Tileset(rom, 0),
+            LevelData(width * screenSize, height * screenSize, blocks.first(n_blocks * 2), blocks.subspan(n_blocks * 2, n_blocks), blocks.subspan(n_blocks * 3)),
+            std::nullopt,
+            Image(0x100, 0xE0)
+        ));
+
+        p_scene->preview.emplace(p_scene->tileset, p_scene->levelData, ParallaxRates{0x80, 0x80});
+        std::vector<CameraPosition> path(p_scene->preview->sweep(4));
+        path.resize(std::min(size, std::size(path)));
+        return [p_scene, path]()
+        {
+            std::uint64_t ret{};
+            for (const CameraPosition& camera : path)
+            {
+                p_scene->preview->compose(camera, p_scene->frame);
+                ret += p_scene->frame.data()[0x80].r;
+            }
+
+            return ret;
+        };
+    }};
+}
+
+static BenchmarkCase findRoomsBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"scan/find-rooms"s, "rooms"s, {0x10, 0x40, n_fixtureRooms}, [=](n_t size) -> BenchmarkBody
+    {
+        auto p_rom(std::make_shared<const Rom>(writeFixtureRom(workDirectory, size)));
+        return [p_rom]()
+        {
+            return std::uint64_t(std::size(findRooms(*p_rom)));
+        };
+    }};
+}
+
+static BenchmarkCase blockSearchBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"scan/block-search"s, "rooms"s, {0x10, 0x40, n_fixtureRooms}, [=](n_t size) -> BenchmarkBody
+    {
+        // A door in a wall: decompressing every room's level data and matching over all of it
+        struct Search
+        {
+            Rom rom;
+            BlockPattern pattern;
+        };
+
+        auto p_search(std::make_shared<const Search>(Rom(writeFixtureRom(workDirectory, size)), parseBlockPattern("8???:?? 9???:??"sv)));
+        return [p_search]()
+        {
+            std::uint64_t n_matches{};
+            findBlockPattern(p_search->rom, p_search->pattern, [&](const BlockMatch& match)
+            {
+                n_matches += match.x + match.y;
+            });
+
+            return n_matches;
+        };
+    }};
+}
+
+static BenchmarkCase corruptBlockSearchBenchmark(const std::filesystem::path& workDirectory)
+{
+    return {"scan/block-search-corrupt"s, "rooms"s, {0x10, 0x40, n_fixtureRooms}, [=](n_t size) -> BenchmarkBody
+    {
+        // As scan/block-search with every other room's level data corrupted, a copy from before the start of the output.
+        // Should take no longer than the clean search, as bad level data is reported without exceptions
+        struct Search
+        {
+            Rom rom;
+            BlockPattern pattern;
+        };
+
+        auto p_search(std::make_shared<Search>(Rom(writeFixtureRom(workDirectory, size)), parseBlockPattern("8???:?? 9???:??"sv)));
+        const std::uint8_t corruption[]{0xC0, 0x10};
+        const std::vector<Room> rooms(findRooms(p_search->rom));
+        for (index_t i_room{}; i_room < std::size(rooms); i_room += 2)
+            p_search->rom.write(rooms[i_room].defaultState().levelDataPointer, corruption);
+
+        return [p_search]()
+        {
+            std::uint64_t n_matches{};
+            const BlockSearchResult result(findBlockPattern(p_search->rom, p_search->pattern, [&](const BlockMatch& match)
+            {
+                n_matches += match.x + match.y;
+            }));
+
+            return n_matches + result.n_levelDataFailed;
+        };
+    }};
+}
+
+std::vector<BenchmarkCase> makeHotPathBenchmarks(const std::filesystem::path& workDirectory)
+try
+{
+    return
+    {
+        configBenchmark(workDirectory),
+        utfBenchmark(),
+        menuBenchmark(),
+        mappingBenchmark(),
+        romValidationBenchmark(workDirectory),
+        decompressBenchmark(),
+        compressBenchmark(),
+        tileDecodeBenchmark(),
+        paletteBenchmark(),
+        renderBenchmark(workDirectory),
+        firstScreenBenchmark(workDirectory),
+        sceneComposeBenchmark(workDirectory),
+        findRoomsBenchmark(workDirectory),
+        blockSearchBenchmark(workDirectory),
+        corruptBlockSearchBenchmark(workDirectory)
+    };
+}
+LOG_RETHROW
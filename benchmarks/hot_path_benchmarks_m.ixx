@@ -0,0 +1,10 @@
+module;
+
+#include "../global.h"
+
+export module hot_path_benchmarks;
+
+export import benchmark;
+
+// Every hot path, each at a few sizes from a small edit to a whole game's worth. Fixture ROMs and the config file are written under `workDirectory`
+export std::vector<BenchmarkCase> makeHotPathBenchmarks(const std::filesystem::path& workDirectory);
@@ -0,0 +1,110 @@
+#include "../global.h"
+
+#include <cstdlib> // for EXIT_FAILURE
+
+import hot_path_benchmarks;
+
+static void printUsage(std::ostream& out)
+try
+{
+    out <<
+        "Usage: benchmarks [options]\n"
+        "    Runs every benchmark at each of its sizes and prints the median time per run.\n"
+        "    --json <file>              Write the results as JSON, for use as a baseline\n"
+        "    --compare <file>           Compare against a baseline written by --json, exits with failure if anything regressed\n"
+        "    --threshold <percent>      How much slower than the baseline counts as a regression (default 10)\n"
+        "    --filter <text>            Only run benchmarks whose name contains the text\n"
+        "    --min-time <milliseconds>  Minimum time of each sample (default 20)\n"
+        "    --samples <n>              Samples per size, the median is reported (default 5)\n"
+        "    --work-dir <directory>     Where fixture ROMs and debug logs are written (default a directory under the system temporary directory)\n"
+        "    --list                     List the benchmarks and their sizes without running them\n";
+}
+LOG_RETHROW
+
+int main(int argc, char* argv[])
+try
+{
+    const std::vector<std::string> arguments(argv + 1, argv + argc);
+    BenchmarkOptions options;
+    std::optional<std::filesystem::path> jsonPath, baselinePath;
+    std::filesystem::path workDirectory(std::filesystem::temp_directory_path() / "metroid_level_editor_benchmarks"s);
+    double threshold(10);
+    bool isList{};
+    for (index_t i{}; i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        const bool hasValue(i + 1 < std::size(arguments));
+        if (argument == "--json"sv && hasValue)
+            jsonPath = arguments[++i];
+        else if (argument == "--compare"sv && hasValue)
+            baselinePath = arguments[++i];
+        else if (argument == "--threshold"sv && hasValue)
+            threshold = std::stod(arguments[++i]);
+        else if (argument == "--filter"sv && hasValue)
+            options.filter = arguments[++i];
+        else if (argument == "--min-time"sv && hasValue)
+            options.minSampleTime = std::chrono::milliseconds(std::stoul(arguments[++i]));
+        else if (argument == "--samples"sv && hasValue)
+            options.n_samples = std::stoul(arguments[++i]);
+        else if (argument == "--work-dir"sv && hasValue)
+            workDirectory = arguments[++i];
+        else if (argument == "--list"sv)
+            isList = true;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::filesystem::create_directories(workDirectory);
+    DebugFile::init(workDirectory);
+
+    const std::vector<BenchmarkCase> cases(makeHotPathBenchmarks(workDirectory));
+    if (isList)
+    {
+        for (const BenchmarkCase& benchmarkCase : cases)
+        {
+            std::cout << benchmarkCase.name << " ("s << benchmarkCase.unit << "):"s;
+            for (n_t size : benchmarkCase.sizes)
+                std::cout << ' ' << size;
+
+            std::cout << '\n';
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Read the baseline first so a bad path fails before the benchmarks run
+    std::vector<BenchmarkResult> baseline;
+    if (baselinePath)
+    {
+        std::ifstream in(*baselinePath);
+        if (!in)
+            throw std::runtime_error(LOG_INFO "Failed to open baseline "s + baselinePath->string());
+
+        baseline = readBenchmarkJson(in);
+    }
+
+    const std::vector<BenchmarkResult> results(runBenchmarks(cases, options, std::cout));
+    if (jsonPath)
+    {
+        std::ofstream out(*jsonPath);
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        writeBenchmarkJson(out, results);
+    }
+
+    if (!baselinePath)
+        return EXIT_SUCCESS;
+
+    const std::vector<BenchmarkComparison> comparisons(compareBenchmarks(baseline, results, threshold));
+    std::cout << '\n';
+    writeBenchmarkComparison(std::cout, comparisons);
+    return std::ranges::any_of(comparisons, &BenchmarkComparison::isRegression) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    DebugFile(DebugFile::error) << LOG_INFO << e.what() << '\n';
+    return EXIT_FAILURE;
+}
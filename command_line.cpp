@@ -0,0 +1,775 @@
+#include "global.h"
+
+#include <cstdlib> // for EXIT_SUCCESS, EXIT_FAILURE
+
+import command_line;
+
+import batch_edit;
+import block_search;
+import dispatch_benchmark;
+import memory_soak;
+import png;
+import room_export;
+import scene_animation;
+import sm_music;
+import sm_reachability;
+import sm_rom_diff;
+import tile_import;
+import tileset_optimiser;
+import wav;
+import world_map;
+
+static void printUsage(std::ostream& out)
+try
+{
+    out <<
+        "Usage:\n"
+        "    --export-rooms <ROM> <output directory> [options]\n"
+        "        Renders every room to PNG.\n"
+        "        --bts          Overlay block types and BTS\n"
+        "        --no-layer1    Don't draw layer 1\n"
+        "        --no-layer2    Don't draw layer 2\n"
+        "        --all-states   Export every room state rather than only the default state\n"
+        "        --sprites      Draw enemies and PLMs\n"
+        "        --level <n>    PNG compression level, 1 (fastest, default) to 9\n"
+        "        --no-cache     Don't use or fill the decompressed asset cache\n"
+        "    --world-map <ROM> <output directory> [options]\n"
+        "        Renders the whole game to a zoomable tile pyramid, <zoom>/<x>/<y>.png.\n"
+        "        Running it again on the same directory only regenerates tiles covering changed rooms.\n"
+        "        --bts          Overlay block types and BTS\n"
+        "        --no-layer1    Don't draw layer 1\n"
+        "        --no-layer2    Don't draw layer 2\n"
+        "        --level <n>    PNG compression level, 1 (fastest, default) to 9\n"
+        "        --no-cache     Don't use or fill the decompressed asset cache\n"
+        "    --find-blocks <ROM> <pattern file>\n"
+        "        Lists every room containing a block pattern. A pattern file has a row of cells per line, each cell being\n"
+        "        a block and BTS in hex, BBBB:TT, where ? matches any digit.\n"
+        "    --replace-blocks <ROM> <pattern file> <replacement file> <output ROM>\n"
+        "        Replaces every match of a block pattern, ? digits in the replacement are left as they were.\n"
+        "    --reachability <ROM> [items]\n"
+        "        Lists the rooms and items reachable from the Landing Site with the given items, any of:\n"
+        "        morph bombs spring hijump space screw speed grapple varia gravity\n"
+        "        charge ice wave spazer plasma missiles supers powerbombs\n"
+        "    --diff <old ROM> <new ROM> [options]\n"
+        "        Lists what changed between two ROMs: rooms, populations and tileset data found through the pointer tables,\n"
+        "        moved blocks, and any other changed bytes.\n"
+        "        --no-cache     Don't use or fill the decompressed asset cache\n"
+        "    --batch <edit script> <output directory> <ROM>... [options]\n"
+        "        Applies an edit script to every ROM in parallel, writing the edited ROMs and batch_report.txt to the output directory.\n"
+        "        Each line of the script is a step, numbers are hex:\n"
+        "            blocks <room> <state> <x> <y> <width> <height> <BBBB:TT>\n"
+        "            room <room> <field> <value>           (mapX mapY upScroller downScroller creFlags doorList)\n"
+        "            state <room> <state> <field> <value>  (levelData tileset music musicTrack fx enemyPopulation enemyGraphics\n"
+        "                                                   layer2ScrollX layer2ScrollY scroll specialXray mainAsm plmPopulation\n"
+        "                                                   libraryBackground setupAsm)\n"
+        "            import <address> <file>\n"
+        "            import-compressed <address> <file>\n"
+        "        <state> is a state index or \"default\". A step that fails is rolled back.\n"
+        "        --keep-going   Write ROMs that had steps fail, without those steps\n"
+        "        --no-cache     Don't use or fill the decompressed asset cache\n"
+        "    --export-samples <ROM> <output directory>\n"
+        "        Decodes every instrument sample of the engine and of each room's music to WAV, sample_<music data>_<index>.wav,\n"
+        "        and draws their waveforms to samples.png.\n"
+        "    --import-tiles <PNG> <output prefix> [options]\n"
+        "        Converts an image to deduplicated 4bpp tiles, a tile table and palettes,\n"
+        "        written to <output prefix>.tiles, <output prefix>.tilemap and <output prefix>.pal.\n"
+        "        --gba                 GBA tiles and tile table entries rather than SNES\n"
+        "        --palettes <n>        Number of palettes to fit the colours to (default 8 for SNES, 10h for GBA)\n"
+        "        --first-tile <n>      Tile number of the first tile in the tile table entries (hex)\n"
+        "        --first-palette <n>   Palette number of the first palette in the tile table entries (hex)\n"
+        "        --no-flip             Don't dedupe flipped tiles\n"
+        "    --optimise-tilesets <ROM> [output ROM] [options]\n"
+        "        Finds duplicate and unused tileset specific tiles and metatiles and reports the bytes that merging\n"
+        "        and clearing them saves after recompression. Writes the optimised ROM if an output ROM is given.\n"
+        "        Metatiles drawn by PLMs are kept. Metatiles only drawn by enemy or boss code or used by rooms not reachable through doors\n"
+        "        count as unused, so clearing is opt-in.\n"
+        "        --no-tile-merge       Don't merge duplicate tiles\n"
+        "        --no-metatile-merge   Don't merge duplicate metatiles\n"
+        "        --drop-unused         Clear unused tiles and metatiles\n"
+        "    --preview-scene <ROM> <room> [output directory] [options]\n"
+        "        Sweeps a camera through a room (hex address) at 60 frames a second, composing each frame from layers rendered once,\n"
+        "        with layer 2 scrolling at its parallax rate. Writes the frames to frame_<n>.png if an output directory is given.\n"
+        "        --state <n>          Room state index, rather than the default state\n"
+        "        --parallax <x> <y>   Layer 2 scroll rates in 1/100h of layer 1's (hex), rather than the room state's\n"
+        "        --speed <n>          Camera speed in pixels a frame (default 4)\n"
+        "        --frames <n>         Stop after this many frames\n"
+        "        --level <n>          PNG compression level, 1 (fastest, default) to 9\n"
+        "        --no-cache           Don't use or fill the decompressed asset cache\n"
+        "    --benchmark-dispatch\n"
+        "        Times per game hot loops compiled from game traits against a runtime switch on the game.\n"
+        "    --memory-soak <ROM> [loads] [options]\n"
+        "        Loads every room in turn into the memory arenas as the editor does, 100000 loads by default, and reports live memory as it goes.\n"
+        "        --samples <n>  Number of times memory is sampled (default 10)\n"
+        "        --no-cache     Don't use or fill the decompressed asset cache\n"
+        "    --help\n"
+        "        Shows this message.\n"s;
+}
+LOG_RETHROW
+
+static int exportRoomsCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path romPath(arguments[0]);
+    RoomExportOptions options;
+    options.outputDirectory = arguments[1];
+    bool isCached(true);
+    for (index_t i(2); i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        if (argument == "--bts"sv)
+            options.renderOptions.bts = true;
+        else if (argument == "--no-layer1"sv)
+            options.renderOptions.layer1 = false;
+        else if (argument == "--no-layer2"sv)
+            options.renderOptions.layer2 = false;
+        else if (argument == "--all-states"sv)
+            options.allStates = true;
+        else if (argument == "--sprites"sv)
+            options.sprites = true;
+        else if (argument == "--level"sv && i + 1 < std::size(arguments))
+            options.compressionLevel = unsigned(std::stoul(arguments[++i]));
+        else if (argument == "--no-cache"sv)
+            isCached = false;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto startTime(std::chrono::steady_clock::now());
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        options.p_assetCache = &assetCache.emplace(os, os.getCacheDirectory());
+
+    const Rom rom(romPath);
+    const RoomExportResult result(exportRooms(rom, options));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    std::cout << "Exported "s << result.n_exported << " rooms in "s << duration.count() << "ms"s;
+    if (result.n_failed)
+        std::cout << ", "s << result.n_failed << " failed (see "s << DebugFile::warning << ')';
+
+    std::cout << '\n';
+    return result.n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int worldMapCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path romPath(arguments[0]);
+    WorldMapOptions options;
+    options.outputDirectory = arguments[1];
+    bool isCached(true);
+    for (index_t i(2); i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        if (argument == "--bts"sv)
+            options.renderOptions.bts = true;
+        else if (argument == "--no-layer1"sv)
+            options.renderOptions.layer1 = false;
+        else if (argument == "--no-layer2"sv)
+            options.renderOptions.layer2 = false;
+        else if (argument == "--level"sv && i + 1 < std::size(arguments))
+            options.compressionLevel = unsigned(std::stoul(arguments[++i]));
+        else if (argument == "--no-cache"sv)
+            isCached = false;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto startTime(std::chrono::steady_clock::now());
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        options.p_assetCache = &assetCache.emplace(os, os.getCacheDirectory());
+
+    const Rom rom(romPath);
+    const WorldMapResult result(buildWorldMap(rom, options));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    std::cout
+        << result.n_roomsChanged << " rooms changed, wrote "s << result.n_tilesWritten << " tiles and removed "s << result.n_tilesRemoved
+        << " in "s << duration.count() << "ms"s;
+
+    if (result.n_roomsFailed)
+        std::cout << ", "s << result.n_roomsFailed << " rooms failed (see "s << DebugFile::warning << ')';
+
+    std::cout << '\n';
+    return result.n_roomsFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static std::string readTextFile(const std::filesystem::path& filepath)
+try
+{
+    std::ifstream in(filepath);
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+LOG_RETHROW
+
+static int findBlocksCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) != 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const BlockPattern pattern(parseBlockPattern(readTextFile(arguments[1])));
+    const auto startTime(std::chrono::steady_clock::now());
+    const Rom rom(arguments[0]);
+    const BlockSearchResult result(findBlockPattern(rom, pattern, [](const BlockMatch& match)
+    {
+        std::cout << "Room $"s << toHexString(match.roomAddress) << " state "s << match.i_state << " at "s << match.x << ", "s << match.y << '\n';
+    }));
+
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+    std::cout << result.n_matches << " matches in "s << result.n_levelDataSearched << " level data searched in "s << duration.count() << "ms"s;
+    if (result.n_levelDataFailed)
+        std::cout << ", "s << result.n_levelDataFailed << " failed (see "s << DebugFile::warning << ')';
+
+    std::cout << '\n';
+    return result.n_levelDataFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int replaceBlocksCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) != 4)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const BlockPattern pattern(parseBlockPattern(readTextFile(arguments[1])));
+    const BlockPattern replacement(parseBlockPattern(readTextFile(arguments[2])));
+    const auto startTime(std::chrono::steady_clock::now());
+    Rom rom(arguments[0]);
+    const BlockReplaceResult result(replaceBlockPattern(rom, pattern, replacement));
+    rom.save(arguments[3]);
+
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+    std::cout << "Replaced "s << result.n_matches << " matches, "s << result.n_levelDataChanged << " level data changed in "s << duration.count() << "ms"s;
+    if (result.n_levelDataFailed)
+        std::cout << ", "s << result.n_levelDataFailed << " failed (see "s << DebugFile::warning << ')';
+
+    std::cout << '\n';
+    return result.n_levelDataFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int reachabilityCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::empty(arguments))
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    ItemSet items;
+    for (const std::string& argument : arguments.subspan(1))
+    {
+        const std::optional<Item> item(findItem(argument));
+        if (!item)
+        {
+            std::cerr << "Unknown item: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+
+        items.set(index_t(*item));
+    }
+
+    const auto startTime(std::chrono::steady_clock::now());
+    const Rom rom(arguments[0]);
+    const ReachabilitySolver solver(rom, items);
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    const std::vector<std::uint16_t> rooms(solver.reachableRooms());
+    std::cout << "Reachable rooms ("s << std::size(rooms) << "):\n"s;
+    for (std::uint16_t room : rooms)
+        std::cout << "    $"s << toHexString(room) << '\n';
+
+    n_t n_reachableItems{};
+    std::cout << "Items:\n"s;
+    for (const ItemLocation& item : solver.itemLocations())
+    {
+        const bool isReachable(solver.isItemReachable(item));
+        n_reachableItems += isReachable;
+        std::cout << "    $"s << toHexString(item.plmId) << " in room $"s << toHexString(item.roomAddress) << " at "s << unsigned(item.x) << ", "s << unsigned(item.y)
+            << (isReachable ? " reachable\n"s : " unreachable\n"s);
+    }
+
+    std::cout << n_reachableItems << " items reachable, solved in "s << duration.count() << "ms ("s << solver.n_iterations() << " iterations)\n"s;
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int diffCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    bool isCached(true);
+    for (const std::string& argument : arguments.subspan(2))
+    {
+        if (argument == "--no-cache"sv)
+            isCached = false;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const Rom oldRom(arguments[0]), newRom(arguments[1]);
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        assetCache.emplace(os, os.getCacheDirectory());
+
+    const auto startTime(std::chrono::steady_clock::now());
+    const std::vector<RomChange> changes(diffRoms(oldRom, newRom, assetCache ? &*assetCache : nullptr));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    for (const RomChange& change : changes)
+        std::cout << describe(change) << '\n';
+
+    std::cout << std::size(changes) << " changes found in "s << duration.count() << "ms\n"s;
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int batchCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 3)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path scriptPath(arguments[0]);
+    BatchEditOptions options;
+    options.outputDirectory = arguments[1];
+    bool isCached(true);
+    std::vector<std::filesystem::path> romPaths;
+    for (const std::string& argument : arguments.subspan(2))
+    {
+        if (argument == "--keep-going"sv)
+            options.keepGoing = true;
+        else if (argument == "--no-cache"sv)
+            isCached = false;
+        else if (argument.starts_with("--"sv))
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+        else
+            romPaths.push_back(argument);
+    }
+
+    // The script is parsed and its imports compressed once, not per ROM
+    const auto startTime(std::chrono::steady_clock::now());
+    const std::vector<EditStep> steps(parseEditScript(readTextFile(scriptPath), scriptPath.parent_path()));
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        options.p_assetCache = &assetCache.emplace(os, os.getCacheDirectory());
+
+    const std::vector<BatchRomResult> results(batchEdit(romPaths, steps, options));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    {
+        std::ofstream report(options.outputDirectory / "batch_report.txt"s);
+        report.exceptions(std::ios::badbit | std::ios::failbit);
+        writeBatchReport(report, results);
+    }
+
+    const n_t n_saved(std::ranges::count_if(results, &BatchRomResult::isSaved));
+    std::cout << "Edited "s << n_saved << " of "s << std::size(results) << " ROMs with "s << std::size(steps) << " steps in "s << duration.count() << "ms"s;
+    if (n_saved != std::size(results))
+        std::cout << " (see "s << (options.outputDirectory / "batch_report.txt"s).string() << ')';
+
+    std::cout << '\n';
+    return n_saved == std::size(results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+LOG_RETHROW
+
+static int previewSceneCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    SceneAnimationOptions options;
+    options.roomAddress = std::uint16_t(std::stoul(arguments[1], nullptr, 0x10));
+    bool isCached(true);
+    for (index_t i(2); i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        if (argument == "--state"sv && i + 1 < std::size(arguments))
+            options.i_state = std::stoul(arguments[++i]);
+        else if (argument == "--parallax"sv && i + 2 < std::size(arguments))
+        {
+            const unsigned x(unsigned(std::stoul(arguments[i + 1], nullptr, 0x10))), y(unsigned(std::stoul(arguments[i + 2], nullptr, 0x10)));
+            options.rates = ParallaxRates{x, y};
+            i += 2;
+        }
+        else if (argument == "--speed"sv && i + 1 < std::size(arguments))
+            options.speed = std::stoul(arguments[++i]);
+        else if (argument == "--frames"sv && i + 1 < std::size(arguments))
+            options.n_maxFrames = std::stoul(arguments[++i]);
+        else if (argument == "--level"sv && i + 1 < std::size(arguments))
+            options.compressionLevel = unsigned(std::stoul(arguments[++i]));
+        else if (argument == "--no-cache"sv)
+            isCached = false;
+        else if (!argument.starts_with("--"sv) && !options.outputDirectory)
+            options.outputDirectory = argument;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        options.p_assetCache = &assetCache.emplace(os, os.getCacheDirectory());
+
+    const Rom rom(arguments[0]);
+    const SceneAnimationResult result(animateScene(rom, options));
+
+    // A frame has 1/60th of a second, composing should take a small part of that
+    const auto frameBudget(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::seconds(1)) / framesPerSecond);
+    std::cout
+        << "Layer 2 parallax "s << toHexString(result.rates.x, 2) << ", "s << toHexString(result.rates.y, 2)
+        << ", layers rendered in "s << result.prepareTime.count() << "us\n"s
+        << "Composed "s << result.n_frames << " frames ("s << result.n_frames * 1000 / framesPerSecond << "ms of animation at "s << framesPerSecond << " fps) in "s
+        << result.composeTime.count() << "us, slowest frame "s << result.slowestFrameTime.count() << "us of a "s << frameBudget.count() << "us frame\n"s;
+
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int exportSamplesCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) != 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const n_t waveformWidth(512), waveformHeight(32);
+
+    const Rom rom(arguments[0]);
+    const std::filesystem::path outputDirectory(arguments[1]);
+    std::filesystem::create_directories(outputDirectory);
+
+    const std::vector<InstrumentSample> samples(findInstrumentSamples(rom));
+    std::vector<std::span<const std::uint8_t>> brrs;
+    for (const InstrumentSample& sample : samples)
+        brrs.push_back(sample.brr);
+
+    const auto startTime(std::chrono::steady_clock::now());
+    const std::vector<DecodedSample> decoded(decodeBrrBatch(brrs, waveformWidth));
+    const auto duration(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime));
+
+    // A band per sample, each column a line from the lowest to the highest sample
+    Image waveforms(waveformWidth, waveformHeight * std::size(samples), Pixel{0, 0, 0, 0xFF});
+    for (index_t i{}; i < std::size(samples); ++i)
+    {
+        writeWav(outputDirectory / ("sample_"s + toHexString(samples[i].i_musicData) + '_' + toHexString(std::uint8_t(samples[i].i_sample)) + ".wav"s), decoded[i].pcm, brrSampleRate);
+        for (index_t x{}; x < waveformWidth; ++x)
+        {
+            const auto toY([&](std::int16_t sample)
+            {
+                return index_t((0x7FFF - sample) * (waveformHeight - 1) / 0xFFFF);
+            });
+
+            for (index_t y(toY(decoded[i].overview.maximums[x])); y <= toY(decoded[i].overview.minimums[x]); ++y)
+                waveforms.row(i * waveformHeight + y)[x] = Pixel{0x40, 0xC0, 0x40, 0xFF};
+        }
+    }
+
+    if (!std::empty(samples))
+        writePng(outputDirectory / "samples.png"s, waveforms);
+
+    std::cout << "Decoded "s << std::size(samples) << " samples in "s << duration.count() << "us\n"s;
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int importTilesCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::size(arguments) < 2)
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path imagePath(arguments[0]), outputPrefix(arguments[1]);
+    TileImportOptions options;
+    std::optional<n_t> n_palettes;
+    bool isGba{};
+    index_t i_firstTile{}, i_firstPalette{};
+    for (index_t i(2); i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        if (argument == "--gba"sv)
+            isGba = true;
+        else if (argument == "--palettes"sv && i + 1 < std::size(arguments))
+            n_palettes = std::stoul(arguments[++i], nullptr, 0x10);
+        else if (argument == "--first-tile"sv && i + 1 < std::size(arguments))
+            i_firstTile = std::stoul(arguments[++i], nullptr, 0x10);
+        else if (argument == "--first-palette"sv && i + 1 < std::size(arguments))
+            i_firstPalette = std::stoul(arguments[++i], nullptr, 0x10);
+        else if (argument == "--no-flip"sv)
+            options.isFlipDedup = false;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    options.n_palettes = n_palettes.value_or(isGba ? 0x10 : 8);
+
+    const Image image(readPng(imagePath));
+    const auto startTime(std::chrono::steady_clock::now());
+    const ImportedTiles imported(importTiles(image, options));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    const std::vector<std::uint8_t> tiles(isGba ? encodeTiles<GbaTile4bpp>(imported.tiles) : encodeTiles<SnesTile4bpp>(imported.tiles));
+    const std::vector<std::uint16_t> tileTable
+    (
+        isGba
+        ? encodeTileTable<GbaTile4bpp>(imported.tileTable, i_firstTile, i_firstPalette)
+        : encodeTileTable<SnesTile4bpp>(imported.tileTable, i_firstTile, i_firstPalette)
+    );
+
+    const auto writeFile([&](std::string extension, std::span<const std::uint8_t> data)
+    {
+        std::filesystem::path filepath(outputPrefix);
+        filepath += extension;
+        std::ofstream out(filepath, std::ios::binary);
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.write(reinterpret_cast<const char*>(std::data(data)), std::size(data));
+    });
+
+    // Tile table entries and colours are little endian
+    const auto toBytes([](std::span<const std::uint16_t> words)
+    {
+        std::vector<std::uint8_t> ret;
+        for (std::uint16_t word : words)
+        {
+            ret.push_back(std::uint8_t(word));
+            ret.push_back(std::uint8_t(word >> 8));
+        }
+
+        return ret;
+    });
+
+    std::vector<std::uint16_t> palettes;
+    for (const std::array<std::uint16_t, 0x10>& palette : imported.palettes)
+        palettes.insert(std::end(palettes), std::begin(palette), std::end(palette));
+
+    writeFile(".tiles"s, tiles);
+    writeFile(".tilemap"s, toBytes(tileTable));
+    writeFile(".pal"s, toBytes(palettes));
+
+    std::cout << "Imported "s << image.width() << 'x' << image.height() << " to "s << std::size(imported.tiles) / 0x40 << " unique tiles of "s << std::size(imported.tileTable)
+        << " and "s << std::size(imported.palettes) << " palettes in "s << duration.count() << "ms\n"s;
+
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int optimiseTilesetsCommand(std::span<const std::string> arguments)
+try
+{
+    if (std::empty(arguments))
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    TilesetOptimiseOptions options;
+    std::optional<std::filesystem::path> outputPath;
+    for (const std::string& argument : arguments.subspan(1))
+    {
+        if (argument == "--no-tile-merge"sv)
+            options.mergeTiles = false;
+        else if (argument == "--no-metatile-merge"sv)
+            options.mergeMetatiles = false;
+        else if (argument == "--drop-unused"sv)
+            options.dropUnused = true;
+        else if (!argument.starts_with("--"sv) && !outputPath)
+            outputPath = argument;
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto startTime(std::chrono::steady_clock::now());
+    Rom rom(arguments[0]);
+    const TilesetOptimisePlan plan(planTilesetOptimisation(rom, options));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    writeTilesetOptimiseReport(std::cout, plan);
+    std::cout << "Planned in "s << duration.count() << "ms\n"s;
+    if (!outputPath)
+        return EXIT_SUCCESS;
+
+    const n_t n_applied(applyTilesetOptimisation(rom, plan));
+    rom.save(*outputPath);
+    std::cout << "Applied "s << n_applied << " of "s << std::size(plan.groups) << " tileset groups\n"s;
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+static int memorySoakCommand(Os& os, std::span<const std::string> arguments)
+try
+{
+    if (std::empty(arguments))
+    {
+        printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    n_t n_loads(100000), n_samples(10);
+    bool isCached(true), hasLoads{};
+    for (index_t i(1); i < std::size(arguments); ++i)
+    {
+        const std::string& argument(arguments[i]);
+        if (argument == "--samples"sv && i + 1 < std::size(arguments))
+            n_samples = std::stoul(arguments[++i]);
+        else if (argument == "--no-cache"sv)
+            isCached = false;
+        else if (!argument.starts_with("--"sv) && !hasLoads)
+        {
+            n_loads = std::stoul(argument);
+            hasLoads = true;
+        }
+        else
+        {
+            std::cerr << "Unknown option: "s << argument << '\n';
+            printUsage(std::cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!n_loads || !n_samples)
+    {
+        std::cerr << "Loads and samples must be non-zero\n"s;
+        return EXIT_FAILURE;
+    }
+
+    std::optional<AssetCache> assetCache;
+    if (isCached)
+        assetCache.emplace(os, os.getCacheDirectory());
+
+    const Rom rom(arguments[0]);
+    const auto startTime(std::chrono::steady_clock::now());
+    const MemorySoakResult result(runMemorySoak(rom, n_loads, n_samples, assetCache ? &*assetCache : nullptr));
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    writeMemorySoakReport(std::cout, result);
+    std::cout << n_loads << " loads in "s << duration.count() << "ms\n"s;
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+int runCommandLine(Os& os, std::span<const std::string> arguments)
+try
+{
+    const std::string& command(arguments[0]);
+    if (command == "--export-rooms"sv)
+        return exportRoomsCommand(os, arguments.subspan(1));
+
+    if (command == "--world-map"sv)
+        return worldMapCommand(os, arguments.subspan(1));
+
+    if (command == "--find-blocks"sv)
+        return findBlocksCommand(arguments.subspan(1));
+
+    if (command == "--replace-blocks"sv)
+        return replaceBlocksCommand(arguments.subspan(1));
+
+    if (command == "--reachability"sv)
+        return reachabilityCommand(arguments.subspan(1));
+
+    if (command == "--export-samples"sv)
+        return exportSamplesCommand(arguments.subspan(1));
+
+    if (command == "--import-tiles"sv)
+        return importTilesCommand(arguments.subspan(1));
+
+    if (command == "--optimise-tilesets"sv)
+        return optimiseTilesetsCommand(arguments.subspan(1));
+
+    if (command == "--batch"sv)
+        return batchCommand(os, arguments.subspan(1));
+
+    if (command == "--diff"sv)
+        return diffCommand(os, arguments.subspan(1));
+
+    if (command == "--preview-scene"sv)
+        return previewSceneCommand(os, arguments.subspan(1));
+
+    if (command == "--benchmark-dispatch"sv)
+    {
+        runDispatchBenchmark(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    if (command == "--memory-soak"sv)
+        return memorySoakCommand(os, arguments.subspan(1));
+
+    if (command == "--help"sv)
+    {
+        printUsage(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    std::cerr << "Unknown command: "s << command << '\n';
+    printUsage(std::cerr);
+    return EXIT_FAILURE;
+}
+LOG_RETHROW
@@ -0,0 +1,10 @@
+module;
+
+#include "global.h"
+
+export module command_line;
+
+export import os;
+
+// Runs the headless command given by `arguments` (excluding the program name) without creating any windows. Returns the process exit code
+export int runCommandLine(Os& os, std::span<const std::string> arguments);
@@ -17,7 +17,9 @@ DebugFile::DebugFile(std::filesystem::path filename) noexcept
         const std::filesystem::path filepath(dataDirectory / filename);
 
         // If first use of file, clear it, otherwise insert spaces
+        static std::mutex mutex;
         static std::unordered_set<std::filesystem::path, FilepathHash> initialised;
+        const std::lock_guard lock(mutex);
         if (initialised.insert(filepath).second)
             open(filepath, trunc);
         else
@@ -0,0 +1,52 @@
+#include "global.h"
+
+import error;
+
+std::string Error::message() const
+try
+{
+    std::string ret(std::string(location.file_name()) + ":"s + std::to_string(location.line()) + " - "s);
+    switch (code)
+    {
+    case ErrorCode::notRomAddress:
+        return ret + "SNES address $"s + toHexString(address, 3) + " is not a ROM address"s;
+
+    case ErrorCode::notPcAddress:
+        return ret + "PC address "s + toHexString(address, 3) + " is out of the mapping's range"s;
+
+    case ErrorCode::beyondRom:
+        return ret + "SNES address $"s + toHexString(address, 3) + " is beyond the end of ROM"s;
+
+    case ErrorCode::readOverrun:
+        return ret + "Read of "s + std::to_string(detail) + " bytes from $"s + toHexString(address, 3) + " overruns end of ROM"s;
+
+    case ErrorCode::compressedOverrun:
+        return ret + "Compressed data overruns end of ROM after "s + toHexString(detail, 3) + " bytes"s;
+
+    case ErrorCode::dictionaryOverrun:
+        return ret + "Dictionary copy from "s + toHexString(detail, 2) + " is beyond the decompressed data"s;
+
+    case ErrorCode::relativeCopyOverrun:
+        return ret + "Relative copy distance "s + toHexString(std::uint8_t(detail)) + " is beyond the decompressed data"s;
+
+    case ErrorCode::decompressedTooLarge:
+        return ret + "Decompressed data exceeds "s + toHexString(detail, 3) + " bytes"s;
+
+    case ErrorCode::levelDataTooSmall:
+        return ret + "Level data at $"s + toHexString(address, 3) + " is too small for room $"s + toHexString(detail, 2);
+
+    case ErrorCode::invalidRoomHeader:
+        return ret + "Invalid room header $"s + toHexString(address, 3);
+
+    case ErrorCode::unknownStateCondition:
+        return ret + "Unknown state condition $"s + toHexString(detail, 2) + " in room $"s + toHexString(address, 3);
+    }
+
+    return ret + "Unknown error "s + std::to_string(toInt(code));
+}
+LOG_RETHROW
+
+std::unexpected<Error> makeError(ErrorCode code, std::uint32_t address, std::uint32_t detail, std::source_location location) noexcept
+{
+    return std::unexpected(Error{code, address, detail, location});
+}
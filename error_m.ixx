@@ -0,0 +1,51 @@
+module;
+
+#include "global.h"
+
+export module error;
+
+// Errors that hot paths see routinely in malformed data, e.g. a scan following every pointer in a hack.
+// They're returned rather than thrown, so a bad pointer costs as little as a good one: no unwinding, no logging at each frame, no message built unless it's asked for.
+// Code that meets the UI converts them to exceptions once with `valueOrThrow`
+export enum class ErrorCode : std::uint8_t
+{
+    notRomAddress,         // `address` isn't mapped to the ROM
+    notPcAddress,          // PC address `address` has no address in the mapping's address space
+    beyondRom,             // `address` is past the end of the ROM
+    readOverrun,           // A read of `detail` bytes from `address` runs off the end of the ROM
+    compressedOverrun,     // Compressed data runs off the end of the ROM after `detail` bytes
+    dictionaryOverrun,     // A decompression copy from `detail` is beyond the data decompressed so far
+    relativeCopyOverrun,   // A decompression copy from `detail` bytes back is beyond the data decompressed so far
+    decompressedTooLarge,  // Decompressed data exceeds `detail` bytes
+    levelDataTooSmall,     // Level data at `address` is too small for room `detail`
+    invalidRoomHeader,     // The room header at `address` isn't a plausible room
+    unknownStateCondition  // Room `address` has state condition `detail`, which isn't one of the game's
+};
+
+export struct Error
+{
+    ErrorCode code;
+
+    // Context for the message, their meaning depends on the code
+    std::uint32_t address, detail;
+
+    std::source_location location;
+
+    // Formatted as the equivalent exception's message would be, with the location in place of LOG_INFO
+    std::string message() const;
+};
+
+export template<typename T>
+using Result = std::expected<T, Error>;
+
+export std::unexpected<Error> makeError(ErrorCode code, std::uint32_t address = 0, std::uint32_t detail = 0, std::source_location location = std::source_location::current()) noexcept;
+
+// Where the exception-free code meets code that throws
+export template<typename T>
+T valueOrThrow(Result<T>&& result)
+{
+    if (!result)
+        throw std::runtime_error(result.error().message());
+
+    return *std::move(result);
+}
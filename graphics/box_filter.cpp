@@ -0,0 +1,72 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import box_filter;
+
+static_assert(sizeof(Pixel) == 4);
+
+// Averages two rows of 2n pixels to one row of n pixels
+static void downsampleRow(const Pixel* p_in0, const Pixel* p_in1, Pixel* p_out, n_t n) noexcept
+{
+    index_t i{};
+
+    // Four output pixels per iteration. Each channel is widened to 16 bits, the two rows are summed vertically,
+    // then horizontally adjacent pixel pairs are summed by pairing the low and high halves of each register
+    const __m128i zero(_mm_setzero_si128()), rounding(_mm_set1_epi16(2));
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i
+            top0(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_in0 + i * 2))),
+            top1(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_in0 + i * 2 + 4))),
+            bottom0(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_in1 + i * 2))),
+            bottom1(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_in1 + i * 2 + 4)));
+
+        // Each sum holds two vertically summed pixels, 16 bits per channel
+        const __m128i
+            sum01(_mm_add_epi16(_mm_unpacklo_epi8(top0, zero), _mm_unpacklo_epi8(bottom0, zero))),
+            sum23(_mm_add_epi16(_mm_unpackhi_epi8(top0, zero), _mm_unpackhi_epi8(bottom0, zero))),
+            sum45(_mm_add_epi16(_mm_unpacklo_epi8(top1, zero), _mm_unpacklo_epi8(bottom1, zero))),
+            sum67(_mm_add_epi16(_mm_unpackhi_epi8(top1, zero), _mm_unpackhi_epi8(bottom1, zero)));
+
+        const __m128i
+            out01(_mm_add_epi16(_mm_unpacklo_epi64(sum01, sum23), _mm_unpackhi_epi64(sum01, sum23))),
+            out23(_mm_add_epi16(_mm_unpacklo_epi64(sum45, sum67), _mm_unpackhi_epi64(sum45, sum67)));
+
+        const __m128i result(_mm_packus_epi16(
+            _mm_srli_epi16(_mm_add_epi16(out01, rounding), 2),
+            _mm_srli_epi16(_mm_add_epi16(out23, rounding), 2)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p_out + i), result);
+    }
+
+    for (; i < n; ++i)
+    {
+        const Pixel
+            & a(p_in0[i * 2]), & b(p_in0[i * 2 + 1]),
+            & c(p_in1[i * 2]), & d(p_in1[i * 2 + 1]);
+
+        p_out[i] =
+        {
+            std::uint8_t((a.r + b.r + c.r + d.r + 2) >> 2),
+            std::uint8_t((a.g + b.g + c.g + d.g + 2) >> 2),
+            std::uint8_t((a.b + b.b + c.b + d.b + 2) >> 2),
+            std::uint8_t((a.a + b.a + c.a + d.a + 2) >> 2)
+        };
+    }
+}
+
+void downsample(const Image& in, Image& out, index_t x_out, index_t y_out)
+try
+{
+    if (in.width() % 2 || in.height() % 2)
+        throw std::runtime_error(LOG_INFO "Can't downsample an image with odd dimensions "s + std::to_string(in.width()) + 'x' + std::to_string(in.height()));
+
+    const n_t width(in.width() / 2), height(in.height() / 2);
+    if (x_out + width > out.width() || y_out + height > out.height())
+        throw std::runtime_error(LOG_INFO "Downsampled image doesn't fit in the output image"s);
+
+    for (index_t y{}; y < height; ++y)
+        downsampleRow(std::data(in.row(y * 2)), std::data(in.row(y * 2 + 1)), &out.row(y_out + y)[x_out], width);
+}
+LOG_RETHROW
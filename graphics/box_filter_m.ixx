@@ -0,0 +1,11 @@
+module;
+
+#include "../global.h"
+
+export module box_filter;
+
+export import image;
+
+// Halves `in` with a 2x2 box filter (rounded average of each 2x2 block of pixels), writing the result into `out` with its top-left corner at (x_out, y_out).
+// `in` must have even dimensions and the result must fit in `out`
+export void downsample(const Image& in, Image& out, index_t x_out, index_t y_out);
@@ -0,0 +1,605 @@
+#include "../global.h"
+
+import deflate;
+
+static const std::uint16_t lengthBases[]
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const std::uint8_t lengthExtraBits[]
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const std::uint16_t distanceBases[]
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const std::uint8_t distanceExtraBits[]
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Huffman codes are packed most significant bit first, everything else in deflate is least significant bit first
+static constexpr std::uint32_t reverseBits(std::uint32_t v, unsigned n) noexcept
+{
+    std::uint32_t ret{};
+    for (unsigned i{}; i < n; ++i)
+        ret |= (v >> i & 1) << (n - 1 - i);
+
+    return ret;
+}
+
+struct HuffmanCode
+{
+    std::uint16_t bits;
+    std::uint8_t n;
+};
+
+// RFC 1951 section 3.2.6
+static constexpr std::array<HuffmanCode, 288> fixedLiteralCodes([]()
+{
+    std::array<HuffmanCode, 288> ret{};
+    for (unsigned symbol{}; symbol < 288; ++symbol)
+    {
+        std::uint32_t code;
+        unsigned n;
+        if (symbol < 144)
+            code = 0x30 + symbol, n = 8;
+        else if (symbol < 256)
+            code = 0x190 + symbol - 144, n = 9;
+        else if (symbol < 280)
+            code = symbol - 256, n = 7;
+        else
+            code = 0xC0 + symbol - 280, n = 8;
+
+        ret[symbol] = {std::uint16_t(reverseBits(code, n)), std::uint8_t(n)};
+    }
+
+    return ret;
+}());
+
+static std::uint32_t updateAdler32(std::uint32_t adler, std::span<const std::uint8_t> data) noexcept
+{
+    // 5552 is the most bytes that can be summed before b can overflow
+    const std::uint32_t modulus(65521);
+    std::uint32_t a(adler & 0xFFFF), b(adler >> 16);
+    while (!std::empty(data))
+    {
+        const n_t n(std::min<n_t>(std::size(data), 5552));
+        for (std::uint8_t v : data.first(n))
+        {
+            a += v;
+            b += a;
+        }
+
+        a %= modulus;
+        b %= modulus;
+        data = data.subspan(n);
+    }
+
+    return b << 16 | a;
+}
+
+Deflater::Deflater(Sink sink_in, unsigned level)
+try
+    : sink(std::move(sink_in)), maxChain(n_t(1) << (std::clamp(level, 1u, 9u) - 1)), head(n_t(1) << hashBits), prev(windowSize)
+{
+    // zlib header: deflate with a 32KiB window, FLEVEL as a hint of the compression level, FCHECK making the header a multiple of 31
+    const std::uint8_t flags(level <= 1 ? 0x01 : level < 6 ? 0x5E : level == 6 ? 0x9C : 0xDA);
+    output.reserve(outputBufferSize + 8);
+    output.push_back(0x78);
+    output.push_back(flags);
+
+    // One non-final fixed Huffman block covers all the data
+    writeBits(0b01'0, 3);
+}
+LOG_RETHROW
+
+void Deflater::writeBits(std::uint32_t bits, unsigned n)
+try
+{
+    bitBuffer |= std::uint64_t(bits) << n_bits;
+    n_bits += n;
+    while (n_bits >= 8)
+    {
+        output.push_back(std::uint8_t(bitBuffer));
+        bitBuffer >>= 8;
+        n_bits -= 8;
+    }
+
+    if (std::size(output) >= outputBufferSize)
+        flushOutput();
+}
+LOG_RETHROW
+
+void Deflater::writeSymbol(unsigned symbol)
+try
+{
+    const HuffmanCode code(fixedLiteralCodes[symbol]);
+    writeBits(code.bits, code.n);
+}
+LOG_RETHROW
+
+void Deflater::writeMatch(n_t length, n_t distance)
+try
+{
+    const index_t i_length(std::upper_bound(std::begin(lengthBases), std::end(lengthBases), length) - std::begin(lengthBases) - 1);
+    writeSymbol(unsigned(257 + i_length));
+    writeBits(std::uint32_t(length - lengthBases[i_length]), lengthExtraBits[i_length]);
+
+    const index_t i_distance(std::upper_bound(std::begin(distanceBases), std::end(distanceBases), distance) - std::begin(distanceBases) - 1);
+    writeBits(reverseBits(std::uint32_t(i_distance), 5), 5);
+    writeBits(std::uint32_t(distance - distanceBases[i_distance]), distanceExtraBits[i_distance]);
+}
+LOG_RETHROW
+
+void Deflater::flushOutput()
+try
+{
+    if (std::empty(output))
+        return;
+
+    sink(output);
+    output.clear();
+}
+LOG_RETHROW
+
+void Deflater::insertHash(index_t i)
+try
+{
+    const std::uint8_t* const p(&window[i - i_windowBegin]);
+    const std::uint32_t key(p[0] | p[1] << 8 | p[2] << 16);
+    const index_t h(key * 0x9E3779B1u >> (32 - hashBits));
+    prev[i & (windowSize - 1)] = head[h];
+    head[h] = i + 1;
+}
+LOG_RETHROW
+
+void Deflater::encode(bool isFlushing)
+try
+{
+    // Unless flushing, keep a full match's worth of lookahead so that matches aren't cut short at the end of the buffered input
+    const index_t i_end(i_windowBegin + std::size(window));
+    const index_t i_stop(isFlushing ? i_end : i_end - std::min(i_end, maxMatch));
+    while (i_next < i_stop)
+    {
+        const n_t n_available(i_end - i_next);
+        n_t bestLength{}, bestDistance{};
+        if (n_available >= minMatch)
+        {
+            const n_t lengthLimit(std::min(n_available, maxMatch));
+            const std::uint8_t* const p_current(&window[i_next - i_windowBegin]);
+            index_t candidate(head[std::uint32_t(p_current[0] | p_current[1] << 8 | p_current[2] << 16) * 0x9E3779B1u >> (32 - hashBits)]);
+            insertHash(i_next);
+
+            // Chain entries are decreasing positions; an entry that isn't is a stale slot that's since been reused
+            for (n_t i_chain{}; candidate && i_chain < maxChain; ++i_chain)
+            {
+                const index_t i_candidate(candidate - 1);
+                if (i_next - i_candidate >= windowSize || i_candidate < i_windowBegin)
+                    break;
+
+                const std::uint8_t* const p_candidate(&window[i_candidate - i_windowBegin]);
+                if (p_candidate[bestLength] == p_current[bestLength])
+                {
+                    n_t length{};
+                    while (length < lengthLimit && p_candidate[length] == p_current[length])
+                        ++length;
+
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = i_next - i_candidate;
+                        if (length == lengthLimit)
+                            break;
+                    }
+                }
+
+                const index_t next(prev[i_candidate & (windowSize - 1)]);
+                if (next >= candidate)
+                    break;
+
+                candidate = next;
+            }
+        }
+
+        if (bestLength >= minMatch)
+        {
+            writeMatch(bestLength, bestDistance);
+            for (index_t i(i_next + 1); i < i_next + bestLength && i + minMatch <= i_end; ++i)
+                insertHash(i);
+
+            i_next += bestLength;
+        }
+        else
+        {
+            writeSymbol(window[i_next - i_windowBegin]);
+            ++i_next;
+        }
+    }
+}
+LOG_RETHROW
+
+void Deflater::write(std::span<const std::uint8_t> data)
+try
+{
+    if (isFinished)
+        throw std::logic_error(LOG_INFO "Write after finish"s);
+
+    adler = updateAdler32(adler, data);
+    window.insert(std::end(window), std::begin(data), std::end(data));
+    encode(false);
+
+    // Only the last window's worth of encoded input can be referenced
+    if (i_next - i_windowBegin > windowSize * 2)
+    {
+        const n_t n_drop(i_next - i_windowBegin - windowSize);
+        window.erase(std::begin(window), std::begin(window) + n_drop);
+        i_windowBegin += n_drop;
+    }
+}
+LOG_RETHROW
+
+void Deflater::finish()
+try
+{
+    if (isFinished)
+        return;
+
+    encode(true);
+
+    // End the data block, then an empty final block
+    writeSymbol(256);
+    writeBits(0b01'1, 3);
+    writeSymbol(256);
+    if (n_bits)
+        writeBits(0, 8 - n_bits);
+
+    for (unsigned shift : {24u, 16u, 8u, 0u})
+        output.push_back(std::uint8_t(adler >> shift));
+
+    flushOutput();
+    isFinished = true;
+}
+LOG_RETHROW
+
+// Single level lookup table decoder. Entries are symbol << 4 | code length, zero for unused codes
+class HuffmanDecoder
+{
+    const static unsigned maxBits{15};
+
+    std::vector<std::uint16_t> table;
+
+public:
+    explicit HuffmanDecoder(std::span<const std::uint8_t> codeLengths)
+        : table(n_t(1) << maxBits)
+    {
+        // Canonical codes, RFC 1951 section 3.2.2
+        unsigned counts[maxBits + 1]{}, nextCodes[maxBits + 1]{};
+        for (std::uint8_t length : codeLengths)
+            ++counts[length];
+
+        counts[0] = 0;
+        for (unsigned length(1), code{}; length <= maxBits; ++length)
+        {
+            code = (code + counts[length - 1]) << 1;
+            nextCodes[length] = code;
+        }
+
+        for (index_t symbol{}; symbol < std::size(codeLengths); ++symbol)
+        {
+            const unsigned length(codeLengths[symbol]);
+            if (!length)
+                continue;
+
+            const std::uint32_t code(nextCodes[length]++);
+            if (code >> length)
+                throw std::runtime_error(LOG_INFO "Oversubscribed Huffman code"s);
+
+            for (std::uint32_t i(reverseBits(code, length)); i < std::size(table); i += 1u << length)
+                table[i] = std::uint16_t(symbol << 4 | length);
+        }
+    }
+
+    template<typename BitReader>
+    unsigned decode(BitReader& in) const
+    {
+        const std::uint16_t entry(table[in.peek(maxBits)]);
+        if (!entry)
+            throw std::runtime_error(LOG_INFO "Invalid Huffman code"s);
+
+        in.skip(entry & 0xF);
+        return entry >> 4;
+    }
+};
+
+class BitReader
+{
+    std::span<const std::uint8_t> data;
+    index_t i_byte{};
+    std::uint64_t buffer{};
+    unsigned n_bits{};
+
+    void refill() noexcept
+    {
+        // Reading past the end yields zero bits, an overrun is detected by skip
+        while (n_bits <= 56)
+        {
+            buffer |= std::uint64_t(i_byte < std::size(data) ? data[i_byte] : 0) << n_bits;
+            ++i_byte;
+            n_bits += 8;
+        }
+    }
+
+public:
+    explicit BitReader(std::span<const std::uint8_t> data)
+        : data(data)
+    {}
+
+    std::uint32_t peek(unsigned n) noexcept
+    {
+        if (n_bits < n)
+            refill();
+
+        return std::uint32_t(buffer & ((std::uint64_t(1) << n) - 1));
+    }
+
+    void skip(unsigned n)
+    {
+        buffer >>= n;
+        n_bits -= n;
+        if (i_byte * 8 - n_bits > std::size(data) * 8)
+            throw std::runtime_error(LOG_INFO "Deflate stream overruns end of data"s);
+    }
+
+    std::uint32_t read(unsigned n)
+    {
+        const std::uint32_t ret(peek(n));
+        skip(n);
+        return ret;
+    }
+
+    void alignToByte()
+    {
+        skip(n_bits % 8);
+    }
+
+    // Byte position of the next unread whole byte
+    index_t position() const noexcept
+    {
+        return i_byte - n_bits / 8;
+    }
+
+    void seek(index_t i) noexcept
+    {
+        i_byte = i;
+        buffer = 0;
+        n_bits = 0;
+    }
+};
+
+// Decodes deflate blocks into `out` until the final block, or until `out` has reached `maxSize`. Returns whether the final block was decoded
+static bool inflateBlocks(BitReader& in, std::span<const std::uint8_t> deflateData, std::vector<std::uint8_t>& out, n_t maxSize)
+try
+{
+    for (bool isFinal{}; !isFinal;)
+    {
+        if (std::size(out) >= maxSize)
+            return false;
+
+        isFinal = in.read(1);
+        const unsigned blockType(in.read(2));
+        if (blockType == 0)
+        {
+            in.alignToByte();
+            const index_t i(in.position());
+            if (i + 4 > std::size(deflateData))
+                throw std::runtime_error(LOG_INFO "Stored block overruns end of data"s);
+
+            const n_t length(deflateData[i] | deflateData[i + 1] << 8);
+            if ((length ^ 0xFFFF) != n_t(deflateData[i + 2] | deflateData[i + 3] << 8) || i + 4 + length > std::size(deflateData))
+                throw std::runtime_error(LOG_INFO "Invalid stored block"s);
+
+            out.insert(std::end(out), std::begin(deflateData) + i + 4, std::begin(deflateData) + i + 4 + length);
+            in.seek(i + 4 + length);
+            continue;
+        }
+
+        std::array<std::uint8_t, 288 + 32> codeLengths{};
+        n_t n_literalCodes(288), n_distanceCodes(32);
+        if (blockType == 1)
+        {
+            std::fill_n(std::begin(codeLengths), 144, std::uint8_t(8));
+            std::fill_n(std::begin(codeLengths) + 144, 112, std::uint8_t(9));
+            std::fill_n(std::begin(codeLengths) + 256, 24, std::uint8_t(7));
+            std::fill_n(std::begin(codeLengths) + 280, 8, std::uint8_t(8));
+            std::fill_n(std::begin(codeLengths) + 288, 32, std::uint8_t(5));
+        }
+        else if (blockType == 2)
+        {
+            // RFC 1951 section 3.2.7
+            static const std::uint8_t order[]{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+            n_literalCodes = in.read(5) + 257;
+            n_distanceCodes = in.read(5) + 1;
+            const n_t n_codeLengthCodes(in.read(4) + 4);
+            std::array<std::uint8_t, 19> codeLengthCodeLengths{};
+            for (index_t i{}; i < n_codeLengthCodes; ++i)
+                codeLengthCodeLengths[order[i]] = std::uint8_t(in.read(3));
+
+            const HuffmanDecoder codeLengthDecoder(codeLengthCodeLengths);
+            const n_t n_codes(n_literalCodes + n_distanceCodes);
+            for (index_t i{}; i < n_codes;)
+            {
+                const unsigned symbol(codeLengthDecoder.decode(in));
+                std::uint8_t length{};
+                n_t n_repeat(1);
+                if (symbol < 16)
+                    length = std::uint8_t(symbol);
+                else if (symbol == 16)
+                {
+                    if (i == 0)
+                        throw std::runtime_error(LOG_INFO "Code length repeat with no previous length"s);
+
+                    length = codeLengths[i - 1];
+                    n_repeat = 3 + in.read(2);
+                }
+                else if (symbol == 17)
+                    n_repeat = 3 + in.read(3);
+                else
+                    n_repeat = 11 + in.read(7);
+
+                if (i + n_repeat > n_codes)
+                    throw std::runtime_error(LOG_INFO "Code lengths overrun"s);
+
+                std::fill_n(std::begin(codeLengths) + i, n_repeat, length);
+                i += n_repeat;
+            }
+
+            // Distance code lengths follow the literal/length code lengths, move them to their fixed position
+            std::copy_backward(std::begin(codeLengths) + n_literalCodes, std::begin(codeLengths) + n_codes, std::begin(codeLengths) + 288 + n_distanceCodes);
+            std::fill(std::begin(codeLengths) + n_literalCodes, std::begin(codeLengths) + 288, std::uint8_t());
+        }
+        else
+            throw std::runtime_error(LOG_INFO "Invalid deflate block type"s);
+
+        const HuffmanDecoder
+            literalDecoder(std::span<const std::uint8_t>(codeLengths).first(288)),
+            distanceDecoder(std::span<const std::uint8_t>(codeLengths).subspan(288));
+
+        for (;;)
+        {
+            if (std::size(out) >= maxSize)
+                return false;
+
+            const unsigned symbol(literalDecoder.decode(in));
+            if (symbol < 256)
+            {
+                out.push_back(std::uint8_t(symbol));
+                continue;
+            }
+
+            if (symbol == 256)
+                break;
+
+            const index_t i_length(symbol - 257);
+            if (i_length >= std::size(lengthBases))
+                throw std::runtime_error(LOG_INFO "Invalid length code"s);
+
+            const n_t length(lengthBases[i_length] + in.read(lengthExtraBits[i_length]));
+            const index_t i_distance(distanceDecoder.decode(in));
+            if (i_distance >= std::size(distanceBases))
+                throw std::runtime_error(LOG_INFO "Invalid distance code"s);
+
+            const n_t distance(distanceBases[i_distance] + in.read(distanceExtraBits[i_distance]));
+            if (distance > std::size(out))
+                throw std::runtime_error(LOG_INFO "Match distance is beyond the start of the data"s);
+
+            const index_t i_begin(std::size(out) - distance);
+            for (index_t i{}; i < length; ++i)
+            {
+                const std::uint8_t v(out[i_begin + i]);
+                out.push_back(v);
+            }
+        }
+    }
+
+    return true;
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> inflate(std::span<const std::uint8_t> zlibData)
+try
+{
+    if (std::size(zlibData) < 6 || (zlibData[0] & 0xF) != 8 || (zlibData[0] << 8 | zlibData[1]) % 31 || zlibData[1] & 0x20)
+        throw std::runtime_error(LOG_INFO "Invalid zlib header"s);
+
+    const std::span<const std::uint8_t> deflateData(zlibData.subspan(2));
+    BitReader in(deflateData);
+    std::vector<std::uint8_t> out;
+    inflateBlocks(in, deflateData, out, std::numeric_limits<n_t>::max());
+
+    in.alignToByte();
+    const index_t i_adler(in.position());
+    if (i_adler + 4 > std::size(deflateData))
+        throw std::runtime_error(LOG_INFO "zlib stream is missing its checksum"s);
+
+    const std::uint32_t adler(std::uint32_t(deflateData[i_adler] << 24 | deflateData[i_adler + 1] << 16 | deflateData[i_adler + 2] << 8 | deflateData[i_adler + 3]));
+    if (adler != updateAdler32(1, out))
+        throw std::runtime_error(LOG_INFO "zlib checksum mismatch"s);
+
+    return out;
+}
+LOG_RETHROW
+
+bool isGzip(std::span<const std::uint8_t> data) noexcept
+{
+    return std::size(data) >= 18 && data[0] == 0x1F && data[1] == 0x8B && data[2] == 8;
+}
+
+std::vector<std::uint8_t> gunzip(std::span<const std::uint8_t> gzipData, n_t maxSize)
+try
+{
+    // RFC 1952 section 2.3
+    const std::uint8_t
+        flagHeaderCrc(1 << 1),
+        flagExtra(1 << 2),
+        flagName(1 << 3),
+        flagComment(1 << 4);
+
+    if (!isGzip(gzipData))
+        throw std::runtime_error(LOG_INFO "Invalid gzip header"s);
+
+    const std::uint8_t flags(gzipData[3]);
+    index_t i(10);
+    if (flags & flagExtra)
+    {
+        if (i + 2 > std::size(gzipData))
+            throw std::runtime_error(LOG_INFO "gzip extra field overruns end of data"s);
+
+        i += 2 + (gzipData[i] | gzipData[i + 1] << 8);
+    }
+
+    for (std::uint8_t flag : {flagName, flagComment})
+        if (flags & flag)
+        {
+            while (i < std::size(gzipData) && gzipData[i])
+                ++i;
+
+            ++i;
+        }
+
+    if (flags & flagHeaderCrc)
+        i += 2;
+
+    if (i > std::size(gzipData))
+        throw std::runtime_error(LOG_INFO "gzip header overruns end of data"s);
+
+    const std::span<const std::uint8_t> deflateData(gzipData.subspan(i));
+    BitReader in(deflateData);
+    std::vector<std::uint8_t> out;
+    if (!inflateBlocks(in, deflateData, out, maxSize))
+    {
+        out.resize(maxSize);
+        return out;
+    }
+
+    // The CRC-32 isn't checked, the size is enough to catch truncation
+    in.alignToByte();
+    const index_t i_size(in.position() + 4);
+    if (i_size + 4 > std::size(deflateData))
+        throw std::runtime_error(LOG_INFO "gzip stream is missing its trailer"s);
+
+    const std::uint32_t size(std::uint32_t(deflateData[i_size] | deflateData[i_size + 1] << 8 | deflateData[i_size + 2] << 16 | deflateData[i_size + 3] << 24));
+    if (size != std::uint32_t(std::size(out)))
+        throw std::runtime_error(LOG_INFO "gzip size mismatch"s);
+
+    if (std::size(out) > maxSize)
+        out.resize(maxSize);
+
+    return out;
+}
+LOG_RETHROW
@@ -0,0 +1,60 @@
+module;
+
+#include "../global.h"
+
+export module deflate;
+
+// Streaming zlib (RFC 1950) compressor producing fixed Huffman deflate (RFC 1951) blocks.
+// Tuned for throughput: a hash chain match finder whose maximum chain length is set by `level` (1 to 9), and a bounded window buffer, so memory use is independent of the input size
+export class Deflater
+{
+public:
+    using Sink = FunctionRef<void(std::span<const std::uint8_t>)>;
+
+private:
+    const static n_t
+        windowSize{0x8000},
+        minMatch{3},
+        maxMatch{258},
+        hashBits{15},
+        outputBufferSize{0x10000};
+
+    Sink sink;
+    n_t maxChain;
+
+    // `window` holds input from absolute position `i_windowBegin`, `i_next` is the absolute position of the next byte to encode.
+    // Hash chain entries are absolute positions + 1 so that zero means empty
+    std::vector<std::uint8_t> window;
+    index_t i_windowBegin{}, i_next{};
+    std::vector<index_t> head, prev;
+
+    std::uint32_t adler{1};
+    std::uint64_t bitBuffer{};
+    unsigned n_bits{};
+    std::vector<std::uint8_t> output;
+    bool isFinished{};
+
+    void writeBits(std::uint32_t bits, unsigned n);
+    void writeSymbol(unsigned symbol);
+    void writeMatch(n_t length, n_t distance);
+    void flushOutput();
+    void insertHash(index_t i);
+    void encode(bool isFlushing);
+
+public:
+    explicit Deflater(Sink sink, unsigned level = 1);
+
+    Deflater(const Deflater&) = delete;
+    auto operator=(Deflater) = delete;
+
+    void write(std::span<const std::uint8_t> data);
+    void finish();
+};
+
+// Decompresses a complete zlib stream, verifying its checksum
+export std::vector<std::uint8_t> inflate(std::span<const std::uint8_t> zlibData);
+
+export bool isGzip(std::span<const std::uint8_t> data) noexcept;
+
+// Decompresses the first member of a gzip (RFC 1952) stream. Decoding stops once `maxSize` bytes are out, for callers that only need the start
+export std::vector<std::uint8_t> gunzip(std::span<const std::uint8_t> gzipData, n_t maxSize = std::numeric_limits<n_t>::max());
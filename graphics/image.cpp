@@ -0,0 +1,43 @@
+#include "../global.h"
+
+import image;
+
+Image::Image(n_t width, n_t height, Pixel fill)
+try
+    : width_(width), height_(height), pixels(width * height, fill)
+{}
+LOG_RETHROW
+
+n_t Image::width() const noexcept
+{
+    return width_;
+}
+
+n_t Image::height() const noexcept
+{
+    return height_;
+}
+
+std::span<Pixel> Image::row(index_t y)
+try
+{
+    return std::span(pixels).subspan(y * width_, width_);
+}
+LOG_RETHROW
+
+std::span<const Pixel> Image::row(index_t y) const
+try
+{
+    return std::span(pixels).subspan(y * width_, width_);
+}
+LOG_RETHROW
+
+std::span<Pixel> Image::data() noexcept
+{
+    return pixels;
+}
+
+std::span<const Pixel> Image::data() const noexcept
+{
+    return pixels;
+}
@@ -0,0 +1,29 @@
+module;
+
+#include "../global.h"
+
+export module image;
+
+export struct Pixel
+{
+    std::uint8_t r, g, b, a;
+};
+
+// Row-major RGBA image
+export class Image
+{
+    n_t width_{}, height_{};
+    std::vector<Pixel> pixels;
+
+public:
+    Image() = default;
+    Image(n_t width, n_t height, Pixel fill = {});
+
+    n_t width() const noexcept;
+    n_t height() const noexcept;
+
+    std::span<Pixel> row(index_t y);
+    std::span<const Pixel> row(index_t y) const;
+    std::span<Pixel> data() noexcept;
+    std::span<const Pixel> data() const noexcept;
+};
@@ -0,0 +1,429 @@
+#include "../global.h"
+
+import png;
+
+static_assert(sizeof(Pixel) == 4);
+
+static constexpr std::array<std::uint32_t, 0x100> crcTable([]()
+{
+    std::array<std::uint32_t, 0x100> ret{};
+    for (std::uint32_t i{}; i < 0x100; ++i)
+    {
+        std::uint32_t crc(i);
+        for (unsigned i_bit{}; i_bit < 8; ++i_bit)
+            crc = crc & 1 ? 0xEDB88320 ^ crc >> 1 : crc >> 1;
+
+        ret[i] = crc;
+    }
+
+    return ret;
+}());
+
+// Pass in and get out the CRC without the final inversion, so it can be updated incrementally
+static std::uint32_t updateCrc32(std::uint32_t crc, std::span<const std::uint8_t> data) noexcept
+{
+    for (std::uint8_t v : data)
+        crc = crcTable[(crc ^ v) & 0xFF] ^ crc >> 8;
+
+    return crc;
+}
+
+static void writeBigEndian(std::ostream& out, std::uint32_t v)
+try
+{
+    const char bytes[]{char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+    out.write(bytes, std::size(bytes));
+}
+LOG_RETHROW
+
+static std::uint8_t paeth(int a, int b, int c) noexcept
+{
+    const int p(a + b - c), pa(std::abs(p - a)), pb(std::abs(p - b)), pc(std::abs(p - c));
+    if (pa <= pb && pa <= pc)
+        return std::uint8_t(a);
+
+    if (pb <= pc)
+        return std::uint8_t(b);
+
+    return std::uint8_t(c);
+}
+
+PngWriter::PngWriter(std::ostream& out, n_t width_in, n_t height_in, unsigned compressionLevel)
+try
+    : p_out(&out), width(width_in), height(height_in), previousRow(width * bytesPerPixel), currentRow(width * bytesPerPixel),
+      deflater([this](std::span<const std::uint8_t> data){ writeChunk("IDAT"sv, data); }, compressionLevel)
+{
+    // PNG specification: https://www.w3.org/TR/png/
+    if (!width || !height || width > 0x7FFFFFFF || height > 0x7FFFFFFF)
+        throw std::runtime_error(LOG_INFO "Invalid PNG dimensions "s + std::to_string(width) + 'x' + std::to_string(height));
+
+    for (index_t i_filter{}; i_filter < std::size(filteredRows); ++i_filter)
+    {
+        filteredRows[i_filter].resize(1 + width * bytesPerPixel);
+        filteredRows[i_filter][0] = std::uint8_t(i_filter);
+    }
+
+    const char signature[]{'\x89', 'P', 'N', 'G', '\r', '\n', '\x1A', '\n'};
+    p_out->write(signature, std::size(signature));
+
+    // Bit depth 8, colour type 6 (RGBA), deflate, adaptive filtering, no interlacing
+    const std::uint8_t header[]
+    {
+        std::uint8_t(width >> 24), std::uint8_t(width >> 16), std::uint8_t(width >> 8), std::uint8_t(width),
+        std::uint8_t(height >> 24), std::uint8_t(height >> 16), std::uint8_t(height >> 8), std::uint8_t(height),
+        8, 6, 0, 0, 0
+    };
+    writeChunk("IHDR"sv, header);
+}
+LOG_RETHROW
+
+void PngWriter::writeChunk(std::string_view type, std::span<const std::uint8_t> data)
+try
+{
+    const std::span<const std::uint8_t> typeBytes(reinterpret_cast<const std::uint8_t*>(std::data(type)), std::size(type));
+    writeBigEndian(*p_out, std::uint32_t(std::size(data)));
+    p_out->write(std::data(type), std::ssize(type));
+    p_out->write(reinterpret_cast<const char*>(std::data(data)), std::ssize(data));
+    writeBigEndian(*p_out, ~updateCrc32(updateCrc32(~0u, typeBytes), data));
+}
+LOG_RETHROW
+
+void PngWriter::writeRow(std::span<const Pixel> row)
+try
+{
+    if (std::size(row) != width)
+        throw std::runtime_error(LOG_INFO "PNG row has "s + std::to_string(std::size(row)) + " pixels, expected "s + std::to_string(width));
+
+    if (i_row >= height)
+        throw std::runtime_error(LOG_INFO "Too many PNG rows written"s);
+
+    std::memcpy(std::data(currentRow), std::data(row), std::size(currentRow));
+
+    // Try every filter type and pick the one with the least sum of absolute (signed) differences, the heuristic recommended by the specification
+    const n_t n(std::size(currentRow));
+    std::uint8_t
+        * const p_none(&filteredRows[0][1]),
+        * const p_sub(&filteredRows[1][1]),
+        * const p_up(&filteredRows[2][1]),
+        * const p_average(&filteredRows[3][1]),
+        * const p_paeth(&filteredRows[4][1]);
+
+    std::array<n_t, 5> costs{};
+    for (index_t i{}; i < n; ++i)
+    {
+        const int
+            x(currentRow[i]),
+            a(i >= bytesPerPixel ? currentRow[i - bytesPerPixel] : 0),
+            b(previousRow[i]),
+            c(i >= bytesPerPixel ? previousRow[i - bytesPerPixel] : 0);
+
+        p_none[i] = std::uint8_t(x);
+        p_sub[i] = std::uint8_t(x - a);
+        p_up[i] = std::uint8_t(x - b);
+        p_average[i] = std::uint8_t(x - (a + b) / 2);
+        p_paeth[i] = std::uint8_t(x - paeth(a, b, c));
+
+        for (index_t i_filter{}; i_filter < std::size(costs); ++i_filter)
+            costs[i_filter] += std::abs(int(std::int8_t(filteredRows[i_filter][1 + i])));
+    }
+
+    const index_t i_best(std::ranges::min_element(costs) - std::begin(costs));
+    deflater.write(filteredRows[i_best]);
+
+    std::swap(previousRow, currentRow);
+    ++i_row;
+}
+LOG_RETHROW
+
+void PngWriter::finish()
+try
+{
+    if (i_row != height)
+        throw std::runtime_error(LOG_INFO "PNG finished after "s + std::to_string(i_row) + " rows, expected "s + std::to_string(height));
+
+    deflater.finish();
+    writeChunk("IEND"sv, {});
+}
+LOG_RETHROW
+
+void writePng(const std::filesystem::path& filepath, const Image& image, unsigned compressionLevel)
+try
+{
+    std::ofstream out(filepath, std::ios::binary);
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+
+    PngWriter png(out, image.width(), image.height(), compressionLevel);
+    for (index_t y{}; y < image.height(); ++y)
+        png.writeRow(image.row(y));
+
+    png.finish();
+}
+LOG_RETHROW
+
+static void unfilter(std::uint8_t filter, std::span<std::uint8_t> row, std::span<const std::uint8_t> previousRow, n_t bytesPerPixel)
+try
+{
+    const n_t n(std::size(row));
+    switch (filter)
+    {
+    default:
+        throw std::runtime_error(LOG_INFO "Invalid PNG filter type "s + std::to_string(filter));
+
+    case 0:
+        break;
+
+    case 1:
+        for (index_t i(bytesPerPixel); i < n; ++i)
+            row[i] = std::uint8_t(row[i] + row[i - bytesPerPixel]);
+
+        break;
+
+    case 2:
+        for (index_t i{}; i < n; ++i)
+            row[i] = std::uint8_t(row[i] + previousRow[i]);
+
+        break;
+
+    case 3:
+        for (index_t i{}; i < n; ++i)
+            row[i] = std::uint8_t(row[i] + ((i >= bytesPerPixel ? row[i - bytesPerPixel] : 0) + previousRow[i]) / 2);
+
+        break;
+
+    case 4:
+        for (index_t i{}; i < n; ++i)
+        {
+            const int
+                a(i >= bytesPerPixel ? row[i - bytesPerPixel] : 0),
+                c(i >= bytesPerPixel ? previousRow[i - bytesPerPixel] : 0);
+
+            row[i] = std::uint8_t(row[i] + paeth(a, previousRow[i], c));
+        }
+
+        break;
+    }
+}
+LOG_RETHROW
+
+Image readPng(std::span<const std::uint8_t> data)
+try
+{
+    const std::uint8_t signature[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (std::size(data) < std::size(signature) || !std::equal(std::begin(signature), std::end(signature), std::begin(data)))
+        throw std::runtime_error(LOG_INFO "Not a PNG file"s);
+
+    const auto readBigEndian([](const std::uint8_t* p) -> std::uint32_t
+    {
+        return std::uint32_t(p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]);
+    });
+
+    n_t width{}, height{};
+    unsigned bitDepth{}, colourType{}, interlaceMethod{};
+    std::vector<Pixel> palette;
+    std::vector<std::uint8_t> transparency, compressed;
+    for (index_t i(std::size(signature));;)
+    {
+        if (i + 12 > std::size(data))
+            throw std::runtime_error(LOG_INFO "PNG ends before IEND"s);
+
+        const n_t length(readBigEndian(&data[i]));
+        if (length > std::size(data) - i - 12)
+            throw std::runtime_error(LOG_INFO "PNG chunk overruns end of file"s);
+
+        const std::span<const std::uint8_t> typeAndBody(data.subspan(i + 4, 4 + length));
+        const std::string_view type(reinterpret_cast<const char*>(std::data(typeAndBody)), 4);
+        const std::span<const std::uint8_t> body(typeAndBody.subspan(4));
+        if (~updateCrc32(~0u, typeAndBody) != readBigEndian(&data[i + 8 + length]))
+            throw std::runtime_error(LOG_INFO "PNG chunk "s + std::string(type) + " has a bad CRC"s);
+
+        i += 12 + length;
+        if (type == "IHDR"sv)
+        {
+            if (length != 13)
+                throw std::runtime_error(LOG_INFO "Invalid IHDR"s);
+
+            width = readBigEndian(&body[0]);
+            height = readBigEndian(&body[4]);
+            bitDepth = body[8];
+            colourType = body[9];
+            interlaceMethod = body[12];
+        }
+        else if (type == "PLTE"sv)
+            for (index_t i_colour{}; i_colour + 3 <= length; i_colour += 3)
+                palette.push_back({body[i_colour], body[i_colour + 1], body[i_colour + 2], 0xFF});
+        else if (type == "tRNS"sv)
+            transparency.assign(std::begin(body), std::end(body));
+        else if (type == "IDAT"sv)
+            compressed.insert(std::end(compressed), std::begin(body), std::end(body));
+        else if (type == "IEND"sv)
+            break;
+    }
+
+    n_t n_channels;
+    switch (colourType)
+    {
+    default:
+        throw std::runtime_error(LOG_INFO "Invalid PNG colour type "s + std::to_string(colourType));
+
+    case 0: n_channels = 1; break;
+    case 2: n_channels = 3; break;
+    case 3: n_channels = 1; break;
+    case 4: n_channels = 2; break;
+    case 6: n_channels = 4; break;
+    }
+
+    // Greyscale allows every bit depth, palette images up to 8 bits, and the rest only 8 or 16 bits
+    const bool
+        isSubByteDepth(bitDepth == 1 || bitDepth == 2 || bitDepth == 4),
+        isValidDepth(bitDepth == 8 || (bitDepth == 16 && colourType != 3) || (isSubByteDepth && (colourType == 0 || colourType == 3)));
+
+    if (!isValidDepth)
+        throw std::runtime_error(LOG_INFO "Invalid PNG bit depth "s + std::to_string(bitDepth) + " for colour type "s + std::to_string(colourType));
+
+    if (!width || !height || interlaceMethod > 1)
+        throw std::runtime_error(LOG_INFO "Unsupported PNG format"s);
+
+    for (index_t i{}; i < std::min(std::size(transparency), std::size(palette)); ++i)
+        if (colourType == 3)
+            palette[i].a = transparency[i];
+
+    const std::vector<std::uint8_t> filtered(inflate(compressed));
+    const n_t bitsPerPixel(n_channels * bitDepth);
+    const n_t bytesPerPixel(std::max<n_t>(1, bitsPerPixel / 8));
+    const unsigned maxSample((1u << std::min(bitDepth, 8u)) - 1);
+
+    // Samples are full precision (up to 16 bits), for comparing against the tRNS colour key
+    const auto readSample([&](std::span<const std::uint8_t> row, index_t x, index_t i_channel) -> unsigned
+    {
+        if (bitDepth == 16)
+            return row[(x * n_channels + i_channel) * 2] << 8 | row[(x * n_channels + i_channel) * 2 + 1];
+
+        if (bitDepth == 8)
+            return row[x * n_channels + i_channel];
+
+        const index_t i_bit(x * bitDepth);
+        return row[i_bit / 8] >> (8 - bitDepth - i_bit % 8) & maxSample;
+    });
+
+    const auto to8Bit([&](unsigned sample) -> std::uint8_t
+    {
+        if (bitDepth == 16)
+            return std::uint8_t(sample >> 8);
+
+        return std::uint8_t(sample * 0xFF / maxSample);
+    });
+
+    const auto isColourKey([&](std::initializer_list<unsigned> samples)
+    {
+        if (std::size(transparency) != std::size(samples) * 2)
+            return false;
+
+        index_t i{};
+        for (unsigned sample : samples)
+        {
+            if (unsigned(transparency[i] << 8 | transparency[i + 1]) != sample)
+                return false;
+
+            i += 2;
+        }
+
+        return true;
+    });
+
+    // Adam7 passes are {x origin, y origin, x step, y step}
+    struct Pass
+    {
+        index_t x0, y0;
+        n_t dx, dy;
+    };
+
+    static const Pass adam7Passes[]{{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+    static const Pass noPasses[]{{0, 0, 1, 1}};
+    const std::span<const Pass> passes(interlaceMethod ? std::span<const Pass>(adam7Passes) : std::span<const Pass>(noPasses));
+
+    Image image(width, height);
+    index_t i_filtered{};
+    for (const Pass& pass : passes)
+    {
+        const n_t
+            passWidth(width > pass.x0 ? (width - pass.x0 + pass.dx - 1) / pass.dx : 0),
+            passHeight(height > pass.y0 ? (height - pass.y0 + pass.dy - 1) / pass.dy : 0);
+
+        if (!passWidth || !passHeight)
+            continue;
+
+        const n_t rowSize((passWidth * bitsPerPixel + 7) / 8);
+        std::vector<std::uint8_t> previousRow(rowSize), row(rowSize);
+        for (index_t y{}; y < passHeight; ++y)
+        {
+            if (i_filtered + 1 + rowSize > std::size(filtered))
+                throw std::runtime_error(LOG_INFO "PNG image data is truncated"s);
+
+            const std::uint8_t filter(filtered[i_filtered]);
+            std::copy_n(std::begin(filtered) + i_filtered + 1, rowSize, std::begin(row));
+            i_filtered += 1 + rowSize;
+            unfilter(filter, row, previousRow, bytesPerPixel);
+
+            const std::span<Pixel> out(image.row(pass.y0 + y * pass.dy));
+            for (index_t x{}; x < passWidth; ++x)
+            {
+                Pixel& p(out[pass.x0 + x * pass.dx]);
+                switch (colourType)
+                {
+                case 0:
+                {
+                    const unsigned v(readSample(row, x, 0));
+                    const std::uint8_t v8(to8Bit(v));
+                    p = {v8, v8, v8, std::uint8_t(isColourKey({v}) ? 0 : 0xFF)};
+                    break;
+                }
+
+                case 2:
+                {
+                    const unsigned r(readSample(row, x, 0)), g(readSample(row, x, 1)), b(readSample(row, x, 2));
+                    p = {to8Bit(r), to8Bit(g), to8Bit(b), std::uint8_t(isColourKey({r, g, b}) ? 0 : 0xFF)};
+                    break;
+                }
+
+                case 3:
+                {
+                    const unsigned i_colour(readSample(row, x, 0));
+                    if (i_colour >= std::size(palette))
+                        throw std::runtime_error(LOG_INFO "PNG palette index out of range"s);
+
+                    p = palette[i_colour];
+                    break;
+                }
+
+                case 4:
+                {
+                    const std::uint8_t v(to8Bit(readSample(row, x, 0)));
+                    p = {v, v, v, to8Bit(readSample(row, x, 1))};
+                    break;
+                }
+
+                case 6:
+                    p = {to8Bit(readSample(row, x, 0)), to8Bit(readSample(row, x, 1)), to8Bit(readSample(row, x, 2)), to8Bit(readSample(row, x, 3))};
+                    break;
+                }
+            }
+
+            std::swap(previousRow, row);
+        }
+    }
+
+    return image;
+}
+LOG_RETHROW
+
+Image readPng(const std::filesystem::path& filepath)
+try
+{
+    std::ifstream in(filepath, std::ios::binary);
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+
+    std::vector<std::uint8_t> data(std::filesystem::file_size(filepath));
+    in.read(reinterpret_cast<char*>(std::data(data)), std::ssize(data));
+    return readPng(data);
+}
+LOG_RETHROW
@@ -0,0 +1,44 @@
+module;
+
+#include "../global.h"
+
+export module png;
+
+export import image;
+
+import deflate;
+
+// Streaming 8-bit RGBA PNG encoder. Rows are filtered and compressed as they're written, so only two rows and the compressor's window are held in memory
+export class PngWriter
+{
+    const static n_t bytesPerPixel{4};
+
+    std::ostream* p_out;
+    n_t width, height;
+    index_t i_row{};
+
+    // Previous row unfiltered, and a filter type byte followed by a filtered row for each filter type
+    std::vector<std::uint8_t> previousRow, currentRow;
+    std::array<std::vector<std::uint8_t>, 5> filteredRows;
+
+    Deflater deflater;
+
+    void writeChunk(std::string_view type, std::span<const std::uint8_t> data);
+
+public:
+    // `compressionLevel` is the Deflater level, 1 favours throughput
+    PngWriter(std::ostream& out, n_t width, n_t height, unsigned compressionLevel = 1);
+
+    PngWriter(const PngWriter&) = delete;
+    auto operator=(PngWriter) = delete;
+
+    void writeRow(std::span<const Pixel> row);
+    void finish();
+};
+
+// Convenience for small images, throws on I/O error
+export void writePng(const std::filesystem::path& filepath, const Image& image, unsigned compressionLevel = 1);
+
+// Decodes any standard PNG (all colour types and bit depths, interlaced or not) to RGBA. Samples of 16-bit images are truncated to 8 bits
+export Image readPng(std::span<const std::uint8_t> data);
+export Image readPng(const std::filesystem::path& filepath);
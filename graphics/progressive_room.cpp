@@ -0,0 +1,284 @@
+#include "../global.h"
+
+import progressive_room;
+
+static const n_t screenPixels(screenSize * blockSize);
+
+ProgressiveRoomLoad::ProgressiveRoomLoad(const Tileset& tileset, std::span<const std::uint8_t> compressed, n_t width, n_t height, RoomViewport viewport, RoomRenderOptions options, OnScreen onScreen, n_t n_workers)
+try
+    : p_tileset(&tileset), options(options), onScreen(std::move(onScreen)), width(width), height(height), viewport(viewport), screens(width * height),
+      decompressor(std::in_place, compressed)
+{
+    threads.emplace_back([this](std::stop_token stopToken)
+    {
+        decompress(stopToken);
+    });
+
+    startWorkers(n_workers);
+}
+LOG_RETHROW
+
+ProgressiveRoomLoad::ProgressiveRoomLoad(const Tileset& tileset, const LevelData& levelData, RoomViewport viewport, RoomRenderOptions options, OnScreen onScreen, n_t n_workers)
+try
+    : p_tileset(&tileset), options(options), onScreen(std::move(onScreen)), width(levelData.width / screenSize), height(levelData.height / screenSize), viewport(viewport),
+      screens(width * height), p_levelData(&levelData)
+{
+    startWorkers(n_workers);
+}
+LOG_RETHROW
+
+ProgressiveRoomLoad::~ProgressiveRoomLoad()
+{
+    // Stopping every thread before joining any, so they wind down together
+    for (std::jthread& thread : threads)
+        thread.request_stop();
+
+    threads.clear();
+}
+
+void ProgressiveRoomLoad::startWorkers(n_t n_workers)
+try
+{
+    // Never more workers than screens
+    for (index_t i{}; i < std::min(std::max(n_workers, n_t(1)), std::size(screens)); ++i)
+        threads.emplace_back([this](std::stop_token stopToken)
+        {
+            work(stopToken);
+        });
+}
+LOG_RETHROW
+
+void ProgressiveRoomLoad::decompress(std::stop_token stopToken)
+try
+{
+    // A row of screens' worth of layer 1 at a time, each step lets the workers preview another row
+    const n_t
+        blocksWide(width * screenSize),
+        n_blocks(blocksWide * height * screenSize),
+        screenRowSize(blocksWide * screenSize * 2);
+
+    while (!decompressor->isDone())
+    {
+        if (stopToken.stop_requested())
+            return;
+
+        const std::span<const std::uint8_t> output(valueOrThrow(decompressor->decompressTo(std::size(decompressor->output()) + screenRowSize)));
+        {
+            std::lock_guard lock(mutex);
+            decompressed = output;
+        }
+
+        changed.notify_all();
+    }
+
+    // Level data is the layer 1 size in bytes, layer 1 blocks, one BTS byte per block, and optionally layer 2 blocks
+    const std::span<const std::uint8_t> data(decompressor->output());
+    if (std::size(data) < 2 + n_blocks * 3)
+        throw std::runtime_error(LOG_INFO "Level data is too small for a "s + std::to_string(width) + "x"s + std::to_string(height) + " screen room"s);
+
+    const std::span<const std::uint8_t> layer2(std::size(data) >= 2 + n_blocks * 5 ? data.subspan(2 + n_blocks * 3, n_blocks * 2) : std::span<const std::uint8_t>());
+    decodedLevelData.emplace(blocksWide, height * screenSize, data.subspan(2, n_blocks * 2), data.subspan(2 + n_blocks * 2, n_blocks), layer2);
+
+    // Previews already drawn are final if there's nothing the final render would add
+    const bool isPreviewFinal(!options.bts && (!options.layer2 || std::empty(decodedLevelData->layer2)));
+    std::vector<index_t> finalisedScreens;
+    {
+        std::lock_guard lock(mutex);
+        p_levelData = &*decodedLevelData;
+        for (index_t i_screen{}; i_screen < std::size(screens); ++i_screen)
+            if (ScreenState& state(screens[i_screen]); isPreviewFinal && state.isPreviewed && !state.isRendering && !state.isFinal)
+            {
+                state.isFinal = true;
+                finalisedScreens.push_back(i_screen);
+            }
+    }
+
+    changed.notify_all();
+    if (onScreen)
+        for (index_t i_screen : finalisedScreens)
+            onScreen(i_screen % width, i_screen / width, true);
+}
+catch (const std::exception& e)
+{
+    DebugFile(DebugFile::error) << LOG_INFO "Failed to decompress level data: "s << e.what() << '\n';
+    {
+        std::lock_guard lock(mutex);
+        error = std::current_exception();
+    }
+
+    changed.notify_all();
+}
+
+std::optional<index_t> ProgressiveRoomLoad::findScreen() const
+try
+{
+    // Nearest by the gap between the screen and the viewport, then by the distance between their centres, so that screens fill in outwards from the view
+    const auto priority([&](index_t i_screen) -> std::pair<std::ptrdiff_t, std::ptrdiff_t>
+    {
+        const std::ptrdiff_t
+            x_screen(std::ptrdiff_t(i_screen % width * screenPixels)),
+            y_screen(std::ptrdiff_t(i_screen / width * screenPixels)),
+            pixels(std::ptrdiff_t(screenPixels)),
+            gapX(std::max({x_screen - (viewport.x + std::ptrdiff_t(viewport.width)), viewport.x - (x_screen + pixels), std::ptrdiff_t{}})),
+            gapY(std::max({y_screen - (viewport.y + std::ptrdiff_t(viewport.height)), viewport.y - (y_screen + pixels), std::ptrdiff_t{}})),
+            dx(2 * x_screen + pixels - (2 * viewport.x + std::ptrdiff_t(viewport.width))),
+            dy(2 * y_screen + pixels - (2 * viewport.y + std::ptrdiff_t(viewport.height)));
+
+        return {std::max(gapX, gapY), dx * dx + dy * dy};
+    });
+
+    // Layer 1 is stored a row of blocks at a time across the whole room, so a screen can be previewed once the rows of its row of screens are decompressed
+    const n_t screenRowSize(width * screenSize * screenSize * 2);
+    const auto isReady([&](index_t i_screen)
+    {
+        const ScreenState& state(screens[i_screen]);
+        if (state.isFinal || state.isRendering)
+            return false;
+
+        if (p_levelData)
+            return true;
+
+        return options.layer1 && !state.isPreviewed && std::size(decompressed) >= 2 + (i_screen / width + 1) * screenRowSize;
+    });
+
+    std::optional<index_t> ret;
+    for (index_t i_screen{}; i_screen < std::size(screens); ++i_screen)
+        if (isReady(i_screen) && (!ret || priority(i_screen) < priority(*ret)))
+            ret = i_screen;
+
+    return ret;
+}
+LOG_RETHROW
+
+bool ProgressiveRoomLoad::isFinished() const
+try
+{
+    return error || std::ranges::all_of(screens, &ScreenState::isFinal);
+}
+LOG_RETHROW
+
+void ProgressiveRoomLoad::work(std::stop_token stopToken)
+try
+{
+    for (;;)
+    {
+        std::unique_lock lock(mutex);
+        std::optional<index_t> i_screen;
+        changed.wait(lock, stopToken, [&]()
+        {
+            i_screen = findScreen();
+            return i_screen || isFinished();
+        });
+
+        if (stopToken.stop_requested() || !i_screen)
+            return;
+
+        ScreenState& state(screens[*i_screen]);
+        state.isRendering = true;
+        const LevelData* const p_finalLevelData(p_levelData);
+        const std::span<const std::uint8_t> data(decompressed);
+        lock.unlock();
+
+        const index_t x_screen(*i_screen % width), y_screen(*i_screen / width);
+        auto p_image(std::make_shared<Image>(screenPixels, screenPixels));
+        if (p_finalLevelData)
+            RoomRenderer(*p_tileset, *p_finalLevelData, options).renderScreen(x_screen, y_screen, *p_image);
+        else
+        {
+            // The screen's layer 1 blocks cut out as level data of their own, drawn without layer 2 and BTS as they aren't decompressed yet
+            const n_t rowSize(width * screenSize * 2);
+            std::vector<std::uint8_t> layer1;
+            for (index_t y{}; y < screenSize; ++y)
+            {
+                const auto it_row(std::begin(data) + 2 + (y_screen * screenSize + y) * rowSize + x_screen * screenSize * 2);
+                layer1.insert(std::end(layer1), it_row, it_row + screenSize * 2);
+            }
+
+            const std::vector<std::uint8_t> bts(screenSize * screenSize);
+            const LevelData preview(screenSize, screenSize, layer1, bts, {});
+            RoomRenderer(*p_tileset, preview, RoomRenderOptions{true, false, false}).renderScreen(0, 0, *p_image);
+        }
+
+        lock.lock();
+        state.p_image = std::move(p_image);
+        state.isRendering = false;
+        state.isPreviewed = true;
+        state.isFinal = p_finalLevelData != nullptr || (p_levelData && !options.bts && (!options.layer2 || std::empty(p_levelData->layer2)));
+        const bool isFinal(state.isFinal);
+        lock.unlock();
+
+        changed.notify_all();
+        if (onScreen)
+            onScreen(x_screen, y_screen, isFinal);
+    }
+}
+catch (const std::exception& e)
+{
+    DebugFile(DebugFile::error) << LOG_INFO "Failed to render room screen: "s << e.what() << '\n';
+    {
+        std::lock_guard lock(mutex);
+        error = std::current_exception();
+    }
+
+    changed.notify_all();
+}
+
+void ProgressiveRoomLoad::setViewport(RoomViewport viewport_in)
+try
+{
+    std::lock_guard lock(mutex);
+    viewport = viewport_in;
+}
+LOG_RETHROW
+
+n_t ProgressiveRoomLoad::screensWide() const noexcept
+{
+    return width;
+}
+
+n_t ProgressiveRoomLoad::screensHigh() const noexcept
+{
+    return height;
+}
+
+ProgressiveRoomLoad::Screen ProgressiveRoomLoad::screen(index_t x_screen, index_t y_screen) const
+try
+{
+    if (x_screen >= width || y_screen >= height)
+        throw std::out_of_range(LOG_INFO "Screen ("s + std::to_string(x_screen) + ", "s + std::to_string(y_screen) + ") is outside the room"s);
+
+    std::lock_guard lock(mutex);
+    const ScreenState& state(screens[y_screen * width + x_screen]);
+    return {state.p_image, state.isFinal};
+}
+LOG_RETHROW
+
+const LevelData* ProgressiveRoomLoad::levelData() const
+try
+{
+    std::lock_guard lock(mutex);
+    return p_levelData;
+}
+LOG_RETHROW
+
+bool ProgressiveRoomLoad::isDone() const
+try
+{
+    std::lock_guard lock(mutex);
+    return !error && isFinished();
+}
+LOG_RETHROW
+
+void ProgressiveRoomLoad::wait() const
+try
+{
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [&]()
+    {
+        return isFinished();
+    });
+
+    if (error)
+        std::rethrow_exception(error);
+}
+LOG_RETHROW
@@ -0,0 +1,105 @@
+module;
+
+#include "../global.h"
+
+export module progressive_room;
+
+export import decompress;
+export import room_renderer;
+
+// The part of the room being shown, in room pixel coordinates. May extend past the room's edges
+export struct RoomViewport
+{
+    std::ptrdiff_t x, y;
+    n_t width, height;
+};
+
+// Decompresses and renders a room a screen at a time on background workers, publishing each screen as it's done.
+// Screens are taken in order of their distance from the viewport, so the visible screens appear first however big the room is.
+// Level data is one compressed stream, layer 1 then BTS then layer 2, so screens are first previewed with layer 1 alone as its rows are decompressed.
+// The final render replaces the preview once the whole stream is decompressed, or the preview is kept if it's already what the final render would draw
+export class ProgressiveRoomLoad
+{
+public:
+    struct Screen
+    {
+        // Null until the screen's first been rendered
+        std::shared_ptr<const Image> p_image;
+        bool isFinal;
+    };
+
+    // Called on a worker thread after a screen is published
+    using OnScreen = std::function<void(index_t x_screen, index_t y_screen, bool isFinal)>;
+
+private:
+    struct ScreenState
+    {
+        std::shared_ptr<const Image> p_image;
+        bool isPreviewed, isFinal, isRendering;
+    };
+
+    const Tileset* p_tileset;
+    RoomRenderOptions options;
+    OnScreen onScreen;
+
+    // In screens
+    n_t width, height;
+
+    mutable std::mutex mutex;
+    mutable std::condition_variable_any changed;
+    RoomViewport viewport;
+    std::vector<ScreenState> screens;
+
+    // Outlives the workers, which read the output published in `decompressed` after unlocking. Its output is reserved up front so it never moves.
+    // Empty when the level data was given already decompressed
+    std::optional<StreamingDecompressor> decompressor;
+
+    // The decompressed level data so far
+    std::span<const std::uint8_t> decompressed;
+
+    // Null until the whole room is decompressed. Points to `decodedLevelData` unless the level data was given
+    const LevelData* p_levelData{};
+    std::optional<LevelData> decodedLevelData;
+    std::exception_ptr error;
+
+    // Declared last so that the workers are stopped before anything they use is destroyed
+    std::vector<std::jthread> threads;
+
+    void startWorkers(n_t n_workers);
+    void decompress(std::stop_token stopToken);
+    void work(std::stop_token stopToken);
+
+    // The pending screen nearest the viewport that can be rendered now, if any. Called with the mutex held
+    std::optional<index_t> findScreen() const;
+    bool isFinished() const;
+
+public:
+    // Decompresses `compressed`, which must stay valid and unchanged until the load is finished or destroyed. `width` and `height` are in screens
+    ProgressiveRoomLoad(const Tileset& tileset, std::span<const std::uint8_t> compressed, n_t width, n_t height, RoomViewport viewport, RoomRenderOptions options = {}, OnScreen onScreen = {}, n_t n_workers = std::thread::hardware_concurrency());
+
+    // Renders level data that's already decompressed, e.g. a live room. `levelData` must outlive the load
+    ProgressiveRoomLoad(const Tileset& tileset, const LevelData& levelData, RoomViewport viewport, RoomRenderOptions options = {}, OnScreen onScreen = {}, n_t n_workers = std::thread::hardware_concurrency());
+
+    ProgressiveRoomLoad(const ProgressiveRoomLoad&) = delete;
+    auto operator=(ProgressiveRoomLoad) = delete;
+
+    // Stops the workers, screens being rendered are finished first
+    ~ProgressiveRoomLoad();
+
+    // Reorders the screens still to be rendered, e.g. when the view scrolls
+    void setViewport(RoomViewport viewport);
+
+    n_t screensWide() const noexcept;
+    n_t screensHigh() const noexcept;
+
+    Screen screen(index_t x_screen, index_t y_screen) const;
+
+    // Null until the whole room's decompressed
+    const LevelData* levelData() const;
+
+    // Every screen has its final render
+    bool isDone() const;
+
+    // Blocks until every screen has its final render. Throws if the level data couldn't be decompressed
+    void wait() const;
+};
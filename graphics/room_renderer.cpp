@@ -0,0 +1,167 @@
+#include "../global.h"
+
+import room_renderer;
+
+import game_traits;
+
+static const Pixel transparent{};
+
+// Block type tints for the BTS overlay, alpha is the tint strength
+static const Pixel blockTypeTints[0x10]
+{
+    {0x00, 0x00, 0x00, 0x00}, // 0: Air
+    {0x00, 0xFF, 0x00, 0x60}, // 1: Slope
+    {0xFF, 0x00, 0x00, 0x40}, // 2: Spike air
+    {0xFF, 0xFF, 0x00, 0x40}, // 3: Special air
+    {0x00, 0xFF, 0xFF, 0x40}, // 4: Shootable air
+    {0x80, 0x80, 0x80, 0x40}, // 5: Horizontal extension
+    {0x00, 0x00, 0x00, 0x00}, // 6: Unused
+    {0xFF, 0x80, 0x00, 0x40}, // 7: Bombable air
+    {0x00, 0x00, 0xFF, 0x60}, // 8: Solid
+    {0xFF, 0x00, 0xFF, 0x80}, // 9: Door
+    {0xFF, 0x00, 0x00, 0x80}, // A: Spike
+    {0xFF, 0xFF, 0x00, 0x80}, // B: Special
+    {0x00, 0xFF, 0xFF, 0x80}, // C: Shootable
+    {0x80, 0x80, 0x80, 0x40}, // D: Vertical extension
+    {0x80, 0x00, 0xFF, 0x80}, // E: Grapple
+    {0xFF, 0x80, 0x00, 0x80}  // F: Bombable
+};
+
+// 3x5 hex digit glyphs, one bit per pixel, top row in the most significant bits
+static const std::uint16_t hexFont[0x10]
+{
+    0b111'101'101'101'111, 0b010'110'010'010'111, 0b111'001'111'100'111, 0b111'001'111'001'111,
+    0b101'101'111'001'001, 0b111'100'111'001'111, 0b111'100'111'101'111, 0b111'001'001'001'001,
+    0b111'101'111'101'111, 0b111'101'111'001'111, 0b010'101'111'101'101, 0b110'101'110'101'110,
+    0b011'100'100'100'011, 0b110'101'101'101'110, 0b111'100'111'100'111, 0b111'100'111'100'100
+};
+
+static void drawBlock(const Tileset& tileset, std::uint16_t block, Image& out, index_t x_out, index_t y_out)
+try
+{
+    // Block flips apply to the metatile as a whole, so they swap quadrants as well as flipping each tile
+    const DecodedBlock decoded(SuperMetroidTraits::Blocks::decode(block));
+    const index_t i_metatile(decoded.i_metatile);
+    const unsigned blockXFlip(decoded.xFlip), blockYFlip(decoded.yFlip);
+    for (unsigned i_quadrant{}; i_quadrant < 4; ++i_quadrant)
+    {
+        const std::uint16_t entry(tileset.tileTable[i_metatile * 4 + i_quadrant]);
+        const index_t i_tile(entry & 0x3FF);
+        const index_t i_palette(entry >> 10 & 7);
+        const bool
+            xFlip((entry >> 14 & 1) != blockXFlip),
+            yFlip((entry >> 15 & 1) != blockYFlip);
+
+        const index_t
+            x_tile(x_out + ((i_quadrant & 1) ^ blockXFlip) * tileSize),
+            y_tile(y_out + (i_quadrant >> 1 ^ blockYFlip) * tileSize);
+
+        const std::uint8_t* const p_tile(&tileset.tiles[i_tile * tileSize * tileSize]);
+        const Pixel* const p_palette(&tileset.palette[i_palette * 0x10]);
+        for (index_t y{}; y < tileSize; ++y)
+        {
+            const std::uint8_t* const p_in(p_tile + (yFlip ? tileSize - 1 - y : y) * tileSize);
+            Pixel* const p_out(&out.row(y_tile + y)[x_tile]);
+            for (index_t x{}; x < tileSize; ++x)
+            {
+                const std::uint8_t i_colour(p_in[xFlip ? tileSize - 1 - x : x]);
+                if (i_colour)
+                    p_out[x] = p_palette[i_colour];
+            }
+        }
+    }
+}
+LOG_RETHROW
+
+static void drawGlyph(Image& out, index_t x, index_t y, unsigned digit, Pixel colour)
+try
+{
+    for (index_t y_glyph{}; y_glyph < 5; ++y_glyph)
+        for (index_t x_glyph{}; x_glyph < 3; ++x_glyph)
+            if (hexFont[digit] >> (14 - y_glyph * 3 - x_glyph) & 1)
+                out.row(y + y_glyph)[x + x_glyph] = colour;
+}
+LOG_RETHROW
+
+static void drawBts(Image& out, index_t x_out, index_t y_out, unsigned blockType, std::uint8_t bts)
+try
+{
+    const Pixel tint(blockTypeTints[blockType]);
+    if (tint.a)
+        for (index_t y{}; y < blockSize; ++y)
+            for (Pixel& p : out.row(y_out + y).subspan(x_out, blockSize))
+            {
+                const auto blend([&](std::uint8_t from, std::uint8_t to)
+                {
+                    return std::uint8_t((from * (0xFF - tint.a) + to * tint.a) / 0xFF);
+                });
+
+                p = {blend(p.r, tint.r), blend(p.g, tint.g), blend(p.b, tint.b), p.a};
+            }
+
+    if (!bts)
+        return;
+
+    const Pixel shadow{0, 0, 0, 0xFF}, text{0xFF, 0xFF, 0xFF, 0xFF};
+    for (const auto& [d, colour] : {std::pair{1, shadow}, std::pair{0, text}})
+    {
+        drawGlyph(out, x_out + 1 + d, y_out + 1 + d, bts >> 4, colour);
+        drawGlyph(out, x_out + 5 + d, y_out + 1 + d, bts & 0xF, colour);
+    }
+}
+LOG_RETHROW
+
+RoomRenderer::RoomRenderer(const Tileset& tileset, const LevelData& levelData, RoomRenderOptions options, const SpriteAtlas* p_spriteAtlas, std::span<const SpriteInstance> sprites)
+    : p_tileset(&tileset), p_levelData(&levelData), options(options), p_spriteAtlas(p_spriteAtlas), sprites(sprites)
+{}
+
+n_t RoomRenderer::width() const noexcept
+{
+    return p_levelData->width * blockSize;
+}
+
+n_t RoomRenderer::height() const noexcept
+{
+    return p_levelData->height * blockSize;
+}
+
+void RoomRenderer::renderBlock(index_t x_block, index_t y_block, Image& out, index_t x_out, index_t y_out) const
+try
+{
+    // Layer 2 is drawn behind layer 1 regardless of tile priority
+    const index_t i_block(y_block * p_levelData->width + x_block);
+    if (options.layer2 && !std::empty(p_levelData->layer2))
+        drawBlock(*p_tileset, p_levelData->layer2[i_block], out, x_out, y_out);
+
+    if (options.layer1)
+        drawBlock(*p_tileset, p_levelData->layer1[i_block], out, x_out, y_out);
+
+    if (options.bts)
+        drawBts(out, x_out, y_out, SuperMetroidTraits::Blocks::decode(p_levelData->layer1[i_block]).type, p_levelData->bts[i_block]);
+}
+LOG_RETHROW
+
+void RoomRenderer::renderBlockRow(index_t y_block, Image& strip) const
+try
+{
+    std::ranges::fill(strip.data(), options.transparent ? transparent : backdrop);
+    for (index_t x_block{}; x_block < p_levelData->width; ++x_block)
+        renderBlock(x_block, y_block, strip, x_block * blockSize, 0);
+
+    if (p_spriteAtlas)
+        p_spriteAtlas->draw(sprites, strip, 0, std::ptrdiff_t(y_block * blockSize));
+}
+LOG_RETHROW
+
+void RoomRenderer::renderScreen(index_t x_screen, index_t y_screen, Image& screen) const
+try
+{
+    std::ranges::fill(screen.data(), options.transparent ? transparent : backdrop);
+    for (index_t y{}; y < screenSize; ++y)
+        for (index_t x{}; x < screenSize; ++x)
+            renderBlock(x_screen * screenSize + x, y_screen * screenSize + y, screen, x * blockSize, y * blockSize);
+
+    if (p_spriteAtlas)
+        p_spriteAtlas->draw(sprites, screen, std::ptrdiff_t(x_screen * screenSize * blockSize), std::ptrdiff_t(y_screen * screenSize * blockSize));
+}
+LOG_RETHROW
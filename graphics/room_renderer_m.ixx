@@ -0,0 +1,47 @@
+module;
+
+#include "../global.h"
+
+export module room_renderer;
+
+export import image;
+export import sm_room;
+export import sm_tileset;
+export import sprite_atlas;
+
+// Drawn where no layer covers a pixel
+export const Pixel backdrop{0, 0, 0, 0xFF};
+
+export struct RoomRenderOptions
+{
+    bool layer1{true}, layer2{true}, bts{};
+
+    // Leave pixels no layer draws over transparent rather than filling them with the backdrop, for drawing layers separately
+    bool transparent{};
+};
+
+// Renders a room a row of blocks or a screen at a time, so that a whole room image never needs to be held in memory
+export class RoomRenderer
+{
+    const Tileset* p_tileset;
+    const LevelData* p_levelData;
+    RoomRenderOptions options;
+    const SpriteAtlas* p_spriteAtlas;
+    std::span<const SpriteInstance> sprites;
+
+    void renderBlock(index_t x_block, index_t y_block, Image& out, index_t x_out, index_t y_out) const;
+
+public:
+    // `sprites` are drawn over the level data, positioned in room pixel coordinates
+    RoomRenderer(const Tileset& tileset, const LevelData& levelData, RoomRenderOptions options = {}, const SpriteAtlas* p_spriteAtlas = {}, std::span<const SpriteInstance> sprites = {});
+
+    // In pixels
+    n_t width() const noexcept;
+    n_t height() const noexcept;
+
+    // `strip` is an image of width() by blockSize pixels
+    void renderBlockRow(index_t y_block, Image& strip) const;
+
+    // `screen` is an image of screenSize * blockSize pixels square
+    void renderScreen(index_t x_screen, index_t y_screen, Image& screen) const;
+};
@@ -0,0 +1,184 @@
+#include "../global.h"
+
+import scene_preview;
+
+static Image renderLayer(const Tileset& tileset, const LevelData& levelData, RoomRenderOptions options)
+try
+{
+    // A block row's strip is the same pixels in the same order as the surface's block row, so it's copied in one go
+    const RoomRenderer renderer(tileset, levelData, options);
+    Image ret(renderer.width(), renderer.height());
+    std::vector<index_t> blockRows(levelData.height);
+    std::iota(std::begin(blockRows), std::end(blockRows), index_t{});
+    std::for_each(std::execution::par, std::begin(blockRows), std::end(blockRows), [&](index_t y_block)
+    {
+        Image strip(renderer.width(), blockSize);
+        renderer.renderBlockRow(y_block, strip);
+        std::ranges::copy(strip.data(), std::begin(ret.row(y_block * blockSize)));
+    });
+
+    return ret;
+}
+LOG_RETHROW
+
+ParallaxRates parallaxRates(const RoomState& state)
+try
+{
+    const auto rate([](std::uint8_t scroll)
+    {
+        return scroll & 0xFE ? unsigned(scroll & 0xFE) : 0x100u;
+    });
+
+    return {rate(state.layer2ScrollX), rate(state.layer2ScrollY)};
+}
+LOG_RETHROW
+
+ScenePreview::ScenePreview(const Tileset& tileset, const LevelData& levelData, ParallaxRates rates, n_t frameWidth, n_t frameHeight)
+try
+    : layer1(renderLayer(tileset, levelData, RoomRenderOptions{true, false, false, true})), rates(rates), frameWidth(frameWidth), frameHeight(frameHeight)
+{
+    // Without layer 2 in the level data the surface is left empty, and the backdrop shows through layer 1
+    if (!std::empty(levelData.layer2))
+        layer2 = renderLayer(tileset, levelData, RoomRenderOptions{false, true, false});
+
+    findRuns();
+}
+LOG_RETHROW
+
+void ScenePreview::findRuns()
+try
+{
+    rowRuns.reserve(layer1.height() + 1);
+    for (index_t y{}; y < layer1.height(); ++y)
+    {
+        rowRuns.push_back(std::size(runs));
+        const std::span<const Pixel> row(layer1.row(y));
+        for (index_t x{}; x < std::size(row);)
+        {
+            if (!row[x].a)
+            {
+                ++x;
+                continue;
+            }
+
+            const index_t x_begin(x);
+            while (x < std::size(row) && row[x].a)
+                ++x;
+
+            runs.push_back({x_begin, x - x_begin});
+        }
+    }
+
+    rowRuns.push_back(std::size(runs));
+}
+LOG_RETHROW
+
+n_t ScenePreview::width() const noexcept
+{
+    return layer1.width();
+}
+
+n_t ScenePreview::height() const noexcept
+{
+    return layer1.height();
+}
+
+void ScenePreview::setParallaxRates(ParallaxRates rates_in) noexcept
+{
+    rates = rates_in;
+}
+
+CameraPosition ScenePreview::clamp(CameraPosition camera) const noexcept
+{
+    const std::ptrdiff_t
+        maxX(std::max(std::ptrdiff_t(width()) - std::ptrdiff_t(frameWidth), std::ptrdiff_t{})),
+        maxY(std::max(std::ptrdiff_t(height()) - std::ptrdiff_t(frameHeight), std::ptrdiff_t{}));
+
+    return {std::max(std::min(camera.x, maxX), std::ptrdiff_t{}), std::max(std::min(camera.y, maxY), std::ptrdiff_t{})};
+}
+
+CameraPosition ScenePreview::layer2Position(CameraPosition camera) const noexcept
+{
+    const CameraPosition clamped(clamp(camera));
+    return {clamped.x * std::ptrdiff_t(rates.x) / 0x100, clamped.y * std::ptrdiff_t(rates.y) / 0x100};
+}
+
+void ScenePreview::compose(CameraPosition camera_in, Image& frame) const
+try
+{
+    if (frame.width() != frameWidth || frame.height() != frameHeight)
+        throw std::invalid_argument(LOG_INFO "Frame is "s + std::to_string(frame.width()) + "x"s + std::to_string(frame.height()) + ", expected "s + std::to_string(frameWidth) + "x"s + std::to_string(frameHeight));
+
+    const CameraPosition camera(clamp(camera_in)), position2(layer2Position(camera_in));
+    const std::ptrdiff_t frameEnd(camera.x + std::ptrdiff_t(frameWidth));
+    for (index_t y{}; y < frameHeight; ++y)
+    {
+        const std::span<Pixel> out(frame.row(y));
+
+        // Layer 2 row copied whole, with the backdrop either side of it where the frame goes past layer 2's edges
+        const std::ptrdiff_t
+            y2(position2.y + std::ptrdiff_t(y)),
+            x2Begin(std::max(position2.x, std::ptrdiff_t{})),
+            x2End(std::min(position2.x + std::ptrdiff_t(frameWidth), std::ptrdiff_t(layer2.width())));
+
+        if (y2 < std::ptrdiff_t(layer2.height()) && x2Begin < x2End)
+        {
+            const std::span<const Pixel> row2(layer2.row(y2));
+            std::fill(std::begin(out), std::begin(out) + (x2Begin - position2.x), backdrop);
+            const auto it_end(std::copy(std::begin(row2) + x2Begin, std::begin(row2) + x2End, std::begin(out) + (x2Begin - position2.x)));
+            std::fill(it_end, std::end(out), backdrop);
+        }
+        else
+            std::ranges::fill(out, backdrop);
+
+        // Layer 1's runs that overlap the frame, clipped to it
+        const index_t y1(index_t(camera.y) + y);
+        if (y1 >= height())
+            continue;
+
+        const std::span<const Pixel> row1(layer1.row(y1));
+        const auto it_rowEnd(std::begin(runs) + rowRuns[y1 + 1]);
+        auto it_run(std::partition_point(std::begin(runs) + rowRuns[y1], it_rowEnd, [&](const Run& run)
+        {
+            return std::ptrdiff_t(run.x + run.length) <= camera.x;
+        }));
+
+        for (; it_run != it_rowEnd && std::ptrdiff_t(it_run->x) < frameEnd; ++it_run)
+        {
+            const std::ptrdiff_t begin(std::max(std::ptrdiff_t(it_run->x), camera.x)), end(std::min(std::ptrdiff_t(it_run->x + it_run->length), frameEnd));
+            std::copy(std::begin(row1) + begin, std::begin(row1) + end, std::begin(out) + (begin - camera.x));
+        }
+    }
+}
+LOG_RETHROW
+
+std::vector<CameraPosition> ScenePreview::sweep(n_t speed) const
+try
+{
+    // The start and end of each row of screens, alternately left to right and right to left, with the last row against the bottom of the room
+    const CameraPosition last(clamp({std::numeric_limits<std::ptrdiff_t>::max(), std::numeric_limits<std::ptrdiff_t>::max()}));
+    const std::ptrdiff_t screenPixels(screenSize * blockSize);
+    std::vector<CameraPosition> waypoints;
+    for (std::ptrdiff_t y{};; y += screenPixels)
+    {
+        const std::ptrdiff_t y_row(std::min(y, last.y));
+        const bool isReversed(std::size(waypoints) / 2 % 2);
+        waypoints.push_back({isReversed ? last.x : 0, y_row});
+        waypoints.push_back({isReversed ? 0 : last.x, y_row});
+        if (y_row == last.y)
+            break;
+    }
+
+    // Consecutive waypoints are in line, so stepping each axis towards the next waypoint moves along the line
+    const std::ptrdiff_t step(std::max(std::ptrdiff_t(speed), std::ptrdiff_t(1)));
+    std::vector<CameraPosition> ret{waypoints.front()};
+    for (const CameraPosition& waypoint : waypoints)
+        while (ret.back() != waypoint)
+        {
+            const CameraPosition from(ret.back());
+            ret.push_back({from.x + std::clamp(waypoint.x - from.x, -step, step), from.y + std::clamp(waypoint.y - from.y, -step, step)});
+        }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,72 @@
+module;
+
+#include "../global.h"
+
+export module scene_preview;
+
+export import room_renderer;
+
+// The rate the camera's simulated at when animating a scene
+export const n_t framesPerSecond{60};
+
+// Layer 2's scroll speed relative to layer 1 in 1/100h, 100h scrolls with layer 1 and 0 holds layer 2 still
+export struct ParallaxRates
+{
+    unsigned x{0x100}, y{0x100};
+};
+
+// The rates the game derives from a room state's layer 2 scroll values.
+// Bit 0 marks layer 2 as a library background rather than level data and isn't part of the rate, the rest is the rate except that 0 scrolls with layer 1
+export ParallaxRates parallaxRates(const RoomState& state);
+
+// Camera position in room pixels, the top left of the frame
+export struct CameraPosition
+{
+    std::ptrdiff_t x, y;
+
+    bool operator==(const CameraPosition&) const = default;
+};
+
+// A room's layers rendered once to surfaces of their own, so that a frame at any camera position is composed from offset row copies without drawing any tiles.
+// Layer 2 is drawn over the backdrop and copied whole, layer 1 keeps the runs of pixels it covers so that only they're copied over it
+export class ScenePreview
+{
+    struct Run
+    {
+        index_t x;
+        n_t length;
+    };
+
+    Image layer1, layer2;
+    ParallaxRates rates;
+    n_t frameWidth, frameHeight;
+
+    // Layer 1's opaque pixel runs, a row's runs are runs[rowRuns[y]] to runs[rowRuns[y + 1]], left to right
+    std::vector<Run> runs;
+    std::vector<index_t> rowRuns;
+
+    void findRuns();
+
+public:
+    // Rendering the layers is the only time tiles are drawn, frames are `frameWidth` by `frameHeight` pixels
+    ScenePreview(const Tileset& tileset, const LevelData& levelData, ParallaxRates rates, n_t frameWidth = 0x100, n_t frameHeight = 0xE0);
+
+    // In pixels
+    n_t width() const noexcept;
+    n_t height() const noexcept;
+
+    // Cheap to change, nothing is re-rendered
+    void setParallaxRates(ParallaxRates rates) noexcept;
+
+    // Limits a camera position to the room as the game does, so that the frame doesn't go past the room's edges where it fits
+    CameraPosition clamp(CameraPosition camera) const noexcept;
+
+    // Layer 2's position for a camera position, after clamping
+    CameraPosition layer2Position(CameraPosition camera) const noexcept;
+
+    // `frame` is a frameWidth by frameHeight image
+    void compose(CameraPosition camera, Image& frame) const;
+
+    // The camera moving `speed` pixels a frame across each row of screens in turn, alternating direction, and down between rows, a position a frame
+    std::vector<CameraPosition> sweep(n_t speed) const;
+};
@@ -0,0 +1,23 @@
+#include "../global.h"
+
+import snes_graphics;
+
+import tile_format;
+
+std::vector<Pixel> decodePalette(std::span<const std::uint8_t> in)
+try
+{
+    std::vector<Pixel> ret(std::size(in) / 2);
+    for (index_t i{}; i < std::size(ret); ++i)
+        ret[i] = bgr555ToPixel(std::uint16_t(in[i * 2] | in[i * 2 + 1] << 8));
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> decodeTiles4bpp(std::span<const std::uint8_t> in)
+try
+{
+    return decodeTiles<SnesTile4bpp>(in);
+}
+LOG_RETHROW
@@ -0,0 +1,37 @@
+module;
+
+#include "../global.h"
+
+export module snes_graphics;
+
+export import image;
+
+export const n_t tileSize{8};
+
+// SNES colours are 0bbbbbgggggrrrrr
+export constexpr Pixel bgr555ToPixel(std::uint16_t colour) noexcept
+{
+    const auto expand([](unsigned v) -> std::uint8_t
+    {
+        return std::uint8_t(v << 3 | v >> 2);
+    });
+
+    return {expand(colour & 0x1F), expand(colour >> 5 & 0x1F), expand(colour >> 10 & 0x1F), 0xFF};
+}
+
+// Rounds to the nearest 5-bit value of each channel
+export constexpr std::uint16_t pixelToBgr555(Pixel pixel) noexcept
+{
+    const auto reduce([](unsigned v) -> unsigned
+    {
+        return (v * 0x1F + 0x7F) / 0xFF;
+    });
+
+    return std::uint16_t(reduce(pixel.r) | reduce(pixel.g) << 5 | reduce(pixel.b) << 10);
+}
+
+// Decodes little endian BGR555 colours
+export std::vector<Pixel> decodePalette(std::span<const std::uint8_t> in);
+
+// Decodes SNES 4bpp planar tiles (32 bytes per tile) to one byte per pixel, 64 bytes per tile
+export std::vector<std::uint8_t> decodeTiles4bpp(std::span<const std::uint8_t> in);
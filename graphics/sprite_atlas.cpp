@@ -0,0 +1,168 @@
+#include "../global.h"
+
+import sprite_atlas;
+
+SpriteAtlas::SpriteAtlas(n_t pageSize)
+try
+    : pageSize(pageSize)
+{
+    if (!pageSize)
+        throw std::runtime_error(LOG_INFO "Sprite atlas page size must be non-zero"s);
+}
+LOG_RETHROW
+
+std::optional<SpriteAtlas::Placement> SpriteAtlas::place(index_t i_page, n_t width, n_t height)
+try
+{
+    Page& page(pages[i_page]);
+    std::vector<SkylineSegment>& skyline(page.skyline);
+    if (width > page.image.width() || height > page.image.height())
+        return {};
+
+    // Bottom-left heuristic: of the positions where the sprite's left edge is at the start of a segment, take the one with the lowest top edge, then the leftmost
+    index_t i_best(std::size(skyline)), y_best{};
+    for (index_t i{}; i < std::size(skyline); ++i)
+    {
+        const index_t x(skyline[i].x);
+        if (x + width > page.image.width())
+            break;
+
+        // The sprite rests on the highest segment it spans
+        index_t y{};
+        for (index_t i_span(i); i_span < std::size(skyline) && skyline[i_span].x < x + width; ++i_span)
+            y = std::max(y, skyline[i_span].y);
+
+        if (y + height <= page.image.height() && (i_best == std::size(skyline) || y < y_best))
+        {
+            i_best = i;
+            y_best = y;
+        }
+    }
+
+    if (i_best == std::size(skyline))
+        return {};
+
+    // Replace the covered part of the skyline with the sprite's top edge
+    const index_t x(skyline[i_best].x), x_end(x + width);
+    index_t i_end(i_best);
+    while (i_end < std::size(skyline) && skyline[i_end].x + skyline[i_end].width <= x_end)
+        ++i_end;
+
+    if (i_end < std::size(skyline) && skyline[i_end].x < x_end)
+    {
+        SkylineSegment& partial(skyline[i_end]);
+        partial.width -= x_end - partial.x;
+        partial.x = x_end;
+    }
+
+    skyline.erase(std::begin(skyline) + i_best, std::begin(skyline) + i_end);
+    skyline.insert(std::begin(skyline) + i_best, {x, y_best + height, width});
+
+    // Merge neighbouring segments at the same height
+    for (index_t i(i_best ? i_best - 1 : 0); i + 1 < std::size(skyline) && i <= i_best + 1;)
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(std::begin(skyline) + i + 1);
+        }
+        else
+            ++i;
+
+    return Placement{i_page, x, y_best, width, height};
+}
+LOG_RETHROW
+
+index_t SpriteAtlas::add(const Image& sprite)
+try
+{
+    const n_t width(sprite.width()), height(sprite.height());
+    std::optional<Placement> placement;
+    for (index_t i_page{}; i_page < std::size(pages) && !placement; ++i_page)
+        placement = place(i_page, width, height);
+
+    if (!placement)
+    {
+        const n_t pageWidth(std::max(pageSize, width)), pageHeight(std::max(pageSize, height));
+        pages.push_back({Image(pageWidth, pageHeight), {{0, 0, pageWidth}}});
+        placement = place(std::size(pages) - 1, width, height);
+        if (!placement)
+            throw std::runtime_error(LOG_INFO "Sprite doesn't fit in an empty atlas page"s);
+    }
+
+    Image& page(pages[placement->i_page].image);
+    for (index_t y{}; y < height; ++y)
+        std::ranges::copy(sprite.row(y), std::begin(page.row(placement->y + y)) + placement->x);
+
+    placements.push_back(*placement);
+    return std::size(placements) - 1;
+}
+LOG_RETHROW
+
+std::vector<index_t> SpriteAtlas::add(std::span<const Image> sprites)
+try
+{
+    std::vector<index_t> order(std::size(sprites));
+    std::iota(std::begin(order), std::end(order), index_t{});
+    std::ranges::stable_sort(order, std::greater(), [&](index_t i) { return sprites[i].height(); });
+
+    std::vector<index_t> ret(std::size(sprites));
+    for (index_t i : order)
+        ret[i] = add(sprites[i]);
+
+    return ret;
+}
+LOG_RETHROW
+
+n_t SpriteAtlas::n_sprites() const noexcept
+{
+    return std::size(placements);
+}
+
+n_t SpriteAtlas::n_pages() const noexcept
+{
+    return std::size(pages);
+}
+
+const Image& SpriteAtlas::page(index_t i_page) const
+try
+{
+    return pages.at(i_page).image;
+}
+LOG_RETHROW
+
+const SpriteAtlas::Placement& SpriteAtlas::placement(index_t i_sprite) const
+try
+{
+    return placements.at(i_sprite);
+}
+LOG_RETHROW
+
+void SpriteAtlas::draw(std::span<const SpriteInstance> sprites, Image& target, std::ptrdiff_t x_target, std::ptrdiff_t y_target) const
+try
+{
+    const std::ptrdiff_t targetWidth(target.width()), targetHeight(target.height());
+    for (const SpriteInstance& sprite : sprites)
+    {
+        const Placement& placement(placements.at(sprite.i_sprite));
+        const Image& page(pages[placement.i_page].image);
+
+        // Clip to the target, in the sprite's own coordinates
+        const std::ptrdiff_t
+            x(sprite.x - x_target),
+            y(sprite.y - y_target),
+            x_begin(std::max<std::ptrdiff_t>(0, -x)),
+            y_begin(std::max<std::ptrdiff_t>(0, -y)),
+            x_end(std::min<std::ptrdiff_t>(placement.width, targetWidth - x)),
+            y_end(std::min<std::ptrdiff_t>(placement.height, targetHeight - y));
+
+        for (std::ptrdiff_t y_sprite(y_begin); y_sprite < y_end; ++y_sprite)
+        {
+            const Pixel* const p_in(&page.row(placement.y + y_sprite)[placement.x]);
+            Pixel* const p_out(&target.row(y + y_sprite)[0]);
+            for (std::ptrdiff_t x_sprite(x_begin); x_sprite < x_end; ++x_sprite)
+                if (p_in[x_sprite].a)
+                    p_out[x + x_sprite] = p_in[x_sprite];
+        }
+    }
+}
+LOG_RETHROW
@@ -0,0 +1,64 @@
+module;
+
+#include "../global.h"
+
+export module sprite_atlas;
+
+export import image;
+
+// A sprite drawn at (x, y), the position of the sprite's top-left corner in the target's coordinate space
+export struct SpriteInstance
+{
+    index_t i_sprite;
+    std::ptrdiff_t x, y;
+};
+
+// Packs sprite frames into fixed size atlas pages with a skyline packer, so a whole object list is drawn by blitting out of a few images.
+// Sprites are only ever added, existing sprites keep their place, so new sprites can be packed in as rooms load without invalidating sprite indices
+export class SpriteAtlas
+{
+public:
+    struct Placement
+    {
+        index_t i_page, x, y;
+        n_t width, height;
+    };
+
+private:
+    // The skyline is the top edge of the packed region of a page as a list of horizontal segments, ordered left to right and covering the page's width
+    struct SkylineSegment
+    {
+        index_t x, y;
+        n_t width;
+    };
+
+    struct Page
+    {
+        Image image;
+        std::vector<SkylineSegment> skyline;
+    };
+
+    n_t pageSize;
+    std::vector<Page> pages;
+    std::vector<Placement> placements;
+
+    std::optional<Placement> place(index_t i_page, n_t width, n_t height);
+
+public:
+    explicit SpriteAtlas(n_t pageSize = 0x400);
+
+    // Returns the new sprite's index. A sprite larger than the page size gets a page of its own
+    index_t add(const Image& sprite);
+
+    // Packs tallest first, which packs tighter than adding one at a time. Returns the new sprites' indices in the order given
+    std::vector<index_t> add(std::span<const Image> sprites);
+
+    n_t n_sprites() const noexcept;
+    n_t n_pages() const noexcept;
+    const Image& page(index_t i_page) const;
+    const Placement& placement(index_t i_sprite) const;
+
+    // Draws sprites in order, so later sprites are drawn on top. Fully transparent pixels are skipped and sprites are clipped to the target.
+    // (x_target, y_target) is the position of the target's top-left corner in the sprites' coordinate space, so that a large scene can be drawn a strip at a time
+    void draw(std::span<const SpriteInstance> sprites, Image& target, std::ptrdiff_t x_target = 0, std::ptrdiff_t y_target = 0) const;
+};
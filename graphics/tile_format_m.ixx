@@ -0,0 +1,133 @@
+module;
+
+#include "../global.h"
+
+export module tile_format;
+
+// Tile format policies. `decode` unpacks one 8x8 tile to one byte per pixel, rows top to bottom, and `encode` packs it back.
+// `tileTableEntry` makes a background tile table entry, which both formats limit to 400h tiles
+export struct SnesTile4bpp
+{
+    static constexpr n_t bytesPerTile{0x20};
+
+    // Each row of a tile is stored as bitplanes 0 and 1 interleaved in the first 10h bytes, then bitplanes 2 and 3 in the next 10h bytes
+    static constexpr void decode(const std::uint8_t* p_in, std::uint8_t* p_out) noexcept
+    {
+        for (index_t y{}; y < 8; ++y)
+        {
+            const unsigned
+                plane0(p_in[y * 2]),
+                plane1(p_in[y * 2 + 1]),
+                plane2(p_in[0x10 + y * 2]),
+                plane3(p_in[0x10 + y * 2 + 1]);
+
+            for (index_t x{}; x < 8; ++x)
+            {
+                const unsigned shift(unsigned(7 - x));
+                p_out[y * 8 + x] = std::uint8_t
+                (
+                    (plane0 >> shift & 1)
+                    | (plane1 >> shift & 1) << 1
+                    | (plane2 >> shift & 1) << 2
+                    | (plane3 >> shift & 1) << 3
+                );
+            }
+        }
+    }
+
+    static constexpr void encode(const std::uint8_t* p_in, std::uint8_t* p_out) noexcept
+    {
+        for (index_t y{}; y < 8; ++y)
+        {
+            unsigned plane0{}, plane1{}, plane2{}, plane3{};
+            for (index_t x{}; x < 8; ++x)
+            {
+                const unsigned shift(unsigned(7 - x)), v(p_in[y * 8 + x]);
+                plane0 |= (v & 1) << shift;
+                plane1 |= (v >> 1 & 1) << shift;
+                plane2 |= (v >> 2 & 1) << shift;
+                plane3 |= (v >> 3 & 1) << shift;
+            }
+
+            p_out[y * 2] = std::uint8_t(plane0);
+            p_out[y * 2 + 1] = std::uint8_t(plane1);
+            p_out[0x10 + y * 2] = std::uint8_t(plane2);
+            p_out[0x10 + y * 2 + 1] = std::uint8_t(plane3);
+        }
+    }
+
+    // vhopppcc cccccccc (flips, priority, palette, tile number)
+    static constexpr std::uint16_t tileTableEntry(index_t i_tile, index_t i_palette, bool xFlip, bool yFlip) noexcept
+    {
+        return std::uint16_t((i_tile & 0x3FF) | (i_palette & 7) << 10 | unsigned(xFlip) << 14 | unsigned(yFlip) << 15);
+    }
+};
+
+export struct GbaTile4bpp
+{
+    static constexpr n_t bytesPerTile{0x20};
+
+    // Linear, two pixels per byte with the left pixel in the low nybble
+    static constexpr void decode(const std::uint8_t* p_in, std::uint8_t* p_out) noexcept
+    {
+        for (index_t i{}; i < bytesPerTile; ++i)
+        {
+            p_out[i * 2] = std::uint8_t(p_in[i] & 0xF);
+            p_out[i * 2 + 1] = std::uint8_t(p_in[i] >> 4);
+        }
+    }
+
+    static constexpr void encode(const std::uint8_t* p_in, std::uint8_t* p_out) noexcept
+    {
+        for (index_t i{}; i < bytesPerTile; ++i)
+            p_out[i] = std::uint8_t((p_in[i * 2] & 0xF) | (p_in[i * 2 + 1] & 0xF) << 4);
+    }
+
+    // ppppvhcc cccccccc (palette, flips, tile number)
+    static constexpr std::uint16_t tileTableEntry(index_t i_tile, index_t i_palette, bool xFlip, bool yFlip) noexcept
+    {
+        return std::uint16_t((i_tile & 0x3FF) | unsigned(xFlip) << 10 | unsigned(yFlip) << 11 | (i_palette & 0xF) << 12);
+    }
+};
+
+export template<typename Format>
+concept TileFormat = requires(const std::uint8_t* p_in, std::uint8_t* p_out)
+{
+    { Format::bytesPerTile } -> std::convertible_to<n_t>;
+    Format::decode(p_in, p_out);
+    Format::encode(p_in, p_out);
+    { Format::tileTableEntry(index_t{}, index_t{}, bool{}, bool{}) } -> std::convertible_to<std::uint16_t>;
+};
+
+// Decodes as many whole tiles as `in` holds into `out`, 40h bytes per tile, without allocating. `out` must hold them
+export template<TileFormat Format>
+void decodeTiles(std::span<const std::uint8_t> in, std::span<std::uint8_t> out)
+{
+    const n_t n_tiles(std::size(in) / Format::bytesPerTile);
+    if (std::size(out) < n_tiles * 0x40)
+        throw std::runtime_error(LOG_INFO "Output is smaller than input"s);
+
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+        Format::decode(&in[i_tile * Format::bytesPerTile], &out[i_tile * 0x40]);
+}
+
+// Decodes as many whole tiles as `in` holds, 40h bytes per tile
+export template<TileFormat Format>
+std::vector<std::uint8_t> decodeTiles(std::span<const std::uint8_t> in)
+{
+    std::vector<std::uint8_t> ret(std::size(in) / Format::bytesPerTile * 0x40);
+    decodeTiles<Format>(in, ret);
+    return ret;
+}
+
+// Encodes tiles of one byte per pixel, 40h bytes per tile
+export template<TileFormat Format>
+std::vector<std::uint8_t> encodeTiles(std::span<const std::uint8_t> in)
+{
+    const n_t n_tiles(std::size(in) / 0x40);
+    std::vector<std::uint8_t> ret(n_tiles * Format::bytesPerTile);
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+        Format::encode(&in[i_tile * 0x40], &ret[i_tile * Format::bytesPerTile]);
+
+    return ret;
+}
@@ -0,0 +1,365 @@
+#include "../global.h"
+
+import tile_import;
+
+import snes_graphics;
+
+static const n_t
+    tilePixels{0x40},
+    coloursPerPalette{0x10},
+    maxTileColours{coloursPerPalette - 1};
+
+// Not a BGR555 colour
+static const std::uint16_t transparent{0x8000};
+
+// Sorted unique BGR555 colours, excluding transparency
+using ColourSet = std::vector<std::uint16_t>;
+
+static unsigned channel(std::uint16_t colour, unsigned i_channel) noexcept
+{
+    return colour >> i_channel * 5 & 0x1F;
+}
+
+static unsigned colourDistance(std::uint16_t lhs, std::uint16_t rhs) noexcept
+{
+    unsigned ret{};
+    for (unsigned i_channel{}; i_channel < 3; ++i_channel)
+    {
+        const int d(int(channel(lhs, i_channel)) - int(channel(rhs, i_channel)));
+        ret += unsigned(d * d);
+    }
+
+    return ret;
+}
+
+static index_t nearestColour(std::span<const std::uint16_t> colours, std::uint16_t colour) noexcept
+{
+    index_t ret{};
+    unsigned bestDistance(std::numeric_limits<unsigned>::max());
+    for (index_t i{}; i < std::size(colours); ++i)
+        if (const unsigned distance(colourDistance(colours[i], colour)); distance < bestDistance)
+        {
+            ret = i;
+            bestDistance = distance;
+        }
+
+    return ret;
+}
+
+static ColourSet makeColourSet(std::span<const std::uint16_t> colours)
+{
+    ColourSet ret;
+    std::ranges::copy_if(colours, std::back_inserter(ret), [](std::uint16_t colour){ return colour != transparent; });
+    std::ranges::sort(ret);
+    ret.erase(std::unique(std::begin(ret), std::end(ret)), std::end(ret));
+    return ret;
+}
+
+// Reduces a tile's opaque pixels to at most `n_colours` colours. Splits the box with the widest channel at its median until there are enough boxes,
+// then each box's pixels are replaced with their average
+static void medianCut(std::span<std::uint16_t> pixels, n_t n_colours)
+{
+    struct Box
+    {
+        index_t i_begin, i_end;
+        unsigned i_channel, range;
+    };
+
+    std::vector<std::uint16_t> colours;
+    std::ranges::copy_if(pixels, std::back_inserter(colours), [](std::uint16_t colour){ return colour != transparent; });
+
+    const auto makeBox([&](index_t i_begin, index_t i_end) -> Box
+    {
+        unsigned minimums[3]{0x1F, 0x1F, 0x1F}, maximums[3]{};
+        for (index_t i(i_begin); i < i_end; ++i)
+            for (unsigned i_channel{}; i_channel < 3; ++i_channel)
+            {
+                minimums[i_channel] = std::min(minimums[i_channel], channel(colours[i], i_channel));
+                maximums[i_channel] = std::max(maximums[i_channel], channel(colours[i], i_channel));
+            }
+
+        Box ret{i_begin, i_end, 0, 0};
+        for (unsigned i_channel{}; i_channel < 3; ++i_channel)
+            if (maximums[i_channel] > minimums[i_channel] && maximums[i_channel] - minimums[i_channel] > ret.range)
+                ret = {i_begin, i_end, i_channel, maximums[i_channel] - minimums[i_channel]};
+
+        return ret;
+    });
+
+    std::vector<Box> boxes{makeBox(0, std::size(colours))};
+    while (std::size(boxes) < n_colours)
+    {
+        const auto it_box(std::ranges::max_element(boxes, {}, &Box::range));
+        if (it_box->range == 0)
+            break;
+
+        const Box box(*it_box);
+        const auto it_begin(std::begin(colours) + box.i_begin), it_middle(it_begin + (box.i_end - box.i_begin) / 2);
+        std::nth_element(it_begin, it_middle, std::begin(colours) + box.i_end, [&](std::uint16_t lhs, std::uint16_t rhs)
+        {
+            return channel(lhs, box.i_channel) < channel(rhs, box.i_channel);
+        });
+
+        const index_t i_middle(it_middle - std::begin(colours));
+        *it_box = makeBox(box.i_begin, i_middle);
+        boxes.push_back(makeBox(i_middle, box.i_end));
+    }
+
+    // Boxes can share a colour at their boundary. Replacements are sorted by colour then average, so that colour takes the numerically lowest of the boxes' averages
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> replacements;
+    for (const Box& box : boxes)
+    {
+        unsigned sums[3]{};
+        for (index_t i(box.i_begin); i < box.i_end; ++i)
+            for (unsigned i_channel{}; i_channel < 3; ++i_channel)
+                sums[i_channel] += channel(colours[i], i_channel);
+
+        const n_t n(box.i_end - box.i_begin);
+        std::uint16_t average{};
+        for (unsigned i_channel{}; i_channel < 3; ++i_channel)
+            average |= std::uint16_t((sums[i_channel] + n / 2) / n << i_channel * 5);
+
+        for (index_t i(box.i_begin); i < box.i_end; ++i)
+            replacements.push_back({colours[i], average});
+    }
+
+    std::ranges::sort(replacements);
+    for (std::uint16_t& pixel : pixels)
+        if (pixel != transparent)
+            pixel = std::ranges::lower_bound(replacements, pixel, {}, &std::pair<std::uint16_t, std::uint16_t>::first)->second;
+}
+
+// Packs colour sets into palettes. Sets are taken largest first and go in the palette they share the most colours with that has room for the rest,
+// or a new palette if none has room. Sets left over once all the palettes are used go in the palette that needs the least error to represent them,
+// filling any free entries with the set's worst represented colours
+static std::vector<ColourSet> fitPalettes(std::span<const ColourSet> colourSets, n_t n_palettes, std::vector<index_t>& i_palettes)
+{
+    std::vector<index_t> order(std::size(colourSets));
+    std::iota(std::begin(order), std::end(order), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](index_t i){ return std::size(colourSets[i]); });
+
+    std::vector<ColourSet> palettes;
+    std::vector<index_t> leftovers;
+    i_palettes.resize(std::size(colourSets));
+    for (index_t i_set : order)
+    {
+        const ColourSet& colourSet(colourSets[i_set]);
+        std::optional<index_t> i_best;
+        n_t bestShared{};
+        for (index_t i_palette{}; i_palette < std::size(palettes); ++i_palette)
+        {
+            ColourSet shared;
+            std::ranges::set_intersection(palettes[i_palette], colourSet, std::back_inserter(shared));
+            if (std::size(palettes[i_palette]) + std::size(colourSet) - std::size(shared) <= maxTileColours && (!i_best || std::size(shared) > bestShared))
+            {
+                i_best = i_palette;
+                bestShared = std::size(shared);
+            }
+        }
+
+        if (!i_best && std::size(palettes) < n_palettes)
+        {
+            i_best = std::size(palettes);
+            palettes.emplace_back();
+        }
+
+        if (!i_best)
+        {
+            leftovers.push_back(i_set);
+            continue;
+        }
+
+        ColourSet merged;
+        std::ranges::set_union(palettes[*i_best], colourSet, std::back_inserter(merged));
+        palettes[*i_best] = std::move(merged);
+        i_palettes[i_set] = *i_best;
+    }
+
+    // Distance from each colour to its nearest colour in each palette, filled as needed and reset when a palette gains colours.
+    // Once the palettes are full, which is soon when there are leftovers, each set costs a lookup per colour per palette
+    const std::uint16_t unknownDistance(0xFFFF);
+    std::vector<std::vector<std::uint16_t>> nearestDistances(std::size(palettes), std::vector<std::uint16_t>(0x8000, unknownDistance));
+    for (index_t i_set : leftovers)
+    {
+        const ColourSet& colourSet(colourSets[i_set]);
+        index_t i_best{};
+        unsigned long long bestError(std::numeric_limits<unsigned long long>::max());
+        std::vector<std::uint16_t> bestAdditions;
+        std::vector<std::pair<unsigned, std::uint16_t>> errors;
+        for (index_t i_palette{}; i_palette < std::size(palettes); ++i_palette)
+        {
+            const ColourSet& palette(palettes[i_palette]);
+            std::vector<std::uint16_t>& distances(nearestDistances[i_palette]);
+            errors.clear();
+            for (std::uint16_t colour : colourSet)
+            {
+                if (distances[colour] == unknownDistance)
+                    distances[colour] = std::uint16_t(colourDistance(colour, palette[nearestColour(palette, colour)]));
+
+                errors.push_back({distances[colour], colour});
+            }
+
+            const n_t n_free(std::min(maxTileColours - std::size(palette), std::size(errors)));
+            if (n_free)
+                std::ranges::sort(errors, std::greater{});
+
+            unsigned long long error{};
+            for (index_t i(n_free); i < std::size(errors); ++i)
+                error += errors[i].first;
+
+            if (error < bestError)
+            {
+                i_best = i_palette;
+                bestError = error;
+                bestAdditions.clear();
+                for (index_t i{}; i < n_free && errors[i].first != 0; ++i)
+                    bestAdditions.push_back(errors[i].second);
+            }
+        }
+
+        if (!std::empty(bestAdditions))
+            std::ranges::fill(nearestDistances[i_best], unknownDistance);
+
+        ColourSet& palette(palettes[i_best]);
+        palette.insert(std::end(palette), std::begin(bestAdditions), std::end(bestAdditions));
+        std::ranges::sort(palette);
+        i_palettes[i_set] = i_best;
+    }
+
+    return palettes;
+}
+
+// The lexicographically least of the tile's flips, so a tile and its flips hash the same
+static std::pair<std::array<std::uint8_t, tilePixels>, std::pair<bool, bool>> canonicalTile(std::span<const std::uint8_t> tile, bool isFlipDedup)
+{
+    std::array<std::uint8_t, tilePixels> ret;
+    std::ranges::copy(tile, std::begin(ret));
+    std::pair<bool, bool> retFlips{};
+    if (!isFlipDedup)
+        return {ret, retFlips};
+
+    for (const auto& [xFlip, yFlip] : {std::pair{true, false}, std::pair{false, true}, std::pair{true, true}})
+    {
+        std::array<std::uint8_t, tilePixels> flipped;
+        for (index_t y{}; y < 8; ++y)
+            for (index_t x{}; x < 8; ++x)
+                flipped[y * 8 + x] = tile[(yFlip ? 7 - y : y) * 8 + (xFlip ? 7 - x : x)];
+
+        if (flipped < ret)
+        {
+            ret = flipped;
+            retFlips = {xFlip, yFlip};
+        }
+    }
+
+    return {ret, retFlips};
+}
+
+ImportedTiles importTiles(const Image& image, const TileImportOptions& options)
+try
+{
+    if (options.n_palettes == 0 || options.n_palettes > 0x10)
+        throw std::runtime_error(LOG_INFO "Can't import tiles to "s + std::to_string(options.n_palettes) + " palettes"s);
+
+    ImportedTiles ret{};
+    ret.n_tilesWide = (image.width() + 7) / 8;
+    ret.n_tilesHigh = (image.height() + 7) / 8;
+    const n_t n_tiles(ret.n_tilesWide * ret.n_tilesHigh);
+
+    std::vector<index_t> indices(n_tiles);
+    std::iota(std::begin(indices), std::end(indices), 0);
+
+    // Each tile to BGR555, reduced to 15 colours
+    std::vector<std::array<std::uint16_t, tilePixels>> tileColours(n_tiles);
+    std::vector<ColourSet> tileColourSets(n_tiles);
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i_tile)
+    {
+        const index_t x_tile(i_tile % ret.n_tilesWide * 8), y_tile(i_tile / ret.n_tilesWide * 8);
+        std::array<std::uint16_t, tilePixels>& colours(tileColours[i_tile]);
+        colours.fill(transparent);
+        for (index_t y(y_tile); y < std::min(y_tile + 8, image.height()); ++y)
+        {
+            const std::span<const Pixel> row(image.row(y));
+            for (index_t x(x_tile); x < std::min(x_tile + 8, image.width()); ++x)
+                if (row[x].a >= 0x80)
+                    colours[(y - y_tile) * 8 + x - x_tile] = pixelToBgr555(row[x]);
+        }
+
+        tileColourSets[i_tile] = makeColourSet(colours);
+        if (std::size(tileColourSets[i_tile]) > maxTileColours)
+        {
+            medianCut(colours, maxTileColours);
+            tileColourSets[i_tile] = makeColourSet(colours);
+        }
+    });
+
+    // Palettes are fitted to the distinct colour sets, which for typical graphics are far fewer than the tiles
+    std::map<ColourSet, index_t> colourSetIndices;
+    std::vector<ColourSet> colourSets;
+    std::vector<index_t> i_tileColourSets(n_tiles);
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+    {
+        const auto [it, isNew](colourSetIndices.insert({std::move(tileColourSets[i_tile]), std::size(colourSets)}));
+        if (isNew)
+            colourSets.push_back(it->first);
+
+        i_tileColourSets[i_tile] = it->second;
+    }
+
+    std::vector<index_t> i_setPalettes;
+    const std::vector<ColourSet> palettes(fitPalettes(colourSets, options.n_palettes, i_setPalettes));
+    for (const ColourSet& palette : palettes)
+    {
+        std::array<std::uint16_t, coloursPerPalette> colours{};
+        std::ranges::copy(palette, std::begin(colours) + 1);
+        ret.palettes.push_back(colours);
+    }
+
+    // Colour index in the assigned palette of each of a colour set's colours
+    std::vector<std::vector<std::uint8_t>> setColourIndices(std::size(colourSets));
+    for (index_t i_set{}; i_set < std::size(colourSets); ++i_set)
+        for (std::uint16_t colour : colourSets[i_set])
+            setColourIndices[i_set].push_back(std::uint8_t(nearestColour(palettes[i_setPalettes[i_set]], colour) + 1));
+
+    // Index the tiles and put them in canonical form
+    std::vector<std::array<std::uint8_t, tilePixels>> canonicalTiles(n_tiles);
+    std::vector<std::pair<bool, bool>> flips(n_tiles);
+    std::vector<std::size_t> hashes(n_tiles);
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i_tile)
+    {
+        const index_t i_set(i_tileColourSets[i_tile]);
+        std::array<std::uint8_t, tilePixels> tile{};
+        for (index_t i{}; i < tilePixels; ++i)
+            if (const std::uint16_t colour(tileColours[i_tile][i]); colour != transparent)
+                tile[i] = setColourIndices[i_set][std::ranges::lower_bound(colourSets[i_set], colour) - std::begin(colourSets[i_set])];
+
+        std::tie(canonicalTiles[i_tile], flips[i_tile]) = canonicalTile(tile, options.isFlipDedup);
+        hashes[i_tile] = std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(std::data(canonicalTiles[i_tile])), tilePixels));
+    });
+
+    // Dedupe, each hash bucket lists the unique tiles with that hash
+    std::unordered_map<std::size_t, std::vector<index_t>> uniqueTiles;
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+    {
+        std::vector<index_t>& candidates(uniqueTiles[hashes[i_tile]]);
+        const auto it(std::ranges::find_if(candidates, [&](index_t i_unique)
+        {
+            return std::equal(std::begin(canonicalTiles[i_tile]), std::end(canonicalTiles[i_tile]), std::begin(ret.tiles) + i_unique * tilePixels);
+        }));
+
+        index_t i_unique;
+        if (it != std::end(candidates))
+            i_unique = *it;
+        else
+        {
+            i_unique = std::size(ret.tiles) / tilePixels;
+            candidates.push_back(i_unique);
+            ret.tiles.insert(std::end(ret.tiles), std::begin(canonicalTiles[i_tile]), std::end(canonicalTiles[i_tile]));
+        }
+
+        ret.tileTable.push_back({i_unique, i_setPalettes[i_tileColourSets[i_tile]], flips[i_tile].first, flips[i_tile].second});
+    }
+
+    return ret;
+}
+LOG_RETHROW
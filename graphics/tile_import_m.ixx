@@ -0,0 +1,59 @@
+module;
+
+#include "../global.h"
+
+export module tile_import;
+
+export import image;
+export import tile_format;
+
+export struct TileImportOptions
+{
+    // At most 10h. SNES backgrounds have 8 palettes, GBA backgrounds have 10h
+    n_t n_palettes{8};
+
+    // Dedupe tiles that are flips of each other, the tile table entry flips them back
+    bool isFlipDedup{true};
+};
+
+export struct TileTableEntry
+{
+    index_t i_tile, i_palette;
+    bool xFlip, yFlip;
+};
+
+export struct ImportedTiles
+{
+    n_t n_tilesWide, n_tilesHigh;
+
+    // One byte per pixel, 40h bytes per tile. Colour 0 is transparent
+    std::vector<std::uint8_t> tiles;
+
+    // Row major, a tile per 8x8 block of the image
+    std::vector<TileTableEntry> tileTable;
+
+    // BGR555. Colour 0 of each palette is the transparent colour and is left 0
+    std::vector<std::array<std::uint16_t, 0x10>> palettes;
+};
+
+// Splits the image into 8x8 tiles, padding the right and bottom edges with transparent pixels. Pixels with alpha below 80h are transparent.
+// Tiles with more than 15 colours are reduced by median cut, then tiles' colour sets are packed into the palettes,
+// tiles whose colours don't fit any palette are mapped to the palette that represents them best
+export ImportedTiles importTiles(const Image& image, const TileImportOptions& options = {});
+
+// `i_firstTile` and `i_firstPalette` are where the tiles and palettes will be loaded
+export template<TileFormat Format>
+std::vector<std::uint16_t> encodeTileTable(std::span<const TileTableEntry> entries, index_t i_firstTile = 0, index_t i_firstPalette = 0)
+{
+    std::vector<std::uint16_t> ret;
+    ret.reserve(std::size(entries));
+    for (const TileTableEntry& entry : entries)
+    {
+        if (i_firstTile + entry.i_tile >= 0x400)
+            throw std::runtime_error(LOG_INFO "Tile number "s + toHexString(i_firstTile + entry.i_tile, 2) + " doesn't fit in a tile table entry"s);
+
+        ret.push_back(Format::tileTableEntry(i_firstTile + entry.i_tile, i_firstPalette + entry.i_palette, entry.xFlip, entry.yFlip));
+    }
+
+    return ret;
+}
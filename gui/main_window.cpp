@@ -17,7 +17,77 @@ try
         };
         menu.asSubmenu().entries.push_back(std::move(open));
     }
+
+    {
+        MenuEntry close(MenuEntry::makeItem());
+        close.text = "Close";
+        close.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).closeRom();
+        };
+        menu.asSubmenu().entries.push_back(std::move(close));
+    }
+
+    {
+        MenuEntry next(MenuEntry::makeItem());
+        next.text = "Next ROM";
+        next.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).stepRom(1);
+        };
+        menu.asSubmenu().entries.push_back(std::move(next));
+    }
+
+    {
+        MenuEntry previous(MenuEntry::makeItem());
+        previous.text = "Previous ROM";
+        previous.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).stepRom(-1);
+        };
+        menu.asSubmenu().entries.push_back(std::move(previous));
+    }
     
+    {
+        MenuEntry compare(MenuEntry::makeItem());
+        compare.text = "Compare with...";
+        compare.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).compareRom();
+        };
+        menu.asSubmenu().entries.push_back(std::move(compare));
+    }
+    
+    {
+        MenuEntry open(MenuEntry::makeItem());
+        open.text = "Open savestate";
+        open.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).openSavestate();
+        };
+        menu.asSubmenu().entries.push_back(std::move(open));
+    }
+
+    {
+        MenuEntry next(MenuEntry::makeItem());
+        next.text = "Next savestate";
+        next.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).stepSavestate(1);
+        };
+        menu.asSubmenu().entries.push_back(std::move(next));
+    }
+
+    {
+        MenuEntry previous(MenuEntry::makeItem());
+        previous.text = "Previous savestate";
+        previous.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).stepSavestate(-1);
+        };
+        menu.asSubmenu().entries.push_back(std::move(previous));
+    }
+
     {
         MenuEntry exit(MenuEntry::makeItem());
         exit.text = "Exit";
@@ -49,11 +119,52 @@ try
 }
 LOG_RETHROW
 
+static MenuEntry makeMenu_debug()
+try
+{
+    MenuEntry menu(MenuEntry::makeSubmenu());
+    menu.text = "Debug";
+
+    {
+        MenuEntry show(MenuEntry::makeItem());
+        show.text = "Memory usage";
+        show.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).showMemoryReport();
+        };
+        menu.asSubmenu().entries.push_back(std::move(show));
+    }
+
+    {
+        MenuEntry dump(MenuEntry::makeItem());
+        dump.text = "Dump memory usage";
+        dump.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).dumpMemoryReport();
+        };
+        menu.asSubmenu().entries.push_back(std::move(dump));
+    }
+
+    {
+        MenuEntry show(MenuEntry::makeItem());
+        show.text = "Startup profile";
+        show.asItem().action = [](Window& window)
+        {
+            static_cast<MainWindow&>(window).showStartupProfile();
+        };
+        menu.asSubmenu().entries.push_back(std::move(show));
+    }
+
+    return menu;
+}
+LOG_RETHROW
+
 static Menu makeMenu()
 try
 {
     Menu menu;
     menu.entries.push_back(makeMenu_file());
+    menu.entries.push_back(makeMenu_debug());
     menu.entries.push_back(makeMenu_help());
 
     return menu;
@@ -62,7 +173,7 @@ LOG_RETHROW
 
 MainWindow::MainWindow(Os& os, std::any os_arg)
 try
-    : Window(os)
+    : Window(os), sessionArena(MemoryScope::session), areaArena(MemoryScope::area), roomArena(MemoryScope::room)
 {
     menu = makeMenu();
     p_os->spawnMainWindow(*this, "MainWindow", "Metroid level editor", std::move(os_arg));
@@ -76,10 +187,245 @@ try
 }
 LOG_RETHROW
 
+void MainWindow::onMouseMove(std::ptrdiff_t x, std::ptrdiff_t y)
+try
+{
+    if (!roomObjects)
+        return;
+
+    hoveredObject = roomObjects->hitTest(x, y);
+    if (dragStart)
+        selection = roomObjects->select(Rect::fromCorners(dragStart->first, dragStart->second, x, y));
+}
+LOG_RETHROW
+
+void MainWindow::onMouseDown(std::ptrdiff_t x, std::ptrdiff_t y)
+try
+{
+    if (!roomObjects)
+        return;
+
+    dragStart.emplace(x, y);
+}
+LOG_RETHROW
+
+void MainWindow::onMouseUp(std::ptrdiff_t x, std::ptrdiff_t y)
+try
+{
+    if (!roomObjects || !dragStart)
+        return;
+
+    // A click without a drag selects the topmost object, a drag selects everything in the rubber band
+    const auto [x_start, y_start](*dragStart);
+    dragStart.reset();
+    if (x_start == x && y_start == y)
+    {
+        selection.clear();
+        if (const std::optional<RoomObject> object(roomObjects->hitTest(x, y)); object && object->type != RoomObjectType::scrollRegion)
+            selection.push_back(*object);
+    }
+    else
+        selection = roomObjects->select(Rect::fromCorners(x_start, y_start, x, y));
+}
+LOG_RETHROW
+
 bool romValidator(const std::filesystem::path& filepath)
 try
 {
-    return false;
+    // The headers identifyGame looks at are all within the first bank, after any copier header
+    const n_t headerRegionSize(0x8000);
+    std::ifstream in(filepath, std::ios::binary);
+    in.seekg(copierHeaderSize(std::filesystem::file_size(filepath)));
+
+    std::vector<std::uint8_t> data(headerRegionSize);
+    in.read(reinterpret_cast<char*>(std::data(data)), std::ssize(data));
+    data.resize(in.gcount());
+    return identifyGame(data).has_value();
+}
+LOG_RETHROW
+
+MainWindow::OpenRom* MainWindow::activeRom() noexcept
+{
+    return std::empty(roms) ? nullptr : roms[i_rom].get();
+}
+
+void MainWindow::dropRoom()
+try
+{
+    roomView.reset();
+    liveRoom.reset();
+    liveModifiedBlocks.reset();
+    liveTileset.reset();
+    roomObjects.reset();
+    hoveredObject.reset();
+    selection.clear();
+    dragStart.reset();
+    roomArena.reset();
+}
+LOG_RETHROW
+
+void MainWindow::dropView()
+try
+{
+    dropRoom();
+    resetAreaArena();
+}
+LOG_RETHROW
+
+// Forgets the loaded assets and their registrations, so that the arena they're in can be reset
+template<typename Map>
+static void dropLoadedAssets(RomAssets& assets, Map& loaded) noexcept
+{
+    for (const auto& [key, asset] : loaded)
+        assets.remove(asset.assetId);
+
+    loaded.clear();
+}
+
+void MainWindow::resetAreaArena()
+try
+{
+    for (const std::unique_ptr<OpenRom>& p_rom : roms)
+        dropLoadedAssets(p_rom->assets, p_rom->levelData);
+
+    areaArena.reset();
+    i_arenaArea.reset();
+}
+LOG_RETHROW
+
+void MainWindow::resetSessionArena()
+try
+{
+    for (const std::unique_ptr<OpenRom>& p_rom : roms)
+        dropLoadedAssets(p_rom->assets, p_rom->tilesets);
+
+    sessionArena.reset();
+}
+LOG_RETHROW
+
+void MainWindow::rebuildAreaArena()
+try
+{
+    std::vector<std::tuple<OpenRom*, std::uint16_t, std::uint16_t>> loaded;
+    for (const std::unique_ptr<OpenRom>& p_rom : roms)
+        for (const auto& [stateAddress, asset] : p_rom->levelData)
+            loaded.emplace_back(p_rom.get(), asset.roomAddress, stateAddress);
+
+    const std::optional<std::uint8_t> i_area(i_arenaArea);
+    resetAreaArena();
+    i_arenaArea = i_area;
+    for (const auto& [p_rom, roomAddress, stateAddress] : loaded)
+    {
+        try
+        {
+            const Room room(*p_rom->p_rom, roomAddress);
+            const auto it_state(std::ranges::find(room.states, stateAddress, &RoomState::address));
+            if (it_state != std::end(room.states))
+                loadLevelData(*p_rom, room, *it_state);
+        }
+        catch (const std::exception& e)
+        {
+            // It's loaded again when it's next viewed
+            DebugFile(DebugFile::warning) << LOG_INFO "Couldn't load level data $"s << toHexString(stateAddress) << " of room $"s << toHexString(roomAddress) << " again: "s << e.what() << '\n';
+        }
+    }
+}
+LOG_RETHROW
+
+void MainWindow::rebuildSessionArena()
+try
+{
+    std::vector<std::pair<OpenRom*, index_t>> loaded;
+    for (const std::unique_ptr<OpenRom>& p_rom : roms)
+        for (const auto& [i_tileset, asset] : p_rom->tilesets)
+            loaded.emplace_back(p_rom.get(), i_tileset);
+
+    const bool isRoomOpen(liveRoom.has_value());
+    dropRoom();
+    resetSessionArena();
+    for (const auto& [p_rom, i_tileset] : loaded)
+    {
+        try
+        {
+            loadTileset(*p_rom, i_tileset);
+        }
+        catch (const std::exception& e)
+        {
+            DebugFile(DebugFile::warning) << LOG_INFO "Couldn't load tileset "s << toHexString(i_tileset, 1) << " again: "s << e.what() << '\n';
+        }
+    }
+
+    if (!isRoomOpen || std::empty(savestatePaths))
+        return;
+
+    try
+    {
+        loadSavestate(savestatePaths[i_savestate]);
+    }
+    catch (const std::exception& e)
+    {
+        DebugFile(DebugFile::warning) << LOG_INFO "Couldn't load "s << savestatePaths[i_savestate].string() << " again: "s << e.what() << '\n';
+    }
+}
+LOG_RETHROW
+
+void MainWindow::dropRomAssets(OpenRom& rom)
+try
+{
+    rom.assets.clear();
+    rom.tilesets.clear();
+    rom.levelData.clear();
+    if (&rom == activeRom())
+        dropView();
+}
+LOG_RETHROW
+
+std::shared_ptr<const Tileset> MainWindow::loadTileset(OpenRom& rom, index_t i_tileset)
+try
+{
+    if (const auto it(rom.tilesets.find(i_tileset)); it != std::end(rom.tilesets))
+        return it->second.p_asset;
+
+    AssetCache* const p_cache(assetCache ? &*assetCache : nullptr);
+    AssetSource source(Tileset::findSource(*rom.p_rom, i_tileset, p_cache));
+    std::shared_ptr<const Tileset> ret(sharedTilesets.get(source.hash, [&]()
+    {
+        return Tileset(*rom.p_rom, i_tileset, p_cache, sessionArena.resource(MemorySubsystem::tiles));
+    }));
+
+    const index_t assetId(rom.assets.add(std::move(source.ranges), [&rom, i_tileset]()
+    {
+        rom.tilesets.erase(i_tileset);
+    }));
+
+    rom.tilesets.emplace(i_tileset, LoadedAsset<Tileset>{ret, assetId});
+    return ret;
+}
+LOG_RETHROW
+
+std::shared_ptr<const LevelData> MainWindow::loadLevelData(OpenRom& rom, const Room& room, const RoomState& state)
+try
+{
+    if (const auto it(rom.levelData.find(state.address)); it != std::end(rom.levelData))
+        return it->second.p_asset;
+
+    // The room header and state are sources too, as they give the level data's size and pointer
+    AssetCache* const p_cache(assetCache ? &*assetCache : nullptr);
+    AssetSource source(LevelData::findSource(*rom.p_rom, room, state, p_cache));
+    std::shared_ptr<const LevelData> ret(sharedLevelData.get(source.hash, [&]()
+    {
+        return LevelData(*rom.p_rom, room, state, p_cache, areaArena.resource(MemorySubsystem::rooms));
+    }));
+
+    const std::vector<RomRange> roomSources(room.sources(*rom.p_rom));
+    source.ranges.insert(std::end(source.ranges), std::begin(roomSources), std::end(roomSources));
+    const index_t assetId(rom.assets.add(std::move(source.ranges), [&rom, stateAddress = state.address]()
+    {
+        rom.levelData.erase(stateAddress);
+    }));
+
+    rom.levelData.emplace(state.address, LoadedAsset<LevelData>{ret, assetId, room.address});
+    return ret;
 }
 LOG_RETHROW
 
@@ -94,5 +440,272 @@ try
     };
 
     std::optional<std::filesystem::path> romPath = p_os->chooseFile(fileFilters, romValidator);
+    if (!romPath)
+        return;
+
+    const auto it_open(std::ranges::find_if(roms, [&](const std::unique_ptr<OpenRom>& p_open)
+    {
+        return std::filesystem::equivalent(p_open->p_rom->path(), *romPath);
+    }));
+
+    if (it_open != std::end(roms))
+    {
+        dropView();
+        i_rom = it_open - std::begin(roms);
+        return;
+    }
+
+    // The game is decided here, once, everything downstream goes through p_game
+    std::unique_ptr<Rom> p_newRom(std::make_unique<Rom>(*romPath));
+    const std::optional<GameId> gameId(identifyGame(p_newRom->bytes()));
+    if (!gameId)
+        throw std::runtime_error(LOG_INFO "Unrecognised ROM "s + romPath->string());
+
+    if (!assetCache)
+        assetCache.emplace(*p_os, p_os->getCacheDirectory());
+
+    dropView();
+    OpenRom& rom(*roms.emplace_back(std::make_unique<OpenRom>()));
+    i_rom = std::size(roms) - 1;
+    rom.p_game = makeGame(*gameId);
+    rom.p_rom = std::move(p_newRom);
+    rom.watch = p_os->watchFile(*romPath, [this, &rom]()
+    {
+        reloadRom(rom);
+    });
+}
+LOG_RETHROW
+
+void MainWindow::closeRom()
+try
+{
+    OpenRom* const p_rom(activeRom());
+    if (!p_rom)
+        return;
+
+    if (p_rom->watch)
+        p_os->unwatchFile(*p_rom->watch);
+
+    dropView();
+    roms.erase(std::begin(roms) + i_rom);
+    if (i_rom == std::size(roms) && i_rom > 0)
+        --i_rom;
+
+    // The closed ROM's tilesets are freed, the other ROMs load theirs again as they're viewed
+    resetSessionArena();
+}
+LOG_RETHROW
+
+void MainWindow::stepRom(std::ptrdiff_t offset)
+try
+{
+    if (std::size(roms) < 2)
+        return;
+
+    // Wraps around
+    const std::ptrdiff_t n_roms(std::ssize(roms));
+    dropView();
+    i_rom = index_t(((std::ptrdiff_t(i_rom) + offset) % n_roms + n_roms) % n_roms);
+}
+LOG_RETHROW
+
+void MainWindow::compareRom()
+try
+{
+    const OpenRom* const p_openRom(activeRom());
+    if (!p_openRom)
+        return;
+
+    const FileFilter fileFilters[]
+    {
+        {"ROM files",      "*.agb;*.gba;*.sfc;*.smc;"},
+        {"GBA ROM files",  "*.agb;*.gba;"},
+        {"SNES ROM files", "*.sfc;*.smc;"}
+    };
+
+    const std::optional<std::filesystem::path> romPath(p_os->chooseFile(fileFilters, romValidator));
+    if (!romPath)
+        return;
+
+    // An open ROM is compared as it is in memory
+    const auto it_open(std::ranges::find_if(roms, [&](const std::unique_ptr<OpenRom>& p_open)
+    {
+        return std::filesystem::equivalent(p_open->p_rom->path(), *romPath);
+    }));
+
+    std::optional<Rom> otherRom;
+    const Rom& oldRom(it_open != std::end(roms) ? *(*it_open)->p_rom : otherRom.emplace(*romPath));
+
+    const auto startTime(std::chrono::steady_clock::now());
+    romChanges = diffRoms(oldRom, *p_openRom->p_rom, assetCache ? &*assetCache : nullptr);
+    const auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime));
+
+    // There's no list view yet, so the first few changes are shown in a message and the full list goes to the debug file
+    const n_t maxListedChanges(0x20);
+    std::string text;
+    for (index_t i{}; i < std::min(std::size(romChanges), maxListedChanges); ++i)
+        text += describe(romChanges[i]) + '\n';
+
+    if (std::size(romChanges) > maxListedChanges)
+        text += "... and "s + std::to_string(std::size(romChanges) - maxListedChanges) + " more\n"s;
+
+    text += std::to_string(std::size(romChanges)) + " changes found in "s + std::to_string(duration.count()) + "ms"s;
+
+    DebugFile debugFile(DebugFile::info);
+    debugFile << LOG_INFO "Changes from "s << romPath->string() << " to "s << p_openRom->p_rom->path().string() << ":\n"s;
+    for (const RomChange& change : romChanges)
+        debugFile << describe(change) << '\n';
+
+    p_os->message("Compare with "s + romPath->filename().string(), text);
+}
+LOG_RETHROW
+
+void MainWindow::reloadRom(OpenRom& rom)
+try
+{
+    const auto startTime(std::chrono::steady_clock::now());
+    std::vector<RomRange> changes;
+    try
+    {
+        changes = rom.p_rom->reload();
+    }
+    catch (const std::exception& e)
+    {
+        // Most likely the assembler still has the file open or it's mid-write, the next change to it tries again
+        DebugFile(DebugFile::warning) << LOG_INFO "Failed to reload "s << rom.p_rom->path().string() << ": "s << e.what() << '\n';
+        return;
+    }
+
+    if (std::empty(changes))
+        return;
+
+    const std::optional<GameId> gameId(identifyGame(rom.p_rom->bytes()));
+    if (!gameId)
+    {
+        DebugFile(DebugFile::warning) << LOG_INFO "Reloaded "s << rom.p_rom->path().string() << " is no longer a recognised ROM, ignoring until it's rebuilt again\n"s;
+        return;
+    }
+
+    const n_t n_tilesets(std::size(rom.tilesets)), n_levelData(std::size(rom.levelData));
+
+    // A changed header could make it a different game, then nothing built for the old one makes sense
+    if (*gameId != rom.p_game->id())
+    {
+        rom.p_game = makeGame(*gameId);
+        dropRomAssets(rom);
+    }
+
+    const n_t n_invalidated(rom.assets.invalidate(changes));
+
+    // The arenas are monotonic, so what's decoded to replace dropped assets would be added on top of what they used
+    if (std::size(rom.levelData) < n_levelData)
+        rebuildAreaArena();
+
+    if (std::size(rom.tilesets) < n_tilesets)
+        rebuildSessionArena();
+    const auto duration(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime));
+    DebugFile(DebugFile::info) << LOG_INFO "Reloaded "s << rom.p_rom->path().string() << ": "s << std::size(changes) << " changed ranges, "s
+        << n_invalidated << " of "s << n_invalidated + rom.assets.size() << " assets invalidated in "s << duration.count() << "us\n"s;
+}
+LOG_RETHROW
+
+void MainWindow::loadSavestate(const std::filesystem::path& filepath)
+try
+{
+    const Savestate savestate(p_os->mapFile(filepath));
+    OpenRom* const p_openRom(activeRom());
+    if (!p_openRom || p_openRom->p_game->id() != GameId::superMetroid || savestate.platform() != Platform::snes)
+        throw std::runtime_error(LOG_INFO "Savestates can only be shown for Super Metroid, with its ROM open"s);
+
+    // The room being replaced is dropped first so that its arena can be reused, a savestate that fails to load leaves no room open
+    const Rom& rom(*p_openRom->p_rom);
+    dropRoom();
+    LiveRoom newLiveRoom(readLiveRoom(rom, savestate.memory(), &roomArena));
+
+    // The ROM's version of the room is what's live blocks are compared against and where the PLMs come from
+    const Room room(rom, newLiveRoom.roomAddress);
+    if (i_arenaArea != room.i_area)
+    {
+        resetAreaArena();
+        i_arenaArea = room.i_area;
+    }
+
+    const auto it_state(std::ranges::find(room.states, newLiveRoom.stateAddress, &RoomState::address));
+    const RoomState& state(it_state != std::end(room.states) ? *it_state : room.defaultState());
+    const std::shared_ptr<const LevelData> p_levelData(loadLevelData(*p_openRom, room, state));
+
+    if (p_levelData->width == newLiveRoom.levelData.width && p_levelData->height == newLiveRoom.levelData.height)
+        liveModifiedBlocks = modifiedBlocks(*p_levelData, newLiveRoom.levelData);
+
+    liveTileset = loadTileset(*p_openRom, state.i_tileset);
+    roomObjects.emplace(rom, room, newLiveRoom.enemies, loadPlmPopulation(rom, state, roomArena.resource(MemorySubsystem::sprites)));
+    liveRoom = std::move(newLiveRoom);
+
+    // The screens around where the game's camera was (256x224 pixels at the layer 1 scroll) are rendered first
+    roomView.emplace(*liveTileset, liveRoom->levelData, RoomViewport{liveRoom->layer1X, liveRoom->layer1Y, 0x100, 0xE0});
+}
+LOG_RETHROW
+
+void MainWindow::openSavestate()
+try
+{
+    const FileFilter fileFilters[]
+    {
+        {"Savestates",        "*.000;*.001;*.002;*.003;*.004;*.005;*.006;*.007;*.008;*.009;*.frz;*.ss0;*.ss1;*.ss2;*.ss3;*.ss4;*.ss5;*.ss6;*.ss7;*.ss8;*.ss9;"},
+        {"snes9x savestates", "*.000;*.001;*.002;*.003;*.004;*.005;*.006;*.007;*.008;*.009;*.frz;"},
+        {"mGBA savestates",   "*.ss0;*.ss1;*.ss2;*.ss3;*.ss4;*.ss5;*.ss6;*.ss7;*.ss8;*.ss9;"}
+    };
+
+    const std::optional<std::filesystem::path> savestatePath(p_os->chooseFile(fileFilters, isSavestateFile));
+    if (!savestatePath)
+        return;
+
+    savestatePaths = findSavestates(savestatePath->parent_path());
+    const auto it(std::ranges::find(savestatePaths, *savestatePath));
+    if (it == std::end(savestatePaths))
+    {
+        savestatePaths.assign(1, *savestatePath);
+        i_savestate = 0;
+    }
+    else
+        i_savestate = it - std::begin(savestatePaths);
+
+    loadSavestate(*savestatePath);
+}
+LOG_RETHROW
+
+void MainWindow::stepSavestate(std::ptrdiff_t offset)
+try
+{
+    if (std::empty(savestatePaths))
+        return;
+
+    // Wraps around
+    const std::ptrdiff_t n_savestates(std::ssize(savestatePaths));
+    i_savestate = index_t(((std::ptrdiff_t(i_savestate) + offset) % n_savestates + n_savestates) % n_savestates);
+    loadSavestate(savestatePaths[i_savestate]);
+}
+LOG_RETHROW
+
+void MainWindow::showMemoryReport()
+try
+{
+    p_os->message("Memory usage"s, memoryReport() + "\nShared tilesets: "s + std::to_string(sharedTilesets.size()) + "\nShared level data: "s + std::to_string(sharedLevelData.size()));
+}
+LOG_RETHROW
+
+void MainWindow::showStartupProfile()
+try
+{
+    p_os->message("Startup profile"s, startupProfile().report());
+}
+LOG_RETHROW
+
+void MainWindow::dumpMemoryReport()
+try
+{
+    const std::filesystem::path filepath(p_os->getDataDirectory() / "memory.txt"s);
+    ::dumpMemoryReport(filepath);
+    DebugFile(DebugFile::info) << LOG_INFO "Memory usage written to "s << filepath.string() << '\n';
 }
 LOG_RETHROW
@@ -6,16 +6,142 @@ export module main_window;
 
 export import window;
 export import window_layout;
-// export import rom;
+export import game_traits;
+export import progressive_room;
+export import rom;
+export import rom_assets;
+export import sm_rom_diff;
+export import sm_live_room;
+export import sm_room_objects;
+export import sm_tileset;
+export import startup_profile;
 
 export class MainWindow : public Window
 {
+    // An asset from the shared assets and its registration in the ROM's assets
+    template<typename T>
+    struct LoadedAsset
+    {
+        std::shared_ptr<const T> p_asset;
+        index_t assetId;
+
+        // Level data only, the room it was loaded for, so that it can be loaded again when its arena is rebuilt
+        std::uint16_t roomAddress{};
+    };
+
+    // A ROM open in the session. Several can be open at once, e.g. a hack alongside the game it's based on, with one of them being viewed
+    struct OpenRom
+    {
+        std::unique_ptr<Rom> p_rom;
+        std::unique_ptr<Game> p_game;
+
+        // Watches the ROM file for rebuilds by an external assembler. Whatever's built from the ROM registers in `assets`, so a rebuild drops only what it changed
+        std::optional<index_t> watch;
+        RomAssets assets;
+
+        // From the session's shared assets, by tileset index and by state address. Tilesets are in the session arena and level data in the area arena
+        std::map<index_t, LoadedAsset<Tileset>> tilesets;
+        std::map<std::uint16_t, LoadedAsset<LevelData>> levelData;
+    };
+
     WindowLayout windowLayout;
-    // std::unique_ptr<Rom> p_rom;
+
+    // What the view loads, by how long it's kept, so that switching rooms frees everything the last room loaded with one reset.
+    // Tilesets are kept until a ROM is closed and level data until the area or viewed ROM changes, every open ROM's share of an arena is dropped before it's reset.
+    // Declared before everything allocated from them so that they're destroyed last
+    MemoryArena sessionArena, areaArena, roomArena;
+    std::optional<std::uint8_t> i_arenaArea;
+
+    // Owned through pointers as the file watches refer to them
+    std::vector<std::unique_ptr<OpenRom>> roms;
+    index_t i_rom{};
+
+    // Decoded assets are shared by every open ROM with the same data, so opening a hack next to its base game only adds what the hack changed
+    SharedAssets<Tileset> sharedTilesets;
+    SharedAssets<LevelData> sharedLevelData;
+
+    // Opened with the first ROM
+    std::optional<AssetCache> assetCache;
+
+    // Objects of the room being edited, empty until a room is open. Mouse positions are room pixel coordinates
+    std::optional<RoomObjects> roomObjects;
+    std::optional<RoomObject> hoveredObject;
+    std::vector<RoomObject> selection;
+    std::optional<std::pair<std::ptrdiff_t, std::ptrdiff_t>> dragStart;
+
+    // The room as it was in a savestate, overlaid on the room view. Savestates are stepped through in filename order
+    std::optional<LiveRoom> liveRoom;
+    std::optional<SelectionMask> liveModifiedBlocks;
+    std::shared_ptr<const Tileset> liveTileset;
+    std::vector<std::filesystem::path> savestatePaths;
+    index_t i_savestate{};
+
+    // Screens of the room being viewed, rendered outwards from the viewport on background workers.
+    // Declared after the level data and tileset it renders from, so that it's stopped before they're destroyed
+    std::optional<ProgressiveRoomLoad> roomView;
+
+    // Changes from the last ROM the active ROM was compared with, for the view to highlight
+    std::vector<RomChange> romChanges;
+
+    // The ROM being viewed, null if none are open
+    OpenRom* activeRom() noexcept;
+
+    // Forgets everything built from the ROM, for when it's replaced
+    void dropRomAssets(OpenRom& rom);
+
+    // Forgets the room being viewed and frees its arena
+    void dropRoom();
+
+    // Forgets the room and everything else loaded for viewing the active ROM, for when another is viewed
+    void dropView();
+
+    // Forget every open ROM's assets from the area or session arena and reset it
+    void resetAreaArena();
+    void resetSessionArena();
+
+    // Resets the arena and loads what every open ROM had in it again, so that assets decoded to replace invalidated ones don't pile up in it.
+    // The view's tileset is in the session arena, so rebuilding that drops the room and loads its savestate again
+    void rebuildAreaArena();
+    void rebuildSessionArena();
+
+    // Through the shared assets, into the session and area arenas. Registered with the ROM's assets, so changes to the data drop this ROM's reference
+    std::shared_ptr<const Tileset> loadTileset(OpenRom& rom, index_t i_tileset);
+    std::shared_ptr<const LevelData> loadLevelData(OpenRom& rom, const Room& room, const RoomState& state);
+
+    // Picks up changes to the ROM file. The view and anything not built from changed bytes are kept
+    void reloadRom(OpenRom& rom);
+
+    void loadSavestate(const std::filesystem::path& filepath);
 
 public:
     MainWindow(Os& os, std::any os_arg);
 
     void onDestroy() override;
+    void onMouseMove(std::ptrdiff_t x, std::ptrdiff_t y) override;
+    void onMouseDown(std::ptrdiff_t x, std::ptrdiff_t y) override;
+    void onMouseUp(std::ptrdiff_t x, std::ptrdiff_t y) override;
+
+    // Opens a ROM alongside those already open and views it. Choosing a ROM that's already open views it
     void openRom();
+
+    // Closes the ROM being viewed. Shared assets no other ROM holds are freed
+    void closeRom();
+
+    // Moves by `offset` through the open ROMs, in the order they were opened
+    void stepRom(std::ptrdiff_t offset);
+
+    // Lists what changed from a chosen ROM to the one being viewed, e.g. the game a hack is based on
+    void compareRom();
+
+    void openSavestate();
+
+    // Moves by `offset` through the savestates in the open savestate's directory
+    void stepSavestate(std::ptrdiff_t offset);
+
+    void showMemoryReport();
+
+    // Appends the memory report to memory.txt in the data directory, for comparing usage over a long session
+    void dumpMemoryReport();
+
+    void showStartupProfile();
 };
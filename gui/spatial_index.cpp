@@ -0,0 +1,182 @@
+#include "../global.h"
+
+import spatial_index;
+
+static index_t clampedCell(std::ptrdiff_t position, n_t cellSize, n_t n_cells) noexcept
+{
+    if (position < 0)
+        return 0;
+
+    return std::min(index_t(position) / cellSize, n_cells - 1);
+}
+
+bool Rect::contains(std::ptrdiff_t x_point, std::ptrdiff_t y_point) const noexcept
+{
+    return x <= x_point && x_point < x + std::ptrdiff_t(width) && y <= y_point && y_point < y + std::ptrdiff_t(height);
+}
+
+bool Rect::intersects(const Rect& other) const noexcept
+{
+    return x < other.x + std::ptrdiff_t(other.width) && other.x < x + std::ptrdiff_t(width)
+        && y < other.y + std::ptrdiff_t(other.height) && other.y < y + std::ptrdiff_t(height);
+}
+
+Rect Rect::fromCorners(std::ptrdiff_t x0, std::ptrdiff_t y0, std::ptrdiff_t x1, std::ptrdiff_t y1) noexcept
+{
+    const auto [x_min, x_max](std::minmax(x0, x1));
+    const auto [y_min, y_max](std::minmax(y0, y1));
+    return {x_min, y_min, n_t(x_max - x_min + 1), n_t(y_max - y_min + 1)};
+}
+
+SpatialIndex::SpatialIndex(n_t width, n_t height, n_t cellSize_in)
+try
+    : cellSize(cellSize_in), n_cellsX(std::max<n_t>((width + cellSize - 1) / cellSize, 1)), n_cellsY(std::max<n_t>((height + cellSize - 1) / cellSize, 1))
+{
+    if (!cellSize)
+        throw std::runtime_error(LOG_INFO "Spatial index cell size is zero"s);
+
+    cells.resize(n_cellsX * n_cellsY);
+}
+LOG_RETHROW
+
+auto SpatialIndex::cellRange(const Rect& rect) const noexcept -> CellRange
+{
+    // Empty rectangles still occupy the cell they're in, so they can be moved and removed like any other
+    const std::ptrdiff_t x_last(rect.x + std::ptrdiff_t(std::max<n_t>(rect.width, 1)) - 1);
+    const std::ptrdiff_t y_last(rect.y + std::ptrdiff_t(std::max<n_t>(rect.height, 1)) - 1);
+    return
+    {
+        clampedCell(rect.x, cellSize, n_cellsX), clampedCell(rect.y, cellSize, n_cellsY),
+        clampedCell(x_last, cellSize, n_cellsX) + 1, clampedCell(y_last, cellSize, n_cellsY) + 1
+    };
+}
+
+void SpatialIndex::link(index_t id, const CellRange& range)
+try
+{
+    for (index_t y(range.y_begin); y < range.y_end; ++y)
+        for (index_t x(range.x_begin); x < range.x_end; ++x)
+            cells[y * n_cellsX + x].push_back(id);
+}
+LOG_RETHROW
+
+void SpatialIndex::unlink(index_t id, const CellRange& range)
+try
+{
+    for (index_t y(range.y_begin); y < range.y_end; ++y)
+        for (index_t x(range.x_begin); x < range.x_end; ++x)
+        {
+            std::vector<index_t>& cell(cells[y * n_cellsX + x]);
+            const auto it(std::ranges::find(cell, id));
+            if (it == std::end(cell))
+                throw std::runtime_error(LOG_INFO "Object "s + std::to_string(id) + " is missing from its cell"s);
+
+            // Order within a cell doesn't matter, queries sort their results
+            *it = cell.back();
+            cell.pop_back();
+        }
+}
+LOG_RETHROW
+
+index_t SpatialIndex::insert(const Rect& rect)
+try
+{
+    const index_t id(std::size(objects));
+    objects.push_back({rect, false});
+    link(id, cellRange(rect));
+    return id;
+}
+LOG_RETHROW
+
+void SpatialIndex::move(index_t id, const Rect& rect)
+try
+{
+    Object& object(objects.at(id));
+    if (object.isRemoved)
+        throw std::runtime_error(LOG_INFO "Moving removed object "s + std::to_string(id));
+
+    // Moves within the same cells, the common case when dragging, don't touch the grid
+    const CellRange oldRange(cellRange(object.rect)), newRange(cellRange(rect));
+    if (oldRange != newRange)
+    {
+        unlink(id, oldRange);
+        link(id, newRange);
+    }
+
+    object.rect = rect;
+}
+LOG_RETHROW
+
+void SpatialIndex::remove(index_t id)
+try
+{
+    Object& object(objects.at(id));
+    if (object.isRemoved)
+        return;
+
+    unlink(id, cellRange(object.rect));
+    object.isRemoved = true;
+}
+LOG_RETHROW
+
+void SpatialIndex::clear()
+try
+{
+    objects.clear();
+    for (std::vector<index_t>& cell : cells)
+        cell.clear();
+}
+LOG_RETHROW
+
+const Rect& SpatialIndex::rect(index_t id) const
+try
+{
+    return objects.at(id).rect;
+}
+LOG_RETHROW
+
+void SpatialIndex::query(std::ptrdiff_t x, std::ptrdiff_t y, std::vector<index_t>& out) const
+try
+{
+    out.clear();
+    for (index_t id : cells[clampedCell(y, cellSize, n_cellsY) * n_cellsX + clampedCell(x, cellSize, n_cellsX)])
+        if (objects[id].rect.contains(x, y))
+            out.push_back(id);
+
+    std::ranges::sort(out, std::greater());
+}
+LOG_RETHROW
+
+void SpatialIndex::query(const Rect& rect, std::vector<index_t>& out) const
+try
+{
+    out.clear();
+    const CellRange range(cellRange(rect));
+    for (index_t y_cell(range.y_begin); y_cell < range.y_end; ++y_cell)
+        for (index_t x_cell(range.x_begin); x_cell < range.x_end; ++x_cell)
+            for (index_t id : cells[y_cell * n_cellsX + x_cell])
+            {
+                const Rect& objectRect(objects[id].rect);
+                if (!objectRect.intersects(rect))
+                    continue;
+
+                const std::ptrdiff_t x_overlap(std::max(objectRect.x, rect.x)), y_overlap(std::max(objectRect.y, rect.y));
+                if (clampedCell(x_overlap, cellSize, n_cellsX) == x_cell && clampedCell(y_overlap, cellSize, n_cellsY) == y_cell)
+                    out.push_back(id);
+            }
+
+    std::ranges::sort(out, std::greater());
+}
+LOG_RETHROW
+
+std::optional<index_t> SpatialIndex::hitTest(std::ptrdiff_t x, std::ptrdiff_t y) const
+try
+{
+    std::optional<index_t> ret;
+    for (index_t id : cells[clampedCell(y, cellSize, n_cellsY) * n_cellsX + clampedCell(x, cellSize, n_cellsX)])
+        if (objects[id].rect.contains(x, y) && (!ret || id > *ret))
+            ret = id;
+
+    return ret;
+}
+LOG_RETHROW
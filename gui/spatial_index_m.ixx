@@ -0,0 +1,64 @@
+module;
+
+#include "../global.h"
+
+export module spatial_index;
+
+// Half-open rectangle in pixels
+export struct Rect
+{
+    std::ptrdiff_t x, y;
+    n_t width, height;
+
+    bool contains(std::ptrdiff_t x_point, std::ptrdiff_t y_point) const noexcept;
+    bool intersects(const Rect& other) const noexcept;
+
+    // Normalised rectangle spanning two corners, both included, as made by dragging out a selection
+    static Rect fromCorners(std::ptrdiff_t x0, std::ptrdiff_t y0, std::ptrdiff_t x1, std::ptrdiff_t y1) noexcept;
+};
+
+// Uniform grid of object rectangles for hit testing. Each object is listed in every cell it overlaps; a query reports an object only from the cell containing
+// the top-left corner of the overlap, so an object spanning many cells is reported once without any per query bookkeeping.
+// Objects outside the indexed area are clamped into the edge cells.
+// Object IDs are handed out in insertion order and aren't reused until `clear`, and a higher ID is on top, so insert objects in draw order
+export class SpatialIndex
+{
+    struct Object
+    {
+        Rect rect;
+        bool isRemoved;
+    };
+
+    struct CellRange
+    {
+        index_t x_begin, y_begin, x_end, y_end;
+
+        bool operator==(const CellRange&) const = default;
+    };
+
+    n_t cellSize, n_cellsX, n_cellsY;
+    std::vector<Object> objects;
+    std::vector<std::vector<index_t>> cells;
+
+    CellRange cellRange(const Rect& rect) const noexcept;
+    void link(index_t id, const CellRange& range);
+    void unlink(index_t id, const CellRange& range);
+
+public:
+    // `width` and `height` in pixels of the area being indexed
+    SpatialIndex(n_t width, n_t height, n_t cellSize = 0x40);
+
+    index_t insert(const Rect& rect);
+    void move(index_t id, const Rect& rect);
+    void remove(index_t id);
+    void clear();
+
+    const Rect& rect(index_t id) const;
+
+    // IDs of the objects containing the point or intersecting the rectangle, topmost first. `out` is cleared first, reusing its capacity
+    void query(std::ptrdiff_t x, std::ptrdiff_t y, std::vector<index_t>& out) const;
+    void query(const Rect& rect, std::vector<index_t>& out) const;
+
+    // Topmost object containing the point
+    std::optional<index_t> hitTest(std::ptrdiff_t x, std::ptrdiff_t y) const;
+};
@@ -35,3 +35,12 @@ Window::Window(Os& os)
 
 void Window::onDestroy()
 {}
+
+void Window::onMouseMove(std::ptrdiff_t, std::ptrdiff_t)
+{}
+
+void Window::onMouseDown(std::ptrdiff_t, std::ptrdiff_t)
+{}
+
+void Window::onMouseUp(std::ptrdiff_t, std::ptrdiff_t)
+{}
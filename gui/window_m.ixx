@@ -48,6 +48,11 @@ public:
     explicit Window(Os& os);
 
     virtual void onDestroy();
+
+    // Mouse position in client area pixels. Button events are for the primary button
+    virtual void onMouseMove(std::ptrdiff_t x, std::ptrdiff_t y);
+    virtual void onMouseDown(std::ptrdiff_t x, std::ptrdiff_t y);
+    virtual void onMouseUp(std::ptrdiff_t x, std::ptrdiff_t y);
 };
 
 template<typename Self>
@@ -0,0 +1,24 @@
+#include "../global.h"
+
+#include <cstdlib> // for EXIT_FAILURE
+
+import main;
+import os_linux;
+
+int main(int argc, char* argv[])
+try
+{
+    Linux os;
+
+    // Skip the program name. Without a command there's no main window to fall back on, so show the usage
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    if (std::empty(arguments))
+        arguments.push_back("--help"s);
+
+    return main_common(os, arguments, {});
+}
+catch (const std::exception& e)
+{
+    DebugFile(DebugFile::error) << LOG_INFO << e.what() << '\n';
+    return EXIT_FAILURE;
+}
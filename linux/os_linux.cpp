@@ -0,0 +1,316 @@
+// XDG base directory specification: https://specifications.freedesktop.org/basedir-spec/latest/
+// inotify reference: https://man7.org/linux/man-pages/man7/inotify.7.html
+// mmap reference: https://man7.org/linux/man-pages/man2/mmap.2.html
+// flock reference: https://man7.org/linux/man-pages/man2/flock.2.html
+
+#include "../global.h"
+
+#include <cerrno> // for errno
+#include <cstdlib> // for EXIT_SUCCESS
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+import os_linux;
+
+// Rebuilds write the file in several goes, wait for them to stop before reporting the change
+static const int fileSettleTime(50); // In milliseconds
+
+// Catches files being rewritten in place, and written elsewhere and renamed over
+static const std::uint32_t watchMask(IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+static std::runtime_error systemError(const std::string& message)
+{
+    return std::runtime_error(message + ": "s + std::generic_category().message(errno));
+}
+
+Linux::~Linux()
+{
+    if (inotify != -1)
+        close(inotify);
+}
+
+int Linux::eventLoop()
+try
+{
+    // No windows, the only thing to wait on is watched files
+    isQuitting = false;
+    while (!isQuitting && !std::empty(fileWatches))
+    {
+        pollfd request{inotify, POLLIN, 0};
+        const int n_ready(poll(&request, 1, std::empty(changedWatches) ? -1 : fileSettleTime));
+        if (n_ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw systemError(LOG_INFO "Failed to wait for file changes"s);
+        }
+
+        if (n_ready)
+        {
+            readFileChanges();
+            continue;
+        }
+
+        // Settled
+        const std::set<index_t> ids(std::move(changedWatches));
+        changedWatches.clear();
+        for (index_t id : ids)
+            onFileChanged(id);
+    }
+
+    return EXIT_SUCCESS;
+}
+LOG_RETHROW
+
+void Linux::readFileChanges()
+try
+{
+    alignas(inotify_event) char buffer[0x1000];
+    const ssize_t n_bytes(read(inotify, buffer, sizeof(buffer)));
+    if (n_bytes < 0)
+    {
+        if (errno == EINTR || errno == EAGAIN)
+            return;
+
+        throw systemError(LOG_INFO "Failed to read file changes"s);
+    }
+
+    for (index_t i{}; i < index_t(n_bytes);)
+    {
+        const inotify_event& event(*reinterpret_cast<const inotify_event*>(&buffer[i]));
+        i += sizeof(inotify_event) + event.len;
+
+        // Dropped events could have been for any of the files
+        if (event.mask & IN_Q_OVERFLOW)
+        {
+            for (const auto& [id, watch] : fileWatches)
+                changedWatches.insert(id);
+
+            continue;
+        }
+
+        if (!event.len)
+            continue;
+
+        const std::string_view filename(event.name);
+        for (const auto& [id, watch] : fileWatches)
+            if (watch.watchDescriptor == event.wd && watch.filename == filename)
+                changedWatches.insert(id);
+    }
+}
+LOG_RETHROW
+
+void Linux::onFileChanged(index_t id)
+try
+{
+    // The watch may have been removed by an earlier callback
+    const auto it(fileWatches.find(id));
+    if (it == std::end(fileWatches))
+        return;
+
+    // The callback may unwatch this file, which would destroy it mid-call
+    std::move_only_function<void()> onChange(std::move(it->second.onChange));
+    onChange();
+    if (const auto it_after(fileWatches.find(id)); it_after != std::end(fileWatches))
+        it_after->second.onChange = std::move(onChange);
+}
+LOG_RETHROW
+
+std::filesystem::path Linux::getDataDirectory() const
+try
+{
+    std::filesystem::path ret;
+    if (const char* const dataHome(std::getenv("XDG_DATA_HOME")); dataHome && *dataHome)
+        ret = dataHome;
+    else if (const char* const home(std::getenv("HOME")); home && *home)
+        ret = std::filesystem::path(home) / ".local"s / "share"s;
+    else
+        throw std::runtime_error(LOG_INFO "Could not get XDG_DATA_HOME or HOME environment variable"s);
+
+    ret /= "PJ"s;
+    create_directories(ret);
+    return ret;
+}
+LOG_RETHROW
+
+std::filesystem::path Linux::getCacheDirectory() const
+try
+{
+    std::filesystem::path ret;
+    if (const char* const cacheHome(std::getenv("XDG_CACHE_HOME")); cacheHome && *cacheHome)
+        ret = cacheHome;
+    else if (const char* const home(std::getenv("HOME")); home && *home)
+        ret = std::filesystem::path(home) / ".cache"s;
+    else
+        throw std::runtime_error(LOG_INFO "Could not get XDG_CACHE_HOME or HOME environment variable"s);
+
+    ret /= "PJ"s;
+    create_directories(ret);
+    return ret;
+}
+LOG_RETHROW
+
+void Linux::error(const std::string& errorText) const
+try
+{
+    std::cerr << errorText << '\n';
+}
+LOG_RETHROW
+
+void Linux::message(const std::string& title, const std::string& text) const
+try
+{
+    std::cout << title << '\n' << text << '\n';
+}
+LOG_RETHROW
+
+void Linux::spawnMainWindow(MainWindow&, std::string_view, std::string_view, std::any)
+try
+{
+    throw std::runtime_error(LOG_INFO "There is no GUI on Linux, run with --help for the command line modes"s);
+}
+LOG_RETHROW
+
+void Linux::quit()
+{
+    isQuitting = true;
+}
+
+std::optional<std::filesystem::path> Linux::chooseFile(std::span<const FileFilter>, FunctionRef<bool(const std::filesystem::path&)>) const
+try
+{
+    return {};
+}
+LOG_RETHROW
+
+index_t Linux::watchFile(const std::filesystem::path& filepath, std::move_only_function<void()> onChange)
+try
+{
+    if (inotify == -1)
+    {
+        inotify = inotify_init1(IN_CLOEXEC);
+        if (inotify == -1)
+            throw systemError(LOG_INFO "Failed to initialise inotify"s);
+    }
+
+    // Watching a directory that's already watched gives back the same descriptor
+    const std::filesystem::path absolutePath(std::filesystem::absolute(filepath));
+    const int watchDescriptor(inotify_add_watch(inotify, absolutePath.parent_path().c_str(), watchMask));
+    if (watchDescriptor == -1)
+        throw systemError(LOG_INFO "Failed to watch directory of "s + filepath.string());
+
+    const index_t id(nextWatchId++);
+    fileWatches.emplace(id, FileWatch{watchDescriptor, absolutePath.filename().string(), std::move(onChange)});
+    return id;
+}
+LOG_RETHROW
+
+void Linux::unwatchFile(index_t id)
+try
+{
+    const auto it(fileWatches.find(id));
+    if (it == std::end(fileWatches))
+        return;
+
+    const int watchDescriptor(it->second.watchDescriptor);
+    fileWatches.erase(it);
+    changedWatches.erase(id);
+    if (std::ranges::none_of(fileWatches, [&](const auto& entry) { return entry.second.watchDescriptor == watchDescriptor; }))
+        inotify_rm_watch(inotify, watchDescriptor);
+}
+LOG_RETHROW
+
+class LinuxMappedFile final : public MappedFile
+{
+    void* p_data{MAP_FAILED};
+    n_t size{};
+
+public:
+    explicit LinuxMappedFile(const std::filesystem::path& filepath)
+    try
+    {
+        const int file(open(filepath.c_str(), O_RDONLY | O_CLOEXEC));
+        if (file == -1)
+            throw systemError(LOG_INFO "Failed to open "s + filepath.string());
+
+        // The mapping keeps its own reference to the file
+        struct stat status;
+        if (fstat(file, &status) == -1)
+        {
+            close(file);
+            throw systemError(LOG_INFO "Failed to get size of "s + filepath.string());
+        }
+
+        size = n_t(status.st_size);
+        if (size)
+            p_data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        close(file);
+        if (size && p_data == MAP_FAILED)
+            throw systemError(LOG_INFO "Failed to map "s + filepath.string());
+    }
+    LOG_RETHROW
+
+    ~LinuxMappedFile() override
+    {
+        if (p_data != MAP_FAILED)
+            munmap(p_data, size);
+    }
+
+    std::span<const std::uint8_t> bytes() const noexcept override
+    {
+        if (p_data == MAP_FAILED)
+            return {};
+
+        return {static_cast<const std::uint8_t*>(p_data), size};
+    }
+};
+
+std::unique_ptr<MappedFile> Linux::mapFile(const std::filesystem::path& filepath) const
+try
+{
+    return std::make_unique<LinuxMappedFile>(filepath);
+}
+LOG_RETHROW
+
+class LinuxFileLock final : public FileLock
+{
+    int file{-1};
+
+public:
+    explicit LinuxFileLock(const std::filesystem::path& filepath)
+    try
+    {
+        file = open(filepath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (file == -1)
+            throw systemError(LOG_INFO "Failed to open "s + filepath.string());
+
+        // The lock belongs to the open file description, so closing it releases the lock even if the process dies
+        while (flock(file, LOCK_EX) == -1)
+            if (errno != EINTR)
+            {
+                close(file);
+                throw systemError(LOG_INFO "Failed to lock "s + filepath.string());
+            }
+    }
+    LOG_RETHROW
+
+    ~LinuxFileLock() override
+    {
+        close(file);
+    }
+};
+
+std::unique_ptr<FileLock> Linux::lockFile(const std::filesystem::path& filepath) const
+try
+{
+    return std::make_unique<LinuxFileLock>(filepath);
+}
+LOG_RETHROW
@@ -0,0 +1,50 @@
+module;
+
+#include "../global.h"
+
+export module os_linux;
+
+export import os;
+
+export import main_window;
+
+// Headless backend: there's no GUI on Linux, only the command line modes
+export class Linux final : public Os
+{
+    struct FileWatch
+    {
+        int watchDescriptor;
+        std::string filename;
+        std::move_only_function<void()> onChange;
+    };
+
+    // One inotify instance for every watch, created with the first. Watches are on the file's directory
+    int inotify{-1};
+    std::map<index_t, FileWatch> fileWatches;
+    index_t nextWatchId{};
+
+    // Watches with changes that haven't settled yet
+    std::set<index_t> changedWatches;
+
+    bool isQuitting{};
+
+    void readFileChanges();
+    void onFileChanged(index_t id);
+
+public:
+    Linux() = default;
+    ~Linux() override;
+
+    int eventLoop() override;
+    std::filesystem::path getDataDirectory() const override;
+    std::filesystem::path getCacheDirectory() const override;
+    void error(const std::string& errorText) const override;
+    void message(const std::string& title, const std::string& text) const override;
+    void spawnMainWindow(MainWindow& window, std::string_view className, std::string_view title, std::any arg) override;
+    void quit() override;
+    std::optional<std::filesystem::path> chooseFile(std::span<const FileFilter> fileFilters, FunctionRef<bool(const std::filesystem::path&)> validator) const override;
+    index_t watchFile(const std::filesystem::path& filepath, std::move_only_function<void()> onChange) override;
+    void unwatchFile(index_t id) override;
+    std::unique_ptr<MappedFile> mapFile(const std::filesystem::path& filepath) const override;
+    std::unique_ptr<FileLock> lockFile(const std::filesystem::path& filepath) const override;
+};
@@ -2,26 +2,59 @@
 
 import main;
 
+import command_line;
 import main_window;
+import startup_profile;
 
-int main_common(Os& os, std::any main_window_arg)
+int main_common(Os& os, std::span<const std::string> arguments, std::any main_window_arg)
 try
 {
-    DebugFile::init(os.getDataDirectory());
+    StartupProfile& profile(startupProfile());
+    profile.endPhase("Before main"s);
 
-    Config config(os.getDataDirectory());
-    try
-    {
-        config.load();
-    }
-    catch (const std::exception& e)
+    const std::filesystem::path dataDirectory(os.getDataDirectory());
+    profile.endPhase("Data directory"s);
+
+    DebugFile::init(dataDirectory);
+    profile.endPhase("Debug file"s);
+
+    // Nothing reads the config while the window's being created, so it's loaded alongside and waited for before handling any events
+    Config config(dataDirectory);
+    std::future<void> configLoaded(std::async(std::launch::async, [&]()
     {
-        DebugFile(DebugFile::warning) << LOG_INFO "Failed to load config, using default config: " << e.what() << '\n';
-    }
+        profile.timeBackground("Config"s, [&]()
+        {
+            try
+            {
+                config.load();
+            }
+            catch (const std::exception& e)
+            {
+                DebugFile(DebugFile::warning) << LOG_INFO "Failed to load config, using default config: " << e.what() << '\n';
+            }
+        });
+    }));
 
     os.init(config);
+    profile.endPhase("OS"s);
+
+    // Command line arguments select a headless mode that skips the main window
+    if (!std::empty(arguments))
+    {
+        os.initDeferred();
+        configLoaded.get();
+        return runCommandLine(os, arguments);
+    }
 
     MainWindow mainWindow(os, std::move(main_window_arg));
+    profile.endPhase("Main window"s);
+    profile.markWindowShown();
+
+    // The console, like the asset cache and game tables that are loaded with the first ROM, isn't needed to show the window
+    os.initDeferred();
+    configLoaded.get();
+    profile.endPhase("Deferred OS"s);
+    profile.logReport();
 
     return os.eventLoop();
 }
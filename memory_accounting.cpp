@@ -0,0 +1,145 @@
+#include "global.h"
+
+import memory_accounting;
+
+static const char* const subsystemNames[n_memorySubsystems]{"Rooms", "Tiles", "Sprites"};
+static const char* const scopeNames[n_memoryScopes]{"Session arena", "Area arena", "Room arena"};
+
+static MemoryCounter subsystemCounters[n_memorySubsystems], scopeCounters[n_memoryScopes];
+
+void MemoryCounter::allocate(n_t size) noexcept
+{
+    const n_t live(bytesLive += size);
+    ++n_allocations;
+
+    n_t peak(bytesPeak);
+    while (live > peak && !bytesPeak.compare_exchange_weak(peak, live));
+}
+
+void MemoryCounter::deallocate(n_t size) noexcept
+{
+    bytesLive -= size;
+}
+
+MemoryUsage MemoryCounter::usage() const noexcept
+{
+    return {bytesLive, bytesPeak, n_allocations};
+}
+
+MemoryCounter& memoryCounter(MemorySubsystem subsystem) noexcept
+{
+    return subsystemCounters[toInt(subsystem)];
+}
+
+MemoryCounter& memoryCounter(MemoryScope scope) noexcept
+{
+    return scopeCounters[toInt(scope)];
+}
+
+TrackedResource::TrackedResource(MemoryCounter& counter, std::pmr::memory_resource* p_upstream_in) noexcept
+    : p_upstream(p_upstream_in), p_counter(&counter)
+{}
+
+void* TrackedResource::do_allocate(std::size_t size, std::size_t alignment)
+{
+    void* const ret(p_upstream->allocate(size, alignment));
+    p_counter->allocate(size);
+    return ret;
+}
+
+void TrackedResource::do_deallocate(void* p, std::size_t size, std::size_t alignment)
+{
+    p_upstream->deallocate(p, size, alignment);
+    p_counter->deallocate(size);
+}
+
+bool TrackedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    // Memory can be freed through any resource with the same upstream, the counts balance out as long as it's the same counter
+    const auto p_other(dynamic_cast<const TrackedResource*>(&other));
+    return p_other && p_other->p_counter == p_counter && p_other->p_upstream->is_equal(*p_upstream);
+}
+
+std::pmr::memory_resource* memoryResource(MemorySubsystem subsystem) noexcept
+{
+    static TrackedResource resources[n_memorySubsystems]
+    {
+        TrackedResource(subsystemCounters[0]),
+        TrackedResource(subsystemCounters[1]),
+        TrackedResource(subsystemCounters[2])
+    };
+
+    return &resources[toInt(subsystem)];
+}
+
+MemoryArena::MemoryArena(MemoryScope scope)
+    : blocks(memoryCounter(scope)),
+      arena(&blocks),
+      subsystemResources
+      {
+          TrackedResource(subsystemCounters[0], &arena),
+          TrackedResource(subsystemCounters[1], &arena),
+          TrackedResource(subsystemCounters[2], &arena)
+      }
+{}
+
+std::pmr::memory_resource* MemoryArena::resource(MemorySubsystem subsystem) noexcept
+{
+    return &subsystemResources[toInt(subsystem)];
+}
+
+void MemoryArena::reset() noexcept
+{
+    arena.release();
+}
+
+std::pmr::memory_resource* memoryResource(MemorySubsystem subsystem, MemoryArena* p_arena) noexcept
+{
+    return p_arena ? p_arena->resource(subsystem) : memoryResource(subsystem);
+}
+
+std::string memoryReport()
+try
+{
+    // Allocation counts as of the previous report, for the allocation rates
+    static std::mutex mutex;
+    static std::chrono::steady_clock::time_point previousTime;
+    static n_t previousSubsystemAllocations[n_memorySubsystems], previousScopeAllocations[n_memoryScopes];
+
+    std::lock_guard lock(mutex);
+    const auto time(std::chrono::steady_clock::now());
+    const double seconds(previousTime == std::chrono::steady_clock::time_point() ? 0 : std::chrono::duration<double>(time - previousTime).count());
+    previousTime = time;
+
+    std::ostringstream out;
+    out << std::left << std::setw(16) << "" << std::right << std::setw(14) << "Live bytes" << std::setw(14) << "Peak bytes" << std::setw(14) << "Allocations" << std::setw(14) << "Per second" << '\n';
+
+    const auto writeRow([&](const char* name, const MemoryUsage& usage, n_t& previousAllocations)
+    {
+        const double rate(seconds > 0 ? double(usage.n_allocations - previousAllocations) / seconds : 0);
+        previousAllocations = usage.n_allocations;
+        out << std::left << std::setw(16) << name << std::right << std::setw(14) << usage.bytesLive << std::setw(14) << usage.bytesPeak
+            << std::setw(14) << usage.n_allocations << std::setw(14) << std::fixed << std::setprecision(1) << rate << '\n';
+    });
+
+    for (index_t i{}; i < n_memorySubsystems; ++i)
+        writeRow(subsystemNames[i], subsystemCounters[i].usage(), previousSubsystemAllocations[i]);
+
+    for (index_t i{}; i < n_memoryScopes; ++i)
+        writeRow(scopeNames[i], scopeCounters[i].usage(), previousScopeAllocations[i]);
+
+    return out.str();
+}
+LOG_RETHROW
+
+void dumpMemoryReport(const std::filesystem::path& filepath)
+try
+{
+    std::ofstream out(filepath, std::ios::app);
+    if (!out)
+        throw std::runtime_error(LOG_INFO "Failed to open "s + filepath.string());
+
+    const std::time_t time(std::time({}));
+    out << std::put_time(std::gmtime(&time), "%c") << '\n' << memoryReport() << '\n';
+}
+LOG_RETHROW
@@ -0,0 +1,88 @@
+module;
+
+#include "global.h"
+
+export module memory_accounting;
+
+// What the memory is used for. Containers take their subsystem's resource, `memoryResource` by default, or an arena's
+export enum class MemorySubsystem
+{
+    rooms,   // Level data
+    tiles,   // Tileset graphics, tile tables and palettes
+    sprites  // Enemy and PLM populations
+};
+
+// How long the memory is kept for. Arenas of a scope are reset together when what they were loaded for is replaced
+export enum class MemoryScope
+{
+    session, // The open ROMs
+    area,
+    room
+};
+
+export const n_t
+    n_memorySubsystems{3},
+    n_memoryScopes{3};
+
+export struct MemoryUsage
+{
+    n_t bytesLive, bytesPeak, n_allocations;
+};
+
+export class MemoryCounter
+{
+    std::atomic<n_t> bytesLive{}, bytesPeak{}, n_allocations{};
+
+public:
+    void allocate(n_t size) noexcept;
+    void deallocate(n_t size) noexcept;
+
+    MemoryUsage usage() const noexcept;
+};
+
+export MemoryCounter& memoryCounter(MemorySubsystem subsystem) noexcept;
+export MemoryCounter& memoryCounter(MemoryScope scope) noexcept;
+
+// Counts allocations against a counter and passes them on upstream
+export class TrackedResource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource* p_upstream;
+    MemoryCounter* p_counter;
+
+    void* do_allocate(std::size_t size, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t size, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+    TrackedResource(MemoryCounter& counter, std::pmr::memory_resource* p_upstream = std::pmr::new_delete_resource()) noexcept;
+};
+
+// A subsystem's heap resource, for containers that aren't loaded into an arena
+export std::pmr::memory_resource* memoryResource(MemorySubsystem subsystem) noexcept;
+
+// Monotonic arena for what's loaded for a scope. Containers allocated from it count against their subsystem, the arena's blocks count against the scope.
+// Nothing is freed until `reset`, which frees everything at once. Not thread safe
+export class MemoryArena
+{
+    TrackedResource blocks;
+    std::pmr::monotonic_buffer_resource arena;
+    std::array<TrackedResource, n_memorySubsystems> subsystemResources;
+
+public:
+    explicit MemoryArena(MemoryScope scope);
+
+    MemoryArena(const MemoryArena&) = delete;
+    auto operator=(MemoryArena) = delete;
+
+    std::pmr::memory_resource* resource(MemorySubsystem subsystem) noexcept;
+
+    // Everything allocated from the arena must already have been destroyed
+    void reset() noexcept;
+};
+
+// The arena's resource for the subsystem if there's an arena, otherwise the subsystem's heap resource
+export std::pmr::memory_resource* memoryResource(MemorySubsystem subsystem, MemoryArena* p_arena) noexcept;
+
+// Live bytes, peak bytes and allocations per second of each subsystem and scope. Allocation rates are over the time since the previous report
+export std::string memoryReport();
+export void dumpMemoryReport(const std::filesystem::path& filepath);
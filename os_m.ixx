@@ -12,6 +12,22 @@ export struct FileFilter
     std::string_view label, glob;
 };
 
+// A read-only mapping of a whole file, unmapped when destroyed
+export class MappedFile
+{
+public:
+    virtual ~MappedFile() = default;
+
+    virtual std::span<const std::uint8_t> bytes() const noexcept = 0;
+};
+
+// An exclusive lock on a file shared between processes, released when destroyed
+export class FileLock
+{
+public:
+    virtual ~FileLock() = default;
+};
+
 export class Os
 {
 protected:
@@ -30,15 +46,34 @@ public:
 
     // Does not require configured state
     virtual std::filesystem::path getDataDirectory() const = 0;
+
+    // For files that can be regenerated, like the asset cache
+    virtual std::filesystem::path getCacheDirectory() const = 0;
     virtual void error(const std::string& errorText) const = 0;
+    virtual void message(const std::string& title, const std::string& text) const = 0;
 
-    // Set up config influenced state
+    // Set up config influenced state. Only what's needed to show the main window, the config may still be loading
     virtual void init(Config& config)
     {
         p_config = &config;
     }
 
+    // Set up state that can wait until the main window's shown, or before running a command line command
+    virtual void initDeferred()
+    {}
+
     virtual void spawnMainWindow(class MainWindow& window, std::string_view className, std::string_view title, std::any arg) = 0;
     virtual void quit() = 0;
     virtual std::optional<std::filesystem::path> chooseFile(std::span<const FileFilter> fileFilters, FunctionRef<bool(const std::filesystem::path&)> validator) const = 0;
+
+    // Calls `onChange` from the event loop once the file has been rewritten, renamed over or recreated, after writes to it have settled.
+    // Returns an ID for `unwatchFile`. Callbacks may watch and unwatch files
+    virtual index_t watchFile(const std::filesystem::path& filepath, std::move_only_function<void()> onChange) = 0;
+    virtual void unwatchFile(index_t id) = 0;
+
+    // Pages are read in as they're touched, so only the parts of the file that are looked at cost anything
+    virtual std::unique_ptr<MappedFile> mapFile(const std::filesystem::path& filepath) const = 0;
+
+    // Blocks until no other process holds the lock. The file is created if it doesn't exist, its contents aren't touched
+    virtual std::unique_ptr<FileLock> lockFile(const std::filesystem::path& filepath) const = 0;
 };
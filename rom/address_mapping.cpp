@@ -0,0 +1,120 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import address_mapping;
+
+static_assert(sizeof(index_t) == 8, "PC addresses are widened to 64 bits 4 at a time");
+
+// Translates 8 addresses at a time with `translate8`, which returns the PC addresses and all ones in the lanes of ROM addresses, then the remainder with Mapping's scalar functions
+template<AddressMapping Mapping, typename Translate8>
+static void translateToPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize, Translate8 translate8)
+{
+    const n_t n(std::size(addresses));
+    if (std::size(out) < n || std::size(invalid) < invalidMaskSize(n))
+        throw std::runtime_error(LOG_INFO "Address translation output is too small"s);
+
+    std::fill_n(std::begin(invalid), invalidMaskSize(n), std::uint64_t{});
+
+    // PC addresses are all below 8000'0000h, so a signed compare works as the range check
+    const __m256i limit(_mm256_set1_epi32(int(std::min<n_t>(romSize, 0x7FFF'FFFF))));
+    index_t i{};
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i address(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&addresses[i])));
+        const auto [pc, isRomAddress](translate8(address));
+        const __m256i isValid(_mm256_and_si256(isRomAddress, _mm256_cmpgt_epi32(limit, pc)));
+        const __m256i validPc(_mm256_and_si256(pc, isValid));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), _mm256_cvtepu32_epi64(_mm256_castsi256_si128(validPc)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i + 4]), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(validPc, 1)));
+
+        const unsigned invalidBits(~unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(isValid))) & 0xFF);
+        invalid[i / 0x40] |= std::uint64_t(invalidBits) << i % 0x40;
+    }
+
+    for (; i < n; ++i)
+    {
+        const bool isValid(Mapping::isRomAddress(addresses[i]) && Mapping::toPc(addresses[i]) < romSize);
+        out[i] = isValid ? Mapping::toPc(addresses[i]) : 0;
+        invalid[i / 0x40] |= std::uint64_t(!isValid) << i % 0x40;
+    }
+}
+
+// Lanes where `v & mask` is non-zero
+static __m256i testBits(__m256i v, std::uint32_t mask) noexcept
+{
+    return _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, _mm256_set1_epi32(int(mask))), _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+}
+
+// Lanes of 24 bit addresses not in banks $7E-$7F
+static __m256i isSnesNonWramBank(__m256i address) noexcept
+{
+    const __m256i
+        is24Bit(_mm256_cmpeq_epi32(_mm256_srli_epi32(address, 24), _mm256_setzero_si256())),
+        isWram(_mm256_cmpeq_epi32(_mm256_srli_epi32(address, 17), _mm256_set1_epi32(0x7E >> 1)));
+
+    return _mm256_andnot_si256(isWram, is24Bit);
+}
+
+// Shared by HiROM and ExHiROM: any address in banks $40-$7D and $C0-$FF, upper halves only in banks $00-$3F and $80-$BF
+static __m256i isHiRomAddress(__m256i address) noexcept
+{
+    const __m256i isFullBank(testBits(address, 0x40'0000));
+    const __m256i isUpperHalf(testBits(address, 0x8000));
+    return _mm256_and_si256(isSnesNonWramBank(address), _mm256_or_si256(isFullBank, isUpperHalf));
+}
+
+void LoRomMapping::toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize)
+try
+{
+    translateToPc<LoRomMapping>(addresses, out, invalid, romSize, [](__m256i address)
+    {
+        const __m256i isRomAddress(_mm256_and_si256(isSnesNonWramBank(address), testBits(address, 0x8000)));
+        const __m256i pc(_mm256_or_si256(
+            _mm256_srli_epi32(_mm256_and_si256(address, _mm256_set1_epi32(0x7F'0000)), 1),
+            _mm256_and_si256(address, _mm256_set1_epi32(0x7FFF))));
+
+        return std::pair(pc, isRomAddress);
+    });
+}
+LOG_RETHROW
+
+void HiRomMapping::toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize)
+try
+{
+    translateToPc<HiRomMapping>(addresses, out, invalid, romSize, [](__m256i address)
+    {
+        return std::pair(_mm256_and_si256(address, _mm256_set1_epi32(0x3F'FFFF)), isHiRomAddress(address));
+    });
+}
+LOG_RETHROW
+
+void ExHiRomMapping::toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize)
+try
+{
+    translateToPc<ExHiRomMapping>(addresses, out, invalid, romSize, [](__m256i address)
+    {
+        // Banks $00-$7F are the second 4MiB
+        const __m256i upperRom(_mm256_andnot_si256(_mm256_srli_epi32(address, 1), _mm256_set1_epi32(0x40'0000)));
+        const __m256i pc(_mm256_or_si256(_mm256_and_si256(address, _mm256_set1_epi32(0x3F'FFFF)), upperRom));
+        return std::pair(pc, isHiRomAddress(address));
+    });
+}
+LOG_RETHROW
+
+void GbaMapping::toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize)
+try
+{
+    translateToPc<GbaMapping>(addresses, out, invalid, romSize, [](__m256i address)
+    {
+        // 0800'0000h-0DFF'FFFFh is address >> 25 in [4, 6]
+        const __m256i region(_mm256_srli_epi32(address, 25));
+        const __m256i isRomAddress(_mm256_and_si256(
+            _mm256_cmpgt_epi32(region, _mm256_set1_epi32(3)),
+            _mm256_cmpgt_epi32(_mm256_set1_epi32(7), region)));
+
+        return std::pair(_mm256_and_si256(address, _mm256_set1_epi32(0x1FF'FFFF)), isRomAddress);
+    });
+}
+LOG_RETHROW
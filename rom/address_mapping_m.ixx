@@ -0,0 +1,193 @@
+module;
+
+#include "../global.h"
+
+export module address_mapping;
+
+export import error;
+
+// Address mapping policies between the console's address space and ROM file offsets (PC addresses, not counting any copier header).
+// The constexpr single address functions: `toPc` requires `isRomAddress(address)` and `fromPc` requires `isPcAddress(address)`, callers that can't guarantee that check first
+// or use `tryToPc` and `tryFromPc` below.
+// The batch functions never throw for bad addresses. Bit i % 40h of invalid[i / 40h] is set for each address i that isn't a ROM address or that maps to romSize or beyond,
+// and its output is zero. `invalid` must have at least invalidMaskSize(std::size(addresses)) elements
+
+export constexpr n_t invalidMaskSize(n_t n_addresses) noexcept
+{
+    return (n_addresses + 0x3F) / 0x40;
+}
+
+export constexpr n_t copierHeaderSize(n_t fileSize) noexcept
+{
+    return fileSize % 0x8000 == 0x200 ? 0x200 : 0;
+}
+
+// LoROM: 8000h bytes of ROM at $8000-$FFFF of banks $00-$7D and $80-$FF, banks $00-$7D mirror banks $80-$FD
+export struct LoRomMapping
+{
+    static constexpr n_t romSizeLimit{0x80 * 0x8000};
+
+    static constexpr bool isRomAddress(std::uint32_t address) noexcept
+    {
+        return address <= 0xFF'FFFF && (address & 0x8000) && (address >> 17) != 0x7E >> 1;
+    }
+
+    static constexpr index_t toPc(std::uint32_t address) noexcept
+    {
+        return (address >> 16 & 0x7F) * 0x8000 + (address & 0x7FFF);
+    }
+
+    static constexpr bool isPcAddress(index_t address) noexcept
+    {
+        return address < romSizeLimit;
+    }
+
+    static constexpr std::uint32_t fromPc(index_t address) noexcept
+    {
+        return std::uint32_t(0x800000 | address / 0x8000 << 16 | 0x8000 | address % 0x8000);
+    }
+
+    static void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize);
+};
+
+// HiROM: 10000h bytes of ROM in each of banks $C0-$FF, mirrored in banks $40-$7D and in the upper halves of banks $00-$3F and $80-$BF
+export struct HiRomMapping
+{
+    static constexpr n_t romSizeLimit{0x40'0000};
+
+    static constexpr bool isRomAddress(std::uint32_t address) noexcept
+    {
+        return address <= 0xFF'FFFF && (address & 0x40'0000 ? (address >> 17) != 0x7E >> 1 : (address & 0x8000) != 0);
+    }
+
+    static constexpr index_t toPc(std::uint32_t address) noexcept
+    {
+        return address & 0x3F'FFFF;
+    }
+
+    static constexpr bool isPcAddress(index_t address) noexcept
+    {
+        return address < romSizeLimit;
+    }
+
+    static constexpr std::uint32_t fromPc(index_t address) noexcept
+    {
+        return std::uint32_t(0xC0'0000 | address);
+    }
+
+    static void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize);
+};
+
+// ExHiROM: the first 4MiB as HiROM banks $C0-$FF (upper halves mirrored in $80-$BF), the next 4MiB in banks $40-$7D (upper halves mirrored in $00-$3F).
+// The last 20000h bytes are only reachable through the upper halves of banks $3E-$3F, as banks $7E-$7F are WRAM
+export struct ExHiRomMapping
+{
+    static constexpr n_t romSizeLimit{0x80'0000};
+
+    static constexpr bool isRomAddress(std::uint32_t address) noexcept
+    {
+        return HiRomMapping::isRomAddress(address);
+    }
+
+    static constexpr index_t toPc(std::uint32_t address) noexcept
+    {
+        return (address & 0x3F'FFFF) | (~address >> 1 & 0x40'0000);
+    }
+
+    static constexpr bool isPcAddress(index_t address) noexcept
+    {
+        return address < 0x7E'0000 || (address < romSizeLimit && address & 0x8000);
+    }
+
+    static constexpr std::uint32_t fromPc(index_t address) noexcept
+    {
+        if (address < 0x40'0000)
+            return std::uint32_t(0xC0'0000 | address);
+
+        if (address < 0x7E'0000)
+            return std::uint32_t(address);
+
+        return std::uint32_t(address - 0x40'0000);
+    }
+
+    static void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize);
+};
+
+// GBA cartridge ROM is mapped at 0800'0000h-09FF'FFFFh, and mirrored at 0A00'0000h and 0C00'0000h (the regions with the other wait state settings)
+export struct GbaMapping
+{
+    static constexpr n_t romSizeLimit{0x200'0000};
+
+    static constexpr bool isRomAddress(std::uint32_t address) noexcept
+    {
+        return address - 0x0800'0000 < 0x0600'0000;
+    }
+
+    static constexpr index_t toPc(std::uint32_t address) noexcept
+    {
+        return address & 0x1FF'FFFF;
+    }
+
+    static constexpr bool isPcAddress(index_t address) noexcept
+    {
+        return address < romSizeLimit;
+    }
+
+    static constexpr std::uint32_t fromPc(index_t address) noexcept
+    {
+        return std::uint32_t(0x0800'0000 | address);
+    }
+
+    static void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize);
+};
+
+export template<typename Mapping>
+concept AddressMapping = requires(std::uint32_t address, index_t pcAddress, std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid)
+{
+    { Mapping::romSizeLimit } -> std::convertible_to<n_t>;
+    { Mapping::isRomAddress(address) } -> std::same_as<bool>;
+    { Mapping::toPc(address) } -> std::same_as<index_t>;
+    { Mapping::isPcAddress(pcAddress) } -> std::same_as<bool>;
+    { Mapping::fromPc(pcAddress) } -> std::same_as<std::uint32_t>;
+    Mapping::toPc(addresses, out, invalid, pcAddress);
+};
+
+// `toPc` with its precondition checked and the result limited to a `romSize` byte ROM, for pointers read from ROM data that are often bad
+export template<AddressMapping Mapping>
+Result<index_t> tryToPc(std::uint32_t address, n_t romSize) noexcept
+{
+    if (!Mapping::isRomAddress(address))
+        return makeError(ErrorCode::notRomAddress, address);
+
+    const index_t ret(Mapping::toPc(address));
+    if (ret >= romSize)
+        return makeError(ErrorCode::beyondRom, address);
+
+    return ret;
+}
+
+// `fromPc` with its precondition checked
+export template<AddressMapping Mapping>
+Result<std::uint32_t> tryFromPc(index_t address) noexcept
+{
+    if (!Mapping::isPcAddress(address))
+        return makeError(ErrorCode::notPcAddress, std::uint32_t(std::min<index_t>(address, 0xFFFF'FFFF)));
+
+    return Mapping::fromPc(address);
+}
+
+static_assert(AddressMapping<LoRomMapping> && AddressMapping<HiRomMapping> && AddressMapping<ExHiRomMapping> && AddressMapping<GbaMapping>);
+
+static_assert(LoRomMapping::toPc(0x8F'91F8) == 0x7'91F8 && LoRomMapping::fromPc(0x7'91F8) == 0x8F'91F8);
+static_assert(LoRomMapping::isRomAddress(0xFF'8000) && LoRomMapping::toPc(0xFF'8000) == 0x3F'8000);
+static_assert(!LoRomMapping::isRomAddress(0x7E'8000) && !LoRomMapping::isRomAddress(0xFF'8000 - 1) && !LoRomMapping::isRomAddress(0x100'8000));
+
+static_assert(HiRomMapping::toPc(0xC1'2345) == 0x1'2345 && HiRomMapping::toPc(0x01'8000) == 0x1'8000 && HiRomMapping::toPc(0x41'0000) == 0x1'0000);
+static_assert(!HiRomMapping::isRomAddress(0x01'7FFF) && !HiRomMapping::isRomAddress(0x7F'0000) && HiRomMapping::isRomAddress(0xFF'0000));
+
+static_assert(ExHiRomMapping::toPc(0xC0'0000) == 0 && ExHiRomMapping::toPc(0x40'0000) == 0x40'0000 && ExHiRomMapping::toPc(0x3E'8000) == 0x7E'8000);
+static_assert(ExHiRomMapping::toPc(0x80'8000) == 0x8000 && ExHiRomMapping::toPc(0x00'8000) == 0x40'8000);
+static_assert(ExHiRomMapping::fromPc(0x7E'8000) == 0x3E'8000 && ExHiRomMapping::fromPc(0x45'0000) == 0x45'0000 && !ExHiRomMapping::isPcAddress(0x7E'7FFF));
+
+static_assert(GbaMapping::toPc(0x0823'4567) == 0x23'4567 && GbaMapping::toPc(0x0C00'0010) == 0x10);
+static_assert(!GbaMapping::isRomAddress(0x0300'0000) && !GbaMapping::isRomAddress(0x0E00'0000) && GbaMapping::isRomAddress(0x0DFF'FFFF));
@@ -0,0 +1,338 @@
+#include "../global.h"
+
+import asset_cache;
+
+import rom;
+
+// Both files start with the magic number, the format version, and the pack's generation, which changes whenever the pack is rewritten.
+// An index whose generation doesn't match the pack's is from before an interrupted compaction
+static const std::uint32_t
+    cacheMagic(0x43414A50), // "PJAC"
+    cacheFormatVersion(2);
+
+static const n_t
+    headerSize(0x10),
+    prefixSize(0x10),
+    blobAlignment(0x10);
+
+struct CacheHeader
+{
+    std::uint32_t magic, formatVersion;
+    std::uint64_t generation;
+};
+
+static_assert(sizeof(CacheHeader) == headerSize);
+
+static std::optional<CacheHeader> readHeader(std::span<const std::uint8_t> file) noexcept
+{
+    if (std::size(file) < headerSize)
+        return {};
+
+    CacheHeader ret;
+    std::memcpy(&ret, std::data(file), headerSize);
+    if (ret.magic != cacheMagic || ret.formatVersion != cacheFormatVersion)
+        return {};
+
+    return ret;
+}
+
+static void writeHeader(std::ostream& out, std::uint64_t generation)
+try
+{
+    const CacheHeader header{cacheMagic, cacheFormatVersion, generation};
+    out.write(reinterpret_cast<const char*>(&header), headerSize);
+}
+LOG_RETHROW
+
+static n_t alignBlob(n_t offset) noexcept
+{
+    return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+}
+
+std::uint64_t AssetCache::key(std::uint64_t prefixHash, std::uint32_t codecVersion) noexcept
+{
+    return prefixHash ^ std::uint64_t(codecVersion) * 0x9E3779B97F4A7C15;
+}
+
+AssetCache::AssetCache(const Os& os, const std::filesystem::path& directory, n_t sizeLimit_in)
+try
+    : p_os(&os), packPath(directory / "assets.pack"s), indexPath(directory / "assets.index"s), lockPath(directory / "assets.lock"s), sizeLimit(sizeLimit_in)
+{
+    create_directories(directory);
+    const std::unique_ptr<FileLock> p_lock(os.lockFile(lockPath));
+
+    std::error_code error;
+    const n_t packFileSize(std::filesystem::file_size(packPath, error));
+    std::vector<IndexRecord> records;
+    if (!error)
+    {
+        p_pack = os.mapFile(packPath);
+        if (const std::optional<CacheHeader> header(readHeader(p_pack->bytes())); header)
+        {
+            generation = header->generation;
+            records = loadIndex(packFileSize);
+        }
+        else
+            p_pack.reset();
+    }
+
+    if (!p_pack)
+        reset();
+    else
+        compact(std::move(records));
+
+    if (!p_pack)
+        p_pack = os.mapFile(packPath);
+
+    packSize = std::size(p_pack->bytes());
+    packOut.open(packPath, std::ios::binary | std::ios::app);
+    packOut.exceptions(std::ios::badbit | std::ios::failbit);
+    indexOut.open(indexPath, std::ios::binary | std::ios::app);
+    indexOut.exceptions(std::ios::badbit | std::ios::failbit);
+}
+LOG_RETHROW
+
+auto AssetCache::loadIndex(n_t packFileSize) -> std::vector<IndexRecord>
+try
+{
+    std::ifstream in(indexPath, std::ios::binary);
+    if (!in)
+        return {};
+
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::optional<CacheHeader> header(readHeader(bytes));
+    if (!header || header->generation != generation)
+        return {};
+
+    // A record cut short by a crash is dropped, as is any record for a blob that didn't make it into the pack
+    std::vector<IndexRecord> ret((std::size(bytes) - headerSize) / sizeof(IndexRecord));
+    std::memcpy(std::data(ret), std::data(bytes) + headerSize, std::size(ret) * sizeof(IndexRecord));
+    std::erase_if(ret, [&](const IndexRecord& record) { return record.offset < headerSize || record.offset + record.size > packFileSize; });
+    return ret;
+}
+LOG_RETHROW
+
+void AssetCache::reset()
+try
+{
+    p_pack.reset();
+    generation = std::uint64_t(std::chrono::system_clock::now().time_since_epoch().count());
+
+    std::ofstream pack(packPath, std::ios::binary | std::ios::trunc);
+    pack.exceptions(std::ios::badbit | std::ios::failbit);
+    writeHeader(pack, generation);
+
+    std::ofstream index(indexPath, std::ios::binary | std::ios::trunc);
+    index.exceptions(std::ios::badbit | std::ios::failbit);
+    writeHeader(index, generation);
+}
+LOG_RETHROW
+
+void AssetCache::compact(std::vector<IndexRecord> records)
+try
+{
+    // Records are appended when a blob is added or used, so the last record for a blob is its last use. Oldest first
+    std::unordered_map<std::uint64_t, index_t> i_lastRecords;
+    for (index_t i{}; i < std::size(records); ++i)
+        i_lastRecords[records[i].offset] = i;
+
+    std::vector<IndexRecord> live;
+    for (index_t i{}; i < std::size(records); ++i)
+        if (i_lastRecords[records[i].offset] == i)
+            live.push_back(records[i]);
+
+    // Keep the most recently used blobs that fit in three quarters of the limit, leaving room to grow before the next compaction
+    n_t liveSize{};
+    for (const IndexRecord& record : live)
+        liveSize += alignBlob(record.size);
+
+    const n_t packFileSize(std::size(p_pack->bytes()));
+    const bool isOverLimit(headerSize + liveSize > sizeLimit);
+    const bool isWasteful(packFileSize > (headerSize + liveSize) * 2 + 0x100000 || std::size(records) > std::size(live) * 2 + 0x100);
+    if (isOverLimit || isWasteful)
+    {
+        if (isOverLimit)
+        {
+            n_t keptSize{};
+            auto it(std::rbegin(live));
+            for (; it != std::rend(live) && headerSize + keptSize + alignBlob(it->size) <= sizeLimit / 4 * 3; ++it)
+                keptSize += alignBlob(it->size);
+
+            live.erase(std::begin(live), it.base());
+        }
+
+        const std::filesystem::path newPackPath(packPath.string() + ".new"s), newIndexPath(indexPath.string() + ".new"s);
+        const std::span<const std::uint8_t> oldPack(p_pack->bytes());
+        ++generation;
+        {
+            std::ofstream pack(newPackPath, std::ios::binary | std::ios::trunc);
+            pack.exceptions(std::ios::badbit | std::ios::failbit);
+            writeHeader(pack, generation);
+
+            n_t offset(headerSize);
+            const char padding[blobAlignment]{};
+            for (IndexRecord& record : live)
+            {
+                const n_t alignedOffset(alignBlob(offset));
+                pack.write(padding, std::streamsize(alignedOffset - offset));
+                pack.write(reinterpret_cast<const char*>(std::data(oldPack) + record.offset), std::streamsize(record.size));
+                record.offset = alignedOffset;
+                offset = alignedOffset + record.size;
+            }
+
+            std::ofstream index(newIndexPath, std::ios::binary | std::ios::trunc);
+            index.exceptions(std::ios::badbit | std::ios::failbit);
+            writeHeader(index, generation);
+            index.write(reinterpret_cast<const char*>(std::data(live)), std::streamsize(std::size(live) * sizeof(IndexRecord)));
+        }
+
+        DebugFile(DebugFile::info) << LOG_INFO "Compacted asset cache from "s << packFileSize << " to "s << std::filesystem::file_size(newPackPath) << " bytes\n"s;
+        p_pack.reset();
+        std::filesystem::rename(newPackPath, packPath);
+        std::filesystem::rename(newIndexPath, indexPath);
+        p_pack = p_os->mapFile(packPath);
+    }
+
+    const std::span<const std::uint8_t> pack(p_pack->bytes());
+    n_loaded = std::size(live);
+    for (index_t i{}; i < std::size(live); ++i)
+    {
+        const IndexRecord& record(live[i]);
+        entries.emplace(key(record.prefixHash, record.codecVersion), Entry{record, pack.subspan(record.offset, record.size), i});
+    }
+}
+LOG_RETHROW
+
+bool AssetCache::isPackCurrent() const
+try
+{
+    // Another process compacting the cache renames new files over the ones this cache has open, writes to those would be lost
+    std::ifstream in(packPath, std::ios::binary);
+    std::array<std::uint8_t, headerSize> bytes{};
+    in.read(reinterpret_cast<char*>(std::data(bytes)), std::streamsize(headerSize));
+    const std::optional<CacheHeader> header(readHeader(bytes));
+    return header && header->generation == generation;
+}
+LOG_RETHROW
+
+// Callers hold the lock file
+void AssetCache::appendRecord(const IndexRecord& record)
+try
+{
+    indexOut.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    indexOut.flush();
+}
+LOG_RETHROW
+
+void AssetCache::appendBlob(IndexRecord& record, std::span<const std::uint8_t> data)
+try
+{
+    // Other processes append to the same pack, so its end is read under the lock rather than remembered
+    const std::unique_ptr<FileLock> p_lock(p_os->lockFile(lockPath));
+    if (!isPackCurrent())
+        return;
+
+    packSize = n_t(std::filesystem::file_size(packPath));
+    record.offset = alignBlob(packSize);
+    if (record.offset + record.size > sizeLimit)
+        return;
+
+    // The blob is flushed before its index record is written, so the index never refers to a blob that isn't there
+    const char padding[blobAlignment]{};
+    packOut.write(padding, std::streamsize(record.offset - packSize));
+    packOut.write(reinterpret_cast<const char*>(std::data(data)), std::streamsize(std::size(data)));
+    packOut.flush();
+    packSize = record.offset + record.size;
+    appendRecord(record);
+}
+LOG_RETHROW
+
+CachedAsset AssetCache::decompress(std::span<const std::uint8_t> source, std::uint32_t codecVersion, Codec codec)
+try
+{
+    const std::uint64_t prefixHash(hashBytes(source.first(std::min(prefixSize, std::size(source)))));
+    const std::uint64_t entryKey(key(prefixHash, codecVersion));
+    {
+        std::lock_guard lock(mutex);
+        const auto [begin, end](entries.equal_range(entryKey));
+        for (auto it(begin); it != end; ++it)
+        {
+            Entry& entry(it->second);
+            const IndexRecord& record(entry.record);
+            if (record.prefixHash != prefixHash || record.codecVersion != codecVersion || record.sourceSize > std::size(source))
+                continue;
+
+            if (hashBytes(source.first(record.sourceSize)) != record.sourceHash)
+                continue;
+
+            // A blob damaged on disk is dropped and decompressed again, the new copy supersedes it in the index
+            if (!entry.isVerified)
+            {
+                if (hashBytes(entry.data) != record.dataHash)
+                {
+                    DebugFile(DebugFile::warning) << LOG_INFO "Asset cache blob at "s << record.offset << " failed its checksum\n"s;
+                    entries.erase(it);
+                    break;
+                }
+
+                entry.isVerified = true;
+            }
+
+            // Using an old blob records the use, so that compaction keeps it. Newer blobs aren't at risk, so the index doesn't grow with every open
+            if (entry.recency < n_loaded / 2)
+            {
+                const std::unique_ptr<FileLock> p_lock(p_os->lockFile(lockPath));
+                if (isPackCurrent())
+                    appendRecord(record);
+
+                entry.recency = n_loaded;
+            }
+
+            ++n_hits_;
+            return {entry.data, record.sourceSize};
+        }
+    }
+
+    Decompressed decompressed(codec(source));
+    ++n_misses_;
+
+    std::lock_guard lock(mutex);
+    const std::vector<std::uint8_t>& data(addedBlobs.emplace_back(std::move(decompressed.data)));
+    IndexRecord record{prefixHash, hashBytes(source.first(decompressed.compressedSize)), 0, std::size(data), hashBytes(data), std::uint32_t(decompressed.compressedSize), codecVersion};
+    appendBlob(record, data);
+    entries.emplace(entryKey, Entry{record, data, n_loaded, true});
+    return {data, decompressed.compressedSize};
+}
+LOG_RETHROW
+
+CachedAsset AssetCache::decompress(std::span<const std::uint8_t> source)
+try
+{
+    return decompress(source, decompressVersion, [](std::span<const std::uint8_t> compressed)
+    {
+        return ::decompress(compressed);
+    });
+}
+LOG_RETHROW
+
+n_t AssetCache::n_hits() const noexcept
+{
+    return n_hits_;
+}
+
+n_t AssetCache::n_misses() const noexcept
+{
+    return n_misses_;
+}
+
+CachedAsset decompress(AssetCache* p_cache, std::span<const std::uint8_t> source, std::vector<std::uint8_t>& storage)
+try
+{
+    if (p_cache)
+        return p_cache->decompress(source);
+
+    Decompressed decompressed(decompress(source));
+    storage = std::move(decompressed.data);
+    return {storage, decompressed.compressedSize};
+}
+LOG_RETHROW
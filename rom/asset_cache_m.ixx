@@ -0,0 +1,89 @@
+module;
+
+#include "../global.h"
+
+export module asset_cache;
+
+export import decompress;
+export import os;
+
+export struct CachedAsset
+{
+    std::span<const std::uint8_t> data;
+    n_t compressedSize;
+};
+
+// Decompressed assets kept on disk between runs, keyed by a hash of the compressed bytes and the version of the codec that decompressed them,
+// so that reopening a ROM doesn't decompress anything it's decompressed before.
+// Blobs are appended to one pack file that's memory mapped when the cache is opened, with an append-only index alongside it.
+// Blobs added while the cache is open are served from memory until it's next opened. Past the size limit nothing more is added,
+// and the next open compacts the pack down to the most recently used blobs. Each blob's checksum is checked the first time it's used.
+// Thread safe, and processes sharing the directory take a lock file around opening and every write
+export class AssetCache
+{
+public:
+    static constexpr n_t defaultSizeLimit{0x10000000};
+
+    using Codec = FunctionRef<Decompressed(std::span<const std::uint8_t>)>;
+
+private:
+    struct IndexRecord
+    {
+        // The prefix finds candidates before the source size is known
+        std::uint64_t prefixHash, sourceHash, offset, size, dataHash;
+        std::uint32_t sourceSize, codecVersion;
+    };
+
+    struct Entry
+    {
+        IndexRecord record;
+        std::span<const std::uint8_t> data;
+
+        // Order of last use as of opening, entries used since are newest
+        index_t recency;
+
+        // Blobs added since opening don't need checking
+        bool isVerified{};
+    };
+
+    const Os* p_os;
+    std::filesystem::path packPath, indexPath, lockPath;
+    n_t sizeLimit;
+    std::uint64_t generation{};
+    std::unique_ptr<MappedFile> p_pack;
+    std::ofstream packOut, indexOut;
+    n_t packSize{}, n_loaded{};
+
+    // Keyed by `key`
+    std::unordered_multimap<std::uint64_t, Entry> entries;
+    std::deque<std::vector<std::uint8_t>> addedBlobs;
+    std::atomic<n_t> n_hits_{}, n_misses_{};
+    std::mutex mutex;
+
+    static std::uint64_t key(std::uint64_t prefixHash, std::uint32_t codecVersion) noexcept;
+
+    std::vector<IndexRecord> loadIndex(n_t packFileSize);
+    void reset();
+    void compact(std::vector<IndexRecord> records);
+    bool isPackCurrent() const;
+    void appendRecord(const IndexRecord& record);
+    void appendBlob(IndexRecord& record, std::span<const std::uint8_t> data);
+
+public:
+    AssetCache(const Os& os, const std::filesystem::path& directory, n_t sizeLimit = defaultSizeLimit);
+
+    AssetCache(const AssetCache&) = delete;
+    auto operator=(AssetCache) = delete;
+
+    // The decompression of the start of `source` by `codec`, decompressing and adding it if it isn't cached. The data lives as long as the cache
+    CachedAsset decompress(std::span<const std::uint8_t> source, std::uint32_t codecVersion, Codec codec);
+
+    // Super Metroid's LZ variant
+    CachedAsset decompress(std::span<const std::uint8_t> source);
+
+    n_t n_hits() const noexcept;
+    n_t n_misses() const noexcept;
+};
+
+// For callers with an optional cache. Without one, the data is decompressed into `storage`
+export CachedAsset decompress(AssetCache* p_cache, std::span<const std::uint8_t> source, std::vector<std::uint8_t>& storage);
@@ -0,0 +1,186 @@
+#include "../global.h"
+
+import compress;
+
+static const n_t
+    maxSize(0x10000),
+    maxLength(0x400),
+    maxShortLength(0x20),
+    maxRelativeDistance(0xFF),
+    hashBits(12),
+    maxChain(0x40);
+
+// Commands, as documented in `decompress`. The inverted copies aren't used: the extended form of command 7 can produce an FFh command byte, which is the terminator
+static const unsigned
+    copyLiteral(0),
+    fillByte(1),
+    fillPair(2),
+    fillIncrementing(3),
+    copyAbsolute(4),
+    copyRelative(6);
+
+static void writeCommand(std::vector<std::uint8_t>& out, unsigned command, n_t length)
+{
+    const n_t n(length - 1);
+    if (length <= maxShortLength)
+        out.push_back(std::uint8_t(command << 5 | n));
+    else
+    {
+        out.push_back(std::uint8_t(0xE0 | command << 2 | n >> 8));
+        out.push_back(std::uint8_t(n));
+    }
+}
+
+static n_t headerSize(n_t length) noexcept
+{
+    return length <= maxShortLength ? 1 : 2;
+}
+
+static index_t hash3(std::span<const std::uint8_t> data, index_t i) noexcept
+{
+    return (data[i] << 8 ^ data[i + 1] << 4 ^ data[i + 2]) & ((1 << hashBits) - 1);
+}
+
+std::vector<std::uint8_t> compress(std::span<const std::uint8_t> data)
+try
+{
+    if (std::size(data) > maxSize)
+        throw std::runtime_error(LOG_INFO "Data to compress exceeds "s + toHexString(maxSize, 3) + " bytes"s);
+
+    const n_t n(std::size(data));
+    std::vector<std::uint8_t> out;
+    std::vector<index_t> head(n_t(1) << hashBits), prev(n);
+    index_t i_literal{}, i{};
+
+    // Hash chain entries are positions + 1 so that zero means empty
+    const auto insertHash([&](index_t i_position)
+    {
+        if (i_position + 3 > n)
+            return;
+
+        const index_t hash(hash3(data, i_position));
+        prev[i_position] = head[hash];
+        head[hash] = i_position + 1;
+    });
+
+    const auto flushLiterals([&]
+    {
+        while (i_literal < i)
+        {
+            const n_t length(std::min(i - i_literal, maxLength));
+            writeCommand(out, copyLiteral, length);
+            out.insert(std::end(out), std::begin(data) + i_literal, std::begin(data) + i_literal + length);
+            i_literal += length;
+        }
+    });
+
+    while (i < n)
+    {
+        const n_t n_remaining(std::min(n - i, maxLength));
+        const auto runLength([&](auto expected)
+        {
+            n_t length{};
+            while (length < n_remaining && data[i + length] == expected(length))
+                ++length;
+
+            return length;
+        });
+
+        const n_t byteFillLength(runLength([&](index_t){ return data[i]; }));
+        const n_t pairFillLength(n_remaining >= 2 ? runLength([&](index_t j){ return data[i + (j & 1)]; }) : 0);
+        const n_t incrementingLength(runLength([&](index_t j){ return std::uint8_t(data[i] + j); }));
+
+        // Longest earlier match, copies may overlap the bytes they produce
+        n_t copyLength{};
+        index_t i_copySource{};
+        if (i + 3 <= n)
+        {
+            index_t i_entry(head[hash3(data, i)]);
+            for (index_t i_chain{}; i_entry && i_chain < maxChain; ++i_chain, i_entry = prev[i_entry - 1])
+            {
+                const index_t i_candidate(i_entry - 1);
+                n_t length{};
+                while (length < n_remaining && data[i_candidate + length] == data[i + length])
+                    ++length;
+
+                // Prefer the nearer source on ties, it may fit a relative copy
+                if (length > copyLength)
+                {
+                    copyLength = length;
+                    i_copySource = i_candidate;
+                }
+            }
+        }
+
+        const bool isRelative(i - i_copySource <= maxRelativeDistance);
+
+        // Bytes saved over emitting the same bytes as literals
+        struct Candidate
+        {
+            unsigned command;
+            n_t length, argumentSize;
+        };
+
+        const Candidate candidates[]
+        {
+            {fillByte, byteFillLength, 1},
+            {fillPair, pairFillLength, 2},
+            {fillIncrementing, incrementingLength, 1},
+            {isRelative ? copyRelative : copyAbsolute, copyLength, isRelative ? 1u : 2u}
+        };
+
+        const Candidate* p_best{};
+        std::ptrdiff_t bestSaving{};
+        for (const Candidate& candidate : candidates)
+        {
+            const std::ptrdiff_t saving(std::ptrdiff_t(candidate.length) - std::ptrdiff_t(headerSize(candidate.length) + candidate.argumentSize));
+            if (saving > bestSaving)
+            {
+                bestSaving = saving;
+                p_best = &candidate;
+            }
+        }
+
+        // A command has to save more than the literal run it breaks up would cost to restart
+        if (!p_best || bestSaving < 2)
+        {
+            insertHash(i);
+            ++i;
+            continue;
+        }
+
+        flushLiterals();
+        writeCommand(out, p_best->command, p_best->length);
+        switch (p_best->command)
+        {
+        case fillByte:
+        case fillIncrementing:
+            out.push_back(data[i]);
+            break;
+
+        case fillPair:
+            out.push_back(data[i]);
+            out.push_back(data[i + 1]);
+            break;
+
+        case copyAbsolute:
+            out.push_back(std::uint8_t(i_copySource));
+            out.push_back(std::uint8_t(i_copySource >> 8));
+            break;
+
+        case copyRelative:
+            out.push_back(std::uint8_t(i - i_copySource));
+            break;
+        }
+
+        for (index_t i_end(i + p_best->length); i < i_end; ++i)
+            insertHash(i);
+
+        i_literal = i;
+    }
+
+    flushLiterals();
+    out.push_back(0xFF);
+    return out;
+}
+LOG_RETHROW
@@ -0,0 +1,9 @@
+module;
+
+#include "../global.h"
+
+export module compress;
+
+// Compresses to the format `decompress` reads. Greedy: at each position it takes whichever of a byte fill, byte pair fill, incrementing fill
+// or dictionary copy saves the most, falling back to literal bytes. Input is limited to a bank's worth of data, as with `decompress`
+export std::vector<std::uint8_t> compress(std::span<const std::uint8_t> data);
@@ -0,0 +1,165 @@
+#include "../global.h"
+
+import decompress;
+
+StreamingDecompressor::StreamingDecompressor(std::span<const std::uint8_t> compressed)
+try
+    : compressed(compressed)
+{
+    out.reserve(maxSize);
+}
+LOG_RETHROW
+
+void StreamingDecompressor::copy(index_t i_source, n_t length, std::uint8_t mask)
+{
+    // Can overlap the output being written, which repeats the copied bytes
+    for (index_t i_length{}; i_length < length; ++i_length)
+    {
+        const std::uint8_t v(out[i_source++]);
+        out.push_back(v ^ mask);
+    }
+}
+
+Result<std::span<const std::uint8_t>> StreamingDecompressor::decompressTo(n_t size)
+try
+{
+    // Command byte is cccnnnnn, or 111cccnn nnnnnnnn for the extended form, where n + 1 is the length and FFh terminates.
+    // Commands:
+    //     0: copy n + 1 bytes from input
+    //     1: repeat a byte
+    //     2: repeat a pair of bytes
+    //     3: write a byte, incrementing it after each write
+    //     4: copy from an absolute offset into the output
+    //     5: as 4, with the copied bytes inverted
+    //     6: copy from a relative (backwards) offset into the output
+    //     7: as 6, with the copied bytes inverted
+
+    // Bytes of input each command reads after its command bytes, command 0 reads its length instead
+    static constexpr n_t argumentSizes[]{0, 1, 2, 1, 2, 2, 1, 1};
+
+    // Input is checked once per command, up front, so that the command bodies don't need to
+    while (!isDone_ && std::size(out) < size)
+    {
+        if (i >= std::size(compressed))
+            return makeError(ErrorCode::compressedOverrun, 0, std::uint32_t(i));
+
+        const std::uint8_t commandByte(compressed[i++]);
+        if (commandByte == 0xFF)
+        {
+            isDone_ = true;
+            break;
+        }
+
+        unsigned command(commandByte >> 5);
+        n_t length;
+        if (command == 7)
+        {
+            if (i >= std::size(compressed))
+                return makeError(ErrorCode::compressedOverrun, 0, std::uint32_t(i));
+
+            command = commandByte >> 2 & 7;
+            length = ((commandByte & 3) << 8 | compressed[i++]) + 1;
+        }
+        else
+            length = (commandByte & 0x1F) + 1;
+
+        if (std::size(out) + length > maxSize)
+            return makeError(ErrorCode::decompressedTooLarge, 0, std::uint32_t(maxSize));
+
+        if (i + (command == 0 ? length : argumentSizes[command]) > std::size(compressed))
+            return makeError(ErrorCode::compressedOverrun, 0, std::uint32_t(std::size(compressed)));
+
+        switch (command)
+        {
+        case 0:
+            out.insert(std::end(out), std::begin(compressed) + i, std::begin(compressed) + i + length);
+            i += length;
+            break;
+
+        case 1:
+            out.insert(std::end(out), length, compressed[i++]);
+            break;
+
+        case 2:
+        {
+            const std::uint8_t v0(compressed[i]), v1(compressed[i + 1]);
+            i += 2;
+            for (index_t i_length{}; i_length < length; ++i_length)
+                out.push_back(i_length & 1 ? v1 : v0);
+
+            break;
+        }
+
+        case 3:
+        {
+            std::uint8_t v(compressed[i++]);
+            for (index_t i_length{}; i_length < length; ++i_length)
+                out.push_back(v++);
+
+            break;
+        }
+
+        case 4:
+        case 5:
+        {
+            const index_t i_source(compressed[i] | compressed[i + 1] << 8);
+            i += 2;
+            if (i_source >= std::size(out))
+                return makeError(ErrorCode::dictionaryOverrun, 0, std::uint32_t(i_source));
+
+            copy(i_source, length, command == 5 ? 0xFF : 0);
+            break;
+        }
+
+        case 6:
+        case 7:
+        {
+            const std::uint8_t distance(compressed[i++]);
+            if (distance == 0 || distance > std::size(out))
+                return makeError(ErrorCode::relativeCopyOverrun, 0, distance);
+
+            copy(std::size(out) - distance, length, command == 7 ? 0xFF : 0);
+            break;
+        }
+        }
+    }
+
+    return output();
+}
+LOG_RETHROW
+
+std::span<const std::uint8_t> StreamingDecompressor::output() const noexcept
+{
+    return out;
+}
+
+bool StreamingDecompressor::isDone() const noexcept
+{
+    return isDone_;
+}
+
+Decompressed StreamingDecompressor::release() &&
+try
+{
+    return {std::move(out), i};
+}
+LOG_RETHROW
+
+Result<Decompressed> tryDecompress(std::span<const std::uint8_t> compressed)
+try
+{
+    // The size limit is checked per command, so this only stops at the terminator or an error
+    StreamingDecompressor decompressor(compressed);
+    if (const Result<std::span<const std::uint8_t>> output(decompressor.decompressTo(std::numeric_limits<n_t>::max())); !output)
+        return std::unexpected(output.error());
+
+    return std::move(decompressor).release();
+}
+LOG_RETHROW
+
+Decompressed decompress(std::span<const std::uint8_t> compressed)
+try
+{
+    return valueOrThrow(tryDecompress(compressed));
+}
+LOG_RETHROW
@@ -0,0 +1,49 @@
+module;
+
+#include "../global.h"
+
+export module decompress;
+
+export import error;
+
+export struct Decompressed
+{
+    std::vector<std::uint8_t> data;
+    n_t compressedSize;
+};
+
+// Bumped whenever `decompress` would give different output for the same input, so that cached decompressions from older versions aren't used
+export const std::uint32_t decompressVersion{1};
+
+// Super Metroid's LZ variant. Output is bounded to a bank's worth of data, the size of the game's decompression buffers
+export Decompressed decompress(std::span<const std::uint8_t> compressed);
+
+// As above, returning errors rather than throwing them, for scans that decompress from pointers that are often bad
+export Result<Decompressed> tryDecompress(std::span<const std::uint8_t> compressed);
+
+// Decompresses a piece at a time, so the start of the data can be used before the rest is decompressed.
+// The output buffer is reserved up front and never reallocated, so spans of the output stay valid while decompression continues
+export class StreamingDecompressor
+{
+    std::span<const std::uint8_t> compressed;
+    std::vector<std::uint8_t> out;
+    index_t i{};
+    bool isDone_{};
+
+    void copy(index_t i_source, n_t length, std::uint8_t mask);
+
+public:
+    static constexpr n_t maxSize{0x10000};
+
+    explicit StreamingDecompressor(std::span<const std::uint8_t> compressed);
+
+    // Decompresses whole commands until there's at least `size` bytes of output or the data ends, so the output can run past `size` by up to a command's length.
+    // Decompression can't continue after an error
+    Result<std::span<const std::uint8_t>> decompressTo(n_t size);
+
+    std::span<const std::uint8_t> output() const noexcept;
+    bool isDone() const noexcept;
+
+    // Moves the output out, the compressed size is of what's been read so far
+    Decompressed release() &&;
+};
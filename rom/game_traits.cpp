@@ -0,0 +1,112 @@
+#include "../global.h"
+
+import game_traits;
+
+template<GameTraits Traits>
+class GameImpl final : public Game
+{
+public:
+    GameId id() const noexcept override
+    {
+        return Traits::id;
+    }
+
+    std::string_view name() const noexcept override
+    {
+        return Traits::name;
+    }
+
+    Platform platform() const noexcept override
+    {
+        return Traits::platform;
+    }
+
+    std::span<const std::string_view> areaNames() const noexcept override
+    {
+        return Traits::areaNames;
+    }
+
+    void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize) const override
+    try
+    {
+        Traits::Mapping::toPc(addresses, out, invalid, romSize);
+    }
+    LOG_RETHROW
+
+    Result<index_t> tryToPc(std::uint32_t address, n_t romSize) const noexcept override
+    {
+        return ::tryToPc<typename Traits::Mapping>(address, romSize);
+    }
+
+    std::vector<std::uint8_t> decodeTiles(std::span<const std::uint8_t> in) const override
+    try
+    {
+        return ::decodeTiles<typename Traits::Tiles>(in);
+    }
+    LOG_RETHROW
+
+    void decodeTiles(std::span<const std::uint8_t> in, std::span<std::uint8_t> out) const override
+    try
+    {
+        ::decodeTiles<typename Traits::Tiles>(in, out);
+    }
+    LOG_RETHROW
+
+    void decodeBlocks(std::span<const std::uint16_t> blocks, std::span<DecodedBlock> out) const override
+    try
+    {
+        if (std::size(out) < std::size(blocks))
+            throw std::runtime_error(LOG_INFO "Output is smaller than input"s);
+
+        for (index_t i{}; i < std::size(blocks); ++i)
+            out[i] = Traits::Blocks::decode(blocks[i]);
+    }
+    LOG_RETHROW
+};
+
+std::optional<GameId> identifyGame(std::span<const std::uint8_t> rom) noexcept
+{
+    const auto readString([&](index_t i, n_t n) -> std::string_view
+    {
+        if (i + n > std::size(rom))
+            return {};
+
+        return {reinterpret_cast<const char*>(&rom[i]), n};
+    });
+
+    // SNES LoROM internal header title at $00:FFC0
+    if (readString(0x7FC0, 21).starts_with("Super Metroid"sv))
+        return GameId::superMetroid;
+
+    // GBA header fixed value at B2h, game code at ACh. The fourth character of the game code is the region
+    if (std::size(rom) > 0xB2 && rom[0xB2] == 0x96)
+    {
+        const std::string_view gameCode(readString(0xAC, 3));
+        if (gameCode == "AMT"sv)
+            return GameId::metroidFusion;
+
+        if (gameCode == "BMX"sv)
+            return GameId::zeroMission;
+    }
+
+    return {};
+}
+
+std::unique_ptr<Game> makeGame(GameId id)
+try
+{
+    switch (id)
+    {
+    case GameId::superMetroid:
+        return std::make_unique<GameImpl<SuperMetroidTraits>>();
+
+    case GameId::metroidFusion:
+        return std::make_unique<GameImpl<MetroidFusionTraits>>();
+
+    case GameId::zeroMission:
+        return std::make_unique<GameImpl<ZeroMissionTraits>>();
+    }
+
+    throw std::runtime_error(LOG_INFO "Unknown game ID "s + std::to_string(toInt(id)));
+}
+LOG_RETHROW
@@ -0,0 +1,129 @@
+module;
+
+#include "../global.h"
+
+export module game_traits;
+
+export import address_mapping;
+export import tile_format;
+
+export enum class Platform
+{
+    snes,
+    gba
+};
+
+export enum class GameId
+{
+    superMetroid,
+    metroidFusion,
+    zeroMission
+};
+
+export struct DecodedBlock
+{
+    std::uint16_t i_metatile;
+    std::uint8_t type;
+    bool xFlip, yFlip;
+};
+
+// Block format policies. `decode` splits a level data block into its fields
+
+// ttttyxmm mmmmmmmm (block type, flip, metatile number)
+export struct SuperMetroidBlockFormat
+{
+    static constexpr DecodedBlock decode(std::uint16_t block) noexcept
+    {
+        return {std::uint16_t(block & 0x3FF), std::uint8_t(block >> 12), bool(block >> 10 & 1), bool(block >> 11 & 1)};
+    }
+};
+
+// Fusion and Zero Mission BG blocks are plain metatile numbers, collision is in a separate clipdata layer
+export struct GbaBlockFormat
+{
+    static constexpr DecodedBlock decode(std::uint16_t block) noexcept
+    {
+        return {block, 0, false, false};
+    }
+};
+
+// Per game traits. Everything that differs between games inside per block or per tile loops is a constexpr value or a policy type here,
+// so those loops are compiled once per game with nothing left to dispatch on
+export struct SuperMetroidTraits
+{
+    static constexpr GameId id{GameId::superMetroid};
+    static constexpr std::string_view name{"Super Metroid"};
+    static constexpr Platform platform{Platform::snes};
+
+    using Mapping = LoRomMapping;
+    using Tiles = SnesTile4bpp;
+    using Blocks = SuperMetroidBlockFormat;
+
+    static constexpr std::array<std::string_view, 8> areaNames{"Crateria", "Brinstar", "Norfair", "Wrecked Ship", "Maridia", "Tourian", "Ceres", "Debug"};
+};
+
+export struct MetroidFusionTraits
+{
+    static constexpr GameId id{GameId::metroidFusion};
+    static constexpr std::string_view name{"Metroid Fusion"};
+    static constexpr Platform platform{Platform::gba};
+
+    using Mapping = GbaMapping;
+    using Tiles = GbaTile4bpp;
+    using Blocks = GbaBlockFormat;
+
+    static constexpr std::array<std::string_view, 7> areaNames{"Main Deck", "Sector 1 (SRX)", "Sector 2 (TRO)", "Sector 3 (PYR)", "Sector 4 (AQA)", "Sector 5 (ARC)", "Sector 6 (NOC)"};
+};
+
+export struct ZeroMissionTraits
+{
+    static constexpr GameId id{GameId::zeroMission};
+    static constexpr std::string_view name{"Metroid Zero Mission"};
+    static constexpr Platform platform{Platform::gba};
+
+    using Mapping = GbaMapping;
+    using Tiles = GbaTile4bpp;
+    using Blocks = GbaBlockFormat;
+
+    static constexpr std::array<std::string_view, 7> areaNames{"Brinstar", "Kraid", "Norfair", "Ridley", "Tourian", "Crateria", "Chozodia"};
+};
+
+export template<typename Traits>
+concept GameTraits = AddressMapping<typename Traits::Mapping> && TileFormat<typename Traits::Tiles> && requires(std::uint16_t block)
+{
+    { Traits::id } -> std::convertible_to<GameId>;
+    { Traits::name } -> std::convertible_to<std::string_view>;
+    { Traits::platform } -> std::convertible_to<Platform>;
+    { Traits::Blocks::decode(block) } -> std::same_as<DecodedBlock>;
+    std::span<const std::string_view>(Traits::areaNames);
+};
+
+static_assert(GameTraits<SuperMetroidTraits> && GameTraits<MetroidFusionTraits> && GameTraits<ZeroMissionTraits>);
+
+// The game independent interface to a game's traits, chosen once when a ROM is opened.
+// Hot paths take whole spans, so there's one virtual call per batch and the per element work is compiled for the game
+export class Game
+{
+public:
+    virtual ~Game() = default;
+
+    virtual GameId id() const noexcept = 0;
+    virtual std::string_view name() const noexcept = 0;
+    virtual Platform platform() const noexcept = 0;
+    virtual std::span<const std::string_view> areaNames() const noexcept = 0;
+
+    // See address_mapping for the invalid address mask
+    virtual void toPc(std::span<const std::uint32_t> addresses, std::span<index_t> out, std::span<std::uint64_t> invalid, n_t romSize) const = 0;
+
+    // A single address, for following one pointer without knowing the game's mapping
+    virtual Result<index_t> tryToPc(std::uint32_t address, n_t romSize) const noexcept = 0;
+
+    virtual std::vector<std::uint8_t> decodeTiles(std::span<const std::uint8_t> in) const = 0;
+    virtual void decodeTiles(std::span<const std::uint8_t> in, std::span<std::uint8_t> out) const = 0;
+    virtual void decodeBlocks(std::span<const std::uint16_t> blocks, std::span<DecodedBlock> out) const = 0;
+};
+
+// Identifies the game from the SNES internal header title or the GBA header game code. `rom` has any copier header already stripped
+export std::optional<GameId> identifyGame(std::span<const std::uint8_t> rom) noexcept;
+
+export std::unique_ptr<Game> makeGame(GameId id);
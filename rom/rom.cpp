@@ -0,0 +1,257 @@
+#include "../global.h"
+
+import rom;
+
+import address_mapping;
+
+static std::vector<std::uint64_t> hashChunks(std::span<const std::uint8_t> data)
+try
+{
+    std::vector<std::uint64_t> ret((std::size(data) + Rom::chunkSize - 1) / Rom::chunkSize);
+    std::vector<index_t> indices(std::size(ret));
+    std::iota(std::begin(indices), std::end(indices), index_t{});
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i_chunk)
+    {
+        ret[i_chunk] = hashBytes(data.subspan(i_chunk * Rom::chunkSize).first(std::min(Rom::chunkSize, std::size(data) - i_chunk * Rom::chunkSize)));
+    });
+
+    return ret;
+}
+LOG_RETHROW
+
+static std::vector<std::uint8_t> readFile(const std::filesystem::path& filepath)
+try
+{
+    std::ifstream in(filepath, std::ios::binary);
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+
+    std::vector<std::uint8_t> ret(std::filesystem::file_size(filepath));
+    in.read(reinterpret_cast<char*>(std::data(ret)), std::ssize(ret));
+    return ret;
+}
+LOG_RETHROW
+
+std::uint64_t hashBytes(std::span<const std::uint8_t> bytes) noexcept
+{
+    // Multiply-rotate over eight bytes at a time
+    const std::uint64_t prime(0x9E3779B97F4A7C15);
+    std::uint64_t ret(std::size(bytes));
+    index_t i{};
+    for (; i + 8 <= std::size(bytes); i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, &bytes[i], 8);
+        ret = std::rotl((ret ^ word) * prime, 31);
+    }
+
+    for (; i < std::size(bytes); ++i)
+        ret = std::rotl((ret ^ bytes[i]) * prime, 31);
+
+    return ret ^ ret >> 32;
+}
+
+bool RomRange::overlaps(const RomRange& other) const noexcept
+{
+    return begin < other.end && other.begin < end;
+}
+
+Rom::Rom(const std::filesystem::path& filepath_in)
+try
+    : filepath(filepath_in)
+{
+    std::ifstream in(filepath, std::ios::binary);
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+
+    const n_t size(std::filesystem::file_size(filepath));
+    copierHeader.resize(copierHeaderSize(size));
+    in.read(reinterpret_cast<char*>(std::data(copierHeader)), std::ssize(copierHeader));
+
+    data.resize(size - std::size(copierHeader));
+    in.read(reinterpret_cast<char*>(std::data(data)), std::ssize(data));
+    hashChunks();
+}
+LOG_RETHROW
+
+void Rom::hashChunks()
+try
+{
+    chunkHashes = ::hashChunks(data);
+}
+LOG_RETHROW
+
+const std::filesystem::path& Rom::path() const noexcept
+{
+    return filepath;
+}
+
+std::span<const std::uint8_t> Rom::bytes() const noexcept
+{
+    return data;
+}
+
+index_t Rom::snesToPc(std::uint32_t address)
+try
+{
+    return valueOrThrow(trySnesToPc(address));
+}
+LOG_RETHROW
+
+std::uint32_t Rom::pcToSnes(index_t address)
+try
+{
+    return valueOrThrow(tryFromPc<LoRomMapping>(address));
+}
+LOG_RETHROW
+
+std::uint8_t Rom::read8(std::uint32_t address) const
+try
+{
+    return valueOrThrow(tryRead8(address));
+}
+LOG_RETHROW
+
+std::uint16_t Rom::read16(std::uint32_t address) const
+try
+{
+    return valueOrThrow(tryRead16(address));
+}
+LOG_RETHROW
+
+std::uint32_t Rom::read24(std::uint32_t address) const
+try
+{
+    return valueOrThrow(tryRead24(address));
+}
+LOG_RETHROW
+
+std::span<const std::uint8_t> Rom::spanFrom(std::uint32_t address) const
+try
+{
+    return valueOrThrow(trySpanFrom(address));
+}
+LOG_RETHROW
+
+Result<index_t> Rom::trySnesToPc(std::uint32_t address) noexcept
+{
+    // Whether it's in this ROM is left to the reads, which know its size
+    return tryToPc<LoRomMapping>(address, LoRomMapping::romSizeLimit);
+}
+
+Result<std::span<const std::uint8_t>> Rom::trySpanFrom(std::uint32_t address) const noexcept
+{
+    const Result<index_t> i(trySnesToPc(address));
+    if (!i)
+        return std::unexpected(i.error());
+
+    if (*i >= std::size(data))
+        return makeError(ErrorCode::beyondRom, address);
+
+    return std::span(data).subspan(*i);
+}
+
+Result<std::uint8_t> Rom::tryRead8(std::uint32_t address) const noexcept
+{
+    const Result<std::span<const std::uint8_t>> bytes(trySpanFrom(address));
+    if (!bytes)
+        return std::unexpected(bytes.error());
+
+    return (*bytes)[0];
+}
+
+Result<std::uint16_t> Rom::tryRead16(std::uint32_t address) const noexcept
+{
+    const Result<std::span<const std::uint8_t>> bytes(trySpanFrom(address));
+    if (!bytes)
+        return std::unexpected(bytes.error());
+
+    if (std::size(*bytes) < 2)
+        return makeError(ErrorCode::readOverrun, address, 2);
+
+    return std::uint16_t((*bytes)[0] | (*bytes)[1] << 8);
+}
+
+Result<std::uint32_t> Rom::tryRead24(std::uint32_t address) const noexcept
+{
+    const Result<std::span<const std::uint8_t>> bytes(trySpanFrom(address));
+    if (!bytes)
+        return std::unexpected(bytes.error());
+
+    if (std::size(*bytes) < 3)
+        return makeError(ErrorCode::readOverrun, address, 3);
+
+    return std::uint32_t((*bytes)[0] | (*bytes)[1] << 8 | (*bytes)[2] << 16);
+}
+
+void Rom::write(std::uint32_t address, std::span<const std::uint8_t> bytes)
+try
+{
+    const index_t i(snesToPc(address));
+    if (i + std::size(bytes) > std::size(data))
+        throw std::runtime_error(LOG_INFO "Write of "s + std::to_string(std::size(bytes)) + " bytes to $"s + toHexString(address, 3) + " overruns end of ROM"s);
+
+    std::ranges::copy(bytes, std::begin(data) + i);
+}
+LOG_RETHROW
+
+void Rom::save(const std::filesystem::path& filepath_out)
+try
+{
+    {
+        std::ofstream out(filepath_out, std::ios::binary);
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.write(reinterpret_cast<const char*>(std::data(copierHeader)), std::ssize(copierHeader));
+        out.write(reinterpret_cast<const char*>(std::data(data)), std::ssize(data));
+    }
+
+    // Saving over the ROM's own file makes the current data the baseline for the next reload
+    std::error_code error;
+    if (std::filesystem::equivalent(filepath_out, filepath, error))
+        hashChunks();
+}
+LOG_RETHROW
+
+std::vector<RomRange> Rom::reload()
+try
+{
+    std::vector<std::uint8_t> file(readFile(filepath));
+    const n_t n_header(copierHeaderSize(std::size(file)));
+    const std::span<const std::uint8_t> newData(std::data(file) + n_header, std::size(file) - n_header);
+    if (n_header != std::size(copierHeader) || std::size(newData) != std::size(data) || !std::ranges::equal(copierHeader, std::span(file).first(n_header)))
+    {
+        copierHeader.assign(std::begin(file), std::begin(file) + n_header);
+        file.erase(std::begin(file), std::begin(file) + n_header);
+        const n_t oldSize(std::size(data));
+        data = std::move(file);
+        hashChunks();
+        return {{0, std::max(oldSize, std::size(data))}};
+    }
+
+    std::vector<std::uint64_t> newHashes(::hashChunks(newData));
+    std::vector<RomRange> ret;
+    for (index_t i_chunk{}; i_chunk < std::size(newHashes); ++i_chunk)
+    {
+        if (newHashes[i_chunk] == chunkHashes[i_chunk])
+            continue;
+
+        // Narrowed to the bytes that differ from the loaded data, so that assets sharing the chunk with a patch survive it
+        const index_t i_chunkBegin(i_chunk * chunkSize), i_chunkEnd(std::min(i_chunkBegin + chunkSize, std::size(data)));
+        const std::span<const std::uint8_t> newChunk(newData.subspan(i_chunkBegin, i_chunkEnd - i_chunkBegin));
+        const std::span<std::uint8_t> chunk(std::data(data) + i_chunkBegin, i_chunkEnd - i_chunkBegin);
+        const index_t i_first(std::ranges::mismatch(chunk, newChunk).in1 - std::begin(chunk));
+        if (i_first == std::size(chunk))
+            continue;
+
+        const index_t i_last(std::size(chunk) - (std::ranges::mismatch(chunk | std::views::reverse, newChunk | std::views::reverse).in1 - std::rbegin(chunk)));
+        std::ranges::copy(newChunk.subspan(i_first, i_last - i_first), std::begin(chunk) + i_first);
+
+        const RomRange range{i_chunkBegin + i_first, i_chunkBegin + i_last};
+        if (!std::empty(ret) && ret.back().end == range.begin)
+            ret.back().end = range.end;
+        else
+            ret.push_back(range);
+    }
+
+    chunkHashes = std::move(newHashes);
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,76 @@
+#include "../global.h"
+
+import rom_assets;
+
+static bool overlapsAny(std::span<const RomRange> sources, std::span<const RomRange> changes) noexcept
+{
+    // Both sorted, so walk them together
+    for (index_t i_source{}, i_change{}; i_source < std::size(sources) && i_change < std::size(changes);)
+    {
+        if (sources[i_source].overlaps(changes[i_change]))
+            return true;
+
+        if (sources[i_source].end <= changes[i_change].end)
+            ++i_source;
+        else
+            ++i_change;
+    }
+
+    return false;
+}
+
+index_t RomAssets::add(std::vector<RomRange> sources, std::move_only_function<void()> onInvalidate)
+try
+{
+    std::erase_if(sources, [](const RomRange& range) { return range.begin >= range.end; });
+    std::ranges::sort(sources, {}, &RomRange::begin);
+
+    std::vector<RomRange> merged;
+    for (const RomRange& range : sources)
+        if (!std::empty(merged) && range.begin <= merged.back().end)
+            merged.back().end = std::max(merged.back().end, range.end);
+        else
+            merged.push_back(range);
+
+    const index_t id(nextId++);
+    assets.emplace(id, Asset{std::move(merged), std::move(onInvalidate)});
+    return id;
+}
+LOG_RETHROW
+
+void RomAssets::remove(index_t id) noexcept
+{
+    assets.erase(id);
+}
+
+n_t RomAssets::invalidate(std::span<const RomRange> changes)
+try
+{
+    // Invalidated assets are taken out before any callback runs, as callbacks are free to add their replacements or remove other assets
+    std::vector<std::move_only_function<void()>> callbacks;
+    for (auto it(std::begin(assets)); it != std::end(assets);)
+        if (overlapsAny(it->second.sources, changes))
+        {
+            callbacks.push_back(std::move(it->second.onInvalidate));
+            it = assets.erase(it);
+        }
+        else
+            ++it;
+
+    for (std::move_only_function<void()>& callback : callbacks)
+        if (callback)
+            callback();
+
+    return std::size(callbacks);
+}
+LOG_RETHROW
+
+void RomAssets::clear() noexcept
+{
+    assets.clear();
+}
+
+n_t RomAssets::size() const noexcept
+{
+    return std::size(assets);
+}
@@ -0,0 +1,35 @@
+module;
+
+#include "../global.h"
+
+export module rom_assets;
+
+export import rom;
+
+// Everything built from ROM bytes that's kept around (decompressed data, rendered tiles, cross-references), each with the ROM ranges it was read from,
+// so that reloading a rewritten ROM only throws away what was built from bytes that changed
+export class RomAssets
+{
+    struct Asset
+    {
+        // Sorted and merged
+        std::vector<RomRange> sources;
+        std::move_only_function<void()> onInvalidate;
+    };
+
+    std::map<index_t, Asset> assets;
+    index_t nextId{};
+
+public:
+    // `onInvalidate` is called once, when a change overlaps one of `sources`, after which the asset is forgotten. Returns an ID for `remove`
+    index_t add(std::vector<RomRange> sources, std::move_only_function<void()> onInvalidate);
+
+    // For assets dropped before being invalidated. Unknown IDs are ignored
+    void remove(index_t id) noexcept;
+
+    // `changes` are as returned by `Rom::reload`, sorted and merged. Returns the number of assets invalidated
+    n_t invalidate(std::span<const RomRange> changes);
+
+    void clear() noexcept;
+    n_t size() const noexcept;
+};
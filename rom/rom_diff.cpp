@@ -0,0 +1,188 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import rom_diff;
+
+// Rolling hash of moveBlockSize bytes, sum of byte * base^(moveBlockSize - 1 - i), wrapping
+static const std::uint32_t rollingHashBase(0x01000193);
+
+static const std::uint32_t rollingHashOutFactor([]()
+{
+    std::uint32_t ret(1);
+    for (index_t i(1); i < moveBlockSize; ++i)
+        ret *= rollingHashBase;
+
+    return ret;
+}());
+
+// Hashes are first looked up in a bitmap of their low bits, which rules out most positions without searching the index
+static const n_t hashFilterBits(20);
+
+static std::uint32_t rollingHash(const std::uint8_t* p) noexcept
+{
+    std::uint32_t ret{};
+    for (index_t i{}; i < moveBlockSize; ++i)
+        ret = ret * rollingHashBase + p[i];
+
+    return ret;
+}
+
+static bool isUniform(const std::uint8_t* p) noexcept
+{
+    return std::all_of(p + 1, p + moveBlockSize, [&](std::uint8_t v) { return v == *p; });
+}
+
+static std::vector<RomRange> findChanges(std::span<const std::uint8_t> oldBytes, std::span<const std::uint8_t> newBytes)
+try
+{
+    const n_t size(std::min(std::size(oldBytes), std::size(newBytes)));
+    std::vector<RomRange> ret;
+    std::optional<index_t> i_runBegin;
+    const auto step([&](index_t i, bool isDifferent)
+    {
+        if (isDifferent && !i_runBegin)
+            i_runBegin = i;
+        else if (!isDifferent && i_runBegin)
+        {
+            ret.push_back({*i_runBegin, i});
+            i_runBegin.reset();
+        }
+    });
+
+    index_t i{};
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i
+            oldBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&oldBytes[i]))),
+            newBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&newBytes[i])));
+
+        // Bit n is set if byte n differs. Blocks entirely the same or entirely different as the current run are skipped whole
+        const std::uint32_t differences(~std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(oldBlock, newBlock))));
+        if (differences == (i_runBegin ? ~std::uint32_t{} : 0))
+            continue;
+
+        for (index_t j{}; j < 32; ++j)
+            step(i + j, differences >> j & 1);
+    }
+
+    for (; i < size; ++i)
+        step(i, oldBytes[i] != newBytes[i]);
+
+    step(size, false);
+    if (std::size(oldBytes) != std::size(newBytes))
+        ret.push_back({size, std::max(std::size(oldBytes), std::size(newBytes))});
+
+    return ret;
+}
+LOG_RETHROW
+
+static std::vector<BlockMove> findMoves(std::span<const std::uint8_t> oldBytes, std::span<const std::uint8_t> newBytes, std::span<const RomRange> changes)
+try
+{
+    if (std::empty(changes))
+        return {};
+
+    // Bytes of a copy can happen to equal the bytes they replaced, splitting the change into runs. Runs closer than a block are searched as one
+    std::vector<RomRange> regions;
+    for (const RomRange& change : changes)
+        if (!std::empty(regions) && change.begin - regions.back().end < moveBlockSize)
+            regions.back().end = change.end;
+        else
+            regions.push_back(change);
+
+    // Index of the old image's aligned blocks. Any copy of at least two blocks contains one of them
+    struct IndexEntry
+    {
+        std::uint32_t hash;
+        index_t i;
+
+        auto operator<=>(const IndexEntry&) const = default;
+    };
+
+    std::vector<IndexEntry> index;
+    std::vector<bool> filter(n_t(1) << hashFilterBits);
+    for (index_t i{}; i + moveBlockSize <= std::size(oldBytes); i += moveBlockSize)
+        if (!isUniform(&oldBytes[i]))
+        {
+            const std::uint32_t hash(rollingHash(&oldBytes[i]));
+            index.push_back({hash, i});
+            filter[hash & ((1 << hashFilterBits) - 1)] = true;
+        }
+
+    std::ranges::sort(index);
+
+    std::vector<BlockMove> ret;
+    for (const RomRange& region : regions)
+    {
+        const index_t end(std::min(region.end, std::size(newBytes)));
+        index_t i(region.begin);
+        if (i + moveBlockSize > end)
+            continue;
+
+        std::uint32_t hash(rollingHash(&newBytes[i]));
+        for (;;)
+        {
+            if (filter[hash & ((1 << hashFilterBits) - 1)] && !isUniform(&newBytes[i]))
+            {
+                const auto [it_begin, it_end](std::ranges::equal_range(index, hash, {}, &IndexEntry::hash));
+                for (auto it(it_begin); it != it_end; ++it)
+                {
+                    if (!std::equal(&newBytes[i], &newBytes[i] + moveBlockSize, &oldBytes[it->i]))
+                        continue;
+
+                    // Extend back to the start of the region and forward to its end, as far as the bytes keep matching
+                    index_t from(it->i), to(i);
+                    while (to > region.begin && from > 0 && newBytes[to - 1] == oldBytes[from - 1] && (std::empty(ret) || to > ret.back().to + ret.back().size))
+                        --from, --to;
+
+                    n_t size(i + moveBlockSize - to);
+                    while (to + size < end && from + size < std::size(oldBytes) && newBytes[to + size] == oldBytes[from + size])
+                        ++size;
+
+                    ret.push_back({from, to, size});
+                    break;
+                }
+
+                if (!std::empty(ret) && ret.back().to + ret.back().size > i)
+                {
+                    i = ret.back().to + ret.back().size;
+                    if (i + moveBlockSize > end)
+                        break;
+
+                    hash = rollingHash(&newBytes[i]);
+                    continue;
+                }
+            }
+
+            if (i + moveBlockSize >= end)
+                break;
+
+            hash = (hash - newBytes[i] * rollingHashOutFactor) * rollingHashBase + newBytes[i + moveBlockSize];
+            ++i;
+        }
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+ByteDiff diffBytes(std::span<const std::uint8_t> oldBytes, std::span<const std::uint8_t> newBytes)
+try
+{
+    ByteDiff ret;
+    ret.changes = findChanges(oldBytes, newBytes);
+    ret.moves = findMoves(oldBytes, newBytes, ret.changes);
+    return ret;
+}
+LOG_RETHROW
+
+n_t overlapSize(std::span<const RomRange> changes, const RomRange& range) noexcept
+{
+    n_t ret{};
+    auto it(std::ranges::upper_bound(changes, range.begin, {}, &RomRange::end));
+    for (; it != std::end(changes) && it->begin < range.end; ++it)
+        ret += std::min(it->end, range.end) - std::max(it->begin, range.begin);
+
+    return ret;
+}
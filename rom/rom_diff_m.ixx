@@ -0,0 +1,32 @@
+module;
+
+#include "../global.h"
+
+export module rom_diff;
+
+export import rom;
+
+// `size` bytes at `from` in the old image are at `to` in the new image
+export struct BlockMove
+{
+    index_t from, to;
+    n_t size;
+};
+
+export struct ByteDiff
+{
+    // Runs of bytes that differ at the same offset, sorted. Where the images are different sizes, the bytes past the end of the smaller one are a change
+    std::vector<RomRange> changes;
+
+    // Changed bytes in the new image that are a copy of at least `moveBlockSize` bytes found elsewhere in the old image, sorted by destination
+    std::vector<BlockMove> moves;
+};
+
+export const n_t moveBlockSize{0x40};
+
+// Compares 32 bytes at a time, then looks for the changed bytes of the new image in the old image with a rolling hash.
+// Blocks that are one byte repeated, like free space, aren't reported as moves
+export ByteDiff diffBytes(std::span<const std::uint8_t> oldBytes, std::span<const std::uint8_t> newBytes);
+
+// Number of bytes in `changes` (sorted, non-overlapping) that overlap `range`
+export n_t overlapSize(std::span<const RomRange> changes, const RomRange& range) noexcept;
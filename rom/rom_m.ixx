@@ -0,0 +1,68 @@
+module;
+
+#include "../global.h"
+
+export module rom;
+
+export import error;
+
+// A range of PC addresses [begin, end)
+export struct RomRange
+{
+    index_t begin, end;
+
+    bool overlaps(const RomRange& other) const noexcept;
+    bool operator==(const RomRange&) const = default;
+};
+
+// Fast non-cryptographic hash, for telling whether bytes have changed. Persisted as the asset cache key, changing it needs an asset cache format bump
+export std::uint64_t hashBytes(std::span<const std::uint8_t> bytes) noexcept;
+
+// A ROM image loaded into memory, with any copier header stripped
+export class Rom
+{
+    std::vector<std::uint8_t> data;
+    std::filesystem::path filepath;
+    std::vector<std::uint8_t> copierHeader;
+
+    // Hashes of each chunk of the file as last loaded or saved, for finding what an external rewrite changed without keeping a second copy
+    std::vector<std::uint64_t> chunkHashes;
+
+    void hashChunks();
+
+public:
+    static constexpr n_t chunkSize{0x1000};
+
+    explicit Rom(const std::filesystem::path& filepath);
+
+    const std::filesystem::path& path() const noexcept;
+    std::span<const std::uint8_t> bytes() const noexcept;
+
+    // LoROM address mapping. Banks $80+ mirror banks $00+. Other games' mappings are address_mapping's `tryToPc` and `tryFromPc`, or Game::tryToPc
+    static index_t snesToPc(std::uint32_t address);
+    static std::uint32_t pcToSnes(index_t address);
+
+    std::uint8_t read8(std::uint32_t address) const;
+    std::uint16_t read16(std::uint32_t address) const;
+    std::uint32_t read24(std::uint32_t address) const;
+
+    // The bytes from address to the end of the ROM
+    std::span<const std::uint8_t> spanFrom(std::uint32_t address) const;
+
+    // As above, returning errors rather than throwing them, for scans that follow pointers that are often bad
+    static Result<index_t> trySnesToPc(std::uint32_t address) noexcept;
+    Result<std::uint8_t> tryRead8(std::uint32_t address) const noexcept;
+    Result<std::uint16_t> tryRead16(std::uint32_t address) const noexcept;
+    Result<std::uint32_t> tryRead24(std::uint32_t address) const noexcept;
+    Result<std::span<const std::uint8_t>> trySpanFrom(std::uint32_t address) const noexcept;
+
+    // Writes the bytes from address onwards, continuing into the next bank as `spanFrom` does
+    void write(std::uint32_t address, std::span<const std::uint8_t> bytes);
+
+    // Saves with the copier header the ROM was loaded with, if any
+    void save(const std::filesystem::path& filepath);
+
+    // Rereads the file after it's been rewritten and copies in only the chunks that changed on disk, so edits elsewhere are kept.
+    // Returns the changed PC ranges, sorted and merged. A change of size or copier header replaces the whole ROM
+    std::vector<RomRange> reload();
+};
@@ -0,0 +1,205 @@
+// snes9x snapshot format: https://github.com/snes9xgit/snes9x/blob/master/snapshot.cpp
+// mGBA savestate format: https://github.com/mgba-emu/mgba/blob/master/include/mgba/internal/gba/serialize.h
+
+#include "../global.h"
+
+import savestate;
+
+import deflate;
+
+static const std::string_view snes9xMagic("#!s9xsnp:"sv);
+
+static const n_t
+    snes9xHeaderSize(14), // Magic, four digit version, newline
+    snes9xBlockHeaderSize(11), // Three letter name, colon, six digit length, colon
+    snesWramSize(0x20000),
+    snesVramSize(0x10000);
+
+// Covers everything up to and including WRAM in every snes9x version, the sound and coprocessor blocks after it aren't decompressed
+static const n_t snes9xPrefixSize(0x40000);
+
+// mGBA savestates are a fixed layout, stored raw or in a PNG screenshot's gbAs chunk
+static const std::uint32_t
+    mgbaMagic(0x01000000),
+    mgbaMagicMask(0xFF000000);
+
+static const n_t
+    mgbaStateSize(0x61000),
+    mgbaVramOffset(0x1000), mgbaVramSize(0x18000),
+    mgbaIwramOffset(0x19000), mgbaIwramSize(0x8000),
+    mgbaWramOffset(0x21000), mgbaWramSize(0x40000);
+
+static const std::uint8_t pngSignature[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static std::uint32_t read32Le(std::span<const std::uint8_t> data, index_t i) noexcept
+{
+    return std::uint32_t(data[i] | data[i + 1] << 8 | data[i + 2] << 16 | data[i + 3] << 24);
+}
+
+static std::uint32_t read32Be(std::span<const std::uint8_t> data, index_t i) noexcept
+{
+    return std::uint32_t(data[i] << 24 | data[i + 1] << 16 | data[i + 2] << 8 | data[i + 3]);
+}
+
+static std::string_view readString(std::span<const std::uint8_t> data, index_t i, n_t n) noexcept
+{
+    return {reinterpret_cast<const char*>(&data[i]), n};
+}
+
+static bool isSnes9x(std::span<const std::uint8_t> data) noexcept
+{
+    return std::size(data) >= snes9xHeaderSize && readString(data, 0, std::size(snes9xMagic)) == snes9xMagic;
+}
+
+// The compressed mGBA state in a PNG savestate, empty if there isn't one
+static std::span<const std::uint8_t> findMgbaStateChunk(std::span<const std::uint8_t> png) noexcept
+{
+    for (index_t i(std::size(pngSignature)); i + 12 <= std::size(png);)
+    {
+        const n_t length(read32Be(png, i));
+        if (i + 12 + length > std::size(png))
+            break;
+
+        if (readString(png, i + 4, 4) == "gbAs"sv)
+            return png.subspan(i + 8, length);
+
+        i += 12 + length;
+    }
+
+    return {};
+}
+
+Savestate::Savestate(std::unique_ptr<MappedFile> p_file_in)
+try
+    : p_file(std::move(p_file_in))
+{
+    const std::span<const std::uint8_t> data(p_file->bytes());
+    if (isSnes9x(data))
+    {
+        format_ = SavestateFormat::snes9x;
+        if (!readSnes9x(data))
+            throw std::runtime_error(LOG_INFO "snes9x savestate is missing its VRAM or WRAM"s);
+
+        return;
+    }
+
+    if (isGzip(data))
+    {
+        format_ = SavestateFormat::snes9x;
+        decompressed = gunzip(data, snes9xPrefixSize);
+        if (!isSnes9x(decompressed))
+            throw std::runtime_error(LOG_INFO "Compressed savestate isn't a snes9x savestate"s);
+
+        if (readSnes9x(decompressed))
+            return;
+
+        // Only decompress the rest if some version puts more ahead of WRAM than expected
+        if (std::size(decompressed) == snes9xPrefixSize)
+        {
+            decompressed = gunzip(data);
+            if (readSnes9x(decompressed))
+                return;
+        }
+
+        throw std::runtime_error(LOG_INFO "snes9x savestate is missing its VRAM or WRAM"s);
+    }
+
+    format_ = SavestateFormat::mgba;
+    if (std::size(data) >= std::size(pngSignature) && std::ranges::equal(data.first(std::size(pngSignature)), pngSignature))
+    {
+        const std::span<const std::uint8_t> chunk(findMgbaStateChunk(data));
+        if (std::empty(chunk))
+            throw std::runtime_error(LOG_INFO "PNG has no mGBA savestate chunk"s);
+
+        decompressed = inflate(chunk);
+        readMgba(decompressed);
+        return;
+    }
+
+    readMgba(data);
+}
+LOG_RETHROW
+
+bool Savestate::readSnes9x(std::span<const std::uint8_t> state)
+try
+{
+    memory_ = {};
+    for (index_t i(snes9xHeaderSize); i + snes9xBlockHeaderSize <= std::size(state);)
+    {
+        const std::string_view name(readString(state, i, 3)), length_text(readString(state, i + 4, 6));
+        if (state[i + 3] != ':' || state[i + 10] != ':' || !std::ranges::all_of(length_text, [](char c) { return '0' <= c && c <= '9'; }))
+            throw std::runtime_error(LOG_INFO "Invalid snes9x block header at "s + toHexString(i, 3));
+
+        n_t length{};
+        std::from_chars(std::data(length_text), std::data(length_text) + std::size(length_text), length);
+        i += snes9xBlockHeaderSize;
+        if (i + length > std::size(state))
+            break;
+
+        if (name == "VRA"sv && length >= snesVramSize)
+            memory_.vram = state.subspan(i, snesVramSize);
+        else if (name == "RAM"sv && length >= snesWramSize)
+            memory_.wram = state.subspan(i, snesWramSize);
+
+        if (!std::empty(memory_.vram) && !std::empty(memory_.wram))
+            return true;
+
+        i += length;
+    }
+
+    return false;
+}
+LOG_RETHROW
+
+void Savestate::readMgba(std::span<const std::uint8_t> state)
+try
+{
+    if (std::size(state) < mgbaStateSize || (read32Le(state, 0) & mgbaMagicMask) != mgbaMagic)
+        throw std::runtime_error(LOG_INFO "Not a GBA mGBA savestate"s);
+
+    memory_.vram = state.subspan(mgbaVramOffset, mgbaVramSize);
+    memory_.iwram = state.subspan(mgbaIwramOffset, mgbaIwramSize);
+    memory_.wram = state.subspan(mgbaWramOffset, mgbaWramSize);
+}
+LOG_RETHROW
+
+SavestateFormat Savestate::format() const noexcept
+{
+    return format_;
+}
+
+Platform Savestate::platform() const noexcept
+{
+    return format_ == SavestateFormat::snes9x ? Platform::snes : Platform::gba;
+}
+
+const ConsoleMemory& Savestate::memory() const noexcept
+{
+    return memory_;
+}
+
+bool isSavestateFile(const std::filesystem::path& filepath)
+try
+{
+    std::string extension(filepath.extension().string());
+    std::ranges::transform(extension, std::begin(extension), [](char c) { return char(std::tolower(static_cast<unsigned char>(c))); });
+    if (extension == ".frz"sv)
+        return true;
+
+    // .000 to .009 and .ss0 to .ss9
+    return std::size(extension) == 4 && (extension.starts_with(".00"sv) || extension.starts_with(".ss"sv)) && '0' <= extension[3] && extension[3] <= '9';
+}
+LOG_RETHROW
+
+std::vector<std::filesystem::path> findSavestates(const std::filesystem::path& directory)
+try
+{
+    std::vector<std::filesystem::path> ret;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+        if (entry.is_regular_file() && isSavestateFile(entry.path()))
+            ret.push_back(entry.path());
+
+    std::ranges::sort(ret);
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,52 @@
+module;
+
+#include "../global.h"
+
+export module savestate;
+
+export import game_traits;
+export import os;
+
+// Console memory as it was when a savestate was made
+export struct ConsoleMemory
+{
+    // SNES 128 KiB WRAM, or GBA 256 KiB EWRAM
+    std::span<const std::uint8_t> wram;
+
+    // SNES 64 KiB VRAM, or GBA 96 KiB VRAM
+    std::span<const std::uint8_t> vram;
+
+    // GBA 32 KiB IWRAM, empty for the SNES
+    std::span<const std::uint8_t> iwram;
+};
+
+export enum class SavestateFormat
+{
+    snes9x,
+    mgba
+};
+
+// An emulator savestate, snes9x (.000 to .009, .frz) or mGBA (.ss0 to .ss9).
+// Memory points into the mapped file where the state is stored uncompressed, otherwise only as much of the state as is needed to reach the memory is decompressed
+export class Savestate
+{
+    std::unique_ptr<MappedFile> p_file;
+    std::vector<std::uint8_t> decompressed;
+    SavestateFormat format_;
+    ConsoleMemory memory_;
+
+    bool readSnes9x(std::span<const std::uint8_t> state);
+    void readMgba(std::span<const std::uint8_t> state);
+
+public:
+    explicit Savestate(std::unique_ptr<MappedFile> p_file);
+
+    SavestateFormat format() const noexcept;
+    Platform platform() const noexcept;
+    const ConsoleMemory& memory() const noexcept;
+};
+
+export bool isSavestateFile(const std::filesystem::path& filepath);
+
+// The savestates in a directory, sorted by filename, for stepping through
+export std::vector<std::filesystem::path> findSavestates(const std::filesystem::path& directory);
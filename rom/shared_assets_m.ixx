@@ -0,0 +1,74 @@
+module;
+
+#include "../global.h"
+
+export module shared_assets;
+
+export import rom;
+
+// What an asset is decoded from: a hash of the ROM data, equal for ROMs with the same data, and the ranges of the ROM it's in
+export struct AssetSource
+{
+    std::uint64_t hash;
+    std::vector<RomRange> ranges;
+};
+
+export constexpr std::uint64_t combineHashes(std::uint64_t seed, std::uint64_t hash) noexcept
+{
+    return seed ^ (hash + 0x9E3779B97F4A7C15 + (seed << 6) + (seed >> 2));
+}
+
+// Decoded assets shared between the open ROMs, keyed by source hash, so that data two ROMs have in common is decoded and stored once.
+// Only weak references are kept, an asset is freed when the last ROM holding it lets it go
+export template<typename T>
+class SharedAssets
+{
+    mutable std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::weak_ptr<const T>> assets;
+
+    // Expired entries are swept when the map has doubled in size since the last sweep
+    n_t sweepSize{0x10};
+
+    void sweep()
+    {
+        std::erase_if(assets, [](const auto& asset) { return asset.second.expired(); });
+        sweepSize = std::max<n_t>(std::size(assets) * 2, 0x10);
+    }
+
+public:
+    // The asset with `hash` if any open ROM has it, otherwise the result of `make`
+    std::shared_ptr<const T> get(std::uint64_t hash, FunctionRef<T()> make)
+    try
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it(assets.find(hash)); it != std::end(assets))
+                if (std::shared_ptr<const T> p_asset{it->second.lock()})
+                    return p_asset;
+        }
+
+        // Decoded outside the lock. If another thread got there first, its asset is used and this one is dropped
+        std::shared_ptr<const T> p_asset(std::make_shared<const T>(make()));
+
+        std::lock_guard lock(mutex);
+        std::weak_ptr<const T>& entry(assets[hash]);
+        if (std::shared_ptr<const T> p_existing{entry.lock()})
+            return p_existing;
+
+        entry = p_asset;
+        if (std::size(assets) >= sweepSize)
+            sweep();
+
+        return p_asset;
+    }
+    LOG_RETHROW
+
+    // Assets held by at least one ROM
+    n_t size() const
+    try
+    {
+        std::lock_guard lock(mutex);
+        return n_t(std::ranges::count_if(assets, [](const auto& asset) { return !asset.second.expired(); }));
+    }
+    LOG_RETHROW
+};
@@ -0,0 +1,84 @@
+#include "global.h"
+
+import startup_profile;
+
+// Constructed during static initialisation, so the time before main_common is counted too
+static StartupProfile profile;
+
+StartupProfile::StartupProfile() noexcept
+    : startTime(std::chrono::steady_clock::now()), phaseStartTime(startTime)
+{}
+
+void StartupProfile::endPhase(std::string name)
+try
+{
+    const auto time(std::chrono::steady_clock::now());
+    std::lock_guard lock(mutex);
+    phases.push_back({std::move(name), std::chrono::duration_cast<std::chrono::microseconds>(time - phaseStartTime), false});
+    phaseStartTime = time;
+}
+LOG_RETHROW
+
+void StartupProfile::timeBackground(std::string name, FunctionRef<void()> f)
+try
+{
+    const auto startTime(std::chrono::steady_clock::now());
+    f();
+    const auto duration(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime));
+
+    std::lock_guard lock(mutex);
+    phases.push_back({std::move(name), duration, true});
+}
+LOG_RETHROW
+
+void StartupProfile::markWindowShown()
+try
+{
+    std::lock_guard lock(mutex);
+    timeToWindow_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+}
+LOG_RETHROW
+
+void StartupProfile::logReport() const
+try
+{
+    DebugFile(DebugFile::info) << LOG_INFO "Startup profile:\n"s << report();
+    if (const std::optional<std::chrono::microseconds> time(timeToWindow()); time && *time > budget)
+        DebugFile(DebugFile::warning) << LOG_INFO "Startup took "s << time->count() / 1000 << "ms to show the window, over the "s << budget.count() << "ms budget\n"s;
+}
+LOG_RETHROW
+
+std::optional<std::chrono::microseconds> StartupProfile::timeToWindow() const
+try
+{
+    std::lock_guard lock(mutex);
+    return timeToWindow_;
+}
+LOG_RETHROW
+
+std::string StartupProfile::report() const
+try
+{
+    const auto milliseconds([](std::chrono::microseconds duration)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << double(duration.count()) / 1000 << "ms"s;
+        return out.str();
+    });
+
+    std::lock_guard lock(mutex);
+    std::ostringstream out;
+    for (const Phase& phase : phases)
+        out << std::left << std::setw(32) << phase.name + (phase.isBackground ? " (background)"s : ""s) << std::right << std::setw(12) << milliseconds(phase.duration) << '\n';
+
+    out << std::left << std::setw(32) << "Time to window" << std::right << std::setw(12) << (timeToWindow_ ? milliseconds(*timeToWindow_) : "-"s)
+        << " of "s << budget.count() << "ms budget\n"s;
+
+    return out.str();
+}
+LOG_RETHROW
+
+StartupProfile& startupProfile() noexcept
+{
+    return profile;
+}
@@ -0,0 +1,51 @@
+module;
+
+#include "global.h"
+
+export module startup_profile;
+
+// Times the phases of startup, from static initialisation to the main window being shown, against the cold start budget.
+// Phases run off the startup path, e.g. loading the config, are timed separately and don't count against the budget
+export class StartupProfile
+{
+public:
+    static constexpr std::chrono::milliseconds budget{150};
+
+    struct Phase
+    {
+        std::string name;
+        std::chrono::microseconds duration;
+        bool isBackground;
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::chrono::steady_clock::time_point startTime, phaseStartTime;
+    std::vector<Phase> phases;
+    std::optional<std::chrono::microseconds> timeToWindow_;
+
+public:
+    StartupProfile() noexcept;
+
+    StartupProfile(const StartupProfile&) = delete;
+    auto operator=(StartupProfile) = delete;
+
+    // Ends the phase that started when the previous one ended
+    void endPhase(std::string name);
+
+    // Runs `f` as a background phase. Thread safe
+    void timeBackground(std::string name, FunctionRef<void()> f);
+
+    // Ends what the budget covers
+    void markWindowShown();
+
+    // Writes the report to the debug log, and a warning if the budget was missed
+    void logReport() const;
+
+    // Empty until the window's been shown
+    std::optional<std::chrono::microseconds> timeToWindow() const;
+
+    std::string report() const;
+};
+
+export StartupProfile& startupProfile() noexcept;
@@ -0,0 +1,588 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import sm_level_edit;
+
+static const n_t bitsPerWord(64);
+
+// Bits [i_bit, i_bit + 32) of a mask row, bits past the end of the row are zero
+static std::uint32_t readMaskBits(std::span<const std::uint64_t> row, index_t i_bit) noexcept
+{
+    const index_t i_word(i_bit / bitsPerWord), shift(i_bit % bitsPerWord);
+    if (i_word >= std::size(row))
+        return 0;
+
+    std::uint64_t bits(row[i_word] >> shift);
+    if (shift > bitsPerWord - 32 && i_word + 1 < std::size(row))
+        bits |= row[i_word + 1] << (bitsPerWord - shift);
+
+    return std::uint32_t(bits);
+}
+
+// Expands 16 mask bits to 16 word lanes of all ones or all zeros
+static __m256i expandMask16(std::uint32_t bits) noexcept
+{
+    const __m256i laneBits(_mm256_setr_epi16(1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, short(0x8000)));
+    return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16(short(bits)), laneBits), laneBits);
+}
+
+// Expands 32 mask bits to 32 byte lanes of all ones or all zeros
+static __m256i expandMask32(std::uint32_t bits) noexcept
+{
+    // Each byte lane takes the byte of `bits` holding its bit, then tests its bit. The shuffle is within 128-bit lanes, each of which has all of `bits`
+    const __m256i byteSelect(_mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3));
+    const __m256i laneBits(_mm256_set1_epi64x(std::int64_t(0x8040'2010'0804'0201)));
+    const __m256i bytes(_mm256_shuffle_epi8(_mm256_set1_epi32(int(bits)), byteSelect));
+    return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, laneBits), laneBits);
+}
+
+// Copies source blocks and BTS to the destination where the mask bit is set. Mask bit `i_maskBegin` corresponds to the first block
+static void maskedCopyRow
+(
+    std::span<std::uint16_t> blocks, std::span<std::uint8_t> bts,
+    std::span<const std::uint16_t> sourceBlocks, std::span<const std::uint8_t> sourceBts,
+    std::span<const std::uint64_t> mask, index_t i_maskBegin
+) noexcept
+{
+    const n_t n(std::size(blocks));
+    index_t i{};
+    for (; i + 32 <= n; i += 32)
+    {
+        const std::uint32_t bits(readMaskBits(mask, i_maskBegin + i));
+        if (!bits)
+            continue;
+
+        for (index_t i_half{}; i_half < 2; ++i_half)
+        {
+            const index_t i_block(i + i_half * 16);
+            const __m256i select(expandMask16(bits >> i_half * 16));
+            const __m256i destination(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&blocks[i_block])));
+            const __m256i source(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&sourceBlocks[i_block])));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&blocks[i_block]), _mm256_blendv_epi8(destination, source, select));
+        }
+
+        const __m256i destinationBts(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&bts[i])));
+        const __m256i sourceBtsValues(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&sourceBts[i])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&bts[i]), _mm256_blendv_epi8(destinationBts, sourceBtsValues, expandMask32(bits)));
+    }
+
+    for (; i < n; ++i)
+        if (readMaskBits(mask, i_maskBegin + i) & 1)
+        {
+            blocks[i] = sourceBlocks[i];
+            bts[i] = sourceBts[i];
+        }
+}
+
+// Applies `edit` to rows [y_begin, y_end) and records the blocks that changed
+static LevelEdit recordEdit(LevelData& levelData, index_t y_begin, index_t y_end, FunctionRef<void()> edit)
+try
+{
+    const index_t i_begin(y_begin * levelData.width), i_end(y_end * levelData.width);
+    const std::vector<std::uint16_t> oldBlocks(std::begin(levelData.layer1) + i_begin, std::begin(levelData.layer1) + i_end);
+    const std::vector<std::uint8_t> oldBts(std::begin(levelData.bts) + i_begin, std::begin(levelData.bts) + i_end);
+    edit();
+
+    LevelEdit ret;
+    const auto record([&](index_t i)
+    {
+        const std::uint16_t newBlock(levelData.layer1[i_begin + i]);
+        const std::uint8_t newBts(levelData.bts[i_begin + i]);
+        if (newBlock == oldBlocks[i] && newBts == oldBts[i])
+            return;
+
+        ret.indices.push_back(i_begin + i);
+        ret.oldBlocks.push_back(oldBlocks[i]);
+        ret.newBlocks.push_back(newBlock);
+        ret.oldBts.push_back(oldBts[i]);
+        ret.newBts.push_back(newBts);
+    });
+
+    // Sixteen blocks are compared at a time and only groups with a difference are looked at individually
+    const n_t n(i_end - i_begin);
+    index_t i{};
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256i blocksBefore(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&oldBlocks[i])));
+        const __m256i blocksAfter(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&levelData.layer1[i_begin + i])));
+        const __m128i btsBefore(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&oldBts[i])));
+        const __m128i btsAfter(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&levelData.bts[i_begin + i])));
+        const unsigned isBlockSame(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi16(blocksBefore, blocksAfter))));
+        const unsigned isBtsSame(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(btsBefore, btsAfter))));
+        if (isBlockSame == 0xFFFF'FFFF && isBtsSame == 0xFFFF)
+            continue;
+
+        for (index_t i_lane{}; i_lane < 16; ++i_lane)
+            record(i + i_lane);
+    }
+
+    for (; i < n; ++i)
+        record(i);
+
+    return ret;
+}
+LOG_RETHROW
+
+static void checkMaskSize(const LevelData& levelData, const SelectionMask& mask)
+try
+{
+    if (mask.width() != levelData.width || mask.height() != levelData.height)
+        throw std::runtime_error(LOG_INFO "Selection is "s + std::to_string(mask.width()) + 'x' + std::to_string(mask.height()) + ", level data is "s + std::to_string(levelData.width) + 'x' + std::to_string(levelData.height));
+}
+LOG_RETHROW
+
+SelectionMask::SelectionMask(n_t width, n_t height)
+try
+    : width_(width), height_(height), n_rowWords((width + bitsPerWord - 1) / bitsPerWord), words(n_rowWords * height)
+{}
+LOG_RETHROW
+
+void SelectionMask::clearPadding() noexcept
+{
+    if (width_ % bitsPerWord == 0)
+        return;
+
+    const std::uint64_t lastWordMask((std::uint64_t(1) << width_ % bitsPerWord) - 1);
+    for (index_t y{}; y < height_; ++y)
+        words[y * n_rowWords + n_rowWords - 1] &= lastWordMask;
+}
+
+template<typename Operation>
+SelectionMask& SelectionMask::combine(const SelectionMask& other, Operation operation)
+try
+{
+    if (other.width_ != width_ || other.height_ != height_)
+        throw std::runtime_error(LOG_INFO "Combining selections of different sizes"s);
+
+    const n_t n(std::size(words));
+    index_t i{};
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i a(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&words[i])));
+        const __m256i b(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&other.words[i])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&words[i]), operation(a, b));
+    }
+
+    for (; i < n; ++i)
+    {
+        // The scalar tail goes through the same operation on a vector with one word used
+        const __m256i result(operation(_mm256_set1_epi64x(std::int64_t(words[i])), _mm256_set1_epi64x(std::int64_t(other.words[i]))));
+        words[i] = std::uint64_t(_mm256_extract_epi64(result, 0));
+    }
+
+    return *this;
+}
+LOG_RETHROW
+
+n_t SelectionMask::width() const noexcept
+{
+    return width_;
+}
+
+n_t SelectionMask::height() const noexcept
+{
+    return height_;
+}
+
+bool SelectionMask::test(index_t x, index_t y) const
+try
+{
+    if (x >= width_ || y >= height_)
+        throw std::out_of_range(LOG_INFO "Selection position out of range"s);
+
+    return words[y * n_rowWords + x / bitsPerWord] >> x % bitsPerWord & 1;
+}
+LOG_RETHROW
+
+void SelectionMask::set(index_t x, index_t y, bool value)
+try
+{
+    if (x >= width_ || y >= height_)
+        throw std::out_of_range(LOG_INFO "Selection position out of range"s);
+
+    const std::uint64_t bit(std::uint64_t(1) << x % bitsPerWord);
+    std::uint64_t& word(words[y * n_rowWords + x / bitsPerWord]);
+    word = value ? word | bit : word & ~bit;
+}
+LOG_RETHROW
+
+void SelectionMask::setRect(index_t x, index_t y, n_t width, n_t height, bool value)
+try
+{
+    if (x >= width_ || y >= height_)
+        return;
+
+    const index_t x_end(std::min(x + width, width_)), y_end(std::min(y + height, height_));
+    if (x_end <= x)
+        return;
+
+    // Whole words in the middle of the span, partial words at either end
+    const index_t i_firstWord(x / bitsPerWord), i_lastWord((x_end - 1) / bitsPerWord);
+    const std::uint64_t firstMask(~std::uint64_t{} << x % bitsPerWord);
+    const std::uint64_t lastMask(~std::uint64_t{} >> (bitsPerWord - 1 - (x_end - 1) % bitsPerWord));
+    for (index_t y_row(y); y_row < y_end; ++y_row)
+    {
+        const std::span<std::uint64_t> rowWords(row(y_row));
+        for (index_t i_word(i_firstWord); i_word <= i_lastWord; ++i_word)
+        {
+            std::uint64_t mask(~std::uint64_t{});
+            if (i_word == i_firstWord)
+                mask &= firstMask;
+            if (i_word == i_lastWord)
+                mask &= lastMask;
+
+            rowWords[i_word] = value ? rowWords[i_word] | mask : rowWords[i_word] & ~mask;
+        }
+    }
+}
+LOG_RETHROW
+
+void SelectionMask::clear() noexcept
+{
+    std::ranges::fill(words, 0);
+}
+
+void SelectionMask::invert() noexcept
+{
+    for (std::uint64_t& word : words)
+        word = ~word;
+
+    clearPadding();
+}
+
+bool SelectionMask::empty() const noexcept
+{
+    return std::ranges::all_of(words, [](std::uint64_t word){ return word == 0; });
+}
+
+n_t SelectionMask::count() const noexcept
+{
+    n_t ret{};
+    for (std::uint64_t word : words)
+        ret += n_t(std::popcount(word));
+
+    return ret;
+}
+
+auto SelectionMask::bounds() const noexcept -> std::optional<Bounds>
+{
+    index_t x_min(width_), x_max{}, y_min(height_), y_max{};
+    for (index_t y{}; y < height_; ++y)
+        for (index_t i_word{}; i_word < n_rowWords; ++i_word)
+        {
+            const std::uint64_t word(words[y * n_rowWords + i_word]);
+            if (!word)
+                continue;
+
+            y_min = std::min(y_min, y);
+            y_max = y;
+            x_min = std::min(x_min, i_word * bitsPerWord + n_t(std::countr_zero(word)));
+            x_max = std::max(x_max, i_word * bitsPerWord + bitsPerWord - 1 - n_t(std::countl_zero(word)));
+        }
+
+    if (y_min == height_)
+        return {};
+
+    return Bounds{x_min, y_min, x_max - x_min + 1, y_max - y_min + 1};
+}
+
+std::span<const std::uint64_t> SelectionMask::row(index_t y) const
+try
+{
+    return std::span(words).subspan(y * n_rowWords, n_rowWords);
+}
+LOG_RETHROW
+
+std::span<std::uint64_t> SelectionMask::row(index_t y)
+try
+{
+    return std::span(words).subspan(y * n_rowWords, n_rowWords);
+}
+LOG_RETHROW
+
+SelectionMask& SelectionMask::operator|=(const SelectionMask& other)
+try
+{
+    return combine(other, [](__m256i a, __m256i b){ return _mm256_or_si256(a, b); });
+}
+LOG_RETHROW
+
+SelectionMask& SelectionMask::operator&=(const SelectionMask& other)
+try
+{
+    return combine(other, [](__m256i a, __m256i b){ return _mm256_and_si256(a, b); });
+}
+LOG_RETHROW
+
+SelectionMask& SelectionMask::operator^=(const SelectionMask& other)
+try
+{
+    return combine(other, [](__m256i a, __m256i b){ return _mm256_xor_si256(a, b); });
+}
+LOG_RETHROW
+
+SelectionMask& SelectionMask::operator-=(const SelectionMask& other)
+try
+{
+    return combine(other, [](__m256i a, __m256i b){ return _mm256_andnot_si256(b, a); });
+}
+LOG_RETHROW
+
+bool LevelEdit::empty() const noexcept
+{
+    return std::empty(indices);
+}
+
+void EditHistory::push(LevelEdit edit)
+try
+{
+    if (edit.empty())
+        return;
+
+    undoSteps.push_back(std::move(edit));
+    redoSteps.clear();
+}
+LOG_RETHROW
+
+bool EditHistory::undo(LevelData& levelData)
+try
+{
+    if (std::empty(undoSteps))
+        return false;
+
+    const LevelEdit& edit(undoSteps.back());
+    for (index_t i{}; i < std::size(edit.indices); ++i)
+    {
+        levelData.layer1.at(edit.indices[i]) = edit.oldBlocks[i];
+        levelData.bts.at(edit.indices[i]) = edit.oldBts[i];
+    }
+
+    redoSteps.push_back(std::move(undoSteps.back()));
+    undoSteps.pop_back();
+    return true;
+}
+LOG_RETHROW
+
+bool EditHistory::redo(LevelData& levelData)
+try
+{
+    if (std::empty(redoSteps))
+        return false;
+
+    const LevelEdit& edit(redoSteps.back());
+    for (index_t i{}; i < std::size(edit.indices); ++i)
+    {
+        levelData.layer1.at(edit.indices[i]) = edit.newBlocks[i];
+        levelData.bts.at(edit.indices[i]) = edit.newBts[i];
+    }
+
+    undoSteps.push_back(std::move(redoSteps.back()));
+    redoSteps.pop_back();
+    return true;
+}
+LOG_RETHROW
+
+n_t EditHistory::n_undoSteps() const noexcept
+{
+    return std::size(undoSteps);
+}
+
+n_t EditHistory::n_redoSteps() const noexcept
+{
+    return std::size(redoSteps);
+}
+
+LevelEdit fill(LevelData& levelData, const SelectionMask& selection, std::uint16_t block, std::uint8_t bts)
+try
+{
+    checkMaskSize(levelData, selection);
+    const std::optional<SelectionMask::Bounds> bounds(selection.bounds());
+    if (!bounds)
+        return {};
+
+    // One row of the fill value serves as the source for every row
+    const std::vector<std::uint16_t> blockRow(levelData.width, block);
+    const std::vector<std::uint8_t> btsRow(levelData.width, bts);
+    return recordEdit(levelData, bounds->y, bounds->y + bounds->height, [&]
+    {
+        for (index_t y(bounds->y); y < bounds->y + bounds->height; ++y)
+        {
+            const index_t i_row(y * levelData.width);
+            maskedCopyRow
+            (
+                std::span(levelData.layer1).subspan(i_row, levelData.width), std::span(levelData.bts).subspan(i_row, levelData.width),
+                blockRow, btsRow, selection.row(y), 0
+            );
+        }
+    });
+}
+LOG_RETHROW
+
+LevelEdit fillRect(LevelData& levelData, index_t x, index_t y, n_t width, n_t height, std::uint16_t block, std::uint8_t bts)
+try
+{
+    SelectionMask selection(levelData.width, levelData.height);
+    selection.setRect(x, y, width, height);
+    return fill(levelData, selection, block, bts);
+}
+LOG_RETHROW
+
+BlockClipboard copy(const LevelData& levelData, const SelectionMask& selection)
+try
+{
+    checkMaskSize(levelData, selection);
+    const std::optional<SelectionMask::Bounds> bounds(selection.bounds());
+    if (!bounds)
+        return {SelectionMask(0, 0), {}, {}};
+
+    BlockClipboard ret{SelectionMask(bounds->width, bounds->height), std::vector<std::uint16_t>(bounds->width * bounds->height), std::vector<std::uint8_t>(bounds->width * bounds->height)};
+    for (index_t y{}; y < bounds->height; ++y)
+    {
+        const index_t i_source((bounds->y + y) * levelData.width + bounds->x);
+        std::copy_n(std::begin(levelData.layer1) + i_source, bounds->width, std::begin(ret.layer1) + y * bounds->width);
+        std::copy_n(std::begin(levelData.bts) + i_source, bounds->width, std::begin(ret.bts) + y * bounds->width);
+
+        // Shifts the selection row down to the bounding box's left edge. Nothing past the box's right edge is selected, so no stray bits come in
+        const std::span<const std::uint64_t> sourceRow(selection.row(bounds->y + y));
+        const std::span<std::uint64_t> row(ret.mask.row(y));
+        for (index_t i_word{}; i_word < std::size(row); ++i_word)
+            row[i_word] = std::uint64_t(readMaskBits(sourceRow, bounds->x + i_word * bitsPerWord)) | std::uint64_t(readMaskBits(sourceRow, bounds->x + i_word * bitsPerWord + 32)) << 32;
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+LevelEdit paste(LevelData& levelData, const BlockClipboard& clipboard, std::ptrdiff_t x, std::ptrdiff_t y)
+try
+{
+    const n_t width(clipboard.mask.width()), height(clipboard.mask.height());
+
+    // Clipped to the room, in clipboard coordinates
+    const index_t x_begin(index_t(std::max<std::ptrdiff_t>(-x, 0))), y_begin(index_t(std::max<std::ptrdiff_t>(-y, 0)));
+    const index_t x_end(index_t(std::clamp<std::ptrdiff_t>(std::ptrdiff_t(levelData.width) - x, 0, std::ptrdiff_t(width))));
+    const index_t y_end(index_t(std::clamp<std::ptrdiff_t>(std::ptrdiff_t(levelData.height) - y, 0, std::ptrdiff_t(height))));
+    if (x_begin >= x_end || y_begin >= y_end)
+        return {};
+
+    const n_t n_columns(x_end - x_begin);
+    return recordEdit(levelData, index_t(y + std::ptrdiff_t(y_begin)), index_t(y + std::ptrdiff_t(y_end)), [&]
+    {
+        for (index_t y_source(y_begin); y_source < y_end; ++y_source)
+        {
+            const index_t i_source(y_source * width + x_begin);
+            const index_t i_destination(index_t(y + std::ptrdiff_t(y_source)) * levelData.width + index_t(x + std::ptrdiff_t(x_begin)));
+            maskedCopyRow
+            (
+                std::span(levelData.layer1).subspan(i_destination, n_columns), std::span(levelData.bts).subspan(i_destination, n_columns),
+                std::span(clipboard.layer1).subspan(i_source, n_columns), std::span(clipboard.bts).subspan(i_source, n_columns),
+                clipboard.mask.row(y_source), x_begin
+            );
+        }
+    });
+}
+LOG_RETHROW
+
+LevelEdit stamp(LevelData& levelData, const SelectionMask& selection, const BlockClipboard& pattern)
+try
+{
+    checkMaskSize(levelData, selection);
+    const n_t patternWidth(pattern.mask.width()), patternHeight(pattern.mask.height());
+    const std::optional<SelectionMask::Bounds> bounds(selection.bounds());
+    if (!bounds || !patternWidth || !patternHeight)
+        return {};
+
+    // Each pattern row is tiled out to the room's width once, then every room row is a masked copy from one of those
+    std::vector<std::vector<std::uint16_t>> tiledBlocks(patternHeight, std::vector<std::uint16_t>(levelData.width));
+    std::vector<std::vector<std::uint8_t>> tiledBts(patternHeight, std::vector<std::uint8_t>(levelData.width));
+    SelectionMask tiledMask(levelData.width, patternHeight);
+    for (index_t y{}; y < patternHeight; ++y)
+        for (index_t x{}; x < levelData.width; ++x)
+        {
+            const index_t i_pattern(y * patternWidth + x % patternWidth);
+            tiledBlocks[y][x] = pattern.layer1[i_pattern];
+            tiledBts[y][x] = pattern.bts[i_pattern];
+            tiledMask.set(x, y, pattern.mask.test(x % patternWidth, y));
+        }
+
+    std::vector<std::uint64_t> rowMask;
+    return recordEdit(levelData, bounds->y, bounds->y + bounds->height, [&]
+    {
+        for (index_t y(bounds->y); y < bounds->y + bounds->height; ++y)
+        {
+            const index_t y_pattern(y % patternHeight);
+            const std::span<const std::uint64_t> selectionRow(selection.row(y)), patternRow(tiledMask.row(y_pattern));
+            rowMask.resize(std::size(selectionRow));
+            std::ranges::transform(selectionRow, patternRow, std::begin(rowMask), std::bit_and());
+
+            const index_t i_row(y * levelData.width);
+            maskedCopyRow
+            (
+                std::span(levelData.layer1).subspan(i_row, levelData.width), std::span(levelData.bts).subspan(i_row, levelData.width),
+                tiledBlocks[y_pattern], tiledBts[y_pattern], rowMask, 0
+            );
+        }
+    });
+}
+LOG_RETHROW
+
+SelectionMask floodSelect(const LevelData& levelData, index_t x, index_t y)
+try
+{
+    if (x >= levelData.width || y >= levelData.height)
+        throw std::out_of_range(LOG_INFO "Flood fill position out of range"s);
+
+    SelectionMask ret(levelData.width, levelData.height);
+    const index_t i_seed(y * levelData.width + x);
+    const std::uint16_t block(levelData.layer1[i_seed]);
+    const std::uint8_t bts(levelData.bts[i_seed]);
+    const auto isMatch([&](index_t x_block, index_t y_block)
+    {
+        const index_t i(y_block * levelData.width + x_block);
+        return levelData.layer1[i] == block && levelData.bts[i] == bts && !ret.test(x_block, y_block);
+    });
+
+    // Scanline fill: each seed is widened to the whole matching run, the run is selected in one go, and the rows above and below are scanned for new seeds
+    std::vector<std::pair<index_t, index_t>> seeds{{x, y}};
+    while (!std::empty(seeds))
+    {
+        const auto [x_seed, y_seed](seeds.back());
+        seeds.pop_back();
+        if (!isMatch(x_seed, y_seed))
+            continue;
+
+        index_t x_begin(x_seed), x_end(x_seed + 1);
+        while (x_begin > 0 && isMatch(x_begin - 1, y_seed))
+            --x_begin;
+        while (x_end < levelData.width && isMatch(x_end, y_seed))
+            ++x_end;
+
+        ret.setRect(x_begin, y_seed, x_end - x_begin, 1);
+        for (const index_t y_next : {y_seed - 1, y_seed + 1})
+        {
+            if (y_next >= levelData.height)
+                continue;
+
+            bool isInRun{};
+            for (index_t x_next(x_begin); x_next < x_end; ++x_next)
+            {
+                const bool isMatching(isMatch(x_next, y_next));
+                if (isMatching && !isInRun)
+                    seeds.emplace_back(x_next, y_next);
+
+                isInRun = isMatching;
+            }
+        }
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+LevelEdit floodFill(LevelData& levelData, index_t x, index_t y, std::uint16_t block, std::uint8_t bts)
+try
+{
+    return fill(levelData, floodSelect(levelData, x, y), block, bts);
+}
+LOG_RETHROW
@@ -0,0 +1,107 @@
+module;
+
+#include "../global.h"
+
+export module sm_level_edit;
+
+export import sm_room;
+
+// One bit per block, each row starting on a word boundary so that rows line up with level data rows and bits past the width are always clear
+export class SelectionMask
+{
+public:
+    struct Bounds
+    {
+        index_t x, y;
+        n_t width, height;
+    };
+
+private:
+    n_t width_, height_, n_rowWords;
+    std::vector<std::uint64_t> words;
+
+    void clearPadding() noexcept;
+
+    template<typename Operation>
+    SelectionMask& combine(const SelectionMask& other, Operation operation);
+
+public:
+    SelectionMask(n_t width, n_t height);
+
+    n_t width() const noexcept;
+    n_t height() const noexcept;
+
+    bool test(index_t x, index_t y) const;
+    void set(index_t x, index_t y, bool value = true);
+
+    // Clipped to the mask
+    void setRect(index_t x, index_t y, n_t width, n_t height, bool value = true);
+
+    void clear() noexcept;
+    void invert() noexcept;
+    bool empty() const noexcept;
+    n_t count() const noexcept;
+    std::optional<Bounds> bounds() const noexcept;
+
+    std::span<const std::uint64_t> row(index_t y) const;
+    std::span<std::uint64_t> row(index_t y);
+
+    // Masks must be the same size
+    SelectionMask& operator|=(const SelectionMask& other);
+    SelectionMask& operator&=(const SelectionMask& other);
+    SelectionMask& operator^=(const SelectionMask& other);
+    SelectionMask& operator-=(const SelectionMask& other);
+};
+
+// Blocks copied out of a room, cropped to the selection's bounding box. Blocks outside the mask are left alone when pasting
+export struct BlockClipboard
+{
+    SelectionMask mask;
+    std::vector<std::uint16_t> layer1;
+    std::vector<std::uint8_t> bts;
+};
+
+// The blocks an edit changed, with their layer 1 and BTS values before and after, so undoing or redoing an edit of any size is one step
+export struct LevelEdit
+{
+    // Ascending
+    std::vector<index_t> indices;
+
+    std::vector<std::uint16_t> oldBlocks, newBlocks;
+    std::vector<std::uint8_t> oldBts, newBts;
+
+    bool empty() const noexcept;
+};
+
+export class EditHistory
+{
+    std::vector<LevelEdit> undoSteps, redoSteps;
+
+public:
+    // Edits that changed nothing aren't recorded. Clears the redo steps
+    void push(LevelEdit edit);
+
+    // Return false if there's nothing to undo or redo
+    bool undo(LevelData& levelData);
+    bool redo(LevelData& levelData);
+
+    n_t n_undoSteps() const noexcept;
+    n_t n_redoSteps() const noexcept;
+};
+
+// Edit kernels. These work on layer 1 and BTS sixteen or thirty-two blocks at a time, and return the edit made for the edit history.
+// Masks must be the size of the level data
+export LevelEdit fill(LevelData& levelData, const SelectionMask& selection, std::uint16_t block, std::uint8_t bts);
+export LevelEdit fillRect(LevelData& levelData, index_t x, index_t y, n_t width, n_t height, std::uint16_t block, std::uint8_t bts);
+
+export BlockClipboard copy(const LevelData& levelData, const SelectionMask& selection);
+
+// (x, y) is the destination of the clipboard's top-left corner, blocks falling outside the room are dropped
+export LevelEdit paste(LevelData& levelData, const BlockClipboard& clipboard, std::ptrdiff_t x, std::ptrdiff_t y);
+
+// Tiles the pattern across the room, aligned to the room's top-left, and writes it to the selected blocks
+export LevelEdit stamp(LevelData& levelData, const SelectionMask& selection, const BlockClipboard& pattern);
+
+// The 4-connected area of blocks with the same layer 1 block and BTS as (x, y)
+export SelectionMask floodSelect(const LevelData& levelData, index_t x, index_t y);
+export LevelEdit floodFill(LevelData& levelData, index_t x, index_t y, std::uint16_t block, std::uint8_t bts);
@@ -0,0 +1,109 @@
+#include "../global.h"
+
+import sm_live_room;
+
+// WRAM addresses, offsets from $7E:0000
+static const index_t
+    roomPointerAddress(0x79B),
+    roomStatePointerAddress(0x7BB),
+    roomWidthAddress(0x7A5), // In blocks
+    roomHeightAddress(0x7A7), // In blocks
+    layer1XAddress(0x911),
+    layer1YAddress(0x915),
+    layer2XAddress(0x917),
+    layer2YAddress(0x919),
+    enemiesAddress(0xF78),
+    layer1Address(0x10002),
+    btsAddress(0x16402),
+    layer2Address(0x19602);
+
+// Enemy RAM is 32 slots of 40h bytes, an empty slot has a zero ID
+static const n_t
+    n_enemySlots(0x20),
+    enemySlotSize(0x40);
+
+// Enemy RAM fields, offsets into the slot
+static const index_t
+    enemyIdOffset(0),
+    enemyXOffset(2),
+    enemyYOffset(6),
+    enemyPropertiesOffset(0xE),
+    enemyExtraPropertiesOffset(0x10),
+    enemyParameter1Offset(0x3C),
+    enemyParameter2Offset(0x3E);
+
+static const n_t snesWramSize(0x20000);
+
+LiveRoom readLiveRoom(const Rom& rom, const ConsoleMemory& memory, MemoryArena* p_arena)
+try
+{
+    const std::span<const std::uint8_t> wram(memory.wram);
+    if (std::size(wram) < snesWramSize)
+        throw std::runtime_error(LOG_INFO "Savestate has no SNES WRAM"s);
+
+    const auto read16([&](index_t i) -> std::uint16_t
+    {
+        return std::uint16_t(wram[i] | wram[i + 1] << 8);
+    });
+
+    const std::uint16_t roomAddress(read16(roomPointerAddress)), stateAddress(read16(roomStatePointerAddress));
+    if (!Room::isValid(rom, roomAddress))
+        throw std::runtime_error(LOG_INFO "Savestate room $"s + toHexString(roomAddress) + " isn't a room in this ROM"s);
+
+    const n_t width(read16(roomWidthAddress)), height(read16(roomHeightAddress)), n_blocks(width * height);
+
+    // The game moves BTS and layer 2 to fixed places after decompressing. Bit 0 of the state's layer 2 X scroll is set when layer 2 is a background rather than level data
+    const Room room(rom, roomAddress);
+    const auto it_state(std::ranges::find(room.states, stateAddress, &RoomState::address));
+    const bool hasLayer2(it_state != std::end(room.states) && !(it_state->layer2ScrollX & 1));
+    if (layer1Address + n_blocks * 2 > btsAddress || btsAddress + n_blocks > layer2Address || layer2Address + n_blocks * 2 > snesWramSize)
+        throw std::runtime_error(LOG_INFO "Savestate room size "s + std::to_string(width) + "x"s + std::to_string(height) + " is too big"s);
+
+    LiveRoom ret
+    {
+        roomAddress, stateAddress,
+        LevelData
+        (
+            width, height, wram.subspan(layer1Address, n_blocks * 2), wram.subspan(btsAddress, n_blocks), hasLayer2 ? wram.subspan(layer2Address, n_blocks * 2) : std::span<const std::uint8_t>(),
+            memoryResource(MemorySubsystem::rooms, p_arena)
+        ),
+        std::pmr::vector<Enemy>(memoryResource(MemorySubsystem::sprites, p_arena)),
+        read16(layer1XAddress), read16(layer1YAddress), read16(layer2XAddress), read16(layer2YAddress)
+    };
+
+    for (index_t i_slot{}; i_slot < n_enemySlots; ++i_slot)
+    {
+        const index_t i(enemiesAddress + i_slot * enemySlotSize);
+        const std::uint16_t id(read16(i + enemyIdOffset));
+        if (!id)
+            continue;
+
+        ret.enemies.push_back
+        ({
+            id, read16(i + enemyXOffset), read16(i + enemyYOffset), 0,
+            read16(i + enemyPropertiesOffset), read16(i + enemyExtraPropertiesOffset), read16(i + enemyParameter1Offset), read16(i + enemyParameter2Offset)
+        });
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+SelectionMask modifiedBlocks(const LevelData& original, const LevelData& live)
+try
+{
+    if (original.width != live.width || original.height != live.height)
+        throw std::runtime_error(LOG_INFO "Level data sizes differ"s);
+
+    SelectionMask ret(live.width, live.height);
+    for (index_t y{}; y < live.height; ++y)
+        for (index_t x{}; x < live.width; ++x)
+        {
+            const index_t i(y * live.width + x);
+            if (original.layer1[i] != live.layer1[i] || original.bts[i] != live.bts[i])
+                ret.set(x, y);
+        }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,30 @@
+module;
+
+#include "../global.h"
+
+export module sm_live_room;
+
+export import savestate;
+export import sm_level_edit;
+export import sm_sprites;
+
+// The room Samus was in when a savestate was made, as the game had it in RAM
+export struct LiveRoom
+{
+    std::uint16_t roomAddress, stateAddress;
+
+    // Including blocks changed by PLMs, shot blocks and the like
+    LevelData levelData;
+
+    // Live positions, in the population data's coordinates. The initial parameter isn't kept in RAM and is zero
+    std::pmr::vector<Enemy> enemies;
+
+    // Top-left of the screen, in pixels
+    std::uint16_t layer1X, layer1Y, layer2X, layer2Y;
+};
+
+// `memory` is a SNES savestate's. Throws if the room pointer in RAM isn't a room in `rom`. Allocates from `p_arena` if given
+export LiveRoom readLiveRoom(const Rom& rom, const ConsoleMemory& memory, MemoryArena* p_arena = nullptr);
+
+// The blocks whose layer 1 block or BTS differs between the room as it is in the ROM and as it is live. The level data must be the same size
+export SelectionMask modifiedBlocks(const LevelData& original, const LevelData& live);
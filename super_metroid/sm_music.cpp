@@ -0,0 +1,116 @@
+#include "../global.h"
+
+import sm_music;
+
+static const std::uint32_t
+    spcEngineAddress(0xCF8000),
+    musicDataPointers(0x8FE7E1);
+
+// The engine's sample directory is at $6D00 in ARAM, with the sample data after it from $6E00
+static const std::uint16_t
+    sampleDirectoryAddress(0x6D00),
+    sampleDataAddress(0x6E00);
+
+static const n_t
+    aramSize(0x10000),
+    maxSamples((sampleDataAddress - sampleDirectoryAddress) / 4);
+
+// Applies SPC upload data to ARAM: blocks of a 16-bit size and ARAM destination followed by the data, terminated by a size of zero
+static void upload(const Rom& rom, std::uint32_t address, std::span<std::uint8_t> aram)
+try
+{
+    const std::span<const std::uint8_t> data(rom.spanFrom(address));
+    index_t i{};
+    for (;;)
+    {
+        if (i + 2 > std::size(data))
+            throw std::runtime_error(LOG_INFO "SPC upload data at $"s + toHexString(address, 3) + " overruns end of ROM"s);
+
+        const n_t size(data[i] | data[i + 1] << 8);
+        if (!size)
+            return;
+
+        if (i + 4 + size > std::size(data))
+            throw std::runtime_error(LOG_INFO "SPC upload data at $"s + toHexString(address, 3) + " overruns end of ROM"s);
+
+        const index_t destination(data[i + 2] | data[i + 3] << 8);
+        if (destination + size > aramSize)
+            throw std::runtime_error(LOG_INFO "SPC upload block of "s + std::to_string(size) + " bytes to $"s + toHexString(destination, 2) + " overruns ARAM"s);
+
+        std::copy_n(std::begin(data) + i + 4, size, std::begin(aram) + destination);
+        i += 4 + size;
+    }
+}
+LOG_RETHROW
+
+static void addSamples(std::vector<InstrumentSample>& samples, std::set<std::pair<std::uint64_t, std::optional<index_t>>>& seen, std::span<const std::uint8_t> aram, std::uint8_t i_musicData)
+try
+{
+    for (index_t i_sample{}; i_sample < maxSamples; ++i_sample)
+    {
+        const index_t i_entry(sampleDirectoryAddress + i_sample * 4);
+        const std::uint16_t
+            startAddress(std::uint16_t(aram[i_entry] | aram[i_entry + 1] << 8)),
+            loopAddress(std::uint16_t(aram[i_entry + 2] | aram[i_entry + 3] << 8));
+
+        // Unused entries are zero or left as FFFFh
+        if (startAddress < sampleDataAddress || startAddress == 0xFFFF)
+            continue;
+
+        n_t size;
+        try
+        {
+            size = brrSize(aram.subspan(startAddress));
+        }
+        catch (const std::exception& e)
+        {
+            LOG_IGNORE(e);
+            continue;
+        }
+
+        const std::span<const std::uint8_t> brr(aram.subspan(startAddress, size));
+        std::optional<index_t> loopOffset;
+        if (brr[size - brrBlockSize] & 2 && loopAddress >= startAddress && (loopAddress - startAddress) % brrBlockSize == 0 && n_t(loopAddress - startAddress) < size)
+            loopOffset = loopAddress - startAddress;
+
+        if (!seen.emplace(hashBytes(brr), loopOffset).second)
+            continue;
+
+        samples.push_back({i_musicData, i_sample, startAddress, loopAddress, std::vector<std::uint8_t>(std::begin(brr), std::end(brr)), loopOffset});
+    }
+}
+LOG_RETHROW
+
+std::vector<InstrumentSample> findInstrumentSamples(const Rom& rom)
+try
+{
+    std::vector<std::uint8_t> engineAram(aramSize);
+    upload(rom, spcEngineAddress, engineAram);
+
+    std::vector<InstrumentSample> ret;
+    std::set<std::pair<std::uint64_t, std::optional<index_t>>> seen;
+    addSamples(ret, seen, engineAram, 0);
+
+    // Music data zero means no change of music
+    std::set<std::uint8_t> musicDataIndices;
+    for (const Room& room : findRooms(rom))
+        for (const RoomState& state : room.states)
+            if (state.i_music)
+                musicDataIndices.insert(state.i_music);
+
+    for (std::uint8_t i_musicData : musicDataIndices)
+        try
+        {
+            // Each set is uploaded over the engine as it is after boot
+            std::vector<std::uint8_t> aram(engineAram);
+            upload(rom, rom.read24(musicDataPointers + i_musicData), aram);
+            addSamples(ret, seen, aram, i_musicData);
+        }
+        catch (const std::exception& e)
+        {
+            DebugFile(DebugFile::warning) << LOG_INFO "Leaving out music data "s << toHexString(i_musicData) << ": "s << e.what() << '\n';
+        }
+
+    return ret;
+}
+LOG_RETHROW
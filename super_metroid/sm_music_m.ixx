@@ -0,0 +1,28 @@
+module;
+
+#include "../global.h"
+
+export module sm_music;
+
+export import brr;
+export import sm_room;
+
+// An entry of the SPC engine's sample directory, as it is once a music data set has been uploaded
+export struct InstrumentSample
+{
+    // Room state music data index of the set that loads the sample, zero for the samples uploaded with the engine
+    std::uint8_t i_musicData;
+    index_t i_sample;
+
+    // ARAM addresses
+    std::uint16_t startAddress, loopAddress;
+
+    // Up to and including the end block
+    std::vector<std::uint8_t> brr;
+
+    // Byte offset into `brr` to loop back to, if the sample loops
+    std::optional<index_t> loopOffset;
+};
+
+// The samples of the engine and of each music data set room states use. Samples with the same BRR data and loop are listed once, the first time they're found
+export std::vector<InstrumentSample> findInstrumentSamples(const Rom& rom);
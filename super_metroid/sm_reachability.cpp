@@ -0,0 +1,652 @@
+#include "../global.h"
+
+import sm_reachability;
+
+// Block types
+static const unsigned
+    horizontalExtensionBlock(5),
+    solidBlock(8),
+    doorBlock(9),
+    spikeBlock(0xA),
+    specialBlock(0xB),
+    shootableBlock(0xC),
+    verticalExtensionBlock(0xD),
+    grappleBlock(0xE),
+    bombableBlock(0xF);
+
+static const n_t
+    maxExtensionHops(0x10),
+    arrivalSearchRadius(2), // Door and start positions can be on a solid block next to where Samus actually is
+    bitsPerWord(64);
+
+// Door cap PLMs come in groups of four, one per direction, 6 bytes apart
+static const std::uint16_t
+    yellowDoorCaps(0xC85A),
+    greenDoorCaps(0xC872),
+    redDoorCaps(0xC88A),
+    doorCapStride(6);
+
+// Visible, chozo orb and hidden item PLMs
+static const std::uint16_t
+    itemPlmsBegin(0xEED7),
+    itemPlmsEnd(0xF000);
+
+static bool isItemPlm(std::uint16_t id) noexcept
+{
+    return itemPlmsBegin <= id && id < itemPlmsEnd;
+}
+
+static n_t countWords(n_t n_regions) noexcept
+{
+    return (n_regions + bitsPerWord - 1) / bitsPerWord;
+}
+
+static bool isDoorCap(std::uint16_t id, std::uint16_t caps) noexcept
+{
+    return caps <= id && id < caps + doorCapStride * 4 && (id - caps) % doorCapStride == 0;
+}
+
+// Grey door caps are opened by events, which are assumed to have happened
+static bool canOpenDoorCap(std::uint16_t id, const ItemSet& items) noexcept
+{
+    if (isDoorCap(id, redDoorCaps))
+        return items[index_t(Item::missiles)] || items[index_t(Item::superMissiles)];
+
+    if (isDoorCap(id, greenDoorCaps))
+        return items[index_t(Item::superMissiles)];
+
+    if (isDoorCap(id, yellowDoorCaps))
+        return items[index_t(Item::powerBombs)];
+
+    return true;
+}
+
+static bool isPassable(unsigned type, std::uint8_t bts, const ItemSet& items) noexcept
+{
+    switch (type)
+    {
+    default:
+        return true;
+
+    case solidBlock:
+    case spikeBlock:
+    case grappleBlock:
+        return false;
+
+    case specialBlock:
+        // Speed booster blocks, everything else here crumbles
+        if (bts == 0x0E || bts == 0x0F)
+            return items[index_t(Item::speedBooster)];
+
+        return true;
+
+    case shootableBlock:
+        if (bts == 0x08 || bts == 0x09)
+            return items[index_t(Item::powerBombs)];
+
+        if (bts == 0x0A || bts == 0x0B)
+            return items[index_t(Item::superMissiles)];
+
+        return true;
+
+    case bombableBlock:
+        return items[index_t(Item::screwAttack)] || (items[index_t(Item::morphBall)] && (items[index_t(Item::bombs)] || items[index_t(Item::powerBombs)]));
+    }
+}
+
+// Extension blocks take the type and BTS of the block they extend, their BTS is the signed offset to it
+static std::pair<unsigned, std::uint8_t> resolveBlock(const LevelData& levelData, index_t x, index_t y) noexcept
+{
+    for (index_t i_hop{}; i_hop < maxExtensionHops; ++i_hop)
+    {
+        const index_t i_block(y * levelData.width + x);
+        const unsigned type(levelData.layer1[i_block] >> 12);
+        const std::uint8_t bts(levelData.bts[i_block]);
+        if (type == horizontalExtensionBlock)
+            x += index_t(std::int8_t(bts));
+        else if (type == verticalExtensionBlock)
+            y += index_t(std::int8_t(bts));
+        else
+            return {type, bts};
+
+        if (x >= levelData.width || y >= levelData.height)
+            break;
+    }
+
+    return {solidBlock, 0};
+}
+
+static std::vector<std::uint8_t> findPassableBlocks(const LevelData& levelData, const ItemSet& items)
+try
+{
+    const n_t n_blocks(levelData.width * levelData.height);
+    std::vector<std::uint8_t> passable(n_blocks);
+    for (index_t y{}; y < levelData.height; ++y)
+        for (index_t x{}; x < levelData.width; ++x)
+        {
+            const auto [type, bts](resolveBlock(levelData, x, y));
+            passable[y * levelData.width + x] = isPassable(type, bts, items);
+        }
+
+    if (items[index_t(Item::morphBall)])
+        return passable;
+
+    // Without the morph ball, one block high passages are closed
+    std::vector<std::uint8_t> ret(n_blocks);
+    for (index_t y{}; y < levelData.height; ++y)
+        for (index_t x{}; x < levelData.width; ++x)
+        {
+            const index_t i_block(y * levelData.width + x);
+            const bool isAbovePassable(y > 0 && passable[i_block - levelData.width]);
+            const bool isBelowPassable(y + 1 < levelData.height && passable[i_block + levelData.width]);
+            ret[i_block] = passable[i_block] && (isAbovePassable || isBelowPassable);
+        }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::optional<Item> findItem(std::string_view name) noexcept
+{
+    const auto it(std::ranges::find(itemNames, name));
+    if (it == std::end(itemNames))
+        return {};
+
+    return Item(it - std::begin(itemNames));
+}
+
+ReachabilitySolver::RoomData::RoomData(Room room_in)
+    : room(std::move(room_in)), plms(memoryResource(MemorySubsystem::sprites))
+{}
+
+ReachabilitySolver::ReachabilitySolver(const Rom& rom, ItemSet items_in, StartPosition start_in)
+try
+    : items(items_in), start(start_in)
+{
+    for (Room& room : findRooms(rom))
+    {
+        roomIndices[room.address] = std::size(rooms);
+        rooms.emplace_back(std::move(room));
+    }
+
+    if (const auto it(roomIndices.find(start.roomAddress)); it != std::end(roomIndices))
+        i_startRoom = it->second;
+
+    // Worker threads collect errors rather than logging them as they go, so the log isn't interleaved
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    std::for_each(std::execution::par, std::begin(rooms), std::end(rooms), [&](RoomData& data)
+    {
+        try
+        {
+            loadRoom(rom, data);
+        }
+        catch (const std::exception& e)
+        {
+            const std::lock_guard lock(mutex);
+            errors.push_back("Room $"s + toHexString(data.room.address) + ": "s + e.what());
+        }
+    });
+
+    for (const std::string& error : errors)
+        DebugFile(DebugFile::warning) << LOG_INFO "Room excluded from reachability: "s << error << '\n';
+
+    linkDoors();
+
+    std::vector<index_t> allRooms(std::size(rooms));
+    std::iota(std::begin(allRooms), std::end(allRooms), index_t{});
+    analyseRooms(allRooms);
+    solve();
+}
+LOG_RETHROW
+
+void ReachabilitySolver::loadRoom(const Rom& rom, RoomData& data)
+try
+{
+    data.doors.clear();
+    data.plms.clear();
+    data.items.clear();
+    data.levelData.reset();
+
+    data.doors = data.room.loadDoors(rom);
+    const RoomState& state(data.room.defaultState());
+    data.plms = loadPlmPopulation(rom, state);
+    std::ranges::copy_if(data.plms, std::back_inserter(data.items), isItemPlm, &Plm::id);
+    data.levelData.emplace(rom, data.room, state);
+}
+LOG_RETHROW
+
+void ReachabilitySolver::linkDoors()
+try
+{
+    for (RoomData& data : rooms)
+        data.incoming.clear();
+
+    for (index_t i_room{}; i_room < std::size(rooms); ++i_room)
+        for (index_t i_door{}; i_door < std::size(rooms[i_room].doors); ++i_door)
+        {
+            const Door& door(rooms[i_room].doors[i_door]);
+            const auto it(roomIndices.find(door.destination));
+            if (it == std::end(roomIndices))
+                continue;
+
+            // The door cap position is the door Samus comes out of, if the door has no cap, the middle of the destination screen stands in for it
+            RoomData& destination(rooms[it->second]);
+            Cell arrival{door.capX, door.capY};
+            if (arrival.x >= destination.room.width * screenSize || arrival.y >= destination.room.height * screenSize)
+                arrival = {door.screenX * screenSize + screenSize / 2, door.screenY * screenSize + screenSize / 2};
+
+            destination.incoming.push_back({i_room, i_door, arrival});
+        }
+}
+LOG_RETHROW
+
+auto ReachabilitySolver::analyse(const RoomData& data) const -> Analysis
+try
+{
+    Analysis ret;
+    ret.doorRegions.resize(std::size(data.doors));
+    ret.doorOpen.assign(std::size(data.doors), true);
+    ret.arrivalRegions.assign(std::size(data.incoming), npos);
+    ret.itemRegions.assign(std::size(data.items), npos);
+    if (!data.levelData)
+        return ret;
+
+    const LevelData& levelData(*data.levelData);
+    const std::vector<std::uint8_t> passable(findPassableBlocks(levelData, items));
+    std::vector<index_t> regions(std::size(passable), npos);
+    std::vector<index_t> stack;
+
+    const auto fill([&](index_t i_seed, index_t i_region)
+    {
+        regions[i_seed] = i_region;
+        stack.push_back(i_seed);
+        while (!std::empty(stack))
+        {
+            const index_t i_block(stack.back());
+            stack.pop_back();
+
+            const index_t x(i_block % levelData.width), y(i_block / levelData.width);
+            const auto visit([&](index_t i_neighbour)
+            {
+                if (passable[i_neighbour] && regions[i_neighbour] == npos)
+                {
+                    regions[i_neighbour] = i_region;
+                    stack.push_back(i_neighbour);
+                }
+            });
+
+            if (x > 0)
+                visit(i_block - 1);
+            if (x + 1 < levelData.width)
+                visit(i_block + 1);
+            if (y > 0)
+                visit(i_block - levelData.width);
+            if (y + 1 < levelData.height)
+                visit(i_block + levelData.width);
+        }
+    });
+
+    // Regions are numbered as they're first found, so numbering is deterministic and an unchanged room analyses to an equal result
+    const auto findRegion([&](Cell cell) -> index_t
+    {
+        for (index_t radius{}; radius <= arrivalSearchRadius; ++radius)
+            for (index_t y(cell.y - radius); y != cell.y + radius + 1; ++y)
+                for (index_t x(cell.x - radius); x != cell.x + radius + 1; ++x)
+                {
+                    if (x >= levelData.width || y >= levelData.height)
+                        continue;
+
+                    const index_t i_block(y * levelData.width + x);
+                    if (!passable[i_block])
+                        continue;
+
+                    if (regions[i_block] == npos)
+                        fill(i_block, ret.n_regions++);
+
+                    return regions[i_block];
+                }
+
+        return npos;
+    });
+
+    for (index_t y{}; y < levelData.height; ++y)
+        for (index_t x{}; x < levelData.width; ++x)
+        {
+            const index_t i_block(y * levelData.width + x);
+            const index_t i_door(levelData.bts[i_block]);
+            if (levelData.layer1[i_block] >> 12 != doorBlock || i_door >= std::size(data.doors) || !passable[i_block])
+                continue;
+
+            const index_t i_region(findRegion({x, y}));
+            std::vector<index_t>& doorRegions(ret.doorRegions[i_door]);
+            if (std::ranges::find(doorRegions, i_region) == std::end(doorRegions))
+                doorRegions.push_back(i_region);
+        }
+
+    for (const Plm& plm : data.plms)
+    {
+        if (plm.x >= levelData.width || plm.y >= levelData.height)
+            continue;
+
+        const index_t i_block(plm.y * levelData.width + plm.x);
+        const index_t i_door(levelData.bts[i_block]);
+        if (levelData.layer1[i_block] >> 12 == doorBlock && i_door < std::size(data.doors) && !canOpenDoorCap(plm.id, items))
+            ret.doorOpen[i_door] = false;
+    }
+
+    for (index_t i{}; i < std::size(data.incoming); ++i)
+        ret.arrivalRegions[i] = findRegion(data.incoming[i].arrival);
+
+    for (index_t i{}; i < std::size(data.items); ++i)
+        ret.itemRegions[i] = findRegion({data.items[i].x, data.items[i].y});
+
+    if (data.room.address == start.roomAddress)
+        ret.startRegion = findRegion({start.x, start.y});
+
+    return ret;
+}
+LOG_RETHROW
+
+void ReachabilitySolver::analyseRooms(std::span<const index_t> roomIndices_in)
+try
+{
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    std::for_each(std::execution::par, std::begin(roomIndices_in), std::end(roomIndices_in), [&](index_t i_room)
+    {
+        RoomData& data(rooms[i_room]);
+        try
+        {
+            data.analysis = analyse(data);
+        }
+        catch (const std::exception& e)
+        {
+            data.analysis = {};
+            data.analysis.doorRegions.resize(std::size(data.doors));
+            data.analysis.doorOpen.assign(std::size(data.doors), false);
+            data.analysis.arrivalRegions.assign(std::size(data.incoming), npos);
+            data.analysis.itemRegions.assign(std::size(data.items), npos);
+
+            const std::lock_guard lock(mutex);
+            errors.push_back("Room $"s + toHexString(data.room.address) + ": "s + e.what());
+        }
+    });
+
+    for (const std::string& error : errors)
+        DebugFile(DebugFile::warning) << LOG_INFO "Room analysis failed: "s << error << '\n';
+}
+LOG_RETHROW
+
+void ReachabilitySolver::propagate(std::span<const index_t> roomIndices_in)
+try
+{
+    // Rooms that aren't listed are never written, so both sets hold their solved words throughout
+    std::vector<std::uint64_t> current(reached), next(reached);
+    if (i_startRoom != npos)
+    {
+        const RoomData& data(rooms[i_startRoom]);
+        if (data.analysis.startRegion != npos)
+            current[data.i_word + data.analysis.startRegion / bitsPerWord] |= std::uint64_t(1) << data.analysis.startRegion % bitsPerWord;
+    }
+
+    // Regions are closed under movement within the room, so only doors propagate. Each iteration pulls in every room's regions that a reached door leads to,
+    // reading the previous iteration's set and writing only the room's own words, until nothing changes
+    for (n_iterations_ = 1;; ++n_iterations_)
+    {
+        std::atomic<bool> isChanged{};
+        std::for_each(std::execution::par, std::begin(roomIndices_in), std::end(roomIndices_in), [&](index_t i_room)
+        {
+            const RoomData& data(rooms[i_room]);
+            std::copy_n(std::begin(current) + data.i_word, countWords(data.analysis.n_regions), std::begin(next) + data.i_word);
+
+            bool isRoomChanged{};
+            for (index_t i{}; i < std::size(data.incoming); ++i)
+            {
+                const index_t i_region(data.analysis.arrivalRegions[i]);
+                if (i_region == npos)
+                    continue;
+
+                const index_t i_bit(data.i_word * bitsPerWord + i_region);
+                const std::uint64_t bit(std::uint64_t(1) << i_bit % bitsPerWord);
+                if (next[i_bit / bitsPerWord] & bit)
+                    continue;
+
+                const Incoming& incoming(data.incoming[i]);
+                const RoomData& source(rooms[incoming.i_room]);
+                if (!source.analysis.doorOpen[incoming.i_door])
+                    continue;
+
+                for (index_t i_sourceRegion : source.analysis.doorRegions[incoming.i_door])
+                {
+                    const index_t i_sourceBit(source.i_word * bitsPerWord + i_sourceRegion);
+                    if (current[i_sourceBit / bitsPerWord] >> i_sourceBit % bitsPerWord & 1)
+                    {
+                        next[i_bit / bitsPerWord] |= bit;
+                        isRoomChanged = true;
+                        break;
+                    }
+                }
+            }
+
+            if (isRoomChanged)
+                isChanged.store(true, std::memory_order_relaxed);
+        });
+
+        current.swap(next);
+        if (!isChanged)
+            break;
+    }
+
+    reached = std::move(current);
+}
+LOG_RETHROW
+
+void ReachabilitySolver::solve()
+try
+{
+    n_t n_words{};
+    for (RoomData& data : rooms)
+    {
+        data.i_word = n_words;
+        n_words += countWords(data.analysis.n_regions);
+    }
+
+    reached.assign(n_words, 0);
+    std::vector<index_t> allRooms(std::size(rooms));
+    std::iota(std::begin(allRooms), std::end(allRooms), index_t{});
+    propagate(allRooms);
+}
+LOG_RETHROW
+
+void ReachabilitySolver::resolveDownstream(std::span<const index_t> roomIndices_in)
+try
+{
+    // A room's regions only depend on the rooms with doors leading into it, so rooms that can't be reached through doors from the changed rooms keep their solution.
+    // The rest are cleared and solved again against it
+    std::vector<bool> isDirty(std::size(rooms));
+    std::vector<index_t> dirtyRooms, stack(std::begin(roomIndices_in), std::end(roomIndices_in));
+    while (!std::empty(stack))
+    {
+        const index_t i_room(stack.back());
+        stack.pop_back();
+        if (isDirty[i_room])
+            continue;
+
+        isDirty[i_room] = true;
+        dirtyRooms.push_back(i_room);
+        for (const Door& door : rooms[i_room].doors)
+            if (const auto it(roomIndices.find(door.destination)); it != std::end(roomIndices) && !isDirty[it->second])
+                stack.push_back(it->second);
+    }
+
+    for (index_t i_room : dirtyRooms)
+    {
+        const RoomData& data(rooms[i_room]);
+        std::fill_n(std::begin(reached) + data.i_word, countWords(data.analysis.n_regions), 0);
+    }
+
+    propagate(dirtyRooms);
+}
+LOG_RETHROW
+
+bool ReachabilitySolver::isReached(const RoomData& data, index_t i_region) const noexcept
+{
+    if (i_region == npos)
+        return false;
+
+    const index_t i_bit(data.i_word * bitsPerWord + i_region);
+    return reached[i_bit / bitsPerWord] >> i_bit % bitsPerWord & 1;
+}
+
+index_t ReachabilitySolver::findRoom(std::uint16_t roomAddress) const
+try
+{
+    const auto it(roomIndices.find(roomAddress));
+    if (it == std::end(roomIndices))
+        throw std::runtime_error(LOG_INFO "Room $"s + toHexString(roomAddress) + " isn't reachable through doors from the starting rooms"s);
+
+    return it->second;
+}
+LOG_RETHROW
+
+void ReachabilitySolver::setItems(ItemSet items_in)
+try
+{
+    items = items_in;
+    std::vector<index_t> allRooms(std::size(rooms));
+    std::iota(std::begin(allRooms), std::end(allRooms), index_t{});
+    analyseRooms(allRooms);
+    solve();
+}
+LOG_RETHROW
+
+bool ReachabilitySolver::updateRoom(const Rom& rom, std::uint16_t roomAddress)
+try
+{
+    const index_t i_room(findRoom(roomAddress));
+    RoomData& data(rooms[i_room]);
+
+    // Rooms the door list leads to, before and after the edit, have their arrival points change if the doors changed
+    std::set<index_t> affectedRooms{i_room};
+    const auto addDestinations([&]
+    {
+        for (const Door& door : data.doors)
+            if (const auto it(roomIndices.find(door.destination)); it != std::end(roomIndices))
+                affectedRooms.insert(it->second);
+    });
+
+    addDestinations();
+    const std::vector<Door> oldDoors(data.doors);
+    data.room = Room(rom, roomAddress);
+    try
+    {
+        loadRoom(rom, data);
+    }
+    catch (const std::exception& e)
+    {
+        DebugFile(DebugFile::warning) << LOG_INFO "Room excluded from reachability: $"s << toHexString(roomAddress) << ": "s << e.what() << '\n';
+    }
+
+    addDestinations();
+    const bool isDoorsChanged(oldDoors != data.doors);
+    if (isDoorsChanged)
+        linkDoors();
+    else
+        affectedRooms = {i_room};
+
+    std::vector<Analysis> oldAnalyses;
+    for (index_t i_affected : affectedRooms)
+        oldAnalyses.push_back(rooms[i_affected].analysis);
+
+    const std::vector<index_t> affected(std::begin(affectedRooms), std::end(affectedRooms));
+    analyseRooms(affected);
+
+    // With the doors changed, the rooms they led to and lead to have different incoming doors even if their regions didn't change
+    std::vector<index_t> changedRooms;
+    bool isLayoutChanged{};
+    for (index_t i{}; i < std::size(affected); ++i)
+    {
+        const Analysis& analysis(rooms[affected[i]].analysis);
+        if (isDoorsChanged || analysis != oldAnalyses[i])
+            changedRooms.push_back(affected[i]);
+
+        isLayoutChanged = isLayoutChanged || countWords(analysis.n_regions) != countWords(oldAnalyses[i].n_regions);
+    }
+
+    if (std::empty(changedRooms))
+        return false;
+
+    // Rooms' words would move, which touches every room's bits anyway
+    if (isLayoutChanged)
+        solve();
+    else
+        resolveDownstream(changedRooms);
+
+    return true;
+}
+LOG_RETHROW
+
+bool ReachabilitySolver::isRoomReachable(std::uint16_t roomAddress) const
+try
+{
+    const RoomData& data(rooms[findRoom(roomAddress)]);
+    for (index_t i_region{}; i_region < data.analysis.n_regions; ++i_region)
+        if (isReached(data, i_region))
+            return true;
+
+    return false;
+}
+LOG_RETHROW
+
+bool ReachabilitySolver::isDoorReachable(std::uint16_t roomAddress, index_t i_door) const
+try
+{
+    const RoomData& data(rooms[findRoom(roomAddress)]);
+    if (i_door >= std::size(data.doors))
+        throw std::runtime_error(LOG_INFO "Room $"s + toHexString(roomAddress) + " has no door "s + std::to_string(i_door));
+
+    return std::ranges::any_of(data.analysis.doorRegions[i_door], [&](index_t i_region){ return isReached(data, i_region); });
+}
+LOG_RETHROW
+
+bool ReachabilitySolver::isItemReachable(const ItemLocation& item) const
+try
+{
+    const RoomData& data(rooms[findRoom(item.roomAddress)]);
+    for (index_t i{}; i < std::size(data.items); ++i)
+        if (data.items[i].id == item.plmId && data.items[i].x == item.x && data.items[i].y == item.y)
+            return isReached(data, data.analysis.itemRegions[i]);
+
+    throw std::runtime_error(LOG_INFO "Room $"s + toHexString(item.roomAddress) + " has no item PLM $"s + toHexString(item.plmId) + " there"s);
+}
+LOG_RETHROW
+
+std::vector<std::uint16_t> ReachabilitySolver::reachableRooms() const
+try
+{
+    std::vector<std::uint16_t> ret;
+    for (const RoomData& data : rooms)
+        if (isRoomReachable(data.room.address))
+            ret.push_back(data.room.address);
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<ItemLocation> ReachabilitySolver::itemLocations() const
+try
+{
+    std::vector<ItemLocation> ret;
+    for (const RoomData& data : rooms)
+        for (const Plm& plm : data.items)
+            ret.push_back({data.room.address, plm.id, plm.x, plm.y});
+
+    return ret;
+}
+LOG_RETHROW
+
+n_t ReachabilitySolver::n_iterations() const noexcept
+{
+    return n_iterations_;
+}
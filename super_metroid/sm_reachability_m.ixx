@@ -0,0 +1,163 @@
+module;
+
+#include "../global.h"
+
+export module sm_reachability;
+
+export import sm_sprites;
+
+export enum class Item
+{
+    morphBall,
+    bombs,
+    springBall,
+    hiJumpBoots,
+    spaceJump,
+    screwAttack,
+    speedBooster,
+    grapplingBeam,
+    variaSuit,
+    gravitySuit,
+    chargeBeam,
+    iceBeam,
+    waveBeam,
+    spazerBeam,
+    plasmaBeam,
+    missiles,
+    superMissiles,
+    powerBombs,
+
+    n_items
+};
+
+export const n_t n_items(n_t(Item::n_items));
+
+export using ItemSet = std::bitset<n_items>;
+
+// Command line names, in `Item` order
+export const std::array<std::string_view, n_items> itemNames
+{
+    "morph"sv, "bombs"sv, "spring"sv, "hijump"sv, "space"sv, "screw"sv, "speed"sv, "grapple"sv, "varia"sv, "gravity"sv,
+    "charge"sv, "ice"sv, "wave"sv, "spazer"sv, "plasma"sv, "missiles"sv, "supers"sv, "powerbombs"sv
+};
+
+export std::optional<Item> findItem(std::string_view name) noexcept;
+
+// A position in blocks in a room
+export struct StartPosition
+{
+    std::uint16_t roomAddress;
+    index_t x, y;
+};
+
+// Where Samus leaves her ship
+export const StartPosition landingSite{0x91F8, 0x48, 0x47};
+
+// An item PLM, position in blocks
+export struct ItemLocation
+{
+    std::uint16_t roomAddress, plmId;
+    std::uint8_t x, y;
+};
+
+// Whole game connectivity under a fixed item set.
+// Each room's blocks are split into regions, the connected areas of blocks Samus can pass through with the items, and doors link a region of one room to a region of another.
+// This is connectivity rather than physics: gravity, jump heights, heat and liquids aren't modelled, so reachable is "not walled off" rather than "completable".
+// Items gate block types (bombable, power bomb, super missile and speed blocks, morph ball passages) and coloured door caps
+export class ReachabilitySolver
+{
+    static constexpr index_t npos{index_t(-1)};
+
+    struct Cell
+    {
+        index_t x, y;
+    };
+
+    // A door of another room leading into this one, and the block the door leads to
+    struct Incoming
+    {
+        index_t i_room, i_door;
+        Cell arrival;
+    };
+
+    // A room's connectivity under the item set. Regions are numbered locally to the room and only regions containing a door, arrival point, item or the start position are numbered
+    struct Analysis
+    {
+        n_t n_regions{};
+
+        // Indexed by door list index
+        std::vector<std::vector<index_t>> doorRegions;
+        std::vector<bool> doorOpen;
+
+        // Indexed as `RoomData::incoming` and `RoomData::items`, npos if the block isn't passable
+        std::vector<index_t> arrivalRegions, itemRegions;
+        index_t startRegion{npos};
+
+        bool operator==(const Analysis&) const = default;
+    };
+
+    struct RoomData
+    {
+        Room room;
+        std::vector<Door> doors;
+        std::pmr::vector<Plm> plms;
+        std::vector<Plm> items;
+
+        // Empty if the level data failed to load, the room then has no regions
+        std::optional<LevelData> levelData;
+
+        std::vector<Incoming> incoming;
+        Analysis analysis;
+
+        // First word of the room's regions in `reached`
+        index_t i_word{};
+
+        explicit RoomData(Room room);
+    };
+
+    ItemSet items;
+    StartPosition start;
+
+    std::vector<RoomData> rooms;
+    std::map<std::uint16_t, index_t> roomIndices;
+    index_t i_startRoom{npos};
+
+    // One bit per region, each room's regions starting on a word boundary so that rooms can be updated in parallel without sharing words
+    std::vector<std::uint64_t> reached;
+    n_t n_iterations_{};
+
+    void loadRoom(const Rom& rom, RoomData& data);
+    void linkDoors();
+    Analysis analyse(const RoomData& data) const;
+    void analyseRooms(std::span<const index_t> roomIndices);
+
+    // Iterates the listed rooms' regions to a fixed point starting from `reached`, the other rooms' regions are taken as already solved
+    void propagate(std::span<const index_t> roomIndices);
+    void solve();
+    void resolveDownstream(std::span<const index_t> roomIndices);
+
+    bool isReached(const RoomData& data, index_t i_region) const noexcept;
+    index_t findRoom(std::uint16_t roomAddress) const;
+
+public:
+    // Loads and analyses every room in parallel and solves
+    ReachabilitySolver(const Rom& rom, ItemSet items, StartPosition start = landingSite);
+
+    // Reanalyses every room under the new item set and solves again. Level data is kept, so this doesn't touch the ROM
+    void setItems(ItemSet items);
+
+    // Reloads one room after it's been edited and solves again if its connectivity changed.
+    // Only the room and the rooms its doors lead to, before or after the edit, are reanalysed, and only the rooms reachable through doors from those whose analysis changed are solved again.
+    // Everything is solved again if a room's region count crosses a word boundary. Returns whether anything was solved again
+    bool updateRoom(const Rom& rom, std::uint16_t roomAddress);
+
+    bool isRoomReachable(std::uint16_t roomAddress) const;
+    bool isDoorReachable(std::uint16_t roomAddress, index_t i_door) const;
+    bool isItemReachable(const ItemLocation& item) const;
+
+    std::vector<std::uint16_t> reachableRooms() const;
+    std::vector<ItemLocation> itemLocations() const;
+
+    // Number of fixed point iterations the last solve took
+    n_t n_iterations() const noexcept;
+};
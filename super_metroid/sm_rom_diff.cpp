@@ -0,0 +1,327 @@
+#include "../global.h"
+
+import sm_rom_diff;
+
+static const std::uint32_t
+    roomBank(0x8F0000),
+    enemyPopulationBank(0xA10000),
+    enemySetBank(0xB40000);
+
+static const n_t
+    enemyPopulationEntrySize(0x10),
+    enemySetEntrySize(4),
+    plmPopulationEntrySize(6),
+    maxEnemySetEntries(0x10);
+
+using ObjectKey = std::tuple<DataKind, std::uint16_t, index_t, index_t>;
+
+static RomRange snesRange(std::uint32_t address, n_t size)
+{
+    const index_t begin(Rom::snesToPc(address));
+    return {begin, begin + size};
+}
+
+static std::string snesAddressString(index_t address)
+try
+{
+    return "$"s + toHexString(Rom::pcToSnes(address), 3);
+}
+LOG_RETHROW
+
+static n_t totalSize(std::span<const RomRange> ranges) noexcept
+{
+    n_t ret{};
+    for (const RomRange& range : ranges)
+        ret += range.end - range.begin;
+
+    return ret;
+}
+
+static std::vector<std::uint8_t> concatenate(const Rom& rom, std::span<const RomRange> ranges)
+try
+{
+    const std::span<const std::uint8_t> bytes(rom.bytes());
+    std::vector<std::uint8_t> ret;
+    for (const RomRange& range : ranges)
+    {
+        if (range.end > std::size(bytes))
+            throw std::runtime_error(LOG_INFO "Range "s + toHexString(range.begin, 3) + " is past the end of the ROM"s);
+
+        ret.insert(std::end(ret), std::begin(bytes) + range.begin, std::begin(bytes) + range.end);
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::string describe(const DataObject& object)
+try
+{
+    const std::string room("Room $"s + toHexString(object.roomAddress));
+    const std::string state(room + " state "s + std::to_string(object.i_state));
+    const std::string tileset("Tileset "s + toHexString(object.i_tileset, 1));
+    switch (object.kind)
+    {
+    case DataKind::room:            return room + " header"s;
+    case DataKind::levelData:       return state + " level data"s;
+    case DataKind::enemyPopulation: return state + " enemy population"s;
+    case DataKind::enemySet:        return state + " enemy set"s;
+    case DataKind::plmPopulation:   return state + " PLM population"s;
+    case DataKind::commonTiles:     return "Common tiles"s;
+    case DataKind::commonTileTable: return "Common tile table"s;
+    case DataKind::tiles:           return tileset + " tiles"s;
+    case DataKind::tileTable:       return tileset + " tile table"s;
+    case DataKind::palette:         return tileset + " palette"s;
+    }
+
+    throw std::runtime_error(LOG_INFO "Unknown data kind "s + std::to_string(int(object.kind)));
+}
+LOG_RETHROW
+
+std::vector<DataObject> findDataObjects(const Rom& rom, AssetCache* p_cache)
+try
+{
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<std::vector<DataObject>> roomObjects(std::size(rooms));
+    std::vector<index_t> roomIndices(std::size(rooms));
+    std::iota(std::begin(roomIndices), std::end(roomIndices), 0);
+    std::for_each(std::execution::par, std::begin(roomIndices), std::end(roomIndices), [&](index_t i_room)
+    {
+        const Room& room(rooms[i_room]);
+        std::vector<DataObject>& objects(roomObjects[i_room]);
+        const auto add([&](DataKind kind, index_t i_state, const auto& findRanges)
+        {
+            DataObject object{kind, room.address, i_state, 0, {}};
+            try
+            {
+                object.ranges = findRanges();
+                objects.push_back(std::move(object));
+            }
+            catch (const std::exception& e)
+            {
+                DebugFile(DebugFile::warning) << LOG_INFO "Leaving out "s << describe(object) << ": "s << e.what() << '\n';
+            }
+        });
+
+        add(DataKind::room, 0, [&]()
+        {
+            return room.sources(rom);
+        });
+
+        for (index_t i_state{}; i_state < std::size(room.states); ++i_state)
+        {
+            const RoomState& state(room.states[i_state]);
+            add(DataKind::levelData, i_state, [&]()
+            {
+                return LevelData::findSource(rom, room, state, p_cache).ranges;
+            });
+
+            // Enemy populations end with FFFFh and a count of enemies to kill to open grey doors
+            add(DataKind::enemyPopulation, i_state, [&]()
+            {
+                return std::vector{snesRange(enemyPopulationBank | state.enemyPopulationPointer, std::size(loadEnemyPopulation(rom, state)) * enemyPopulationEntrySize + 3)};
+            });
+
+            if (state.enemyGraphicsPointer >= 0x8000)
+                add(DataKind::enemySet, i_state, [&]()
+                {
+                    const std::uint32_t address(enemySetBank | state.enemyGraphicsPointer);
+                    n_t n_entries{};
+                    while (n_entries < maxEnemySetEntries && rom.read16(address + std::uint32_t(n_entries * enemySetEntrySize)) != 0xFFFF)
+                        ++n_entries;
+
+                    return std::vector{snesRange(address, n_entries * enemySetEntrySize + 2)};
+                });
+
+            if (state.plmPopulationPointer >= 0x8000)
+                add(DataKind::plmPopulation, i_state, [&]()
+                {
+                    return std::vector{snesRange(roomBank | state.plmPopulationPointer, std::size(loadPlmPopulation(rom, state)) * plmPopulationEntrySize + 2)};
+                });
+        }
+    });
+
+    std::vector<DataObject> tilesetObjects;
+    for (index_t i_tileset{}; i_tileset < Tileset::n_tilesets; ++i_tileset)
+        try
+        {
+            const Tileset::Ranges ranges(Tileset::findRanges(rom, i_tileset, p_cache));
+            tilesetObjects.push_back({DataKind::commonTiles, 0, 0, 0, {ranges.creTiles}});
+            tilesetObjects.push_back({DataKind::commonTileTable, 0, 0, 0, {ranges.creTileTable}});
+            tilesetObjects.push_back({DataKind::tiles, 0, 0, i_tileset, {ranges.tiles, ranges.entry}});
+            tilesetObjects.push_back({DataKind::tileTable, 0, 0, i_tileset, {ranges.tileTable, ranges.entry}});
+            tilesetObjects.push_back({DataKind::palette, 0, 0, i_tileset, {ranges.palette, ranges.entry}});
+        }
+        catch (const std::exception& e)
+        {
+            DebugFile(DebugFile::warning) << LOG_INFO "Leaving out tileset "s << toHexString(i_tileset, 1) << ": "s << e.what() << '\n';
+        }
+
+    // Objects pointed to more than once are kept the first time
+    std::vector<DataObject> ret;
+    std::set<std::pair<DataKind, index_t>> seen;
+    const auto keep([&](DataObject& object)
+    {
+        if (seen.emplace(object.kind, object.ranges.front().begin).second)
+            ret.push_back(std::move(object));
+    });
+
+    for (std::vector<DataObject>& objects : roomObjects)
+        for (DataObject& object : objects)
+            keep(object);
+
+    for (DataObject& object : tilesetObjects)
+        keep(object);
+
+    return ret;
+}
+LOG_RETHROW
+
+std::string describe(const RomChange& change)
+try
+{
+    const std::string what(change.object ? describe(*change.object) : "Data"s);
+    const std::string at(" at "s + snesAddressString(change.range.begin));
+    switch (change.kind)
+    {
+    case ChangeKind::modified:
+        return "Modified "s + what + at + (change.oldAddress ? " (moved from "s + snesAddressString(*change.oldAddress) + ')' : ""s)
+            + ", "s + std::to_string(change.n_bytesChanged) + " bytes"s;
+
+    case ChangeKind::moved:
+        return "Moved "s + what + " from "s + snesAddressString(*change.oldAddress) + " to "s + snesAddressString(change.range.begin) + ", "s + std::to_string(change.n_bytesChanged) + " bytes"s;
+
+    case ChangeKind::added:
+        return "Added "s + what + at + ", "s + std::to_string(change.n_bytesChanged) + " bytes"s;
+
+    case ChangeKind::removed:
+        return "Removed "s + what + at + ", "s + std::to_string(change.n_bytesChanged) + " bytes"s;
+    }
+
+    throw std::runtime_error(LOG_INFO "Unknown change kind "s + std::to_string(int(change.kind)));
+}
+LOG_RETHROW
+
+// Adds the parts of `change` not in `covered` (sorted and merged) as changes without an object, as moves where they're in one of `moves`
+static void addUnmappedChanges(const RomRange& change, std::span<const RomRange> covered, std::span<const BlockMove> moves, n_t oldSize, n_t newSize, std::vector<RomChange>& out)
+try
+{
+    const auto addPiece([&](index_t begin, index_t end)
+    {
+        const auto addUnmoved([&](index_t begin, index_t end)
+        {
+            if (begin >= end)
+                return;
+
+            const ChangeKind kind(begin >= oldSize ? ChangeKind::added : begin >= newSize ? ChangeKind::removed : ChangeKind::modified);
+            out.push_back({kind, {}, {begin, end}, {}, end - begin});
+        });
+
+        auto it(std::ranges::upper_bound(moves, begin, {}, [](const BlockMove& move) { return move.to + move.size; }));
+        for (; it != std::end(moves) && it->to < end; ++it)
+        {
+            const index_t moveBegin(std::max(it->to, begin)), moveEnd(std::min(it->to + it->size, end));
+            addUnmoved(begin, moveBegin);
+            out.push_back({ChangeKind::moved, {}, {moveBegin, moveEnd}, it->from + (moveBegin - it->to), moveEnd - moveBegin});
+            begin = moveEnd;
+        }
+
+        addUnmoved(begin, end);
+    });
+
+    index_t begin(change.begin);
+    auto it(std::ranges::upper_bound(covered, begin, {}, &RomRange::end));
+    for (; it != std::end(covered) && it->begin < change.end; ++it)
+    {
+        if (begin < it->begin)
+            addPiece(begin, it->begin);
+
+        begin = std::max(begin, it->end);
+    }
+
+    if (begin < change.end)
+        addPiece(begin, change.end);
+}
+LOG_RETHROW
+
+std::vector<RomChange> diffRoms(const Rom& oldRom, const Rom& newRom, AssetCache* p_cache)
+try
+{
+    // The byte compare and finding each ROM's objects are independent
+    ByteDiff diff;
+    std::vector<DataObject> oldObjects, newObjects;
+    const std::function<void()> tasks[]
+    {
+        [&]() { diff = diffBytes(oldRom.bytes(), newRom.bytes()); },
+        [&]() { oldObjects = findDataObjects(oldRom, p_cache); },
+        [&]() { newObjects = findDataObjects(newRom, p_cache); }
+    };
+
+    std::for_each(std::execution::par, std::begin(tasks), std::end(tasks), [](const std::function<void()>& task)
+    {
+        task();
+    });
+
+    const auto key([](const DataObject& object)
+    {
+        return ObjectKey(object.kind, object.roomAddress, object.i_state, object.i_tileset);
+    });
+
+    std::map<ObjectKey, const DataObject*> unmatchedOldObjects;
+    for (const DataObject& object : oldObjects)
+        unmatchedOldObjects.emplace(key(object), &object);
+
+    // Bytes that changed as part of an object in either ROM are reported as that object's change. Old objects' ranges count so that data moving out of
+    // somewhere isn't also reported as a change to where it was
+    std::vector<RomChange> ret;
+    std::vector<RomRange> covered;
+    for (const DataObject& object : newObjects)
+    {
+        covered.insert(std::end(covered), std::begin(object.ranges), std::end(object.ranges));
+        const auto it(unmatchedOldObjects.find(key(object)));
+        if (it == std::end(unmatchedOldObjects))
+        {
+            ret.push_back({ChangeKind::added, object, object.ranges.front(), {}, totalSize(object.ranges)});
+            continue;
+        }
+
+        const DataObject& oldObject(*it->second);
+        unmatchedOldObjects.erase(it);
+        covered.insert(std::end(covered), std::begin(oldObject.ranges), std::end(oldObject.ranges));
+        if (oldObject.ranges == object.ranges)
+        {
+            n_t n_bytesChanged{};
+            for (const RomRange& range : object.ranges)
+                n_bytesChanged += overlapSize(diff.changes, range);
+
+            if (n_bytesChanged)
+                ret.push_back({ChangeKind::modified, object, object.ranges.front(), {}, n_bytesChanged});
+        }
+        else
+        {
+            const bool isSame(concatenate(oldRom, oldObject.ranges) == concatenate(newRom, object.ranges));
+            ret.push_back({isSame ? ChangeKind::moved : ChangeKind::modified, object, object.ranges.front(), oldObject.ranges.front().begin, totalSize(object.ranges)});
+        }
+    }
+
+    for (const auto& [objectKey, p_object] : unmatchedOldObjects)
+    {
+        covered.insert(std::end(covered), std::begin(p_object->ranges), std::end(p_object->ranges));
+        ret.push_back({ChangeKind::removed, *p_object, p_object->ranges.front(), {}, totalSize(p_object->ranges)});
+    }
+
+    std::ranges::sort(covered, {}, &RomRange::begin);
+    std::vector<RomRange> mergedCovered;
+    for (const RomRange& range : covered)
+        if (!std::empty(mergedCovered) && range.begin <= mergedCovered.back().end)
+            mergedCovered.back().end = std::max(mergedCovered.back().end, range.end);
+        else
+            mergedCovered.push_back(range);
+
+    for (const RomRange& change : diff.changes)
+        addUnmappedChanges(change, mergedCovered, diff.moves, std::size(oldRom.bytes()), std::size(newRom.bytes()), ret);
+
+    std::ranges::stable_sort(ret, {}, [](const RomChange& change) { return change.range.begin; });
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,69 @@
+module;
+
+#include "../global.h"
+
+export module sm_rom_diff;
+
+export import rom_diff;
+export import sm_sprites;
+export import sm_tileset;
+
+export enum class DataKind
+{
+    room, // Room header, state headers, door list and doors
+    levelData,
+    enemyPopulation,
+    enemySet,
+    plmPopulation,
+    commonTiles,
+    commonTileTable,
+    tiles,
+    tileTable,
+    palette
+};
+
+// Something the game reads from the ROM, found through the pointer tables. Data that several rooms, states or tilesets point to is one object,
+// identified by the first room and state (in room address order) or the first tileset that points to it
+export struct DataObject
+{
+    DataKind kind;
+    std::uint16_t roomAddress;
+    index_t i_state, i_tileset;
+
+    // The main one (the room header, the compressed data) first
+    std::vector<RomRange> ranges;
+};
+
+export std::string describe(const DataObject& object);
+
+// Everything found from the rooms `findRooms` finds and the tileset table. Objects that fail to load are logged and left out
+export std::vector<DataObject> findDataObjects(const Rom& rom, AssetCache* p_cache = nullptr);
+
+export enum class ChangeKind
+{
+    modified,
+    moved, // The same bytes at a different address
+    added,
+    removed
+};
+
+export struct RomChange
+{
+    ChangeKind kind;
+
+    // Unset for changes to bytes that aren't part of anything found through the pointer tables
+    std::optional<DataObject> object;
+
+    // Where the change is in the new ROM, or the old ROM for removed data. The object's main range if it has an object
+    RomRange range;
+
+    // Where the data was in the old ROM, if it's moved
+    std::optional<index_t> oldAddress;
+
+    n_t n_bytesChanged;
+};
+
+export std::string describe(const RomChange& change);
+
+// What changed from `oldRom` to `newRom`, ordered by address, for reviewing a hack update
+export std::vector<RomChange> diffRoms(const Rom& oldRom, const Rom& newRom, AssetCache* p_cache = nullptr);
@@ -0,0 +1,403 @@
+#include "../global.h"
+
+import sm_room;
+
+import address_mapping;
+
+static const std::uint32_t
+    roomBank(0x8F0000),
+    doorBank(0x830000);
+
+static const std::uint16_t startingRooms[]
+{
+    0x91F8, // Landing Site
+    0xDF45  // Ceres elevator
+};
+
+static const n_t
+    maxScreens(50), // Size of the level data buffers in RAM
+    maxDoors(0x40),
+    doorSize(12);
+
+RoomState::RoomState(const Rom& rom, std::uint16_t address, std::uint16_t condition)
+try
+    : RoomState(valueOrThrow(tryLoad(rom, address, condition)))
+{
+}
+LOG_RETHROW
+
+Result<RoomState> RoomState::tryLoad(const Rom& rom, std::uint16_t address, std::uint16_t condition) noexcept
+{
+    const n_t stateSize(26);
+    const Result<std::span<const std::uint8_t>> bytes(rom.trySpanFrom(roomBank | address));
+    if (!bytes)
+        return std::unexpected(bytes.error());
+
+    if (std::size(*bytes) < stateSize)
+        return makeError(ErrorCode::readOverrun, roomBank | address, stateSize);
+
+    const std::span<const std::uint8_t> data(*bytes);
+    const auto read16([&](index_t i) -> std::uint16_t
+    {
+        return std::uint16_t(data[i] | data[i + 1] << 8);
+    });
+
+    RoomState ret;
+    ret.address = address;
+    ret.condition = condition;
+    ret.levelDataPointer = std::uint32_t(data[0] | data[1] << 8 | data[2] << 16);
+    ret.i_tileset = data[3];
+    ret.i_music = data[4];
+    ret.musicTrack = data[5];
+    ret.fxPointer = read16(6);
+    ret.enemyPopulationPointer = read16(8);
+    ret.enemyGraphicsPointer = read16(10);
+    ret.layer2ScrollX = data[12];
+    ret.layer2ScrollY = data[13];
+    ret.scrollPointer = read16(14);
+    ret.specialXrayPointer = read16(16);
+    ret.mainAsmPointer = read16(18);
+    ret.plmPopulationPointer = read16(20);
+    ret.libraryBackgroundPointer = read16(22);
+    ret.setupAsmPointer = read16(24);
+    return ret;
+}
+
+bool Room::isValid(const Rom& rom, std::uint16_t address) noexcept
+{
+    // Called for every door of every room a scan finds, so bad pointers are handled without exceptions
+    if (address < 0x8000)
+        return false;
+
+    const Result<std::span<const std::uint8_t>> data(rom.trySpanFrom(roomBank | address));
+    if (!data || std::size(*data) < 11)
+        return false;
+
+    const unsigned i_area((*data)[1]), width((*data)[4]), height((*data)[5]);
+    return i_area < 8 && width && height && width * height <= maxScreens;
+}
+
+Room::Room(const Rom& rom, std::uint16_t address)
+try
+    : Room(valueOrThrow(tryLoad(rom, address)))
+{
+}
+LOG_RETHROW
+
+Result<Room> Room::tryLoad(const Rom& rom, std::uint16_t address)
+try
+{
+    if (!isValid(rom, address))
+        return makeError(ErrorCode::invalidRoomHeader, roomBank | address);
+
+    const std::span<const std::uint8_t> data(*rom.trySpanFrom(roomBank | address));
+    Room ret;
+    ret.address = address;
+    ret.i_room = data[0];
+    ret.i_area = data[1];
+    ret.mapX = data[2];
+    ret.mapY = data[3];
+    ret.width = data[4];
+    ret.height = data[5];
+    ret.upScroller = data[6];
+    ret.downScroller = data[7];
+    ret.creFlags = data[8];
+    ret.doorListPointer = std::uint16_t(data[9] | data[10] << 8);
+
+    // State conditions are a condition ASM pointer, its arguments and a state pointer, terminated by the default condition with the default state following it
+    std::uint16_t i_condition(std::uint16_t(address + 11));
+    for (;;)
+    {
+        const Result<std::uint16_t> condition(rom.tryRead16(roomBank | i_condition));
+        if (!condition)
+            return std::unexpected(condition.error());
+
+        i_condition += 2;
+        if (*condition == defaultStateCondition)
+        {
+            const Result<RoomState> state(RoomState::tryLoad(rom, i_condition, *condition));
+            if (!state)
+                return std::unexpected(state.error());
+
+            ret.states.push_back(*state);
+            break;
+        }
+
+        switch (*condition)
+        {
+        default:
+            return makeError(ErrorCode::unknownStateCondition, roomBank | address, *condition);
+
+        case 0xE5FF: // Main area boss is dead
+        case 0xE640: // Morph ball
+        case 0xE652: // Morph ball and missiles
+        case 0xE669: // Power bombs
+        case 0xE678: // Speed booster
+            break;
+
+        case 0xE612: // Event
+        case 0xE629: // Boss
+            i_condition += 1;
+            break;
+
+        case 0xE5EB: // Door
+            i_condition += 2;
+            break;
+        }
+
+        const Result<std::uint16_t> statePointer(rom.tryRead16(roomBank | i_condition));
+        if (!statePointer)
+            return std::unexpected(statePointer.error());
+
+        i_condition += 2;
+        const Result<RoomState> state(RoomState::tryLoad(rom, *statePointer, *condition));
+        if (!state)
+            return std::unexpected(state.error());
+
+        ret.states.push_back(*state);
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+const RoomState& Room::defaultState() const
+try
+{
+    return states.back();
+}
+LOG_RETHROW
+
+std::vector<Door> Room::loadDoors(const Rom& rom) const
+try
+{
+    // The door list has no terminator; it's followed by unrelated data, so stop at the first entry that isn't a plausible door.
+    // That includes entries that can't be read, which are routine in hacks, so they're handled without exceptions
+    std::vector<Door> ret;
+    for (index_t i_door{}; i_door < maxDoors; ++i_door)
+    {
+        const Result<std::uint16_t> doorPointer(rom.tryRead16(roomBank | std::uint16_t(doorListPointer + i_door * 2)));
+        if (!doorPointer || *doorPointer < 0x8000)
+            break;
+
+        const Result<std::span<const std::uint8_t>> data(rom.trySpanFrom(doorBank | *doorPointer));
+        if (!data || std::size(*data) < doorSize)
+            break;
+
+        const std::span<const std::uint8_t> door(*data);
+        const std::uint16_t destination(std::uint16_t(door[0] | door[1] << 8));
+        if (destination != 0 && !isValid(rom, destination))
+            break;
+
+        ret.push_back
+        ({
+            *doorPointer, destination,
+            door[2], door[3], door[4], door[5], door[6], door[7],
+            std::uint16_t(door[8] | door[9] << 8), std::uint16_t(door[0xA] | door[0xB] << 8)
+        });
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<RomRange> Room::sources(const Rom& rom) const
+try
+{
+    // Translated as one batch, as this runs for every room whenever the ROM is reloaded or diffed
+    const n_t stateSize(26);
+    std::vector<std::uint32_t> addresses;
+    std::vector<n_t> sizes;
+    const auto add([&](std::uint32_t address, n_t size)
+    {
+        addresses.push_back(address);
+        sizes.push_back(size);
+    });
+
+    // The header and state conditions run up to the default state
+    add(roomBank | address, defaultState().address + stateSize - address);
+    for (const RoomState& state : states)
+        add(roomBank | state.address, stateSize);
+
+    // Including the entry after the last door, which would become a door if it were changed to point to one
+    const std::vector<Door> doors(loadDoors(rom));
+    add(roomBank | doorListPointer, (std::size(doors) + 1) * 2);
+    for (const Door& door : doors)
+        add(doorBank | door.address, doorSize);
+
+    std::vector<index_t> begins(std::size(addresses));
+    std::vector<std::uint64_t> invalid(invalidMaskSize(std::size(addresses)));
+    LoRomMapping::toPc(addresses, begins, invalid, std::size(rom.bytes()));
+
+    std::vector<RomRange> ret;
+    for (index_t i{}; i < std::size(addresses); ++i)
+    {
+        if (invalid[i / 0x40] >> i % 0x40 & 1)
+            throw std::runtime_error(LOG_INFO "Room $"s + toHexString(address) + " data at $"s + toHexString(addresses[i], 3) + " is outside the ROM"s);
+
+        ret.push_back({begins[i], begins[i] + sizes[i]});
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<std::uint16_t> Room::findDoorDestinations(const Rom& rom) const
+try
+{
+    std::vector<std::uint16_t> ret;
+    for (const Door& door : loadDoors(rom))
+        if (door.destination != 0)
+            ret.push_back(door.destination);
+
+    return ret;
+}
+LOG_RETHROW
+
+// Little endian blocks
+static void readBlocks(std::span<const std::uint8_t> data, n_t n_blocks, std::pmr::vector<std::uint16_t>& out)
+{
+    out.resize(n_blocks);
+    for (index_t i{}; i < n_blocks; ++i)
+        out[i] = std::uint16_t(data[i * 2] | data[i * 2 + 1] << 8);
+}
+
+LevelData::LevelData(const Rom& rom, const Room& room, const RoomState& state, AssetCache* p_cache, std::pmr::memory_resource* p_memory)
+try
+    : width(room.width * screenSize), height(room.height * screenSize), layer1(p_memory), bts(p_memory), layer2(p_memory)
+{
+    // Level data is the layer 1 size in bytes, layer 1 blocks, one BTS byte per block, and optionally layer 2 blocks
+    std::vector<std::uint8_t> storage;
+    const CachedAsset decompressed(decompress(p_cache, rom.spanFrom(state.levelDataPointer), storage));
+    const std::span<const std::uint8_t> data(decompressed.data);
+    compressedSize = decompressed.compressedSize;
+    source.begin = Rom::snesToPc(state.levelDataPointer);
+    source.end = source.begin + compressedSize;
+
+    const n_t n_blocks(width * height);
+    if (std::size(data) < 2 + n_blocks * 3)
+        throw std::runtime_error(LOG_INFO "Level data at $"s + toHexString(state.levelDataPointer, 3) + " is too small for room $"s + toHexString(room.address));
+
+    readBlocks(data.subspan(2), n_blocks, layer1);
+    bts.assign(std::begin(data) + 2 + n_blocks * 2, std::begin(data) + 2 + n_blocks * 3);
+    if (std::size(data) >= 2 + n_blocks * 5)
+        readBlocks(data.subspan(2 + n_blocks * 3), n_blocks, layer2);
+}
+LOG_RETHROW
+
+LevelData::LevelData(n_t width_in, n_t height_in, std::span<const std::uint8_t> layer1_in, std::span<const std::uint8_t> bts_in, std::span<const std::uint8_t> layer2_in, std::pmr::memory_resource* p_memory)
+try
+    : width(width_in), height(height_in), layer1(p_memory), bts(p_memory), layer2(p_memory), compressedSize{}, source{}
+{
+    const n_t n_blocks(width * height);
+    if (std::size(layer1_in) < n_blocks * 2 || std::size(bts_in) < n_blocks || (!std::empty(layer2_in) && std::size(layer2_in) < n_blocks * 2))
+        throw std::runtime_error(LOG_INFO "Level data is too small for a "s + std::to_string(width) + "x"s + std::to_string(height) + " block room"s);
+
+    readBlocks(layer1_in, n_blocks, layer1);
+    bts.assign(std::begin(bts_in), std::begin(bts_in) + n_blocks);
+    if (!std::empty(layer2_in))
+        readBlocks(layer2_in, n_blocks, layer2);
+}
+LOG_RETHROW
+
+Result<LevelData> LevelData::tryLoad(const Rom& rom, const Room& room, const RoomState& state, std::pmr::memory_resource* p_memory)
+try
+{
+    const Result<std::span<const std::uint8_t>> compressed(rom.trySpanFrom(state.levelDataPointer));
+    if (!compressed)
+        return std::unexpected(compressed.error());
+
+    const Result<Decompressed> decompressed(tryDecompress(*compressed));
+    if (!decompressed)
+        return std::unexpected(decompressed.error());
+
+    const n_t width(room.width * screenSize), height(room.height * screenSize), n_blocks(width * height);
+    const std::span<const std::uint8_t> data(decompressed->data);
+    if (std::size(data) < 2 + n_blocks * 3)
+        return makeError(ErrorCode::levelDataTooSmall, state.levelDataPointer, room.address);
+
+    const std::span<const std::uint8_t> layer2(std::size(data) >= 2 + n_blocks * 5 ? data.subspan(2 + n_blocks * 3, n_blocks * 2) : std::span<const std::uint8_t>());
+    LevelData ret(width, height, data.subspan(2, n_blocks * 2), data.subspan(2 + n_blocks * 2, n_blocks), layer2, p_memory);
+    ret.compressedSize = decompressed->compressedSize;
+    ret.source.begin = Rom::snesToPc(state.levelDataPointer);
+    ret.source.end = ret.source.begin + ret.compressedSize;
+    return ret;
+}
+LOG_RETHROW
+
+AssetSource LevelData::findSource(const Rom& rom, const Room& room, const RoomState& state, AssetCache* p_cache)
+try
+{
+    std::vector<std::uint8_t> storage;
+    const n_t compressedSize(decompress(p_cache, rom.spanFrom(state.levelDataPointer), storage).compressedSize);
+    const index_t i_begin(Rom::snesToPc(state.levelDataPointer));
+
+    std::uint64_t hash(hashBytes(rom.spanFrom(state.levelDataPointer).first(compressedSize)));
+    hash = combineHashes(hash, i_begin);
+    hash = combineHashes(hash, room.width << 8 | room.height);
+    return {hash, {{i_begin, i_begin + compressedSize}}};
+}
+LOG_RETHROW
+
+std::vector<std::uint8_t> LevelData::toBytes() const
+try
+{
+    const n_t layer1Size(std::size(layer1) * 2);
+    std::vector<std::uint8_t> ret{std::uint8_t(layer1Size), std::uint8_t(layer1Size >> 8)};
+    ret.reserve(2 + layer1Size + std::size(bts) + std::size(layer2) * 2);
+
+    const auto writeBlocks([&](std::span<const std::uint16_t> blocks)
+    {
+        for (std::uint16_t block : blocks)
+        {
+            ret.push_back(std::uint8_t(block));
+            ret.push_back(std::uint8_t(block >> 8));
+        }
+    });
+
+    writeBlocks(layer1);
+    ret.insert(std::end(ret), std::begin(bts), std::end(bts));
+    writeBlocks(layer2);
+    return ret;
+}
+LOG_RETHROW
+
+std::vector<Room> findRooms(const Rom& rom, n_t* p_n_failed)
+try
+{
+    std::set<std::uint16_t> found(std::begin(startingRooms), std::end(startingRooms));
+    std::vector<std::uint16_t> pending(std::begin(startingRooms), std::end(startingRooms));
+    std::vector<Room> ret;
+    std::vector<Error> errors;
+    while (!std::empty(pending))
+    {
+        Result<Room> room(Room::tryLoad(rom, pending.back()));
+        pending.pop_back();
+        if (!room)
+        {
+            errors.push_back(room.error());
+            continue;
+        }
+
+        for (std::uint16_t destination : room->findDoorDestinations(rom))
+            if (found.insert(destination).second)
+                pending.push_back(destination);
+
+        ret.push_back(*std::move(room));
+    }
+
+    // One debug file for all of them, a corrupt ROM can have an error per room
+    if (!std::empty(errors))
+    {
+        DebugFile debugFile(DebugFile::warning);
+        for (const Error& error : errors)
+            debugFile << LOG_INFO "Room left out of scan: "s << error.message() << '\n';
+    }
+
+    if (p_n_failed)
+        *p_n_failed = std::size(errors);
+
+    std::ranges::sort(ret, {}, &Room::address);
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,121 @@
+module;
+
+#include "../global.h"
+
+export module sm_room;
+
+export import asset_cache;
+export import memory_accounting;
+export import shared_assets;
+export import rom;
+
+export const n_t
+    screenSize{0x10}, // In blocks
+    blockSize{0x10}; // In pixels
+
+export struct RoomState
+{
+    // State data is in bank $8F
+    std::uint16_t address;
+
+    // The state condition ASM that selects this state, the default state's is $E5E6
+    std::uint16_t condition;
+
+    std::uint32_t levelDataPointer;
+    std::uint8_t i_tileset, i_music, musicTrack;
+    std::uint16_t fxPointer, enemyPopulationPointer, enemyGraphicsPointer;
+    std::uint8_t layer2ScrollX, layer2ScrollY;
+    std::uint16_t scrollPointer, specialXrayPointer, mainAsmPointer, plmPopulationPointer, libraryBackgroundPointer, setupAsmPointer;
+
+    RoomState(const Rom& rom, std::uint16_t address, std::uint16_t condition);
+
+    // As the constructor, returning errors rather than throwing them
+    static Result<RoomState> tryLoad(const Rom& rom, std::uint16_t address, std::uint16_t condition) noexcept;
+
+private:
+    RoomState() = default;
+};
+
+// Door data is in bank $83. The door cap position is in blocks in the destination room, the screen is the destination screen Samus arrives in
+export struct Door
+{
+    std::uint16_t address, destination;
+    std::uint8_t bitflag, direction, capX, capY, screenX, screenY;
+    std::uint16_t spawnDistance, asmPointer;
+
+    bool operator==(const Door&) const = default;
+};
+
+export struct Room
+{
+    const static std::uint16_t defaultStateCondition{0xE5E6};
+
+    // Room headers are in bank $8F
+    std::uint16_t address;
+
+    std::uint8_t i_room, i_area, mapX, mapY, width, height, upScroller, downScroller, creFlags;
+    std::uint16_t doorListPointer;
+
+    // In the order the game evaluates them, so the default state is last
+    std::vector<RoomState> states;
+
+    Room(const Rom& rom, std::uint16_t address);
+
+    // As the constructor, returning errors rather than throwing them, for scans over every room of ROMs that may be corrupt or use custom state conditions
+    static Result<Room> tryLoad(const Rom& rom, std::uint16_t address);
+
+    // Only checks the header, the state list can still fail to load
+    static bool isValid(const Rom& rom, std::uint16_t address) noexcept;
+
+    const RoomState& defaultState() const;
+
+    // The room's door list, in order, so that the index of a door is the BTS of its door blocks. Elevator pads have a destination of zero
+    std::vector<Door> loadDoors(const Rom& rom) const;
+
+    // Destination rooms of the room's doors, excluding elevator pads with no destination
+    std::vector<std::uint16_t> findDoorDestinations(const Rom& rom) const;
+
+    // The ROM bytes the room header, states, door list and doors are read from, for invalidating things built from them when the ROM is reloaded
+    std::vector<RomRange> sources(const Rom& rom) const;
+
+private:
+    Room() = default;
+};
+
+// Decompressed level data. Blocks are ttttyxmm mmmmmmmm (block type, flip, metatile number)
+export struct LevelData
+{
+    // In blocks
+    n_t width, height;
+
+    std::pmr::vector<std::uint16_t> layer1;
+    std::pmr::vector<std::uint8_t> bts;
+
+    // Empty if the room uses a library background
+    std::pmr::vector<std::uint16_t> layer2;
+
+    // Size of the level data in the ROM, which is the space available to write it back to
+    n_t compressedSize;
+
+    // The compressed level data in the ROM
+    RomRange source;
+
+    // Decompresses through `p_cache` if given
+    LevelData(const Rom& rom, const Room& room, const RoomState& state, AssetCache* p_cache = nullptr, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::rooms));
+
+    // From little endian blocks, as laid out in RAM. `layer2` may be empty. Not from the ROM, so the compressed size and source are zero
+    LevelData(n_t width, n_t height, std::span<const std::uint8_t> layer1, std::span<const std::uint8_t> bts, std::span<const std::uint8_t> layer2, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::rooms));
+
+    // As the ROM constructor without a cache, returning errors rather than throwing them, for scans over every room of ROMs that may be corrupt
+    static Result<LevelData> tryLoad(const Rom& rom, const Room& room, const RoomState& state, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::rooms));
+
+    // For sharing level data between ROMs. Hashes the compressed level data, its address and the room size, so that rooms sharing level data are the same in every field
+    static AssetSource findSource(const Rom& rom, const Room& room, const RoomState& state, AssetCache* p_cache = nullptr);
+
+    // The uncompressed level data format read by the constructor
+    std::vector<std::uint8_t> toBytes() const;
+};
+
+// Finds every room reachable through doors from the game's starting rooms (Landing Site and Ceres), ordered by address.
+// Rooms that fail to load are left out along with anything only reachable through them, they're logged once and counted in `p_n_failed` if given
+export std::vector<Room> findRooms(const Rom& rom, n_t* p_n_failed = nullptr);
@@ -0,0 +1,114 @@
+#include "../global.h"
+
+import sm_room_objects;
+
+static const std::uint32_t enemyHeaderBank(0xA00000);
+
+// Enemy header fields, offsets into the header
+static const index_t
+    enemyRadiusXOffset(8),
+    enemyRadiusYOffset(0xA);
+
+static const n_t screenSizePixels(screenSize * blockSize);
+
+Rect RoomObjects::enemyRect(const Enemy& enemy, std::pair<n_t, n_t> radius) noexcept
+{
+    // Enemy positions are the centre of the hitbox
+    const auto [x_radius, y_radius](radius);
+    return {std::ptrdiff_t(enemy.x) - std::ptrdiff_t(x_radius), std::ptrdiff_t(enemy.y) - std::ptrdiff_t(y_radius), x_radius * 2, y_radius * 2};
+}
+
+Rect RoomObjects::plmRect(std::uint8_t x, std::uint8_t y) noexcept
+{
+    return {std::ptrdiff_t(x * blockSize), std::ptrdiff_t(y * blockSize), blockSize, blockSize};
+}
+
+RoomObjects::RoomObjects(const Rom& rom, const Room& room, std::span<const Enemy> enemies, std::span<const Plm> plms)
+try
+    : index(room.width * screenSizePixels, room.height * screenSizePixels)
+{
+    // Inserted bottom to top, the index puts later insertions on top
+    for (index_t y{}; y < room.height; ++y)
+        for (index_t x{}; x < room.width; ++x)
+        {
+            index.insert({std::ptrdiff_t(x * screenSizePixels), std::ptrdiff_t(y * screenSizePixels), screenSizePixels, screenSizePixels});
+            objects.push_back({RoomObjectType::scrollRegion, y * room.width + x});
+        }
+
+    for (index_t i_plm{}; i_plm < std::size(plms); ++i_plm)
+    {
+        const Plm& plm(plms[i_plm]);
+        plmIds.push_back(index.insert(plmRect(plm.x, plm.y)));
+        objects.push_back({isDoorCapPlm(plm.id) ? RoomObjectType::doorCap : RoomObjectType::plm, i_plm});
+    }
+
+    for (index_t i_enemy{}; i_enemy < std::size(enemies); ++i_enemy)
+    {
+        const Enemy& enemy(enemies[i_enemy]);
+        const std::uint32_t header(enemyHeaderBank | enemy.id);
+        const std::pair<n_t, n_t> radius(std::max<n_t>(rom.read16(header + enemyRadiusXOffset), 1), std::max<n_t>(rom.read16(header + enemyRadiusYOffset), 1));
+        enemyRadii.push_back(radius);
+        enemyIds.push_back(index.insert(enemyRect(enemy, radius)));
+        objects.push_back({RoomObjectType::enemy, i_enemy});
+    }
+}
+LOG_RETHROW
+
+std::optional<RoomObject> RoomObjects::hitTest(std::ptrdiff_t x, std::ptrdiff_t y) const
+try
+{
+    const std::optional<index_t> id(index.hitTest(x, y));
+    if (!id)
+        return {};
+
+    return objects[*id];
+}
+LOG_RETHROW
+
+std::vector<RoomObject> RoomObjects::select(const Rect& rect, bool includeScrollRegions) const
+try
+{
+    index.query(rect, queryResults);
+
+    std::vector<RoomObject> ret;
+    for (index_t id : queryResults)
+        if (includeScrollRegions || objects[id].type != RoomObjectType::scrollRegion)
+            ret.push_back(objects[id]);
+
+    return ret;
+}
+LOG_RETHROW
+
+Rect RoomObjects::bounds(const RoomObject& object) const
+try
+{
+    switch (object.type)
+    {
+    case RoomObjectType::enemy:
+        return index.rect(enemyIds.at(object.i_object));
+
+    case RoomObjectType::plm:
+    case RoomObjectType::doorCap:
+        return index.rect(plmIds.at(object.i_object));
+
+    case RoomObjectType::scrollRegion:
+        return index.rect(object.i_object);
+    }
+
+    throw std::runtime_error(LOG_INFO "Unknown room object type "s + std::to_string(int(object.type)));
+}
+LOG_RETHROW
+
+void RoomObjects::moveEnemy(index_t i_enemy, const Enemy& enemy)
+try
+{
+    index.move(enemyIds.at(i_enemy), enemyRect(enemy, enemyRadii.at(i_enemy)));
+}
+LOG_RETHROW
+
+void RoomObjects::movePlm(index_t i_plm, const Plm& plm)
+try
+{
+    index.move(plmIds.at(i_plm), plmRect(plm.x, plm.y));
+}
+LOG_RETHROW
@@ -0,0 +1,61 @@
+module;
+
+#include "../global.h"
+
+export module sm_room_objects;
+
+export import sm_sprites;
+export import spatial_index;
+
+export enum class RoomObjectType
+{
+    scrollRegion,
+    plm,
+    doorCap,
+    enemy
+};
+
+// `i_object` indexes the room's enemy or PLM population, or is the screen index (y * room width + x) of a scroll region
+export struct RoomObject
+{
+    RoomObjectType type;
+    index_t i_object;
+
+    bool operator==(const RoomObject&) const = default;
+};
+
+// Hit testing over a room's objects in room pixel coordinates, for hover and selection.
+// Scroll regions are at the bottom, then PLMs and door caps, then enemies on top, as they're drawn
+export class RoomObjects
+{
+    SpatialIndex index;
+
+    // Indexed by spatial index ID
+    std::vector<RoomObject> objects;
+
+    std::vector<index_t> enemyIds, plmIds;
+
+    // Enemy hitbox radii from the enemy headers, in pixels
+    std::vector<std::pair<n_t, n_t>> enemyRadii;
+
+    // Reused between queries so that hovering doesn't allocate
+    mutable std::vector<index_t> queryResults;
+
+    static Rect enemyRect(const Enemy& enemy, std::pair<n_t, n_t> radius) noexcept;
+    static Rect plmRect(std::uint8_t x, std::uint8_t y) noexcept;
+
+public:
+    RoomObjects(const Rom& rom, const Room& room, std::span<const Enemy> enemies, std::span<const Plm> plms);
+
+    // Topmost object under the point
+    std::optional<RoomObject> hitTest(std::ptrdiff_t x, std::ptrdiff_t y) const;
+
+    // Objects intersecting the rectangle, topmost first. Scroll regions are left out unless `includeScrollRegions`, as they'd cover any rubber band selection
+    std::vector<RoomObject> select(const Rect& rect, bool includeScrollRegions = false) const;
+
+    Rect bounds(const RoomObject& object) const;
+
+    // Updates an object's position after it's been moved in the editor. Positions are as in the population data
+    void moveEnemy(index_t i_enemy, const Enemy& enemy);
+    void movePlm(index_t i_plm, const Plm& plm);
+};
@@ -0,0 +1,319 @@
+#include "../global.h"
+
+import sm_sprites;
+
+import snes_graphics;
+
+static const std::uint32_t
+    roomBank(0x8F0000),
+    enemyHeaderBank(0xA00000),
+    enemyPopulationBank(0xA10000);
+
+static const n_t
+    maxEnemies(0x20), // Enemy RAM slots
+    maxPlms(0x28), // PLM RAM slots
+    enemyPopulationEntrySize(0x10),
+    plmPopulationEntrySize(6),
+    maxEnemyTileDataSize(0x2000),
+    maxSpritemapEntries(0x80),
+    initAiScanSize(0x100);
+
+// Enemy header fields, offsets into the header
+static const index_t
+    enemyTileDataSizeOffset(0),
+    enemyPaletteOffset(2),
+    enemyBankOffset(0xC),
+    enemyInitAiOffset(0x12),
+    enemyTileDataOffset(0x36);
+
+// Door cap PLMs are four colours of four directions, 6 bytes apart
+static const std::uint16_t
+    doorCapPlmsBegin(0xC842),
+    doorCapPlmsEnd(0xC8A2),
+    doorCapPlmStride(6);
+
+// Enemy tiles are loaded to the second sprite tile table, spritemap tile numbers below this are common sprite graphics
+static const std::uint16_t enemyTileBase(0x100);
+
+bool isDoorCapPlm(std::uint16_t id) noexcept
+{
+    return doorCapPlmsBegin <= id && id < doorCapPlmsEnd && (id - doorCapPlmsBegin) % doorCapPlmStride == 0;
+}
+
+std::pmr::vector<Enemy> loadEnemyPopulation(const Rom& rom, const RoomState& state, std::pmr::memory_resource* p_memory)
+try
+{
+    std::pmr::vector<Enemy> ret(p_memory);
+    const std::uint32_t address(enemyPopulationBank | state.enemyPopulationPointer);
+    for (index_t i{}; i < maxEnemies; ++i)
+    {
+        const std::uint32_t p(address + std::uint32_t(i * enemyPopulationEntrySize));
+        const std::uint16_t id(rom.read16(p));
+        if (id == 0xFFFF)
+            break;
+
+        ret.push_back({id, rom.read16(p + 2), rom.read16(p + 4), rom.read16(p + 6), rom.read16(p + 8), rom.read16(p + 0xA), rom.read16(p + 0xC), rom.read16(p + 0xE)});
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+std::pmr::vector<Plm> loadPlmPopulation(const Rom& rom, const RoomState& state, std::pmr::memory_resource* p_memory)
+try
+{
+    std::pmr::vector<Plm> ret(p_memory);
+    if (state.plmPopulationPointer < 0x8000)
+        return ret;
+
+    const std::uint32_t address(roomBank | state.plmPopulationPointer);
+    for (index_t i{}; i < maxPlms; ++i)
+    {
+        const std::uint32_t p(address + std::uint32_t(i * plmPopulationEntrySize));
+        const std::uint16_t id(rom.read16(p));
+        if (!id)
+            break;
+
+        ret.push_back({id, rom.read8(p + 2), rom.read8(p + 3), rom.read16(p + 4)});
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+// Enemy instruction lists and spritemaps are set up by the enemy's initialisation AI, which nearly always starts the enemy off with
+// LDA #imm : STA $0F92,x (instruction list pointer) or LDA #imm : STA $0F8E,x (spritemap pointer), so the first of those in the routine gives the enemy's first frame
+static std::optional<std::uint16_t> findInitialSpritemap(const Rom& rom, std::uint32_t bank, std::uint16_t initAi)
+try
+{
+    const std::span<const std::uint8_t> data(rom.spanFrom(bank | initAi));
+    const std::span<const std::uint8_t> code(data.first(std::min(initAiScanSize, std::size(data))));
+    for (index_t i{}; i + 6 <= std::size(code); ++i)
+    {
+        if (code[i] != 0xA9 || code[i + 3] != 0x9D || code[i + 5] != 0x0F)
+            continue;
+
+        const std::uint16_t operand(std::uint16_t(code[i + 1] | code[i + 2] << 8));
+        if (operand < 0x8000)
+            continue;
+
+        if (code[i + 4] == 0x8E)
+            return operand;
+
+        if (code[i + 4] == 0x92)
+        {
+            // Instruction lists are timer, spritemap pairs interleaved with instructions (ASM pointers, which are $8000+).
+            // Instructions take a variable number of arguments, so only a list that starts with a frame can be read
+            const std::uint16_t timer(rom.read16(bank | operand));
+            if (timer && timer < 0x8000)
+                return rom.read16(bank | std::uint16_t(operand + 2));
+
+            return {};
+        }
+    }
+
+    return {};
+}
+LOG_RETHROW
+
+static void drawTile(Image& out, std::ptrdiff_t x_out, std::ptrdiff_t y_out, const std::uint8_t* p_tile, bool xFlip, bool yFlip, std::span<const Pixel> palette)
+{
+    for (index_t y{}; y < tileSize; ++y)
+    {
+        const std::uint8_t* const p_in(p_tile + (yFlip ? tileSize - 1 - y : y) * tileSize);
+        for (index_t x{}; x < tileSize; ++x)
+        {
+            const std::uint8_t i_colour(p_in[xFlip ? tileSize - 1 - x : x]);
+            if (i_colour)
+                out.row(y_out + y)[x_out + x] = palette[i_colour];
+        }
+    }
+}
+
+// Spritemaps are a count of entries followed by 5 byte entries: s000000x xxxxxxxx (size, X offset), Y offset byte, vhoopppt tttttttt (flip, priority, palette, tile number).
+// Earlier entries are drawn on top. Palette bits are ignored: they're added to the palette slot the room's enemy graphics set gives the enemy,
+// and the neighbouring slots hold whatever other enemies or the enemy's own code load there, so every entry is drawn with the header's palette
+static SpriteFrame decodeSpritemap(const Rom& rom, std::uint32_t address, std::span<const std::uint8_t> tiles, std::span<const Pixel> palette)
+try
+{
+    struct Entry
+    {
+        std::ptrdiff_t x, y;
+        n_t size;
+        std::uint16_t attributes;
+    };
+
+    const n_t n_entries(rom.read16(address));
+    if (!n_entries || n_entries > maxSpritemapEntries)
+        throw std::runtime_error(LOG_INFO "Invalid spritemap $"s + toHexString(address, 3));
+
+    std::vector<Entry> entries;
+    std::ptrdiff_t x_min(PTRDIFF_MAX), y_min(PTRDIFF_MAX), x_max(PTRDIFF_MIN), y_max(PTRDIFF_MIN);
+    for (index_t i{}; i < n_entries; ++i)
+    {
+        const std::uint32_t p(address + 2 + std::uint32_t(i * 5));
+        const std::uint16_t xWord(rom.read16(p));
+        const Entry entry
+        {
+            std::ptrdiff_t((xWord & 0x1FF) ^ 0x100) - 0x100,
+            std::int8_t(rom.read8(p + 2)),
+            xWord & 0x8000 ? tileSize * 2 : tileSize,
+            rom.read16(p + 3)
+        };
+
+        entries.push_back(entry);
+        x_min = std::min(x_min, entry.x);
+        y_min = std::min(y_min, entry.y);
+        x_max = std::max(x_max, entry.x + std::ptrdiff_t(entry.size));
+        y_max = std::max(y_max, entry.y + std::ptrdiff_t(entry.size));
+    }
+
+    SpriteFrame frame{Image(n_t(x_max - x_min), n_t(y_max - y_min)), -x_min, -y_min};
+    const n_t n_tiles(std::size(tiles) / (tileSize * tileSize));
+    for (const Entry& entry : entries | std::views::reverse)
+    {
+        const bool xFlip(entry.attributes >> 14 & 1), yFlip(entry.attributes >> 15 & 1);
+        const n_t n_subtiles(entry.size / tileSize);
+        for (index_t y_subtile{}; y_subtile < n_subtiles; ++y_subtile)
+            for (index_t x_subtile{}; x_subtile < n_subtiles; ++x_subtile)
+            {
+                // 16x16 sprites are four tiles from two consecutive rows of the 16 tile wide sprite tile table
+                const index_t i_tile((entry.attributes & 0x1FF) + y_subtile * 0x10 + x_subtile);
+                if (i_tile < enemyTileBase || i_tile - enemyTileBase >= n_tiles)
+                    continue;
+
+                const index_t
+                    x(entry.x - x_min + (xFlip ? n_subtiles - 1 - x_subtile : x_subtile) * tileSize),
+                    y(entry.y - y_min + (yFlip ? n_subtiles - 1 - y_subtile : y_subtile) * tileSize);
+
+                drawTile(frame.image, x, y, &tiles[(i_tile - enemyTileBase) * tileSize * tileSize], xFlip, yFlip, palette);
+            }
+    }
+
+    return frame;
+}
+LOG_RETHROW
+
+SpriteFrame decodeEnemyFrame(const Rom& rom, std::uint16_t id)
+try
+{
+    const std::uint32_t header(enemyHeaderBank | id);
+    const std::uint32_t bank(std::uint32_t(rom.read8(header + enemyBankOffset)) << 16);
+    const n_t tileDataSize(std::min<n_t>(rom.read16(header + enemyTileDataSizeOffset) & 0x7FFF, maxEnemyTileDataSize));
+
+    const std::uint32_t paletteAddress(bank | rom.read16(header + enemyPaletteOffset));
+    const std::span<const std::uint8_t> paletteData(rom.spanFrom(paletteAddress));
+    if (std::size(paletteData) < 0x20)
+        throw std::runtime_error(LOG_INFO "Enemy $"s + toHexString(id) + " palette at $"s + toHexString(paletteAddress, 3) + " overruns end of ROM"s);
+
+    std::vector<Pixel> palette(decodePalette(paletteData.first(0x20)));
+    palette[0].a = 0;
+
+    const std::span<const std::uint8_t> tileData(rom.spanFrom(rom.read24(header + enemyTileDataOffset)));
+    const std::vector<std::uint8_t> tiles(decodeTiles4bpp(tileData.first(std::min(tileDataSize, std::size(tileData)))));
+
+    const std::optional<std::uint16_t> spritemap(findInitialSpritemap(rom, bank, rom.read16(header + enemyInitAiOffset)));
+    if (spritemap)
+        return decodeSpritemap(rom, bank | *spritemap, tiles, palette);
+
+    const n_t
+        n_tiles(std::size(tiles) / (tileSize * tileSize)),
+        n_columns(std::clamp<n_t>(n_tiles, 1, 0x10)),
+        n_rows(std::max<n_t>((n_tiles + 0xF) / 0x10, 1));
+
+    SpriteFrame frame{Image(n_columns * tileSize, n_rows * tileSize), std::ptrdiff_t(n_columns * tileSize / 2), std::ptrdiff_t(n_rows * tileSize / 2)};
+    for (index_t i_tile{}; i_tile < n_tiles; ++i_tile)
+        drawTile(frame.image, i_tile % 0x10 * tileSize, i_tile / 0x10 * tileSize, &tiles[i_tile * tileSize * tileSize], false, false, palette);
+
+    return frame;
+}
+LOG_RETHROW
+
+static SpriteFrame makePlmMarker()
+try
+{
+    const Pixel colour{0xFF, 0xFF, 0x00, 0xFF};
+    const n_t size(tileSize * 2);
+    SpriteFrame frame{Image(size, size), 0, 0};
+    for (index_t i{}; i < size; ++i)
+        frame.image.row(0)[i] = frame.image.row(size - 1)[i] = frame.image.row(i)[0] = frame.image.row(i)[size - 1] = colour;
+
+    return frame;
+}
+LOG_RETHROW
+
+ObjectSprites::ObjectSprites()
+try
+{
+    const SpriteFrame marker(makePlmMarker());
+    plmMarker = {atlas_.add(marker.image), marker.x_origin, marker.y_origin};
+}
+LOG_RETHROW
+
+void ObjectSprites::addEnemyTypes(const Rom& rom, std::span<const Enemy> enemies)
+try
+{
+    std::vector<std::uint16_t> ids;
+    for (const Enemy& enemy : enemies)
+        if (!enemySprites.contains(enemy.id))
+            ids.push_back(enemy.id);
+
+    std::ranges::sort(ids);
+    ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
+    if (std::empty(ids))
+        return;
+
+    // An enemy that fails to decode gets an empty frame so it isn't retried every time a room using it is loaded
+    std::vector<SpriteFrame> frames(std::size(ids));
+    std::vector<std::string> errors(std::size(ids));
+    std::vector<index_t> indices(std::size(ids));
+    std::iota(std::begin(indices), std::end(indices), index_t{});
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i)
+    {
+        try
+        {
+            frames[i] = decodeEnemyFrame(rom, ids[i]);
+        }
+        catch (const std::exception& e)
+        {
+            frames[i] = {Image(1, 1), 0, 0};
+            errors[i] = e.what();
+        }
+    });
+
+    for (index_t i{}; i < std::size(ids); ++i)
+        if (!std::empty(errors[i]))
+            DebugFile(DebugFile::warning) << LOG_INFO "Couldn't decode enemy $"s << toHexString(ids[i]) << ": "s << errors[i] << '\n';
+
+    std::vector<Image> images;
+    for (SpriteFrame& frame : frames)
+        images.push_back(std::move(frame.image));
+
+    const std::vector<index_t> i_sprites(atlas_.add(images));
+    for (index_t i{}; i < std::size(ids); ++i)
+        enemySprites[ids[i]] = {i_sprites[i], frames[i].x_origin, frames[i].y_origin};
+}
+LOG_RETHROW
+
+std::vector<SpriteInstance> ObjectSprites::layout(std::span<const Enemy> enemies, std::span<const Plm> plms) const
+try
+{
+    std::vector<SpriteInstance> ret;
+    for (const Enemy& enemy : enemies)
+    {
+        const auto it(enemySprites.find(enemy.id));
+        if (it != std::end(enemySprites))
+            ret.push_back({it->second.i_sprite, std::ptrdiff_t(enemy.x) - it->second.x_origin, std::ptrdiff_t(enemy.y) - it->second.y_origin});
+    }
+
+    for (const Plm& plm : plms)
+        ret.push_back({plmMarker.i_sprite, std::ptrdiff_t(plm.x * blockSize) - plmMarker.x_origin, std::ptrdiff_t(plm.y * blockSize) - plmMarker.y_origin});
+
+    return ret;
+}
+LOG_RETHROW
+
+const SpriteAtlas& ObjectSprites::atlas() const noexcept
+{
+    return atlas_;
+}
@@ -0,0 +1,67 @@
+module;
+
+#include "../global.h"
+
+export module sm_sprites;
+
+export import sm_room;
+export import sprite_atlas;
+
+// Enemy population entries are in bank $A1, the enemy ID is a pointer to the enemy's header in bank $A0. Positions are in pixels
+export struct Enemy
+{
+    std::uint16_t id, x, y, initialParameter, properties, extraProperties, parameter1, parameter2;
+};
+
+// PLM population entries are in bank $8F, the PLM ID is a pointer to the PLM's header in bank $84. Positions are in blocks
+export struct Plm
+{
+    std::uint16_t id;
+    std::uint8_t x, y;
+    std::uint16_t parameter;
+};
+
+// Grey, yellow, green and red door caps facing each direction
+export bool isDoorCapPlm(std::uint16_t id) noexcept;
+
+export std::pmr::vector<Enemy> loadEnemyPopulation(const Rom& rom, const RoomState& state, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::sprites));
+export std::pmr::vector<Plm> loadPlmPopulation(const Rom& rom, const RoomState& state, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::sprites));
+
+// A decoded sprite frame, (x_origin, y_origin) is the position in the image of the point the object's position refers to
+export struct SpriteFrame
+{
+    Image image;
+    std::ptrdiff_t x_origin, y_origin;
+};
+
+// The frame the enemy is first drawn with, or its graphics laid out as in VRAM if that can't be found
+export SpriteFrame decodeEnemyFrame(const Rom& rom, std::uint16_t id);
+
+// Enemy and PLM sprites shared across rooms. Each enemy type is decoded the first time it's seen and packed into the atlas alongside the types already loaded
+export class ObjectSprites
+{
+    struct Sprite
+    {
+        index_t i_sprite;
+        std::ptrdiff_t x_origin, y_origin;
+    };
+
+    SpriteAtlas atlas_;
+    std::map<std::uint16_t, Sprite> enemySprites;
+
+    // PLMs draw by writing blocks to the level data from their instruction lists, with graphics that instructions load at runtime
+    // (e.g. items), so they're drawn as a block outline marking where they are rather than as what they draw
+    Sprite plmMarker;
+
+public:
+    ObjectSprites();
+
+    // Decodes the enemy types not already loaded, in parallel, and packs them together
+    void addEnemyTypes(const Rom& rom, std::span<const Enemy> enemies);
+
+    // Sprites positioned in room pixel coordinates, enemies in population order and then PLMs.
+    // Enemy types not yet added are skipped
+    std::vector<SpriteInstance> layout(std::span<const Enemy> enemies, std::span<const Plm> plms) const;
+
+    const SpriteAtlas& atlas() const noexcept;
+};
@@ -0,0 +1,112 @@
+#include "../global.h"
+
+import sm_tileset;
+
+static const std::uint32_t
+    tilesetTableAddress(0x8FE6A2),
+    creTilesAddress(0xB98000),
+    creTileTableAddress(0xB9A09D);
+
+static const n_t
+    vramSize(0x8000),
+    creTilesOffset(0x5000),
+    tileTableSize(0x2000),
+    creTileTableSize(0x800);
+
+// Copies as much of `from` as fits into `to` at offset `i_to`
+static void load(std::span<std::uint8_t> to, index_t i_to, std::span<const std::uint8_t> from)
+try
+{
+    const n_t n(std::min(std::size(from), std::size(to) - i_to));
+    std::copy_n(std::begin(from), n, std::begin(to) + i_to);
+}
+LOG_RETHROW
+
+static std::uint32_t tilesetEntryAddress(index_t i_tileset)
+try
+{
+    // Tileset table entries are three long pointers: tile table, tiles, palette
+    if (i_tileset >= Tileset::n_tilesets)
+        throw std::runtime_error(LOG_INFO "Invalid tileset index "s + toHexString(i_tileset, 1));
+
+    return tilesetTableAddress + std::uint32_t(i_tileset) * 9;
+}
+LOG_RETHROW
+
+Tileset::Tileset(const Rom& rom, index_t i_tileset, AssetCache* p_cache, std::pmr::memory_resource* p_memory)
+try
+    : tiles(p_memory), tileTable(p_memory), palette(p_memory)
+{
+    // Tilesets that don't use CRE graphics (Ceres, Kraid's room, etc.) are big enough to overwrite them, so CRE is always loaded first
+    const std::uint32_t entryAddress(tilesetEntryAddress(i_tileset));
+    const std::uint32_t
+        tileTableAddress(rom.read24(entryAddress)),
+        tilesAddress(rom.read24(entryAddress + 3)),
+        paletteAddress(rom.read24(entryAddress + 6));
+
+    // Cached data is used in place, `storage` only holds data decompressed without a cache
+    std::vector<std::uint8_t> storage, sceTileTableStorage;
+
+    std::vector<std::uint8_t> vram(vramSize);
+    load(vram, creTilesOffset, decompress(p_cache, rom.spanFrom(creTilesAddress), storage).data);
+    load(vram, 0, decompress(p_cache, rom.spanFrom(tilesAddress), storage).data);
+    const std::vector<std::uint8_t> decodedTiles(decodeTiles4bpp(vram));
+    tiles.assign(std::begin(decodedTiles), std::end(decodedTiles));
+
+    std::vector<std::uint8_t> tileTableBytes(tileTableSize);
+    const std::span<const std::uint8_t> sceTileTable(decompress(p_cache, rom.spanFrom(tileTableAddress), sceTileTableStorage).data);
+    if (std::size(sceTileTable) >= tileTableSize)
+        load(tileTableBytes, 0, sceTileTable);
+    else
+    {
+        load(tileTableBytes, 0, decompress(p_cache, rom.spanFrom(creTileTableAddress), storage).data);
+        load(tileTableBytes, creTileTableSize, sceTileTable);
+    }
+
+    tileTable.resize(n_metatiles * 4);
+    for (index_t i{}; i < std::size(tileTable); ++i)
+        tileTable[i] = std::uint16_t(tileTableBytes[i * 2] | tileTableBytes[i * 2 + 1] << 8);
+
+    const std::vector<Pixel> decodedPalette(decodePalette(decompress(p_cache, rom.spanFrom(paletteAddress), storage).data));
+    palette.assign(std::begin(decodedPalette), std::end(decodedPalette));
+    palette.resize(n_colours, Pixel{0, 0, 0, 0xFF});
+}
+LOG_RETHROW
+
+auto Tileset::findRanges(const Rom& rom, index_t i_tileset, AssetCache* p_cache) -> Ranges
+try
+{
+    const std::uint32_t entryAddress(tilesetEntryAddress(i_tileset));
+    std::vector<std::uint8_t> storage;
+    const auto compressedRange([&](std::uint32_t address) -> RomRange
+    {
+        const index_t i_begin(Rom::snesToPc(address));
+        return {i_begin, i_begin + decompress(p_cache, rom.spanFrom(address), storage).compressedSize};
+    });
+
+    const index_t i_entry(Rom::snesToPc(entryAddress));
+    return
+    {
+        {i_entry, i_entry + 9},
+        compressedRange(creTilesAddress), compressedRange(rom.read24(entryAddress + 3)),
+        compressedRange(creTileTableAddress), compressedRange(rom.read24(entryAddress)),
+        compressedRange(rom.read24(entryAddress + 6))
+    };
+}
+LOG_RETHROW
+
+AssetSource Tileset::findSource(const Rom& rom, index_t i_tileset, AssetCache* p_cache)
+try
+{
+    // The table entry is a source so that repointing a tileset invalidates it, but only the data it points to is hashed
+    const Ranges ranges(findRanges(rom, i_tileset, p_cache));
+    AssetSource ret{0, {ranges.entry}};
+    for (const RomRange& range : {ranges.creTiles, ranges.tiles, ranges.creTileTable, ranges.tileTable, ranges.palette})
+    {
+        ret.hash = combineHashes(ret.hash, hashBytes(rom.bytes().subspan(range.begin, range.end - range.begin)));
+        ret.ranges.push_back(range);
+    }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,44 @@
+module;
+
+#include "../global.h"
+
+export module sm_tileset;
+
+export import asset_cache;
+export import memory_accounting;
+export import shared_assets;
+export import rom;
+export import snes_graphics;
+
+// The BG graphics of a room as they're laid out in VRAM/CGRAM/RAM after the game has loaded the common (CRE) and tileset specific (SCE) graphics
+export struct Tileset
+{
+    const static n_t
+        n_tilesets{0x1D},
+        n_tiles{0x400},
+        n_metatiles{0x400},
+        n_colours{0x80};
+
+    // One byte per pixel, tileSize * tileSize bytes per tile
+    std::pmr::vector<std::uint8_t> tiles;
+
+    // Four BG tilemap entries (top-left, top-right, bottom-left, bottom-right) per 16x16 metatile.
+    // Tilemap entries are vhopppcc cccccccc (flip, priority, palette, tile number)
+    std::pmr::vector<std::uint16_t> tileTable;
+
+    std::pmr::vector<Pixel> palette;
+
+    // Decompresses through `p_cache` if given
+    Tileset(const Rom& rom, index_t i_tileset, AssetCache* p_cache = nullptr, std::pmr::memory_resource* p_memory = memoryResource(MemorySubsystem::tiles));
+
+    // The tileset's entry in the tileset table and the compressed data it's loaded from, including the common (CRE) data every tileset loads
+    struct Ranges
+    {
+        RomRange entry, creTiles, tiles, creTileTable, tileTable, palette;
+    };
+
+    static Ranges findRanges(const Rom& rom, index_t i_tileset, AssetCache* p_cache = nullptr);
+
+    // For sharing tilesets between ROMs. Hashes the compressed graphics, so ROMs with the same graphics share a tileset wherever it is in the ROM
+    static AssetSource findSource(const Rom& rom, index_t i_tileset, AssetCache* p_cache = nullptr);
+};
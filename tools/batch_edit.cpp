@@ -0,0 +1,439 @@
+#include "../global.h"
+
+import batch_edit;
+
+import compress;
+import decompress;
+import game_traits;
+
+static const std::uint32_t roomBank(0x8F0000);
+
+struct RoomField
+{
+    std::string_view name;
+    index_t offset;
+    n_t size;
+};
+
+// Fields that can be changed without moving anything. The room's size and state conditions aren't, as the level data and state list depend on them
+static const RoomField headerFields[]
+{
+    {"mapX",         2, 1},
+    {"mapY",         3, 1},
+    {"upScroller",   6, 1},
+    {"downScroller", 7, 1},
+    {"creFlags",     8, 1},
+    {"doorList",     9, 2}
+};
+
+static const RoomField stateFields[]
+{
+    {"levelData",          0, 3},
+    {"tileset",            3, 1},
+    {"music",              4, 1},
+    {"musicTrack",         5, 1},
+    {"fx",                 6, 2},
+    {"enemyPopulation",    8, 2},
+    {"enemyGraphics",     10, 2},
+    {"layer2ScrollX",     12, 1},
+    {"layer2ScrollY",     13, 1},
+    {"scroll",            14, 2},
+    {"specialXray",       16, 2},
+    {"mainAsm",           18, 2},
+    {"plmPopulation",     20, 2},
+    {"libraryBackground", 22, 2},
+    {"setupAsm",          24, 2}
+};
+
+// Undo log of a step's writes, so that a step failing partway can put back what it wrote
+class RomTransaction
+{
+    Rom& rom;
+    std::vector<std::pair<std::uint32_t, std::vector<std::uint8_t>>> undoLog;
+
+public:
+    explicit RomTransaction(Rom& rom)
+        : rom(rom)
+    {}
+
+    void write(std::uint32_t address, std::span<const std::uint8_t> bytes)
+    try
+    {
+        const std::span<const std::uint8_t> oldBytes(rom.spanFrom(address));
+        if (std::size(bytes) > std::size(oldBytes))
+            throw std::runtime_error(LOG_INFO "Write of "s + std::to_string(std::size(bytes)) + " bytes to $"s + toHexString(address, 3) + " overruns end of ROM"s);
+
+        undoLog.emplace_back(address, std::vector<std::uint8_t>(std::begin(oldBytes), std::begin(oldBytes) + std::size(bytes)));
+        rom.write(address, bytes);
+    }
+    LOG_RETHROW
+
+    // Only writes over what was already written, so doesn't fail
+    void rollback()
+    {
+        for (auto it(std::rbegin(undoLog)); it != std::rend(undoLog); ++it)
+            rom.write(it->first, it->second);
+
+        undoLog.clear();
+    }
+};
+
+static std::uint32_t parseHex(std::string_view text)
+try
+{
+    if (!std::empty(text) && text.front() == '$')
+        text.remove_prefix(1);
+
+    std::uint32_t ret{};
+    const auto [p_end, error](std::from_chars(std::data(text), std::data(text) + std::size(text), ret, 16));
+    if (std::empty(text) || error != std::errc() || p_end != std::data(text) + std::size(text))
+        throw std::runtime_error(LOG_INFO "Invalid hex number \""s + std::string(text) + '"');
+
+    return ret;
+}
+LOG_RETHROW
+
+static std::uint16_t parseRoomAddress(std::string_view text)
+try
+{
+    // Either a bank $8F address or the 16 bit room pointer
+    const std::uint32_t address(parseHex(text));
+    if ((address & 0x7F0000) != (roomBank & 0x7F0000) && address > 0xFFFF)
+        throw std::runtime_error(LOG_INFO "Room address $"s + toHexString(address, 3) + " isn't in bank $8F"s);
+
+    return std::uint16_t(address);
+}
+LOG_RETHROW
+
+static std::optional<index_t> parseStateIndex(std::string_view text)
+try
+{
+    if (text == "default"sv)
+        return std::nullopt;
+
+    return index_t(parseHex(text));
+}
+LOG_RETHROW
+
+static const RoomField& findField(std::span<const RoomField> fields, std::string_view name)
+try
+{
+    const auto it(std::ranges::find(fields, name, &RoomField::name));
+    if (it == std::end(fields))
+        throw std::runtime_error(LOG_INFO "Unknown field \""s + std::string(name) + '"');
+
+    return *it;
+}
+LOG_RETHROW
+
+static std::vector<std::uint8_t> readBinaryFile(const std::filesystem::path& filepath)
+try
+{
+    std::ifstream in(filepath, std::ios::binary);
+    in.exceptions(std::ios::badbit | std::ios::failbit);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+LOG_RETHROW
+
+static EditStep parseStep(index_t i_line, std::span<const std::string> words, const std::filesystem::path& directory)
+try
+{
+    const auto checkArguments([&](n_t n_arguments)
+    {
+        if (std::size(words) != n_arguments + 1)
+            throw std::runtime_error(LOG_INFO "\""s + words[0] + "\" takes "s + std::to_string(n_arguments) + " arguments"s);
+    });
+
+    const std::string& command(words[0]);
+    if (command == "blocks"sv)
+    {
+        checkArguments(7);
+        const std::string& cell(words[7]);
+        if (std::size(cell) != 7 || cell[4] != ':')
+            throw std::runtime_error(LOG_INFO "Block \""s + cell + "\" isn't BBBB:TT"s);
+
+        const std::uint32_t block(parseHex(std::string_view(cell).substr(0, 4))), bts(parseHex(std::string_view(cell).substr(5, 2)));
+        const BlockFillStep step
+        {
+            parseRoomAddress(words[1]), parseStateIndex(words[2]),
+            parseHex(words[3]), parseHex(words[4]), parseHex(words[5]), parseHex(words[6]),
+            std::uint16_t(block), std::uint8_t(bts)
+        };
+
+        if (!step.width || !step.height)
+            throw std::runtime_error(LOG_INFO "Block rectangle is empty"s);
+
+        return {i_line, step};
+    }
+
+    if (command == "room"sv || command == "state"sv)
+    {
+        const bool isStateField(command == "state"sv);
+        checkArguments(isStateField ? 4 : 3);
+        const RoomField& field(findField(isStateField ? std::span<const RoomField>(stateFields) : std::span<const RoomField>(headerFields), words[std::size(words) - 2]));
+        const std::uint32_t value(parseHex(words.back()));
+        if (value >> field.size * 8)
+            throw std::runtime_error(LOG_INFO "Value $"s + toHexString(value, field.size) + " is too big for "s + std::string(field.name));
+
+        return {i_line, RoomFieldStep{parseRoomAddress(words[1]), isStateField ? parseStateIndex(words[2]) : std::nullopt, isStateField, field.offset, field.size, value}};
+    }
+
+    if (command == "import"sv || command == "import-compressed"sv)
+    {
+        checkArguments(2);
+        const bool isCompressed(command == "import-compressed"sv);
+        std::vector<std::uint8_t> bytes(readBinaryFile(directory / words[2]));
+        if (isCompressed)
+            bytes = compress(bytes);
+
+        return {i_line, ImportStep{parseHex(words[1]), std::move(bytes), isCompressed}};
+    }
+
+    throw std::runtime_error(LOG_INFO "Unknown step \""s + command + '"');
+}
+LOG_RETHROW
+
+std::vector<EditStep> parseEditScript(std::string_view text, const std::filesystem::path& directory)
+try
+{
+    std::vector<EditStep> ret;
+    std::istringstream lines{std::string(text)};
+    index_t i_line{};
+    for (std::string line; std::getline(lines, line);)
+    {
+        ++i_line;
+        std::istringstream in(line);
+        std::vector<std::string> words;
+        for (std::string word; in >> word;)
+            words.push_back(std::move(word));
+
+        if (std::empty(words) || words[0].front() == '#')
+            continue;
+
+        try
+        {
+            ret.push_back(parseStep(i_line, words, directory));
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error(LOG_INFO "Edit script line "s + std::to_string(i_line) + ": "s + e.what());
+        }
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+static const RoomState& findState(const Room& room, std::optional<index_t> i_state)
+try
+{
+    if (!i_state)
+        return room.defaultState();
+
+    if (*i_state >= std::size(room.states))
+        throw std::runtime_error(LOG_INFO "Room $"s + toHexString(room.address) + " has no state "s + std::to_string(*i_state));
+
+    return room.states[*i_state];
+}
+LOG_RETHROW
+
+// The script's rooms and states must all be in the ROM, checked before anything's written so that a ROM the script doesn't fit is left alone
+static void validate(const Rom& rom, std::span<const EditStep> steps)
+try
+{
+    if (identifyGame(rom.bytes()) != GameId::superMetroid)
+        throw std::runtime_error(LOG_INFO "Not a Super Metroid ROM"s);
+
+    std::map<std::uint16_t, Room> rooms;
+    const auto check([&](std::uint16_t roomAddress, std::optional<index_t> i_state)
+    {
+        auto it(rooms.find(roomAddress));
+        if (it == std::end(rooms))
+            it = rooms.try_emplace(roomAddress, rom, roomAddress).first;
+
+        findState(it->second, i_state);
+    });
+
+    for (const EditStep& step : steps)
+        if (const BlockFillStep* const p_fill{std::get_if<BlockFillStep>(&step.edit)})
+            check(p_fill->roomAddress, p_fill->i_state);
+        else if (const RoomFieldStep* const p_field{std::get_if<RoomFieldStep>(&step.edit)})
+            check(p_field->roomAddress, p_field->i_state);
+        else
+            rom.spanFrom(std::get<ImportStep>(step.edit).address);
+}
+LOG_RETHROW
+
+static void applyStep(Rom& rom, RomTransaction& transaction, const BlockFillStep& step, AssetCache* p_cache)
+try
+{
+    const Room room(rom, step.roomAddress);
+    const RoomState& state(findState(room, step.i_state));
+    LevelData levelData(rom, room, state, p_cache);
+    if (step.x + step.width > levelData.width || step.y + step.height > levelData.height)
+        throw std::runtime_error(LOG_INFO "Block rectangle is outside room $"s + toHexString(room.address));
+
+    fillRect(levelData, step.x, step.y, step.width, step.height, step.block, step.bts);
+    const std::vector<std::uint8_t> compressed(compress(levelData.toBytes()));
+    if (std::size(compressed) > levelData.compressedSize)
+        throw std::runtime_error(LOG_INFO "Level data $"s + toHexString(state.levelDataPointer, 3) + " recompresses to "s + std::to_string(std::size(compressed)) + " bytes, more than its original "s + std::to_string(levelData.compressedSize));
+
+    transaction.write(state.levelDataPointer, compressed);
+}
+LOG_RETHROW
+
+static void applyStep(Rom& rom, RomTransaction& transaction, const RoomFieldStep& step)
+try
+{
+    const Room room(rom, step.roomAddress);
+    const std::uint16_t address(step.isStateField ? findState(room, step.i_state).address : room.address);
+    std::vector<std::uint8_t> bytes(step.size);
+    for (index_t i{}; i < step.size; ++i)
+        bytes[i] = std::uint8_t(step.value >> i * 8);
+
+    transaction.write(roomBank | std::uint32_t(address + step.offset), bytes);
+
+    // The room and the state's level data must still load, e.g. a level data pointer to something that isn't level data fails the step
+    const Room newRoom(rom, step.roomAddress);
+    if (step.isStateField)
+        LevelData(rom, newRoom, findState(newRoom, step.i_state));
+}
+LOG_RETHROW
+
+static void applyStep(Rom& rom, RomTransaction& transaction, const ImportStep& step)
+try
+{
+    if (step.isCompressed)
+    {
+        const n_t space(decompress(rom.spanFrom(step.address)).compressedSize);
+        if (std::size(step.bytes) > space)
+            throw std::runtime_error(LOG_INFO "Import to $"s + toHexString(step.address, 3) + " compresses to "s + std::to_string(std::size(step.bytes)) + " bytes, more than the "s + std::to_string(space) + " there"s);
+    }
+
+    transaction.write(step.address, step.bytes);
+}
+LOG_RETHROW
+
+// Rolled back steps are added to `errors` rather than logged, so that each ROM's are written together once every ROM is done
+static void editRom(BatchRomResult& result, std::vector<std::string>& errors, std::span<const EditStep> steps, const BatchEditOptions& options)
+try
+{
+    using namespace std::chrono;
+
+    const auto startTime(steady_clock::now());
+    Rom rom(result.romPath);
+    validate(rom, steps);
+    const auto editStartTime(steady_clock::now());
+    result.loadTime = duration_cast<microseconds>(editStartTime - startTime);
+
+    for (const EditStep& step : steps)
+    {
+        RomTransaction transaction(rom);
+        try
+        {
+            if (const BlockFillStep* const p_fill{std::get_if<BlockFillStep>(&step.edit)})
+                applyStep(rom, transaction, *p_fill, options.p_assetCache);
+            else if (const RoomFieldStep* const p_field{std::get_if<RoomFieldStep>(&step.edit)})
+                applyStep(rom, transaction, *p_field);
+            else
+                applyStep(rom, transaction, std::get<ImportStep>(step.edit));
+
+            ++result.n_stepsApplied;
+        }
+        catch (const std::exception& e)
+        {
+            transaction.rollback();
+            ++result.n_stepsFailed;
+            errors.push_back(", line "s + std::to_string(step.i_line) + " rolled back: "s + e.what());
+        }
+    }
+
+    const auto saveStartTime(steady_clock::now());
+    result.editTime = duration_cast<microseconds>(saveStartTime - editStartTime);
+    if (result.n_stepsFailed && !options.keepGoing)
+        return;
+
+    rom.save(options.outputDirectory / result.romPath.filename());
+    result.isSaved = true;
+    result.saveTime = duration_cast<microseconds>(steady_clock::now() - saveStartTime);
+}
+LOG_RETHROW
+
+std::vector<BatchRomResult> batchEdit(std::span<const std::filesystem::path> romPaths, std::span<const EditStep> steps, const BatchEditOptions& options)
+try
+{
+    // Outputs are named after their inputs, so two inputs with the same name would overwrite each other
+    std::set<std::filesystem::path> filenames;
+    for (const std::filesystem::path& romPath : romPaths)
+        if (!filenames.insert(romPath.filename()).second)
+            throw std::runtime_error(LOG_INFO "More than one ROM named "s + romPath.filename().string());
+
+    std::filesystem::create_directories(options.outputDirectory);
+
+    std::vector<BatchRomResult> ret(std::size(romPaths));
+    for (index_t i{}; i < std::size(romPaths); ++i)
+        ret[i].romPath = romPaths[i];
+
+    // One task per ROM, so that loading and saving of different ROMs overlap and the disk stays busy.
+    // Worker threads collect errors rather than logging them as they go, so the log isn't interleaved
+    std::vector<std::vector<std::string>> errors(std::size(ret));
+    std::vector<index_t> indices(std::size(ret));
+    std::iota(std::begin(indices), std::end(indices), index_t{});
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i)
+    {
+        try
+        {
+            editRom(ret[i], errors[i], steps, options);
+        }
+        catch (const std::exception& e)
+        {
+            ret[i].error = e.what();
+            errors[i].push_back(" failed: "s + e.what());
+        }
+    });
+
+    if (std::ranges::any_of(errors, [](const std::vector<std::string>& romErrors) { return !std::empty(romErrors); }))
+    {
+        DebugFile debugFile(DebugFile::warning);
+        for (index_t i{}; i < std::size(ret); ++i)
+            for (const std::string& error : errors[i])
+                debugFile << LOG_INFO "Batch edit of "s << ret[i].romPath.string() << error << '\n';
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+void writeBatchReport(std::ostream& out, std::span<const BatchRomResult> results)
+try
+{
+    const auto milliseconds([](std::chrono::microseconds duration)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << double(duration.count()) / 1000;
+        return out.str();
+    });
+
+    out << std::left << std::setw(40) << "ROM" << std::right << std::setw(8) << "Applied" << std::setw(8) << "Failed" << std::setw(10) << "Load ms" << std::setw(10) << "Edit ms" << std::setw(10) << "Save ms" << "  Result\n";
+
+    n_t n_saved{}, n_stepsApplied{}, n_stepsFailed{};
+    std::chrono::microseconds loadTime{}, editTime{}, saveTime{};
+    for (const BatchRomResult& result : results)
+    {
+        out << std::left << std::setw(40) << result.romPath.filename().string() << std::right << std::setw(8) << result.n_stepsApplied << std::setw(8) << result.n_stepsFailed
+            << std::setw(10) << milliseconds(result.loadTime) << std::setw(10) << milliseconds(result.editTime) << std::setw(10) << milliseconds(result.saveTime) << "  "s
+            << (result.isSaved ? "saved"s : !std::empty(result.error) ? result.error : "not saved"s) << '\n';
+
+        n_saved += result.isSaved;
+        n_stepsApplied += result.n_stepsApplied;
+        n_stepsFailed += result.n_stepsFailed;
+        loadTime += result.loadTime;
+        editTime += result.editTime;
+        saveTime += result.saveTime;
+    }
+
+    out << std::left << std::setw(40) << "Total" << std::right << std::setw(8) << n_stepsApplied << std::setw(8) << n_stepsFailed
+        << std::setw(10) << milliseconds(loadTime) << std::setw(10) << milliseconds(editTime) << std::setw(10) << milliseconds(saveTime) << "  "s
+        << n_saved << " of "s << std::size(results) << " saved\n"s;
+}
+LOG_RETHROW
@@ -0,0 +1,85 @@
+module;
+
+#include "../global.h"
+
+export module batch_edit;
+
+export import asset_cache;
+export import sm_level_edit;
+
+// Fills a rectangle of a room state's level data with one block and BTS. No state index means the default state
+export struct BlockFillStep
+{
+    std::uint16_t roomAddress;
+    std::optional<index_t> i_state;
+    index_t x, y;
+    n_t width, height;
+    std::uint16_t block;
+    std::uint8_t bts;
+};
+
+// Writes a field of a room header, or of a room state if there's a state index, `size` bytes at `offset`, little endian
+export struct RoomFieldStep
+{
+    std::uint16_t roomAddress;
+    std::optional<index_t> i_state;
+    bool isStateField;
+    index_t offset;
+    n_t size;
+    std::uint32_t value;
+};
+
+// Writes a file's bytes to the ROM. Compressed imports are compressed once when the script's parsed, and must fit in the space of the compressed data they replace
+export struct ImportStep
+{
+    std::uint32_t address;
+    std::vector<std::uint8_t> bytes;
+    bool isCompressed;
+};
+
+export struct EditStep
+{
+    // Script line number, from 1
+    index_t i_line;
+    std::variant<BlockFillStep, RoomFieldStep, ImportStep> edit;
+};
+
+// Parses an edit script, one step per line, applied in order. Numbers are hex, optionally with a leading '$'. Import files are relative to `directory`.
+//     blocks <room> <state> <x> <y> <width> <height> <BBBB:TT>
+//     room <room> <field> <value>
+//     state <room> <state> <field> <value>
+//     import <SNES address> <file>
+//     import-compressed <SNES address> <file>
+// <state> is an index into the room's states or "default". Lines starting with '#' are comments
+export std::vector<EditStep> parseEditScript(std::string_view text, const std::filesystem::path& directory);
+
+export struct BatchEditOptions
+{
+    // Edited ROMs are written here with the name of the ROM they were made from
+    std::filesystem::path outputDirectory;
+
+    // Write ROMs that had steps fail, without those steps. Otherwise a ROM with a failed step isn't written
+    bool keepGoing{};
+
+    // Level data is decompressed through this if given. ROM variants mostly share level data, so it's usually a hit
+    AssetCache* p_assetCache{};
+};
+
+export struct BatchRomResult
+{
+    std::filesystem::path romPath;
+    n_t n_stepsApplied{}, n_stepsFailed{};
+    bool isSaved{};
+
+    // Why the ROM couldn't be loaded, validated or saved, if it couldn't
+    std::string error;
+
+    std::chrono::microseconds loadTime{}, editTime{}, saveTime{};
+};
+
+// Applies the steps to every ROM, one ROM per task across all cores. Each ROM is validated against the script once before any step is applied.
+// Each step is a transaction: a step that fails is rolled back whole and logged, and the ROM continues with the next step. Results are in the order of `romPaths`
+export std::vector<BatchRomResult> batchEdit(std::span<const std::filesystem::path> romPaths, std::span<const EditStep> steps, const BatchEditOptions& options);
+
+// A line per ROM of its step counts and timings, then the totals
+export void writeBatchReport(std::ostream& out, std::span<const BatchRomResult> results);
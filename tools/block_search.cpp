@@ -0,0 +1,348 @@
+#include "../global.h"
+
+#include <immintrin.h>
+
+import block_search;
+
+import compress;
+
+// Level data is searched once however many room states use it
+struct Job
+{
+    std::uint32_t levelDataPointer;
+    std::vector<std::pair<const Room*, index_t>> users;
+
+    // Set by replacing
+    n_t n_matches{};
+    std::vector<std::uint8_t> compressed;
+    n_t originalSize{};
+};
+
+static void checkPattern(const BlockPattern& pattern)
+try
+{
+    const n_t n_blocks(pattern.width * pattern.height);
+    if (!n_blocks)
+        throw std::runtime_error(LOG_INFO "Block pattern is empty"s);
+
+    if (std::size(pattern.blocks) != n_blocks || std::size(pattern.blockMasks) != n_blocks || std::size(pattern.bts) != n_blocks || std::size(pattern.btsMasks) != n_blocks)
+        throw std::runtime_error(LOG_INFO "Block pattern arrays don't match its "s + std::to_string(pattern.width) + 'x' + std::to_string(pattern.height) + " size"s);
+}
+LOG_RETHROW
+
+static std::vector<Job> makeJobs(const std::vector<Room>& rooms)
+try
+{
+    std::vector<Job> ret;
+    std::map<std::uint32_t, index_t> jobIndices;
+    for (const Room& room : rooms)
+        for (index_t i_state{}; i_state < std::size(room.states); ++i_state)
+        {
+            const std::uint32_t pointer(room.states[i_state].levelDataPointer);
+            const auto [it, isNew](jobIndices.try_emplace(pointer, std::size(ret)));
+            if (isNew)
+                ret.emplace_back().levelDataPointer = pointer;
+
+            ret[it->second].users.emplace_back(&room, i_state);
+        }
+
+    return ret;
+}
+LOG_RETHROW
+
+// The most constrained pattern block, which the prefilter scans for
+static index_t findAnchor(const BlockPattern& pattern) noexcept
+{
+    index_t ret{};
+    int maxBits(-1);
+    for (index_t i{}; i < std::size(pattern.blocks); ++i)
+    {
+        const int n_bits(std::popcount(pattern.blockMasks[i]) + std::popcount(pattern.btsMasks[i]));
+        if (n_bits > maxBits)
+        {
+            maxBits = n_bits;
+            ret = i;
+        }
+    }
+
+    return ret;
+}
+
+static bool isMatch(const LevelData& levelData, const BlockPattern& pattern, index_t x, index_t y) noexcept
+{
+    for (index_t y_pattern{}; y_pattern < pattern.height; ++y_pattern)
+        for (index_t x_pattern{}; x_pattern < pattern.width; ++x_pattern)
+        {
+            const index_t i_pattern(y_pattern * pattern.width + x_pattern);
+            const index_t i_block((y + y_pattern) * levelData.width + x + x_pattern);
+            const std::uint16_t blockMask(pattern.blockMasks[i_pattern]);
+            const std::uint8_t btsMask(pattern.btsMasks[i_pattern]);
+            if ((levelData.layer1[i_block] & blockMask) != (pattern.blocks[i_pattern] & blockMask) || (levelData.bts[i_block] & btsMask) != (pattern.bts[i_pattern] & btsMask))
+                return false;
+        }
+
+    return true;
+}
+
+// Positions of the pattern's top-left corner, in row major order. The anchor block is compared sixteen blocks at a time and only its hits are verified in full
+static std::vector<std::pair<index_t, index_t>> findMatches(const LevelData& levelData, const BlockPattern& pattern, index_t i_anchor)
+try
+{
+    std::vector<std::pair<index_t, index_t>> ret;
+    if (pattern.width > levelData.width || pattern.height > levelData.height)
+        return ret;
+
+    const index_t x_anchor(i_anchor % pattern.width), y_anchor(i_anchor / pattern.width);
+    const std::uint16_t mask(pattern.blockMasks[i_anchor]), value(std::uint16_t(pattern.blocks[i_anchor] & mask));
+    const auto verify([&](index_t i_block)
+    {
+        const index_t x(i_block % levelData.width), y(i_block / levelData.width);
+        if (x < x_anchor || x - x_anchor + pattern.width > levelData.width)
+            return;
+
+        if (isMatch(levelData, pattern, x - x_anchor, y - y_anchor))
+            ret.emplace_back(x - x_anchor, y - y_anchor);
+    });
+
+    // Only the rows the anchor can be in are scanned
+    index_t i(y_anchor * levelData.width);
+    const index_t i_end((levelData.height - pattern.height + y_anchor + 1) * levelData.width);
+    const __m256i maskVector(_mm256_set1_epi16(short(mask))), valueVector(_mm256_set1_epi16(short(value)));
+    for (; i + 16 <= i_end; i += 16)
+    {
+        const __m256i blocks(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&levelData.layer1[i])));
+        unsigned hits(unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(blocks, maskVector), valueVector))));
+        while (hits)
+        {
+            // Two mask bits per block
+            const unsigned i_bit(unsigned(std::countr_zero(hits)));
+            verify(i + i_bit / 2);
+            hits &= ~(3u << i_bit);
+        }
+    }
+
+    for (; i < i_end; ++i)
+        if ((levelData.layer1[i] & mask) == value)
+            verify(i);
+
+    return ret;
+}
+LOG_RETHROW
+
+BlockPattern parseBlockPattern(std::string_view text)
+try
+{
+    // Returns the value and mask of a run of hex digits
+    const auto parseHex([](std::string_view digits) -> std::pair<unsigned, unsigned>
+    {
+        unsigned value{}, mask{};
+        for (char c : digits)
+        {
+            value <<= 4;
+            mask <<= 4;
+            if (c == '?')
+                continue;
+
+            mask |= 0xF;
+            if ('0' <= c && c <= '9')
+                value |= unsigned(c - '0');
+            else if ('A' <= (c & ~0x20) && (c & ~0x20) <= 'F')
+                value |= unsigned((c & ~0x20) - 'A' + 10);
+            else
+                throw std::runtime_error(LOG_INFO "Invalid hex digit '"s + c + "' in block pattern"s);
+        }
+
+        return {value, mask};
+    });
+
+    BlockPattern ret{};
+    std::istringstream lines{std::string(text)};
+    for (std::string line; std::getline(lines, line);)
+    {
+        std::istringstream cells(line);
+        n_t n_cells{};
+        for (std::string cell; cells >> cell; ++n_cells)
+        {
+            if (std::size(cell) != 7 || cell[4] != ':')
+                throw std::runtime_error(LOG_INFO "Block pattern cell \""s + cell + "\" isn't BBBB:TT"s);
+
+            const auto [block, blockMask](parseHex(std::string_view(cell).substr(0, 4)));
+            const auto [bts, btsMask](parseHex(std::string_view(cell).substr(5, 2)));
+            ret.blocks.push_back(std::uint16_t(block));
+            ret.blockMasks.push_back(std::uint16_t(blockMask));
+            ret.bts.push_back(std::uint8_t(bts));
+            ret.btsMasks.push_back(std::uint8_t(btsMask));
+        }
+
+        if (!n_cells)
+            continue;
+
+        if (ret.height && n_cells != ret.width)
+            throw std::runtime_error(LOG_INFO "Block pattern rows have different lengths"s);
+
+        ret.width = n_cells;
+        ++ret.height;
+    }
+
+    checkPattern(ret);
+    return ret;
+}
+LOG_RETHROW
+
+BlockSearchResult findBlockPattern(const Rom& rom, const BlockPattern& pattern, FunctionRef<void(const BlockMatch&)> onMatch)
+try
+{
+    checkPattern(pattern);
+    const index_t i_anchor(findAnchor(pattern));
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<Job> jobs(makeJobs(rooms));
+
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    BlockSearchResult ret;
+    std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](const Job& job)
+    {
+        const auto [p_room, i_state](job.users.front());
+        try
+        {
+            // Corrupt level data is routine in hacks, so it's reported without exceptions
+            const Result<LevelData> levelData(LevelData::tryLoad(rom, *p_room, p_room->states[i_state]));
+            if (!levelData)
+            {
+                const std::lock_guard lock(mutex);
+                ++ret.n_levelDataFailed;
+                errors.push_back("Level data $"s + toHexString(job.levelDataPointer, 3) + " of room $"s + toHexString(p_room->address) + ": "s + levelData.error().message());
+                return;
+            }
+
+            const std::vector<std::pair<index_t, index_t>> matches(findMatches(*levelData, pattern, i_anchor));
+
+            const std::lock_guard lock(mutex);
+            ++ret.n_levelDataSearched;
+            for (const auto& [p_user, i_userState] : job.users)
+                for (const auto& [x, y] : matches)
+                {
+                    onMatch({p_user->address, i_userState, job.levelDataPointer, x, y});
+                    ++ret.n_matches;
+                }
+        }
+        catch (const std::exception& e)
+        {
+            const std::lock_guard lock(mutex);
+            ++ret.n_levelDataFailed;
+            errors.push_back("Level data $"s + toHexString(job.levelDataPointer, 3) + " of room $"s + toHexString(p_room->address) + ": "s + e.what());
+        }
+    });
+
+    // One debug file for all of them, a corrupt ROM can have an error per room
+    if (!std::empty(errors))
+    {
+        DebugFile debugFile(DebugFile::warning);
+        for (const std::string& error : errors)
+            debugFile << LOG_INFO "Block search failed: "s << error << '\n';
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+BlockReplaceResult replaceBlockPattern(Rom& rom, const BlockPattern& pattern, const BlockPattern& replacement)
+try
+{
+    checkPattern(pattern);
+    checkPattern(replacement);
+    if (replacement.width != pattern.width || replacement.height != pattern.height)
+        throw std::runtime_error(LOG_INFO "Replacement is a different size to the pattern"s);
+
+    const index_t i_anchor(findAnchor(pattern));
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<Job> jobs(makeJobs(rooms));
+
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    const auto addError([&](std::string error)
+    {
+        const std::lock_guard lock(mutex);
+        errors.push_back(std::move(error));
+    });
+
+    // Matching, replacing and recompressing are all per level data, so they're done together on the workers; the ROM is only written once they're all done
+    std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](Job& job)
+    {
+        const auto [p_room, i_state](job.users.front());
+        try
+        {
+            Result<LevelData> loaded(LevelData::tryLoad(rom, *p_room, p_room->states[i_state]));
+            if (!loaded)
+            {
+                addError("Level data $"s + toHexString(job.levelDataPointer, 3) + " of room $"s + toHexString(p_room->address) + ": "s + loaded.error().message());
+                return;
+            }
+
+            LevelData& levelData(*loaded);
+            const std::vector<std::pair<index_t, index_t>> matches(findMatches(levelData, pattern, i_anchor));
+            if (std::empty(matches))
+                return;
+
+            const std::vector<std::uint8_t> original(levelData.toBytes());
+            for (const auto& [x, y] : matches)
+                for (index_t y_pattern{}; y_pattern < pattern.height; ++y_pattern)
+                    for (index_t x_pattern{}; x_pattern < pattern.width; ++x_pattern)
+                    {
+                        const index_t i_pattern(y_pattern * pattern.width + x_pattern);
+                        const index_t i_block((y + y_pattern) * levelData.width + x + x_pattern);
+                        const std::uint16_t blockMask(replacement.blockMasks[i_pattern]);
+                        const std::uint8_t btsMask(replacement.btsMasks[i_pattern]);
+                        std::uint16_t& block(levelData.layer1[i_block]);
+                        std::uint8_t& bts(levelData.bts[i_block]);
+                        block = std::uint16_t((block & ~blockMask) | (replacement.blocks[i_pattern] & blockMask));
+                        bts = std::uint8_t((bts & ~btsMask) | (replacement.bts[i_pattern] & btsMask));
+                    }
+
+            job.n_matches = std::size(matches) * std::size(job.users);
+            const std::vector<std::uint8_t> replaced(levelData.toBytes());
+            if (replaced == original)
+                return;
+
+            job.compressed = compress(replaced);
+            job.originalSize = levelData.compressedSize;
+        }
+        catch (const std::exception& e)
+        {
+            addError("Level data $"s + toHexString(job.levelDataPointer, 3) + " of room $"s + toHexString(p_room->address) + ": "s + e.what());
+        }
+    });
+
+    BlockReplaceResult ret;
+    ret.n_levelDataFailed = std::size(errors);
+    for (const Job& job : jobs)
+    {
+        ret.n_matches += job.n_matches;
+        if (std::empty(job.compressed))
+            continue;
+
+        if (std::size(job.compressed) > job.originalSize)
+        {
+            ++ret.n_levelDataFailed;
+            errors.push_back
+            (
+                "Level data $"s + toHexString(job.levelDataPointer, 3) + " recompresses to "s + std::to_string(std::size(job.compressed))
+                + " bytes, more than its original "s + std::to_string(job.originalSize)
+            );
+            continue;
+        }
+
+        rom.write(job.levelDataPointer, job.compressed);
+        ++ret.n_levelDataChanged;
+    }
+
+    if (!std::empty(errors))
+    {
+        DebugFile debugFile(DebugFile::warning);
+        for (const std::string& error : errors)
+            debugFile << LOG_INFO "Block replace failed: "s << error << '\n';
+    }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,47 @@
+module;
+
+#include "../global.h"
+
+export module block_search;
+
+export import sm_room;
+
+// A rectangle of layer 1 blocks and BTS, row major. When searching, a block matches where (block & mask) == (pattern block & mask), so a zero mask is a wildcard.
+// When replacing, the mask selects the bits that are written
+export struct BlockPattern
+{
+    n_t width, height;
+    std::vector<std::uint16_t> blocks, blockMasks;
+    std::vector<std::uint8_t> bts, btsMasks;
+};
+
+// Parses a pattern written as rows of cells, one row per line. A cell is the block and BTS in hex, "BBBB:TT", where a '?' digit is a wildcard digit
+// (searching) or a digit left as it is (replacing). For example "9?40:0? 8000:??"
+export BlockPattern parseBlockPattern(std::string_view text);
+
+// (x, y) is the position in blocks of the pattern's top-left corner
+export struct BlockMatch
+{
+    std::uint16_t roomAddress;
+    index_t i_state;
+    std::uint32_t levelDataPointer;
+    index_t x, y;
+};
+
+export struct BlockSearchResult
+{
+    n_t n_matches{}, n_levelDataSearched{}, n_levelDataFailed{};
+};
+
+export struct BlockReplaceResult
+{
+    n_t n_matches{}, n_levelDataChanged{}, n_levelDataFailed{};
+};
+
+// Searches every room state's level data in parallel, level data shared between room states is searched once and reported for each of them.
+// `onMatch` is called from the worker threads as each level data finishes, one call at a time, so results can be shown while the search runs
+export BlockSearchResult findBlockPattern(const Rom& rom, const BlockPattern& pattern, FunctionRef<void(const BlockMatch&)> onMatch);
+
+// Writes `replacement` over every match of `pattern`, matching against the level data as it was before any replacement.
+// Changed level data is recompressed in parallel, then written back in one pass. Level data that no longer fits in its original space is left as it was and counted as failed
+export BlockReplaceResult replaceBlockPattern(Rom& rom, const BlockPattern& pattern, const BlockPattern& replacement);
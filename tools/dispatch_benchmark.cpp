@@ -0,0 +1,177 @@
+#include "../global.h"
+
+import dispatch_benchmark;
+
+import game_traits;
+
+static const n_t
+    n_tiles(0x8000),
+    n_blocks(0x100000),
+    n_addresses(0x100000),
+    n_runs(5);
+
+// The baseline switches on the game for every element, as code that stores "which game" on an object and checks it in the loop does.
+// The loops read the game from a per element array, so the compiler can't prove it's the same each time and hoist the switch out of the loop
+static void decodeTileSwitch(GameId game, const std::uint8_t* p_in, std::uint8_t* p_out) noexcept
+{
+    switch (game)
+    {
+    case GameId::superMetroid:
+        SnesTile4bpp::decode(p_in, p_out);
+        break;
+
+    case GameId::metroidFusion:
+    case GameId::zeroMission:
+        GbaTile4bpp::decode(p_in, p_out);
+        break;
+    }
+}
+
+static DecodedBlock decodeBlockSwitch(GameId game, std::uint16_t block) noexcept
+{
+    switch (game)
+    {
+    case GameId::superMetroid:
+        return SuperMetroidBlockFormat::decode(block);
+
+    case GameId::metroidFusion:
+    case GameId::zeroMission:
+        return GbaBlockFormat::decode(block);
+    }
+
+    return {};
+}
+
+// Checked as the batch functions are, zero and `isInvalid` set for an address that isn't a ROM address or that maps to romSize or beyond
+template<AddressMapping Mapping>
+static index_t checkedToPc(std::uint32_t address, n_t romSize, bool& isInvalid) noexcept
+{
+    isInvalid = !Mapping::isRomAddress(address) || Mapping::toPc(address) >= romSize;
+    return isInvalid ? 0 : Mapping::toPc(address);
+}
+
+static index_t toPcSwitch(GameId game, std::uint32_t address, n_t romSize, bool& isInvalid) noexcept
+{
+    switch (game)
+    {
+    case GameId::superMetroid:
+        return checkedToPc<LoRomMapping>(address, romSize, isInvalid);
+
+    case GameId::metroidFusion:
+    case GameId::zeroMission:
+        return checkedToPc<GbaMapping>(address, romSize, isInvalid);
+    }
+
+    isInvalid = true;
+    return {};
+}
+
+// Best of n_runs, in nanoseconds per element
+template<typename F>
+static double time(n_t n_elements, F f)
+{
+    double best(std::numeric_limits<double>::infinity());
+    for (index_t i_run{}; i_run < n_runs; ++i_run)
+    {
+        const auto startTime(std::chrono::steady_clock::now());
+        f();
+        const std::chrono::duration<double, std::nano> duration(std::chrono::steady_clock::now() - startTime);
+        best = std::min(best, duration.count() / double(n_elements));
+    }
+
+    return best;
+}
+
+void runDispatchBenchmark(std::ostream& out)
+try
+{
+    std::mt19937 random(0);
+    std::vector<std::uint8_t> tileData(n_tiles * 0x20);
+    for (std::uint8_t& v : tileData)
+        v = std::uint8_t(random());
+
+    std::vector<std::uint16_t> blocks(n_blocks);
+    for (std::uint16_t& v : blocks)
+        v = std::uint16_t(random());
+
+    std::vector<std::uint8_t> tiles(n_tiles * 0x40);
+    std::vector<DecodedBlock> decodedBlocks(n_blocks);
+    std::vector<index_t> pcAddresses(n_addresses);
+    std::vector<std::uint64_t> invalidAddresses(invalidMaskSize(n_addresses));
+
+    // Results are folded into a checksum so none of the work can be optimised away
+    std::uint64_t checksum{};
+
+    out << std::left << std::setw(22) << "Game"s << std::setw(11) << "Operation"s << std::right << std::setw(16) << "Switch (ns)"s << std::setw(16) << "Traits (ns)"s << std::setw(10) << "Speedup"s << '\n';
+    out << std::fixed;
+    for (GameId id : {GameId::superMetroid, GameId::metroidFusion, GameId::zeroMission})
+    {
+        const std::unique_ptr<Game> p_game(makeGame(id));
+        const std::vector<GameId> games(std::max({n_tiles, n_blocks, n_addresses}), id);
+
+        // Smaller than the range the addresses are generated in, so both the valid and the invalid paths are taken
+        const n_t romSize(p_game->platform() == Platform::snes ? 0x18'0000 : 0x60'0000);
+        std::vector<std::uint32_t> addresses(n_addresses);
+        for (std::uint32_t& address : addresses)
+            address = p_game->platform() == Platform::snes
+                ? std::uint32_t(0x80'8000 | random() % 0x40 << 16 | random() % 0x8000)
+                : std::uint32_t(0x0800'0000 | random() % 0x80'0000);
+
+        const auto report([&](std::string_view operation, double switchTime, double traitsTime)
+        {
+            out
+                << std::left << std::setw(22) << p_game->name() << std::setw(11) << operation << std::right << std::setprecision(3)
+                << std::setw(16) << switchTime << std::setw(16) << traitsTime << std::setprecision(2) << std::setw(9) << switchTime / traitsTime << "x\n"s;
+        });
+
+        report("tiles"sv,
+            time(n_tiles, [&]()
+            {
+                for (index_t i{}; i < n_tiles; ++i)
+                    decodeTileSwitch(games[i], &tileData[i * 0x20], &tiles[i * 0x40]);
+
+                checksum += tiles[random() % std::size(tiles)];
+            }),
+            time(n_tiles, [&]()
+            {
+                p_game->decodeTiles(tileData, tiles);
+                checksum += tiles[random() % std::size(tiles)];
+            }));
+
+        report("blocks"sv,
+            time(n_blocks, [&]()
+            {
+                for (index_t i{}; i < n_blocks; ++i)
+                    decodedBlocks[i] = decodeBlockSwitch(games[i], blocks[i]);
+
+                checksum += decodedBlocks[random() % n_blocks].i_metatile;
+            }),
+            time(n_blocks, [&]()
+            {
+                p_game->decodeBlocks(blocks, decodedBlocks);
+                checksum += decodedBlocks[random() % n_blocks].i_metatile;
+            }));
+
+        report("addresses"sv,
+            time(n_addresses, [&]()
+            {
+                std::ranges::fill(invalidAddresses, std::uint64_t{});
+                for (index_t i{}; i < n_addresses; ++i)
+                {
+                    bool isInvalid;
+                    pcAddresses[i] = toPcSwitch(games[i], addresses[i], romSize, isInvalid);
+                    invalidAddresses[i / 0x40] |= std::uint64_t(isInvalid) << i % 0x40;
+                }
+
+                checksum += pcAddresses[random() % n_addresses] + invalidAddresses[random() % std::size(invalidAddresses)];
+            }),
+            time(n_addresses, [&]()
+            {
+                p_game->toPc(addresses, pcAddresses, invalidAddresses, romSize);
+                checksum += pcAddresses[random() % n_addresses] + invalidAddresses[random() % std::size(invalidAddresses)];
+            }));
+    }
+
+    out << "Checksum: "s << toHexString(checksum) << '\n';
+}
+LOG_RETHROW
@@ -0,0 +1,9 @@
+module;
+
+#include "../global.h"
+
+export module dispatch_benchmark;
+
+// Times the per tile, per block and per address hot paths through Game (one virtual call per batch, loops compiled per game)
+// against a runtime switch on the game for every element, on synthetic data, and writes a table of the results
+export void runDispatchBenchmark(std::ostream& out);
@@ -0,0 +1,92 @@
+#include "../global.h"
+
+import memory_soak;
+
+MemorySoakResult runMemorySoak(const Rom& rom, n_t n_loads, n_t n_samples, AssetCache* p_cache)
+try
+{
+    const std::vector<Room> rooms(findRooms(rom));
+    if (std::empty(rooms))
+        throw std::runtime_error(LOG_INFO "No rooms found"s);
+
+    MemorySoakResult ret;
+    MemoryArena sessionArena(MemoryScope::session), areaArena(MemoryScope::area), roomArena(MemoryScope::room);
+    std::optional<std::uint8_t> i_arenaArea;
+
+    // Declared after the arenas so that they're destroyed first
+    std::map<index_t, Tileset> tilesets;
+    std::map<std::uint16_t, LevelData> levelData;
+
+    const auto takeSample([&](n_t n_done)
+    {
+        MemorySoakSample& sample(ret.samples.emplace_back(n_done));
+        for (index_t i{}; i < n_memorySubsystems; ++i)
+            sample.subsystemBytes[i] = memoryCounter(MemorySubsystem(i)).usage().bytesLive;
+
+        for (index_t i{}; i < n_memoryScopes; ++i)
+            sample.scopeBytes[i] = memoryCounter(MemoryScope(i)).usage().bytesLive;
+    });
+
+    for (index_t i_load{}; i_load < n_loads; ++i_load)
+    {
+        const Room& room(rooms[i_load % std::size(rooms)]);
+        roomArena.reset();
+        ret.maxRoomBytesAfterReset = std::max(ret.maxRoomBytesAfterReset, memoryCounter(MemoryScope::room).usage().bytesLive);
+        if (i_arenaArea != room.i_area)
+        {
+            levelData.clear();
+            areaArena.reset();
+            i_arenaArea = room.i_area;
+        }
+
+        try
+        {
+            const RoomState& state(room.defaultState());
+            if (!levelData.contains(state.address))
+                levelData.emplace(state.address, LevelData(rom, room, state, p_cache, areaArena.resource(MemorySubsystem::rooms)));
+
+            if (!tilesets.contains(state.i_tileset))
+                tilesets.emplace(state.i_tileset, Tileset(rom, state.i_tileset, p_cache, sessionArena.resource(MemorySubsystem::tiles)));
+
+            const std::pmr::vector<Enemy> enemies(loadEnemyPopulation(rom, state, roomArena.resource(MemorySubsystem::sprites)));
+            const std::pmr::vector<Plm> plms(loadPlmPopulation(rom, state, roomArena.resource(MemorySubsystem::sprites)));
+        }
+        catch (const std::exception& e)
+        {
+            // Each room fails the same way every time round, so only the first time is logged
+            if (i_load < std::size(rooms))
+                DebugFile(DebugFile::warning) << LOG_INFO "Room $"s << toHexString(room.address) << " failed to load: "s << e.what() << '\n';
+
+            ++ret.n_failedLoads;
+        }
+
+        if ((i_load + 1) * n_samples / n_loads != i_load * n_samples / n_loads)
+            takeSample(i_load + 1);
+    }
+
+    return ret;
+}
+LOG_RETHROW
+
+void writeMemorySoakReport(std::ostream& out, const MemorySoakResult& result)
+try
+{
+    // Live bytes should be the same at every sample once every area has been through the area arena
+    out << std::right << std::setw(12) << "Loads" << std::setw(12) << "Rooms" << std::setw(12) << "Tiles" << std::setw(12) << "Sprites"
+        << std::setw(12) << "Session" << std::setw(12) << "Area" << std::setw(12) << "Room" << '\n';
+
+    for (const MemorySoakSample& sample : result.samples)
+    {
+        out << std::setw(12) << sample.n_loads;
+        for (n_t bytes : sample.subsystemBytes)
+            out << std::setw(12) << bytes;
+
+        for (n_t bytes : sample.scopeBytes)
+            out << std::setw(12) << bytes;
+
+        out << '\n';
+    }
+
+    out << "Room arena held at most "s << result.maxRoomBytesAfterReset << " bytes after a reset, "s << result.n_failedLoads << " loads failed\n\n"s << memoryReport();
+}
+LOG_RETHROW
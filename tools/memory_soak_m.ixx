@@ -0,0 +1,31 @@
+module;
+
+#include "../global.h"
+
+export module memory_soak;
+
+export import sm_sprites;
+export import sm_tileset;
+
+// Live bytes of each subsystem and scope after `n_loads` loads
+export struct MemorySoakSample
+{
+    n_t n_loads;
+    std::array<n_t, n_memorySubsystems> subsystemBytes;
+    std::array<n_t, n_memoryScopes> scopeBytes;
+};
+
+export struct MemorySoakResult
+{
+    std::vector<MemorySoakSample> samples;
+
+    // The most the room arena held straight after a reset, anything but zero is memory that outlived its room
+    n_t maxRoomBytesAfterReset{};
+    n_t n_failedLoads{};
+};
+
+// Loads the ROM's rooms in turn `n_loads` times into arenas as the main window loads a savestate's room: level data into the area arena, reset when the area changes,
+// tilesets into the session arena, and enemy and PLM populations into the room arena, reset every load. Memory is sampled `n_samples` times, evenly through the loads
+export MemorySoakResult runMemorySoak(const Rom& rom, n_t n_loads, n_t n_samples, AssetCache* p_cache);
+
+export void writeMemorySoakReport(std::ostream& out, const MemorySoakResult& result);
@@ -0,0 +1,144 @@
+#include "../global.h"
+
+import room_export;
+
+import png;
+
+struct Job
+{
+    const Room* p_room;
+    index_t i_state;
+    std::pmr::vector<Enemy> enemies;
+    std::pmr::vector<Plm> plms;
+};
+
+static std::filesystem::path makeFilename(const Room& room, index_t i_state, bool allStates)
+try
+{
+    std::string filename("room_"s + toHexString(room.i_area) + '_' + toHexString(room.address));
+    if (allStates)
+        filename += "_state"s + std::to_string(i_state);
+
+    return filename + ".png"s;
+}
+LOG_RETHROW
+
+static void exportRoom(const std::filesystem::path& filepath, const RoomRenderer& renderer, unsigned compressionLevel)
+try
+{
+    // Rendering a row of blocks at a time keeps memory flat regardless of room size
+    std::ofstream out(filepath, std::ios::binary);
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+
+    PngWriter png(out, renderer.width(), renderer.height(), compressionLevel);
+    Image strip(renderer.width(), blockSize);
+    for (index_t y_block{}; y_block < renderer.height() / blockSize; ++y_block)
+    {
+        renderer.renderBlockRow(y_block, strip);
+        for (index_t y{}; y < blockSize; ++y)
+            png.writeRow(strip.row(y));
+    }
+
+    png.finish();
+}
+LOG_RETHROW
+
+RoomExportResult exportRooms(const Rom& rom, const RoomExportOptions& options)
+try
+{
+    create_directories(options.outputDirectory);
+
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<Job> jobs;
+    std::set<index_t> tilesetIndices;
+
+    // The populations are moved into the jobs, which needs them to have the same memory resource
+    std::pmr::memory_resource* const p_sprites(memoryResource(MemorySubsystem::sprites));
+    for (const Room& room : rooms)
+    {
+        const index_t i_firstState(options.allStates ? 0 : std::size(room.states) - 1);
+        for (index_t i_state(i_firstState); i_state < std::size(room.states); ++i_state)
+        {
+            jobs.push_back({&room, i_state, std::pmr::vector<Enemy>(p_sprites), std::pmr::vector<Plm>(p_sprites)});
+            tilesetIndices.insert(room.states[i_state].i_tileset);
+        }
+    }
+
+    // Worker threads collect errors rather than logging them as they go, so the log isn't interleaved
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    const auto addError([&](std::string error)
+    {
+        const std::lock_guard lock(mutex);
+        errors.push_back(std::move(error));
+    });
+
+    // Each tileset is decompressed once up front and shared by all the rooms that use it
+    std::vector<std::optional<Tileset>> tilesets(Tileset::n_tilesets);
+    std::for_each(std::execution::par, std::begin(tilesetIndices), std::end(tilesetIndices), [&](index_t i_tileset)
+    {
+        try
+        {
+            if (i_tileset < std::size(tilesets))
+                tilesets[i_tileset].emplace(rom, i_tileset, options.p_assetCache);
+        }
+        catch (const std::exception& e)
+        {
+            addError("Tileset "s + toHexString(i_tileset, 1) + ": "s + e.what());
+        }
+    });
+
+    // Object populations are loaded up front so that every enemy type is decoded once and packed into one atlas shared by all the rooms
+    ObjectSprites objectSprites;
+    if (options.sprites)
+    {
+        std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](Job& job)
+        {
+            try
+            {
+                const RoomState& state(job.p_room->states[job.i_state]);
+                job.enemies = loadEnemyPopulation(rom, state);
+                job.plms = loadPlmPopulation(rom, state);
+            }
+            catch (const std::exception& e)
+            {
+                addError("Room $"s + toHexString(job.p_room->address) + " state "s + std::to_string(job.i_state) + " objects: "s + e.what());
+            }
+        });
+
+        std::vector<Enemy> enemies;
+        for (const Job& job : jobs)
+            enemies.insert(std::end(enemies), std::begin(job.enemies), std::end(job.enemies));
+
+        objectSprites.addEnemyTypes(rom, enemies);
+    }
+
+    std::atomic<n_t> n_exported{};
+    std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](const Job& job)
+    {
+        const Room& room(*job.p_room);
+        try
+        {
+            const RoomState& state(room.states[job.i_state]);
+            if (state.i_tileset >= std::size(tilesets) || !tilesets[state.i_tileset])
+                throw std::runtime_error(LOG_INFO "Tileset "s + toHexString(state.i_tileset) + " is not available"s);
+
+            const LevelData levelData(rom, room, state, options.p_assetCache);
+            const std::vector<SpriteInstance> sprites(objectSprites.layout(job.enemies, job.plms));
+            const RoomRenderer renderer(*tilesets[state.i_tileset], levelData, options.renderOptions, &objectSprites.atlas(), sprites);
+            exportRoom(options.outputDirectory / makeFilename(room, job.i_state, options.allStates), renderer, options.compressionLevel);
+            ++n_exported;
+        }
+        catch (const std::exception& e)
+        {
+            addError("Room $"s + toHexString(room.address) + " state "s + std::to_string(job.i_state) + ": "s + e.what());
+        }
+    });
+
+    for (const std::string& error : errors)
+        DebugFile(DebugFile::warning) << LOG_INFO "Room export failed: "s << error << '\n';
+
+    const n_t n_failedRooms(std::size(jobs) - n_exported);
+    return {n_exported, n_failedRooms};
+}
+LOG_RETHROW
@@ -0,0 +1,34 @@
+module;
+
+#include "../global.h"
+
+export module room_export;
+
+export import room_renderer;
+export import sm_sprites;
+
+export struct RoomExportOptions
+{
+    std::filesystem::path outputDirectory;
+    RoomRenderOptions renderOptions;
+
+    // Export every room state rather than only the default state
+    bool allStates{};
+
+    // Draw enemies and PLMs over the level data
+    bool sprites{};
+
+    unsigned compressionLevel{1};
+
+    // Tilesets and level data are decompressed through this if given
+    AssetCache* p_assetCache{};
+};
+
+export struct RoomExportResult
+{
+    n_t n_exported{}, n_failed{};
+};
+
+// Renders rooms to PNG files named room_<area>_<room address>[_state<n>].png, one room per task across all cores.
+// A room that fails to export is logged and skipped
+export RoomExportResult exportRooms(const Rom& rom, const RoomExportOptions& options);
@@ -0,0 +1,55 @@
+#include "../global.h"
+
+import scene_animation;
+
+import png;
+
+SceneAnimationResult animateScene(const Rom& rom, const SceneAnimationOptions& options)
+try
+{
+    if (!Room::isValid(rom, options.roomAddress))
+        throw std::runtime_error(LOG_INFO "$"s + toHexString(options.roomAddress) + " isn't a room in this ROM"s);
+
+    const Room room(rom, options.roomAddress);
+    const index_t i_state(options.i_state.value_or(std::size(room.states) - 1));
+    if (i_state >= std::size(room.states))
+        throw std::runtime_error(LOG_INFO "Room $"s + toHexString(room.address) + " has no state "s + std::to_string(i_state));
+
+    if (options.outputDirectory)
+        create_directories(*options.outputDirectory);
+
+    SceneAnimationResult ret;
+    const RoomState& state(room.states[i_state]);
+    ret.rates = options.rates.value_or(parallaxRates(state));
+
+    const auto startTime(std::chrono::steady_clock::now());
+    const Tileset tileset(rom, state.i_tileset, options.p_assetCache);
+    const LevelData levelData(rom, room, state, options.p_assetCache);
+    const ScenePreview scene(tileset, levelData, ret.rates);
+    ret.prepareTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+
+    std::vector<CameraPosition> path(scene.sweep(options.speed));
+    if (options.n_maxFrames && std::size(path) > options.n_maxFrames)
+        path.resize(options.n_maxFrames);
+
+    Image frame(0x100, 0xE0);
+    for (const CameraPosition& camera : path)
+    {
+        const auto frameStartTime(std::chrono::steady_clock::now());
+        scene.compose(camera, frame);
+        const auto frameTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frameStartTime));
+        ret.composeTime += frameTime;
+        ret.slowestFrameTime = std::max(ret.slowestFrameTime, frameTime);
+
+        if (options.outputDirectory)
+        {
+            const std::string i_frame(std::to_string(ret.n_frames));
+            writePng(*options.outputDirectory / ("frame_"s + std::string(5 - std::min(std::size(i_frame), n_t(5)), '0') + i_frame + ".png"s), frame, options.compressionLevel);
+        }
+
+        ++ret.n_frames;
+    }
+
+    return ret;
+}
+LOG_RETHROW
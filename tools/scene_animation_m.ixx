@@ -0,0 +1,47 @@
+module;
+
+#include "../global.h"
+
+export module scene_animation;
+
+export import scene_preview;
+
+export struct SceneAnimationOptions
+{
+    std::uint16_t roomAddress;
+
+    // The default state if not given
+    std::optional<index_t> i_state;
+
+    // The room state's rates if not given
+    std::optional<ParallaxRates> rates;
+
+    // Frames are written to frame_<n>.png here if given, otherwise they're only composed for timing
+    std::optional<std::filesystem::path> outputDirectory;
+
+    // Camera speed in pixels a frame
+    n_t speed{4};
+
+    // Stop after this many frames if non-zero
+    n_t n_maxFrames{};
+
+    unsigned compressionLevel{1};
+
+    // Tilesets and level data are decompressed through this if given
+    AssetCache* p_assetCache{};
+};
+
+export struct SceneAnimationResult
+{
+    n_t n_frames{};
+    ParallaxRates rates;
+
+    // Rendering the layer surfaces, which is the only rendering of tiles
+    std::chrono::microseconds prepareTime{};
+
+    // Composing frames, not counting writing them
+    std::chrono::microseconds composeTime{}, slowestFrameTime{};
+};
+
+// Sweeps a camera through a room a frame at a time as the game would at 60 frames a second, composing each frame from the room's retained layers
+export SceneAnimationResult animateScene(const Rom& rom, const SceneAnimationOptions& options);
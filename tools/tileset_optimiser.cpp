@@ -0,0 +1,720 @@
+#include "../global.h"
+
+import tileset_optimiser;
+
+import compress;
+import decompress;
+import sm_sprites;
+import sm_tileset;
+import tile_format;
+
+static const n_t
+    tilePixels{0x40},
+    entriesPerMetatile{4},
+    fullTileTableSize{0x2000},
+    n_creMetatiles{0x100};
+
+static const std::uint16_t
+    tileNumberMask{0x3FF},
+    entryXFlip{0x4000},
+    entryYFlip{0x8000},
+    blockMetatileMask{0x3FF},
+    blockXFlip{0x400},
+    blockYFlip{0x800};
+
+// PLM headers, instruction lists and draw instructions are all in bank $84
+static const std::uint32_t plmBank{0x840000};
+
+// The PLM instructions that instruction lists are followed through, anything else takes arguments this doesn't know the size of
+static const std::uint16_t
+    plmSleepInstruction{0x86B4},
+    plmDeleteInstruction{0x86BC},
+    plmGotoInstruction{0x8724},
+    plmDecrementTimerGotoInstruction{0x873F},
+    plmSetTimerInstruction{0x874E};
+
+static const n_t
+    maxPlmInstructions{0x200},
+    maxDrawEntries{0x40},
+    maxDrawEntryBlocks{0x40};
+
+// Metatiles a PLM's instruction list draws, as far as the list could be followed
+struct PlmDraws
+{
+    std::set<index_t> i_metatiles;
+    bool isComplete{true};
+};
+
+// Level data is loaded once however many room states use it
+struct LevelDataJob
+{
+    std::uint32_t pointer;
+    const Room* p_room;
+    index_t i_state;
+    std::set<index_t> i_tilesets{};
+    std::optional<LevelData> levelData{};
+    std::string error{};
+};
+
+struct TileTableBlob
+{
+    std::uint32_t address;
+    n_t compressedSize;
+    std::vector<std::uint16_t> entries;
+
+    // Metatile number of the first entry, 100h if the common metatiles come first
+    index_t i_firstMetatile;
+};
+
+struct TilesBlob
+{
+    std::uint32_t address;
+    n_t compressedSize;
+    std::vector<std::uint8_t> bytes;
+};
+
+struct Remap
+{
+    index_t i_to;
+    bool xFlip, yFlip;
+};
+
+// A tile of each tiles blob, or a metatile of each tile table, end to end, in whichever of its flips is lexicographically least
+template<typename T>
+struct Canonical
+{
+    std::vector<T> values;
+    bool xFlip, yFlip;
+};
+
+template<typename T>
+static Canonical<T> canonicalise(const std::vector<T>& values, FunctionRef<std::vector<T>(const std::vector<T>&, bool, bool)> flip)
+{
+    Canonical<T> ret{values, false, false};
+    for (const auto& [xFlip, yFlip] : {std::pair{true, false}, std::pair{false, true}, std::pair{true, true}})
+        if (std::vector<T> flipped(flip(values, xFlip, yFlip)); flipped < ret.values)
+            ret = {std::move(flipped), xFlip, yFlip};
+
+    return ret;
+}
+
+// Maps each candidate to the first candidate with the same canonical form. `canonicals` is parallel to `candidates`.
+// Candidates that mustn't be merged away are taken first, so they're the representatives where they can be
+template<typename T>
+static std::map<index_t, Remap> findDuplicates(std::span<const index_t> candidates, std::span<const Canonical<T>> canonicals, FunctionRef<bool(index_t)> isPinned)
+{
+    std::vector<index_t> order(std::size(candidates));
+    std::iota(std::begin(order), std::end(order), 0);
+    std::ranges::stable_partition(order, [&](index_t i){ return isPinned(candidates[i]); });
+
+    std::map<index_t, Remap> ret;
+    std::unordered_map<std::size_t, std::vector<index_t>> representatives;
+    for (index_t i : order)
+    {
+        const Canonical<T>& canonical(canonicals[i]);
+        const std::size_t hash(std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(std::data(canonical.values)), std::size(canonical.values) * sizeof(T))));
+        std::vector<index_t>& bucket(representatives[hash]);
+        const auto it(std::ranges::find_if(bucket, [&](index_t i_representative){ return canonicals[i_representative].values == canonical.values; }));
+        if (it == std::end(bucket) || isPinned(candidates[i]))
+        {
+            bucket.push_back(i);
+            continue;
+        }
+
+        // Both are flips of the canonical form, and flips undo themselves, so the candidate is the representative flipped by the difference
+        const Canonical<T>& representative(canonicals[*it]);
+        ret[candidates[i]] = {candidates[*it], canonical.xFlip != representative.xFlip, canonical.yFlip != representative.yFlip};
+    }
+
+    return ret;
+}
+
+static std::vector<std::uint8_t> decodeTile(const TilesBlob& blob, index_t i_tile)
+{
+    std::vector<std::uint8_t> ret(tilePixels);
+    SnesTile4bpp::decode(&blob.bytes[i_tile * SnesTile4bpp::bytesPerTile], std::data(ret));
+    return ret;
+}
+
+static std::vector<std::uint8_t> flipTiles(const std::vector<std::uint8_t>& tiles, bool xFlip, bool yFlip)
+{
+    std::vector<std::uint8_t> ret(std::size(tiles));
+    for (index_t i_tile{}; i_tile < std::size(tiles) / tilePixels; ++i_tile)
+        for (index_t y{}; y < 8; ++y)
+            for (index_t x{}; x < 8; ++x)
+                ret[i_tile * tilePixels + y * 8 + x] = tiles[i_tile * tilePixels + (yFlip ? 7 - y : y) * 8 + (xFlip ? 7 - x : x)];
+
+    return ret;
+}
+
+// Entries are top-left, top-right, bottom-left, bottom-right per tile table
+static std::vector<std::uint16_t> flipMetatiles(const std::vector<std::uint16_t>& entries, bool xFlip, bool yFlip)
+{
+    std::vector<std::uint16_t> ret(std::size(entries));
+    for (index_t i_metatile{}; i_metatile < std::size(entries) / entriesPerMetatile; ++i_metatile)
+        for (index_t i{}; i < entriesPerMetatile; ++i)
+        {
+            const index_t i_from((xFlip ? i ^ 1 : i) ^ (yFlip ? 2 : 0));
+            ret[i_metatile * entriesPerMetatile + i] = std::uint16_t(entries[i_metatile * entriesPerMetatile + i_from] ^ (xFlip ? entryXFlip : 0) ^ (yFlip ? entryYFlip : 0));
+        }
+
+    return ret;
+}
+
+static std::vector<std::uint8_t> toBytes(std::span<const std::uint16_t> words)
+{
+    std::vector<std::uint8_t> ret;
+    for (std::uint16_t word : words)
+    {
+        ret.push_back(std::uint8_t(word));
+        ret.push_back(std::uint8_t(word >> 8));
+    }
+
+    return ret;
+}
+
+static std::vector<std::uint16_t> toWords(std::span<const std::uint8_t> bytes)
+{
+    std::vector<std::uint16_t> ret;
+    for (index_t i{}; i + 1 < std::size(bytes); i += 2)
+        ret.push_back(std::uint16_t(bytes[i] | bytes[i + 1] << 8));
+
+    return ret;
+}
+
+// Draw instructions are entries of a block count (bit 15 set for a column rather than a row) and that many level data blocks,
+// each entry but the last followed by the X and Y offset bytes of the next, and the last by a zero word
+static void addDrawnMetatiles(const Rom& rom, std::uint16_t drawPointer, std::set<index_t>& i_metatiles)
+try
+{
+    std::uint32_t address(plmBank | drawPointer);
+    for (index_t i_entry{}; i_entry < maxDrawEntries; ++i_entry)
+    {
+        const n_t n_blocks(rom.read16(address) & 0x7FFF);
+        if (!n_blocks || n_blocks > maxDrawEntryBlocks)
+            throw std::runtime_error(LOG_INFO "Invalid PLM draw instruction $"s + toHexString(plmBank | drawPointer, 3));
+
+        for (index_t i_block{}; i_block < n_blocks; ++i_block)
+            i_metatiles.insert(rom.read16(address + std::uint32_t(2 + i_block * 2)) & blockMetatileMask);
+
+        address += std::uint32_t(2 + n_blocks * 2);
+        if (!rom.read16(address))
+            return;
+
+        address += 2;
+    }
+
+    throw std::runtime_error(LOG_INFO "PLM draw instruction $"s + toHexString(plmBank | drawPointer, 3) + " doesn't end"s);
+}
+LOG_RETHROW
+
+// Instruction lists are timer, draw instruction pairs interleaved with instructions (ASM pointers, which are $8000+).
+// Every branch of the list is followed, up to the first instruction whose arguments aren't known
+static PlmDraws findPlmDraws(const Rom& rom, std::uint16_t id)
+{
+    PlmDraws ret;
+    try
+    {
+        std::set<std::uint16_t> visited;
+        std::vector<std::uint16_t> pending{rom.read16(plmBank | std::uint16_t(id + 2))};
+        for (n_t n_instructions{}; !std::empty(pending); ++n_instructions)
+        {
+            if (n_instructions == maxPlmInstructions)
+                throw std::runtime_error(LOG_INFO "PLM instruction list is too long"s);
+
+            const std::uint16_t pointer(pending.back());
+            pending.pop_back();
+            if (pointer < 0x8000 || !visited.insert(pointer).second)
+                continue;
+
+            const std::uint16_t instruction(rom.read16(plmBank | pointer));
+            if (instruction < 0x8000)
+            {
+                addDrawnMetatiles(rom, rom.read16(plmBank | std::uint16_t(pointer + 2)), ret.i_metatiles);
+                pending.push_back(std::uint16_t(pointer + 4));
+            }
+            else if (instruction == plmSleepInstruction)
+                pending.push_back(std::uint16_t(pointer + 2));
+            else if (instruction == plmGotoInstruction)
+                pending.push_back(rom.read16(plmBank | std::uint16_t(pointer + 2)));
+            else if (instruction == plmDecrementTimerGotoInstruction)
+            {
+                pending.push_back(rom.read16(plmBank | std::uint16_t(pointer + 2)));
+                pending.push_back(std::uint16_t(pointer + 4));
+            }
+            else if (instruction == plmSetTimerInstruction)
+                pending.push_back(std::uint16_t(pointer + 3));
+            else if (instruction != plmDeleteInstruction)
+                ret.isComplete = false;
+        }
+    }
+    catch (const std::exception&)
+    {
+        ret.isComplete = false;
+    }
+
+    return ret;
+}
+
+static void planGroup(const Rom& rom, TilesetGroupPlan& plan, std::span<const Tileset::Ranges> ranges, std::span<LevelDataJob* const> jobs, const std::vector<bool>& isMetatileDrawnByPlm,
+    const std::vector<std::uint16_t>& creTileTable, const TilesetOptimiseOptions& options)
+try
+{
+    // Distinct tile tables and tiles of the group
+    std::vector<TileTableBlob> tileTables;
+    std::vector<TilesBlob> tilesBlobs;
+    bool isCreUsed{};
+    for (index_t i_tileset : plan.i_tilesets)
+    {
+        if (const std::uint32_t address(Rom::pcToSnes(ranges[i_tileset].tileTable.begin)); std::ranges::find(tileTables, address, &TileTableBlob::address) == std::end(tileTables))
+        {
+            const Decompressed decompressed(decompress(rom.spanFrom(address)));
+            const index_t i_firstMetatile(std::size(decompressed.data) >= fullTileTableSize ? 0 : n_creMetatiles);
+            tileTables.push_back({address, decompressed.compressedSize, toWords(decompressed.data), i_firstMetatile});
+            isCreUsed |= i_firstMetatile != 0;
+        }
+
+        if (const std::uint32_t address(Rom::pcToSnes(ranges[i_tileset].tiles.begin)); std::ranges::find(tilesBlobs, address, &TilesBlob::address) == std::end(tilesBlobs))
+        {
+            Decompressed decompressed(decompress(rom.spanFrom(address)));
+            tilesBlobs.push_back({address, decompressed.compressedSize, std::move(decompressed.data)});
+        }
+    }
+
+    const std::vector<TileTableBlob> originalTileTables(tileTables);
+    const std::vector<TilesBlob> originalTilesBlobs(tilesBlobs);
+
+    // Metatiles that are tileset specific in every tile table, and tiles that are tileset specific in every tiles blob
+    index_t i_firstCandidateMetatile{}, i_endCandidateMetatile(Tileset::n_metatiles);
+    for (const TileTableBlob& blob : tileTables)
+    {
+        i_firstCandidateMetatile = std::max(i_firstCandidateMetatile, blob.i_firstMetatile);
+        i_endCandidateMetatile = std::min(i_endCandidateMetatile, blob.i_firstMetatile + std::size(blob.entries) / entriesPerMetatile);
+    }
+
+    n_t n_candidateTiles(Tileset::n_tiles);
+    for (const TilesBlob& blob : tilesBlobs)
+        n_candidateTiles = std::min(n_candidateTiles, std::size(blob.bytes) / SnesTile4bpp::bytesPerTile);
+
+    const auto isCandidateMetatile([&](index_t i_metatile)
+    {
+        return i_firstCandidateMetatile <= i_metatile && i_metatile < i_endCandidateMetatile;
+    });
+
+    // A PLM list that couldn't be followed could draw any metatile
+    const bool isDropping(options.dropUnused && std::empty(plan.unreadablePlms));
+
+    // Metatile usage
+    std::vector<n_t> metatileCounts(Tileset::n_metatiles);
+    for (const LevelDataJob* p_job : jobs)
+        for (const std::pmr::vector<std::uint16_t>* p_layer : {&p_job->levelData->layer1, &p_job->levelData->layer2})
+            for (std::uint16_t block : *p_layer)
+                ++metatileCounts[block & blockMetatileMask];
+
+    plan.n_levelData = std::size(jobs);
+    const auto candidateMetatiles(std::views::iota(i_firstCandidateMetatile, std::max(i_firstCandidateMetatile, i_endCandidateMetatile)));
+    plan.n_metatilesUsed = n_t(std::ranges::count_if(candidateMetatiles, [&](index_t i){ return metatileCounts[i] != 0; }));
+    plan.n_metatilesDrawnByPlms = n_t(std::ranges::count_if(candidateMetatiles, [&](index_t i){ return bool(isMetatileDrawnByPlm[i]); }));
+
+    // Metatiles PLMs draw are written by number, so they're never merged away or dropped
+    const auto isKeptMetatile([&](index_t i_metatile)
+    {
+        return !isCandidateMetatile(i_metatile) || metatileCounts[i_metatile] || isMetatileDrawnByPlm[i_metatile] || !isDropping;
+    });
+
+    // Tiles used by the common tile table can't have their entries rewritten
+    std::vector<bool> isTilePinned(Tileset::n_tiles), isTileUsed(Tileset::n_tiles);
+    if (isCreUsed)
+        for (std::uint16_t entry : creTileTable)
+            isTilePinned[entry & tileNumberMask] = isTileUsed[entry & tileNumberMask] = true;
+
+    const auto markUsedTiles([&]
+    {
+        for (const TileTableBlob& blob : tileTables)
+            for (index_t i{}; i < std::size(blob.entries); ++i)
+                if (isKeptMetatile(blob.i_firstMetatile + i / entriesPerMetatile))
+                    isTileUsed[blob.entries[i] & tileNumberMask] = true;
+    });
+
+    markUsedTiles();
+    plan.n_tilesUsed = n_t(std::count(std::begin(isTileUsed), std::begin(isTileUsed) + n_candidateTiles, true));
+
+    // Merge tiles, the tile tables' entries are rewritten to the representative with the difference in flip
+    if (options.mergeTiles)
+    {
+        std::vector<index_t> candidates;
+        for (index_t i_tile{}; i_tile < n_candidateTiles; ++i_tile)
+            if (isTileUsed[i_tile])
+                candidates.push_back(i_tile);
+
+        std::vector<Canonical<std::uint8_t>> canonicals(std::size(candidates));
+        std::vector<index_t> indices(std::size(candidates));
+        std::iota(std::begin(indices), std::end(indices), 0);
+        std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i)
+        {
+            std::vector<std::uint8_t> tiles;
+            for (const TilesBlob& blob : tilesBlobs)
+            {
+                const std::vector<std::uint8_t> tile(decodeTile(blob, candidates[i]));
+                tiles.insert(std::end(tiles), std::begin(tile), std::end(tile));
+            }
+
+            canonicals[i] = canonicalise<std::uint8_t>(tiles, flipTiles);
+        });
+
+        const std::map<index_t, Remap> remaps(findDuplicates<std::uint8_t>(candidates, canonicals, [&](index_t i_tile){ return bool(isTilePinned[i_tile]); }));
+        plan.n_tilesMerged = std::size(remaps);
+        for (TileTableBlob& blob : tileTables)
+            for (std::uint16_t& entry : blob.entries)
+                if (const auto it(remaps.find(entry & tileNumberMask)); it != std::end(remaps))
+                    entry = std::uint16_t(((entry & ~tileNumberMask) ^ (it->second.xFlip ? entryXFlip : 0) ^ (it->second.yFlip ? entryYFlip : 0)) | it->second.i_to);
+    }
+
+    // Merge metatiles, level data is rewritten to the representative with the difference in flip
+    std::map<index_t, Remap> metatileRemaps;
+    if (options.mergeMetatiles)
+    {
+        std::vector<index_t> candidates;
+        std::vector<Canonical<std::uint16_t>> canonicals;
+        for (index_t i_metatile(i_firstCandidateMetatile); i_metatile < i_endCandidateMetatile; ++i_metatile)
+        {
+            if (!metatileCounts[i_metatile] && !isMetatileDrawnByPlm[i_metatile])
+                continue;
+
+            std::vector<std::uint16_t> entries;
+            for (const TileTableBlob& blob : tileTables)
+            {
+                const auto it_begin(std::begin(blob.entries) + (i_metatile - blob.i_firstMetatile) * entriesPerMetatile);
+                entries.insert(std::end(entries), it_begin, it_begin + entriesPerMetatile);
+            }
+
+            candidates.push_back(i_metatile);
+            canonicals.push_back(canonicalise<std::uint16_t>(entries, flipMetatiles));
+        }
+
+        metatileRemaps = findDuplicates<std::uint16_t>(candidates, canonicals, [&](index_t i_metatile){ return bool(isMetatileDrawnByPlm[i_metatile]); });
+        plan.n_metatilesMerged = std::size(metatileRemaps);
+        for (const auto& [i_metatile, remap] : metatileRemaps)
+            metatileCounts[i_metatile] = 0;
+    }
+
+    // Drop what's unused, merged away metatiles now count as unused
+    if (isDropping)
+    {
+        for (index_t i_metatile(i_firstCandidateMetatile); i_metatile < i_endCandidateMetatile; ++i_metatile)
+        {
+            if (isKeptMetatile(i_metatile))
+                continue;
+
+            bool isDropped{};
+            for (TileTableBlob& blob : tileTables)
+            {
+                const auto it_begin(std::begin(blob.entries) + (i_metatile - blob.i_firstMetatile) * entriesPerMetatile);
+                isDropped |= std::any_of(it_begin, it_begin + entriesPerMetatile, [](std::uint16_t entry){ return entry != 0; });
+                std::fill_n(it_begin, entriesPerMetatile, std::uint16_t{});
+            }
+
+            plan.n_metatilesDropped += isDropped;
+        }
+
+        isTileUsed = isTilePinned;
+
+        markUsedTiles();
+        for (index_t i_tile{}; i_tile < n_candidateTiles; ++i_tile)
+        {
+            if (isTileUsed[i_tile])
+                continue;
+
+            bool isDropped{};
+            for (TilesBlob& blob : tilesBlobs)
+            {
+                const auto it_begin(std::begin(blob.bytes) + i_tile * SnesTile4bpp::bytesPerTile);
+                isDropped |= std::any_of(it_begin, it_begin + SnesTile4bpp::bytesPerTile, [](std::uint8_t byte){ return byte != 0; });
+                std::fill_n(it_begin, SnesTile4bpp::bytesPerTile, std::uint8_t{});
+            }
+
+            plan.n_tilesDropped += isDropped;
+        }
+    }
+
+    // Recompress whatever changed
+    std::mutex mutex;
+    const auto addWrite([&](std::uint32_t address, std::span<const std::uint8_t> data, n_t originalSize)
+    {
+        std::vector<std::uint8_t> compressed(compress(data));
+        const std::lock_guard lock(mutex);
+        plan.writes.push_back({address, std::move(compressed), originalSize});
+    });
+
+    for (index_t i{}; i < std::size(tileTables); ++i)
+        if (tileTables[i].entries != originalTileTables[i].entries)
+            addWrite(tileTables[i].address, toBytes(tileTables[i].entries), tileTables[i].compressedSize);
+
+    for (index_t i{}; i < std::size(tilesBlobs); ++i)
+        if (tilesBlobs[i].bytes != originalTilesBlobs[i].bytes)
+            addWrite(tilesBlobs[i].address, tilesBlobs[i].bytes, tilesBlobs[i].compressedSize);
+
+    if (!std::empty(metatileRemaps))
+        std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](LevelDataJob* p_job)
+        {
+            LevelData levelData(*p_job->levelData);
+            bool isChanged{};
+            for (std::pmr::vector<std::uint16_t>* p_layer : {&levelData.layer1, &levelData.layer2})
+                for (std::uint16_t& block : *p_layer)
+                    if (const auto it(metatileRemaps.find(block & blockMetatileMask)); it != std::end(metatileRemaps))
+                    {
+                        block = std::uint16_t(((block & ~blockMetatileMask) ^ (it->second.xFlip ? blockXFlip : 0) ^ (it->second.yFlip ? blockYFlip : 0)) | it->second.i_to);
+                        isChanged = true;
+                    }
+
+            if (isChanged)
+                addWrite(p_job->pointer, levelData.toBytes(), levelData.compressedSize);
+        });
+
+    std::ranges::sort(plan.writes, {}, &TilesetOptimiseWrite::address);
+}
+catch (const std::exception& e)
+{
+    plan.error = e.what();
+    plan.writes.clear();
+}
+
+n_t TilesetGroupPlan::originalSize() const noexcept
+{
+    n_t ret{};
+    for (const TilesetOptimiseWrite& write : writes)
+        ret += write.originalSize;
+
+    return ret;
+}
+
+n_t TilesetGroupPlan::optimisedSize() const noexcept
+{
+    n_t ret{};
+    for (const TilesetOptimiseWrite& write : writes)
+        ret += std::size(write.compressed);
+
+    return ret;
+}
+
+bool TilesetGroupPlan::isFit() const noexcept
+{
+    return std::ranges::all_of(writes, [](const TilesetOptimiseWrite& write){ return std::size(write.compressed) <= write.originalSize; });
+}
+
+TilesetOptimisePlan planTilesetOptimisation(const Rom& rom, const TilesetOptimiseOptions& options)
+try
+{
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<LevelDataJob> jobs;
+    std::map<std::uint32_t, index_t> jobIndices;
+    for (const Room& room : rooms)
+        for (index_t i_state{}; i_state < std::size(room.states); ++i_state)
+        {
+            const RoomState& state(room.states[i_state]);
+            const auto [it, isNew](jobIndices.try_emplace(state.levelDataPointer, std::size(jobs)));
+            if (isNew)
+                jobs.push_back({state.levelDataPointer, &room, i_state});
+
+            LevelDataJob& job(jobs[it->second]);
+            if (state.i_tileset < Tileset::n_tilesets)
+                job.i_tilesets.insert(state.i_tileset);
+            else
+                job.error = "Room $"s + toHexString(room.address) + " state "s + std::to_string(i_state) + " has invalid tileset "s + toHexString(state.i_tileset);
+        }
+
+    std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [&](LevelDataJob& job)
+    {
+        try
+        {
+            job.levelData.emplace(rom, *job.p_room, job.p_room->states[job.i_state]);
+        }
+        catch (const std::exception& e)
+        {
+            job.error = "Level data $"s + toHexString(job.pointer, 3) + " of room $"s + toHexString(job.p_room->address) + ": "s + e.what();
+        }
+    });
+
+    // Group tilesets by shared tile tables, tiles and level data
+    std::vector<index_t> parents(Tileset::n_tilesets);
+    std::iota(std::begin(parents), std::end(parents), 0);
+    const auto find([&](index_t i)
+    {
+        while (parents[i] != i)
+            i = parents[i] = parents[parents[i]];
+
+        return i;
+    });
+
+    const auto unite([&](index_t lhs, index_t rhs)
+    {
+        parents[find(lhs)] = find(rhs);
+    });
+
+    std::vector<std::optional<Tileset::Ranges>> ranges(Tileset::n_tilesets);
+    std::vector<std::string> tilesetErrors(Tileset::n_tilesets);
+    for (index_t i_tileset{}; i_tileset < Tileset::n_tilesets; ++i_tileset)
+    {
+        try
+        {
+            ranges[i_tileset] = Tileset::findRanges(rom, i_tileset);
+        }
+        catch (const std::exception& e)
+        {
+            tilesetErrors[i_tileset] = "Tileset "s + toHexString(i_tileset, 1) + ": "s + e.what();
+            continue;
+        }
+
+        for (index_t i_other{}; i_other < i_tileset; ++i_other)
+            if (ranges[i_other] && (ranges[i_other]->tileTable == ranges[i_tileset]->tileTable || ranges[i_other]->tiles == ranges[i_tileset]->tiles))
+                unite(i_other, i_tileset);
+    }
+
+    for (const LevelDataJob& job : jobs)
+        for (index_t i_tileset : job.i_tilesets)
+            unite(*std::begin(job.i_tilesets), i_tileset);
+
+    TilesetOptimisePlan ret;
+    std::map<index_t, index_t> groupIndices;
+    for (index_t i_tileset{}; i_tileset < Tileset::n_tilesets; ++i_tileset)
+    {
+        const auto [it, isNew](groupIndices.try_emplace(find(i_tileset), std::size(ret.groups)));
+        if (isNew)
+            ret.groups.emplace_back();
+
+        TilesetGroupPlan& group(ret.groups[it->second]);
+        group.i_tilesets.push_back(i_tileset);
+        if (std::empty(group.error))
+            group.error = tilesetErrors[i_tileset];
+    }
+
+    std::vector<std::vector<LevelDataJob*>> groupJobs(std::size(ret.groups));
+    for (LevelDataJob& job : jobs)
+    {
+        if (std::empty(job.i_tilesets))
+            continue;
+
+        const index_t i_group(groupIndices.at(find(*std::begin(job.i_tilesets))));
+        groupJobs[i_group].push_back(&job);
+        if (std::empty(ret.groups[i_group].error))
+            ret.groups[i_group].error = job.error;
+    }
+
+    // Metatiles drawn by the PLMs of each group's rooms. PLMs are placed in many rooms, so each instruction list is followed once
+    std::map<std::uint16_t, PlmDraws> plmDraws;
+    std::vector<std::vector<bool>> groupPlmMetatiles(std::size(ret.groups), std::vector<bool>(Tileset::n_metatiles));
+    for (const Room& room : rooms)
+        for (index_t i_state{}; i_state < std::size(room.states); ++i_state)
+        {
+            const RoomState& state(room.states[i_state]);
+            if (state.i_tileset >= Tileset::n_tilesets)
+                continue;
+
+            const index_t i_group(groupIndices.at(find(state.i_tileset)));
+            TilesetGroupPlan& group(ret.groups[i_group]);
+            try
+            {
+                for (const Plm& plm : loadPlmPopulation(rom, state))
+                {
+                    auto it(plmDraws.find(plm.id));
+                    if (it == std::end(plmDraws))
+                        it = plmDraws.emplace(plm.id, findPlmDraws(rom, plm.id)).first;
+
+                    for (index_t i_metatile : it->second.i_metatiles)
+                        groupPlmMetatiles[i_group][i_metatile] = true;
+
+                    if (!it->second.isComplete && std::ranges::find(group.unreadablePlms, plm.id) == std::end(group.unreadablePlms))
+                        group.unreadablePlms.push_back(plm.id);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                if (std::empty(group.error))
+                    group.error = "PLMs of room $"s + toHexString(room.address) + " state "s + std::to_string(i_state) + ": "s + e.what();
+            }
+        }
+
+    // Every tileset's ranges have the same common tile table
+    const auto it_ranges(std::ranges::find_if(ranges, [](const std::optional<Tileset::Ranges>& tilesetRanges){ return tilesetRanges.has_value(); }));
+    if (it_ranges == std::end(ranges))
+        return ret;
+
+    const std::vector<std::uint16_t> creTileTable(toWords(decompress(rom.bytes().subspan((*it_ranges)->creTileTable.begin)).data));
+    std::vector<Tileset::Ranges> validRanges(Tileset::n_tilesets);
+    for (index_t i_tileset{}; i_tileset < Tileset::n_tilesets; ++i_tileset)
+        if (ranges[i_tileset])
+            validRanges[i_tileset] = *ranges[i_tileset];
+
+    std::vector<index_t> indices(std::size(ret.groups));
+    std::iota(std::begin(indices), std::end(indices), 0);
+    std::for_each(std::execution::par, std::begin(indices), std::end(indices), [&](index_t i_group)
+    {
+        if (std::empty(ret.groups[i_group].error))
+            planGroup(rom, ret.groups[i_group], validRanges, groupJobs[i_group], groupPlmMetatiles[i_group], creTileTable, options);
+    });
+
+    return ret;
+}
+LOG_RETHROW
+
+void writeTilesetOptimiseReport(std::ostream& out, const TilesetOptimisePlan& plan)
+try
+{
+    n_t n_saved{};
+    for (const TilesetGroupPlan& group : plan.groups)
+    {
+        out << "Tilesets"s;
+        for (index_t i_tileset : group.i_tilesets)
+            out << ' ' << toHexString(i_tileset, 1);
+
+        if (!std::empty(group.error))
+        {
+            out << ": "s << group.error << '\n';
+            continue;
+        }
+
+        out << ": "s << group.n_levelData << " level data\n"s
+            << "    Metatiles: "s << group.n_metatilesUsed << " used, "s << group.n_metatilesDrawnByPlms << " drawn by PLMs, "s << group.n_metatilesMerged << " merged, "s << group.n_metatilesDropped << " dropped\n"s
+            << "    Tiles: "s << group.n_tilesUsed << " used, "s << group.n_tilesMerged << " merged, "s << group.n_tilesDropped << " dropped\n"s;
+
+        if (!std::empty(group.unreadablePlms))
+        {
+            out << "    Unused metatiles can't be dropped, instruction lists of PLMs"s;
+            for (std::uint16_t id : group.unreadablePlms)
+                out << " $"s << toHexString(id);
+
+            out << " couldn't be followed\n"s;
+        }
+
+        out << "    Compressed: "s << group.originalSize() << " -> "s << group.optimisedSize() << " bytes in "s << std::size(group.writes) << " blocks of data"s;
+
+        if (!group.isFit())
+            out << ", not applicable: some data no longer fits in its space"s;
+        else
+            n_saved += group.originalSize() - group.optimisedSize();
+
+        out << '\n';
+    }
+
+    out << "Total: "s << n_saved << " bytes saved\n"s;
+}
+LOG_RETHROW
+
+n_t applyTilesetOptimisation(Rom& rom, const TilesetOptimisePlan& plan)
+try
+{
+    n_t ret{};
+    for (const TilesetGroupPlan& group : plan.groups)
+    {
+        if (!std::empty(group.error) || !group.isFit())
+            continue;
+
+        for (const TilesetOptimiseWrite& write : group.writes)
+            rom.write(write.address, write.compressed);
+
+        ++ret;
+    }
+
+    return ret;
+}
+LOG_RETHROW
@@ -0,0 +1,68 @@
+module;
+
+#include "../global.h"
+
+export module tileset_optimiser;
+
+export import sm_room;
+
+export struct TilesetOptimiseOptions
+{
+    // Merge tiles that are the same as another, or a flip of another, by rewriting tile table entries
+    bool mergeTiles{true};
+
+    // Merge metatiles that are the same as another, or a flip of another, by rewriting level data
+    bool mergeMetatiles{true};
+
+    // Clear metatiles that neither level data nor PLM draw instructions use, and tiles no metatile uses, so they recompress to almost nothing.
+    // Off by default: enemy and boss code that writes blocks or tilemaps itself, like Kraid's body, isn't seen and would lose its graphics
+    bool dropUnused{};
+};
+
+// Compressed data to write over the compressed data it replaces
+export struct TilesetOptimiseWrite
+{
+    std::uint32_t address;
+    std::vector<std::uint8_t> compressed;
+    n_t originalSize;
+};
+
+// Tilesets that share tile tables, tiles or level data are optimised together, as one remap has to hold for all of them
+export struct TilesetGroupPlan
+{
+    std::vector<index_t> i_tilesets;
+    n_t n_levelData{};
+    n_t n_metatilesUsed{}, n_metatilesDrawnByPlms{}, n_metatilesMerged{}, n_metatilesDropped{};
+    n_t n_tilesUsed{}, n_tilesMerged{}, n_tilesDropped{};
+
+    // PLMs in the group's rooms whose instruction lists couldn't be followed to the end. Nothing is dropped from the group if there are any
+    std::vector<std::uint16_t> unreadablePlms;
+
+    // Only data that changed
+    std::vector<TilesetOptimiseWrite> writes;
+
+    // Set if the group couldn't be optimised
+    std::string error;
+
+    n_t originalSize() const noexcept;
+    n_t optimisedSize() const noexcept;
+
+    // Every write fits in the space of the data it replaces
+    bool isFit() const noexcept;
+};
+
+export struct TilesetOptimisePlan
+{
+    std::vector<TilesetGroupPlan> groups;
+};
+
+// Only the tileset specific (SCE) parts of tile tables and tiles are changed, common (CRE) metatiles and tiles are shared by every tileset and are left alone.
+// Metatile usage comes from the level data and the PLM draw instructions of the rooms `findRooms` finds. Metatiles merged away are kept unless dropping,
+// metatiles only drawn by enemy or boss code, or only used by rooms not reachable by doors, are seen as unused.
+// Loading, planning and recompressing run in parallel
+export TilesetOptimisePlan planTilesetOptimisation(const Rom& rom, const TilesetOptimiseOptions& options = {});
+
+export void writeTilesetOptimiseReport(std::ostream& out, const TilesetOptimisePlan& plan);
+
+// Writes the groups that fit and have no error, returns the number of groups written
+export n_t applyTilesetOptimisation(Rom& rom, const TilesetOptimisePlan& plan);
@@ -0,0 +1,417 @@
+#include "../global.h"
+
+import world_map;
+
+import box_filter;
+import png;
+
+static const n_t
+    areaWidth{0x40}, areaHeight{0x20}, // In screens
+    maxZoom{7},
+    worldSize{n_t(1) << maxZoom}, // In screens, one screen per tile at the deepest zoom level
+    tilePixels{screenSize * blockSize},
+    parallelZoom{3}; // Tiles above this zoom level build their children concurrently
+
+static const unsigned manifestVersion{1};
+
+// Top-left of each area's map in the world map, in screens
+static const index_t areaOrigins[][2]{{0, 0}, {64, 0}, {0, 32}, {64, 32}, {0, 64}, {64, 64}, {0, 96}, {64, 96}};
+
+struct ScreenRect
+{
+    index_t x, y;
+    n_t width, height;
+
+    bool operator==(const ScreenRect&) const = default;
+};
+
+struct ManifestEntry
+{
+    std::uint64_t fingerprint;
+    ScreenRect rect;
+};
+
+struct Manifest
+{
+    RoomRenderOptions renderOptions;
+    std::map<std::uint16_t, ManifestEntry> rooms;
+};
+
+struct MapRoom
+{
+    const Room* p_room;
+    std::optional<LevelData> levelData;
+    const Tileset* p_tileset;
+    ScreenRect rect;
+    std::uint64_t fingerprint;
+};
+
+// FNV-1a
+static std::uint64_t hashBytes(std::uint64_t hash, std::span<const std::byte> data) noexcept
+{
+    for (std::byte v : data)
+        hash = (hash ^ std::uint64_t(v)) * 0x100000001B3;
+
+    return hash;
+}
+
+static const std::uint64_t hashSeed{0xCBF29CE484222325};
+
+// Summed area table over the world's screens, for counting the flagged screens in a rectangle in constant time
+class ScreenCounts
+{
+    std::vector<n_t> sums;
+
+public:
+    explicit ScreenCounts(const std::vector<bool>& screens)
+        : sums((worldSize + 1) * (worldSize + 1))
+    {
+        for (index_t y{}; y < worldSize; ++y)
+            for (index_t x{}; x < worldSize; ++x)
+                sums[(y + 1) * (worldSize + 1) + x + 1] =
+                    n_t(screens[y * worldSize + x])
+                    + sums[y * (worldSize + 1) + x + 1]
+                    + sums[(y + 1) * (worldSize + 1) + x]
+                    - sums[y * (worldSize + 1) + x];
+    }
+
+    n_t count(index_t x, index_t y, n_t width, n_t height) const noexcept
+    {
+        const n_t stride(worldSize + 1);
+        return sums[(y + height) * stride + x + width] - sums[y * stride + x + width] - sums[(y + height) * stride + x] + sums[y * stride + x];
+    }
+};
+
+static void markScreens(std::vector<bool>& screens, const ScreenRect& rect)
+{
+    for (index_t y(rect.y); y < rect.y + rect.height; ++y)
+        for (index_t x(rect.x); x < rect.x + rect.width; ++x)
+            screens[y * worldSize + x] = true;
+}
+
+static std::optional<Manifest> readManifest(const std::filesystem::path& filepath)
+try
+{
+    std::ifstream in(filepath);
+    if (!in)
+        return {};
+
+    std::string label;
+    unsigned version{};
+    Manifest manifest;
+    in >> label >> version;
+    if (label != "Version:"sv || version != manifestVersion)
+        return {};
+
+    in >> label >> manifest.renderOptions.layer1 >> manifest.renderOptions.layer2 >> manifest.renderOptions.bts;
+    if (!in || label != "Options:"sv)
+        return {};
+
+    while (in >> label)
+    {
+        std::uint16_t address;
+        ManifestEntry entry;
+        in >> std::hex >> address >> entry.fingerprint >> std::dec >> entry.rect.x >> entry.rect.y >> entry.rect.width >> entry.rect.height;
+        if (!in || label != "Room:"sv)
+            return {};
+
+        manifest.rooms[address] = entry;
+    }
+
+    return manifest;
+}
+LOG_RETHROW
+
+static void writeManifest(const std::filesystem::path& filepath, const RoomRenderOptions& renderOptions, const std::vector<MapRoom>& rooms)
+try
+{
+    std::ofstream out(filepath);
+    out.exceptions(std::ios::badbit | std::ios::failbit);
+
+    out << "Version: "s << manifestVersion << '\n';
+    out << "Options: "s << renderOptions.layer1 << ' ' << renderOptions.layer2 << ' ' << renderOptions.bts << '\n';
+    for (const MapRoom& room : rooms)
+        out
+            << "Room: "s << std::hex << room.p_room->address << ' ' << room.fingerprint << std::dec
+            << ' ' << room.rect.x << ' ' << room.rect.y << ' ' << room.rect.width << ' ' << room.rect.height << '\n';
+}
+LOG_RETHROW
+
+class WorldMapBuilder
+{
+    const WorldMapOptions* p_options;
+    const std::vector<MapRoom>* p_rooms;
+
+    // Index of the room drawn at each screen, later rooms take precedence where rooms overlap
+    std::vector<index_t> screenRooms;
+    ScreenCounts occupied, dirty;
+
+    std::atomic<n_t> n_tilesWritten{}, n_tilesRemoved{};
+
+    std::filesystem::path tilePath(index_t zoom, index_t x, index_t y) const
+    try
+    {
+        return p_options->outputDirectory / std::to_string(zoom) / std::to_string(x) / (std::to_string(y) + ".png"s);
+    }
+    LOG_RETHROW
+
+    void renderScreen(index_t x_screen, index_t y_screen, Image& tile) const
+    try
+    {
+        const index_t i_room(screenRooms[y_screen * worldSize + x_screen]);
+        if (i_room >= std::size(*p_rooms))
+            return;
+
+        const MapRoom& room((*p_rooms)[i_room]);
+        const RoomRenderer renderer(*room.p_tileset, *room.levelData, p_options->renderOptions);
+        renderer.renderScreen(x_screen - room.rect.x, y_screen - room.rect.y, tile);
+    }
+    LOG_RETHROW
+
+public:
+    WorldMapBuilder(const WorldMapOptions& options, const std::vector<MapRoom>& rooms, std::vector<index_t> screenRooms_in, const std::vector<bool>& dirtyScreens)
+    try
+        : p_options(&options), p_rooms(&rooms), screenRooms(std::move(screenRooms_in)),
+          occupied([&]()
+          {
+              std::vector<bool> screens(worldSize * worldSize);
+              for (index_t i{}; i < std::size(screens); ++i)
+                  screens[i] = screenRooms[i] < std::size(rooms);
+
+              return screens;
+          }()),
+          dirty(dirtyScreens)
+    {}
+    LOG_RETHROW
+
+    n_t tilesWritten() const noexcept
+    {
+        return n_tilesWritten;
+    }
+
+    n_t tilesRemoved() const noexcept
+    {
+        return n_tilesRemoved;
+    }
+
+    // Returns the tile's image, or nothing if the tile is empty.
+    // Tiles that don't cover any dirty screens are loaded from the previous build rather than regenerated
+    std::optional<Image> buildTile(index_t zoom, index_t x, index_t y)
+    try
+    {
+        const n_t n_screens(n_t(1) << (maxZoom - zoom));
+        const index_t x_screen(x * n_screens), y_screen(y * n_screens);
+        const std::filesystem::path filepath(tilePath(zoom, x, y));
+        const bool isOccupied(occupied.count(x_screen, y_screen, n_screens, n_screens) != 0);
+        if (!isOccupied)
+        {
+            if (dirty.count(x_screen, y_screen, n_screens, n_screens) && std::filesystem::remove(filepath))
+                ++n_tilesRemoved;
+
+            return {};
+        }
+
+        // A clean tile missing from the previous build is regenerated
+        if (!dirty.count(x_screen, y_screen, n_screens, n_screens) && exists(filepath))
+            return readPng(filepath);
+
+        Image tile(tilePixels, tilePixels, backdrop);
+        if (zoom == maxZoom)
+            renderScreen(x, y, tile);
+        else
+        {
+            std::array<std::optional<Image>, 4> children;
+            std::array<std::exception_ptr, 4> errors;
+            const auto buildChild([&](index_t i_child)
+            {
+                // Exceptions mustn't escape a parallel algorithm
+                try
+                {
+                    children[i_child] = buildTile(zoom + 1, x * 2 + i_child % 2, y * 2 + i_child / 2);
+                }
+                catch (...)
+                {
+                    errors[i_child] = std::current_exception();
+                }
+            });
+
+            const std::array<index_t, 4> i_children{0, 1, 2, 3};
+            if (zoom < parallelZoom)
+                std::for_each(std::execution::par, std::begin(i_children), std::end(i_children), buildChild);
+            else
+                std::for_each(std::begin(i_children), std::end(i_children), buildChild);
+
+            for (const std::exception_ptr& error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+
+            for (index_t i_child{}; i_child < std::size(children); ++i_child)
+                if (children[i_child])
+                    downsample(*children[i_child], tile, i_child % 2 * tilePixels / 2, i_child / 2 * tilePixels / 2);
+        }
+
+        create_directories(filepath.parent_path());
+        writePng(filepath, tile, p_options->compressionLevel);
+        ++n_tilesWritten;
+        return tile;
+    }
+    LOG_RETHROW
+};
+
+WorldMapResult buildWorldMap(const Rom& rom, const WorldMapOptions& options)
+try
+{
+    create_directories(options.outputDirectory);
+
+    const std::filesystem::path manifestPath(options.outputDirectory / "manifest.txt"s);
+    const std::vector<Room> rooms(findRooms(rom));
+    std::vector<MapRoom> mapRooms;
+    std::set<index_t> tilesetIndices;
+    for (const Room& room : rooms)
+    {
+        if (room.mapX >= areaWidth || room.mapY >= areaHeight)
+            continue;
+
+        const ScreenRect rect
+        {
+            areaOrigins[room.i_area][0] + room.mapX,
+            areaOrigins[room.i_area][1] + room.mapY,
+            std::min<n_t>(room.width, areaWidth - room.mapX),
+            std::min<n_t>(room.height, areaHeight - room.mapY)
+        };
+
+        mapRooms.push_back({&room, {}, {}, rect, {}});
+        tilesetIndices.insert(room.defaultState().i_tileset);
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    const auto addError([&](std::string error)
+    {
+        const std::lock_guard lock(mutex);
+        errors.push_back(std::move(error));
+    });
+
+    std::vector<std::optional<Tileset>> tilesets(Tileset::n_tilesets);
+    std::vector<std::uint64_t> tilesetHashes(Tileset::n_tilesets);
+    std::for_each(std::execution::par, std::begin(tilesetIndices), std::end(tilesetIndices), [&](index_t i_tileset)
+    {
+        try
+        {
+            if (i_tileset >= std::size(tilesets))
+                return;
+
+            const Tileset& tileset(tilesets[i_tileset].emplace(rom, i_tileset, options.p_assetCache));
+            std::uint64_t hash(hashSeed);
+            hash = hashBytes(hash, std::as_bytes(std::span(tileset.tiles)));
+            hash = hashBytes(hash, std::as_bytes(std::span(tileset.tileTable)));
+            hash = hashBytes(hash, std::as_bytes(std::span(tileset.palette)));
+            tilesetHashes[i_tileset] = hash;
+        }
+        catch (const std::exception& e)
+        {
+            addError("Tileset "s + toHexString(i_tileset, 1) + ": "s + e.what());
+        }
+    });
+
+    // A room's fingerprint covers everything that affects how it's drawn: its header, default state, level data and tileset
+    std::for_each(std::execution::par, std::begin(mapRooms), std::end(mapRooms), [&](MapRoom& mapRoom)
+    {
+        const Room& room(*mapRoom.p_room);
+        try
+        {
+            const RoomState& state(room.defaultState());
+            if (state.i_tileset >= std::size(tilesets) || !tilesets[state.i_tileset])
+                throw std::runtime_error(LOG_INFO "Tileset "s + toHexString(state.i_tileset) + " is not available"s);
+
+            mapRoom.p_tileset = &*tilesets[state.i_tileset];
+            const LevelData& levelData(mapRoom.levelData.emplace(rom, room, state, options.p_assetCache));
+
+            const n_t roomHeaderSize{11}, stateDataSize{26};
+            std::uint64_t hash(hashSeed);
+            hash = hashBytes(hash, std::as_bytes(rom.spanFrom(0x8F'0000 | room.address).first(roomHeaderSize)));
+            hash = hashBytes(hash, std::as_bytes(rom.spanFrom(0x8F'0000 | state.address).first(stateDataSize)));
+            hash = hashBytes(hash, std::as_bytes(std::span(levelData.layer1)));
+            hash = hashBytes(hash, std::as_bytes(std::span(levelData.bts)));
+            hash = hashBytes(hash, std::as_bytes(std::span(levelData.layer2)));
+            mapRoom.fingerprint = hash ^ tilesetHashes[state.i_tileset];
+        }
+        catch (const std::exception& e)
+        {
+            addError("Room $"s + toHexString(room.address) + ": "s + e.what());
+        }
+    });
+
+    for (const std::string& error : errors)
+        DebugFile(DebugFile::warning) << LOG_INFO "World map room skipped: "s << error << '\n';
+
+    const n_t n_candidates(std::size(mapRooms));
+    std::erase_if(mapRooms, [](const MapRoom& room) { return !room.levelData; });
+
+    WorldMapResult result;
+    result.n_roomsFailed = n_candidates - std::size(mapRooms);
+
+    std::vector<index_t> screenRooms(worldSize * worldSize, std::size(mapRooms));
+    for (index_t i_room{}; i_room < std::size(mapRooms); ++i_room)
+    {
+        const ScreenRect& rect(mapRooms[i_room].rect);
+        for (index_t y(rect.y); y < rect.y + rect.height; ++y)
+            for (index_t x(rect.x); x < rect.x + rect.width; ++x)
+                screenRooms[y * worldSize + x] = i_room;
+    }
+
+    // Anything that invalidates the whole previous build (no manifest, a different format or different render options) is a full rebuild
+    std::vector<bool> dirtyScreens(worldSize * worldSize);
+    std::optional<Manifest> manifest(readManifest(manifestPath));
+    if (manifest
+        && manifest->renderOptions.layer1 == options.renderOptions.layer1
+        && manifest->renderOptions.layer2 == options.renderOptions.layer2
+        && manifest->renderOptions.bts == options.renderOptions.bts)
+    {
+        // Screens covered by an added, removed, moved or edited room, before and after
+        for (const MapRoom& room : mapRooms)
+        {
+            const auto it(manifest->rooms.find(room.p_room->address));
+            if (it != std::end(manifest->rooms) && it->second.fingerprint == room.fingerprint && it->second.rect == room.rect)
+            {
+                manifest->rooms.erase(it);
+                continue;
+            }
+
+            if (it != std::end(manifest->rooms))
+            {
+                markScreens(dirtyScreens, it->second.rect);
+                manifest->rooms.erase(it);
+            }
+
+            markScreens(dirtyScreens, room.rect);
+            ++result.n_roomsChanged;
+        }
+
+        for (const auto& [address, entry] : manifest->rooms)
+        {
+            markScreens(dirtyScreens, entry.rect);
+            ++result.n_roomsChanged;
+        }
+    }
+    else
+    {
+        for (index_t zoom{}; zoom <= maxZoom; ++zoom)
+            std::filesystem::remove_all(options.outputDirectory / std::to_string(zoom));
+
+        std::fill(std::begin(dirtyScreens), std::end(dirtyScreens), true);
+        result.n_roomsChanged = std::size(mapRooms);
+    }
+
+    // The manifest is removed while tiles are being written, so an interrupted build is followed by a full rebuild
+    std::filesystem::remove(manifestPath);
+
+    WorldMapBuilder builder(options, mapRooms, std::move(screenRooms), dirtyScreens);
+    builder.buildTile(0, 0, 0);
+    writeManifest(manifestPath, options.renderOptions, mapRooms);
+
+    result.n_tilesWritten = builder.tilesWritten();
+    result.n_tilesRemoved = builder.tilesRemoved();
+    return result;
+}
+LOG_RETHROW
@@ -0,0 +1,28 @@
+module;
+
+#include "../global.h"
+
+export module world_map;
+
+export import room_renderer;
+
+export struct WorldMapOptions
+{
+    std::filesystem::path outputDirectory;
+    RoomRenderOptions renderOptions;
+    unsigned compressionLevel{1};
+
+    // Tilesets and level data are decompressed through this if given
+    AssetCache* p_assetCache{};
+};
+
+export struct WorldMapResult
+{
+    n_t n_tilesWritten{}, n_tilesRemoved{}, n_roomsChanged{}, n_roomsFailed{};
+};
+
+// Renders every room's default state into a zoomable tile pyramid of 256x256 PNG files at <output directory>/<zoom>/<x>/<y>.png.
+// The eight area maps are laid out in a 2x4 grid of 64x32 screens, at the deepest zoom level one tile is one room screen, and each level above is box filtered down from the four tiles below it.
+// The tree is built depth first so only a few tiles per level are held in memory at once, and tiles with no rooms in them aren't written.
+// A manifest of room fingerprints is kept in the output directory, so that rebuilding after editing the ROM only regenerates the tiles that cover changed rooms
+export WorldMapResult buildWorldMap(const Rom& rom, const WorldMapOptions& options);
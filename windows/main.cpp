@@ -2,12 +2,35 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <shellapi.h>
 
 #include <cstdlib> // for EXIT_FAILURE
 
 import main;
 import os_windows;
 
+import string;
+
+static std::vector<std::string> getArguments()
+try
+{
+    // CommandLineToArgvW reference: https://learn.microsoft.com/en-gb/windows/win32/api/shellapi/nf-shellapi-commandlinetoargvw
+    // GetCommandLine reference: https://learn.microsoft.com/en-gb/windows/win32/api/processenv/nf-processenv-getcommandlinew
+
+    int n_arguments;
+    const std::unique_ptr p_arguments(makeUniquePtr(CommandLineToArgvW(GetCommandLine(), &n_arguments), [](wchar_t** p){ LocalFree(p); }));
+    if (!p_arguments)
+        throw WindowsError(LOG_INFO "Failed to parse command line");
+
+    // Skip the program name
+    std::vector<std::string> arguments;
+    for (int i_argument(1); i_argument < n_arguments; ++i_argument)
+        arguments.push_back(toString(p_arguments.get()[i_argument]));
+
+    return arguments;
+}
+LOG_RETHROW
+
 // WinMain reference: https://learn.microsoft.com/en-gb/windows/win32/api/winbase/nf-winbase-winmain
 // wWinMain article: https://learn.microsoft.com/en-gb/windows/win32/learnwin32/winmain--the-application-entry-point
 int APIENTRY wWinMain(HINSTANCE instance, HINSTANCE, wchar_t* cmdLine, Windows::MainWindowArg_t cmdShow)
@@ -15,7 +38,7 @@ try
 {
     Windows windows(instance);
 
-    return main_common(windows, std::move(cmdShow));
+    return main_common(windows, getArguments(), std::move(cmdShow));
 }
 catch (const std::exception& e)
 {
@@ -3,4 +3,4 @@ export module main;
 export import os;
 import std;
 
-export int main_common(Os& os, std::any main_window_arg);
+export int main_common(Os& os, std::span<const std::string> arguments, std::any main_window_arg);
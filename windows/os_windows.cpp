@@ -28,6 +28,9 @@ import string;
 
 static std::map<HWND, Window*> windowMap;
 
+// Posted to the watching thread with the watch ID as wParam
+static const unsigned fileChangedMessage(WM_APP);
+
 static long CALLBACK vectoredHandler(EXCEPTION_POINTERS* p_e) noexcept
 {
     // VectoredHandler reference: https://learn.microsoft.com/en-gb/windows/win32/api/winnt/nc-winnt-pvectored_exception_handler
@@ -297,6 +300,36 @@ try
         const index_t i_menuItem(wParam);
         const auto menuHandle(reinterpret_cast<HMENU>(lParam));
         handleMenuCommand(windowHandle, menuHandle, i_menuItem);
+        break;
+    }
+
+    // WM_MOUSEMOVE reference: https://learn.microsoft.com/en-gb/windows/win32/inputdev/wm-mousemove
+    case WM_MOUSEMOVE:
+    {
+        windowMap[windowHandle]->onMouseMove(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        break;
+    }
+
+    // WM_LBUTTONDOWN reference: https://learn.microsoft.com/en-gb/windows/win32/inputdev/wm-lbuttondown
+    case WM_LBUTTONDOWN:
+    {
+        // SetCapture reference: https://learn.microsoft.com/en-gb/windows/win32/api/winuser/nf-winuser-setcapture
+        // Capturing the mouse keeps the rubber band going when the drag leaves the window
+        SetCapture(windowHandle);
+        windowMap[windowHandle]->onMouseDown(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        break;
+    }
+
+    // WM_LBUTTONUP reference: https://learn.microsoft.com/en-gb/windows/win32/inputdev/wm-lbuttonup
+    case WM_LBUTTONUP:
+    {
+        // ReleaseCapture reference: https://learn.microsoft.com/en-gb/windows/win32/api/winuser/nf-winuser-releasecapture
+        // The drag still ends if the capture couldn't be released, the next click takes it again anyway
+        if (!ReleaseCapture())
+            DebugFile(DebugFile::warning) << LOG_INFO "Failed to release mouse capture, error code "s << GetLastError() << '\n';
+
+        windowMap[windowHandle]->onMouseUp(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        break;
     }
 
     // WM_PAINT reference: https://learn.microsoft.com/en-gb/windows/win32/gdi/wm-paint
@@ -494,15 +527,21 @@ void Windows::init(Config& config)
 try
 {
     // AddVectoredExceptionHandler reference: https://learn.microsoft.com/en-gb/windows/win32/api/errhandlingapi/nf-errhandlingapi-addvectoredexceptionhandler
-    // AllocConsole reference: https://learn.microsoft.com/en-us/windows/console/allocconsole
 
     Os::init(config);
 
     // Set Windows exception handler
     if (!AddVectoredExceptionHandler(~0ul, vectoredHandler))
         throw WindowsError(LOG_INFO "Could not add vectored exception handler");
+}
+LOG_RETHROW
 
-    // Create console window
+void Windows::initDeferred()
+try
+{
+    // AllocConsole reference: https://learn.microsoft.com/en-us/windows/console/allocconsole
+
+    // Create console window. Creating it takes long enough to be noticeable, so it's left until the main window's up
     if (!AllocConsole())
         throw WindowsError(LOG_INFO "Failed to allocate console");
 
@@ -514,6 +553,11 @@ try
 
     if (!std::freopen("CONOUT$", "w", stderr))
         throw std::runtime_error(LOG_INFO "Failed to redirect stderr");
+
+    // Anything written before there was a console failed and left the streams in a failed state
+    std::cin.clear();
+    std::cout.clear();
+    std::cerr.clear();
 }
 LOG_RETHROW
 
@@ -537,6 +581,13 @@ try
         if (!isNotQuit)
             return static_cast<int>(msg.wParam);
 
+        // Thread messages have no window to be dispatched to
+        if (!msg.hwnd && msg.message == fileChangedMessage)
+        {
+            onFileChanged(static_cast<index_t>(msg.wParam));
+            continue;
+        }
+
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
@@ -556,6 +607,15 @@ try
 }
 LOG_RETHROW
 
+std::filesystem::path Windows::getCacheDirectory() const
+try
+{
+    std::filesystem::path ret(getDataDirectory() / "cache"s);
+    create_directories(ret);
+    return ret;
+}
+LOG_RETHROW
+
 static void error(const std::wstring& errorText)
 try
 {
@@ -572,6 +632,15 @@ try
 }
 LOG_RETHROW
 
+void Windows::message(const std::string& title, const std::string& text) const
+try
+{
+    const std::wstring title_wide(toWstring(title)), text_wide(toWstring(text));
+    if (!MessageBox(nullptr, std::data(text_wide), std::data(title_wide), MB_ICONINFORMATION))
+        throw WindowsError(LOG_INFO "Failed to message box"s);
+}
+LOG_RETHROW
+
 void Windows::spawnMainWindow(MainWindow& window, std::string_view className, std::string_view title, std::any arg)
 try
 {
@@ -583,6 +652,11 @@ try
     HMENU const menu(createWindowMenu(*window.menu));
     HWND const windowHandle(createWindow(instance, className_wide.c_str(), title_wide.c_str(), cmdShow, menu));
     windowMap[windowHandle] = &window;
+
+    // UpdateWindow reference: https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-updatewindow
+    // Paints now rather than on the event loop's first pass, so the window's on screen while the deferred setup runs
+    if (!UpdateWindow(windowHandle))
+        throw WindowsError(LOG_INFO "Failed to paint "s + std::string(title) + " window");
 }
 LOG_RETHROW
 
@@ -686,3 +760,260 @@ try
     return std::filesystem::path(filepath);
 }
 LOG_RETHROW
+
+// Rebuilds write the file in several goes, wait for them to stop before reporting the change
+static const unsigned long fileSettleTime(50); // In milliseconds
+
+static bool isWatchedFile(const FILE_NOTIFY_INFORMATION& notification, std::wstring_view filename)
+{
+    // CompareStringOrdinal reference: https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-comparestringordinal
+
+    const std::wstring_view changedFilename(notification.FileName, notification.FileNameLength / sizeof(wchar_t));
+    return CompareStringOrdinal(std::data(changedFilename), int(std::size(changedFilename)), std::data(filename), int(std::size(filename)), true) == CSTR_EQUAL;
+}
+
+static void watchDirectory(HANDLE directory, HANDLE stopEvent, std::wstring filename, unsigned long threadId, index_t id)
+try
+{
+    // ReadDirectoryChangesW reference: https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-readdirectorychangesw
+    // FILE_NOTIFY_INFORMATION reference: https://learn.microsoft.com/en-us/windows/win32/api/winnt/ns-winnt-file_notify_information
+    // WaitForMultipleObjects reference: https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitformultipleobjects
+    // GetOverlappedResult reference: https://learn.microsoft.com/en-us/windows/win32/api/ioapiset/nf-ioapiset-getoverlappedresult
+    // PostThreadMessage reference: https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-postthreadmessagew
+
+    const unsigned long filter(FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+
+    std::unique_ptr<void, decltype(&CloseHandle)> readEvent(CreateEvent(nullptr, false, false, nullptr), CloseHandle);
+    if (!readEvent)
+        throw WindowsError(LOG_INFO "Failed to create directory read event"s);
+
+    alignas(unsigned long) std::byte buffer[0x1000];
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = readEvent.get();
+    bool isChanged{};
+    for (;;)
+    {
+        if (!ReadDirectoryChangesW(directory, buffer, sizeof(buffer), false, filter, nullptr, &overlapped, nullptr))
+            throw WindowsError(LOG_INFO "Failed to read directory changes"s);
+
+        HANDLE const handles[]{stopEvent, readEvent.get()};
+        unsigned long result;
+        for (;;)
+        {
+            result = WaitForMultipleObjects(static_cast<unsigned long>(std::size(handles)), handles, false, isChanged ? fileSettleTime : INFINITE);
+            if (result != WAIT_TIMEOUT)
+                break;
+
+            // Settled. If the window thread is in a modal loop the message is dropped, the next change is picked up as usual
+            isChanged = false;
+            PostThreadMessage(threadId, fileChangedMessage, id, 0);
+        }
+
+        if (result == WAIT_FAILED)
+            throw WindowsError(LOG_INFO "Failed to wait for directory changes"s);
+
+        unsigned long n_bytes;
+        if (result == WAIT_OBJECT_0)
+        {
+            CancelIo(directory);
+            GetOverlappedResult(directory, &overlapped, &n_bytes, true);
+            return;
+        }
+
+        if (!GetOverlappedResult(directory, &overlapped, &n_bytes, false))
+            throw WindowsError(LOG_INFO "Failed to get directory changes"s);
+
+        // Zero bytes means the changes overflowed the buffer, any of them could have been the file
+        if (!n_bytes)
+        {
+            isChanged = true;
+            continue;
+        }
+
+        for (const std::byte* p(buffer);;)
+        {
+            const auto& notification(*reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p));
+            isChanged |= notification.Action != FILE_ACTION_REMOVED && notification.Action != FILE_ACTION_RENAMED_OLD_NAME && isWatchedFile(notification, filename);
+            if (!notification.NextEntryOffset)
+                break;
+
+            p += notification.NextEntryOffset;
+        }
+    }
+}
+catch (const std::exception& e)
+{
+    DebugFile(DebugFile::warning) << LOG_INFO "Stopped watching "s << toString(filename) << ": "s << e.what() << '\n';
+}
+
+Windows::FileWatch::FileWatch(const std::filesystem::path& filepath, std::move_only_function<void()> onChange_in, index_t id)
+try
+    : onChange(std::move(onChange_in))
+{
+    // CreateFile reference: https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-createfilew
+    // CreateEvent reference: https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createeventw
+
+    // Watching the directory rather than the file catches assemblers that write a new file and rename it over the old one
+    const std::filesystem::path absolutePath(std::filesystem::absolute(filepath));
+    directory = CreateFile(absolutePath.parent_path().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE)
+        throw WindowsError(LOG_INFO "Failed to open directory of "s + filepath.string());
+
+    stopEvent = CreateEvent(nullptr, true, false, nullptr);
+    if (!stopEvent)
+    {
+        CloseHandle(directory);
+        throw WindowsError(LOG_INFO "Failed to create file watch stop event"s);
+    }
+
+    thread = std::jthread(watchDirectory, directory, stopEvent, absolutePath.filename().wstring(), GetCurrentThreadId(), id);
+}
+LOG_RETHROW
+
+Windows::FileWatch::~FileWatch()
+{
+    // SetEvent reference: https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-setevent
+
+    SetEvent(stopEvent);
+    thread.join();
+    CloseHandle(stopEvent);
+    CloseHandle(directory);
+}
+
+index_t Windows::watchFile(const std::filesystem::path& filepath, std::move_only_function<void()> onChange)
+try
+{
+    const index_t id(nextWatchId++);
+    fileWatches[id] = std::make_unique<FileWatch>(filepath, std::move(onChange), id);
+    return id;
+}
+LOG_RETHROW
+
+void Windows::unwatchFile(index_t id)
+try
+{
+    fileWatches.erase(id);
+}
+LOG_RETHROW
+
+void Windows::onFileChanged(index_t id)
+try
+{
+    // Messages can still arrive for a watch that's since been removed
+    const auto it(fileWatches.find(id));
+    if (it == std::end(fileWatches))
+        return;
+
+    // The callback may unwatch this file, which would destroy it mid-call
+    std::move_only_function<void()> onChange(std::move(it->second->onChange));
+    onChange();
+    if (const auto it_after(fileWatches.find(id)); it_after != std::end(fileWatches))
+        it_after->second->onChange = std::move(onChange);
+}
+LOG_RETHROW
+
+class WindowsMappedFile final : public MappedFile
+{
+    // CreateFileMapping reference: https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-createfilemappingw
+    // MapViewOfFile reference: https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile
+
+    const void* p_data{};
+    n_t size{};
+
+public:
+    explicit WindowsMappedFile(const std::filesystem::path& filepath)
+    try
+    {
+        HANDLE const file(CreateFile(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (file == INVALID_HANDLE_VALUE)
+            throw WindowsError(LOG_INFO "Failed to open "s + filepath.string());
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            throw WindowsError(LOG_INFO "Failed to get size of "s + filepath.string());
+        }
+
+        // Empty files can't be mapped
+        size = n_t(fileSize.QuadPart);
+        if (!size)
+        {
+            CloseHandle(file);
+            return;
+        }
+
+        // The view keeps its own references to the mapping and file
+        HANDLE const mapping(CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+        CloseHandle(file);
+        if (!mapping)
+            throw WindowsError(LOG_INFO "Failed to create mapping of "s + filepath.string());
+
+        p_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!p_data)
+            throw WindowsError(LOG_INFO "Failed to map "s + filepath.string());
+    }
+    LOG_RETHROW
+
+    ~WindowsMappedFile() override
+    {
+        if (p_data)
+            UnmapViewOfFile(p_data);
+    }
+
+    std::span<const std::uint8_t> bytes() const noexcept override
+    {
+        if (!p_data)
+            return {};
+
+        return {static_cast<const std::uint8_t*>(p_data), size};
+    }
+};
+
+std::unique_ptr<MappedFile> Windows::mapFile(const std::filesystem::path& filepath) const
+try
+{
+    return std::make_unique<WindowsMappedFile>(filepath);
+}
+LOG_RETHROW
+
+class WindowsFileLock final : public FileLock
+{
+    // LockFileEx reference: https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-lockfileex
+    // UnlockFileEx reference: https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-unlockfileex
+
+    HANDLE file{INVALID_HANDLE_VALUE};
+
+public:
+    explicit WindowsFileLock(const std::filesystem::path& filepath)
+    try
+    {
+        file = CreateFile(filepath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw WindowsError(LOG_INFO "Failed to open "s + filepath.string());
+
+        // Locking the whole possible range, the file is empty
+        OVERLAPPED overlapped{};
+        if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped))
+        {
+            CloseHandle(file);
+            throw WindowsError(LOG_INFO "Failed to lock "s + filepath.string());
+        }
+    }
+    LOG_RETHROW
+
+    ~WindowsFileLock() override
+    {
+        OVERLAPPED overlapped{};
+        UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &overlapped);
+        CloseHandle(file);
+    }
+};
+
+std::unique_ptr<FileLock> Windows::lockFile(const std::filesystem::path& filepath) const
+try
+{
+    return std::make_unique<WindowsFileLock>(filepath);
+}
+LOG_RETHROW
@@ -59,17 +59,39 @@ public:
     using MainWindowArg_t = int;
 
 private:
+    // A thread per watch waits on changes to the file's directory and posts a message to the thread that asked for the watch
+    struct FileWatch
+    {
+        std::move_only_function<void()> onChange;
+        HANDLE directory, stopEvent;
+        std::jthread thread;
+
+        FileWatch(const std::filesystem::path& filepath, std::move_only_function<void()> onChange, index_t id);
+        ~FileWatch();
+    };
+
     HINSTANCE instance;
+    std::map<index_t, std::unique_ptr<FileWatch>> fileWatches;
+    index_t nextWatchId{};
+
+    void onFileChanged(index_t id);
 
 public:
     Windows(HINSTANCE instance) noexcept;
     ~Windows() override = default;
 
     void init(Config& config) override;
+    void initDeferred() override;
     int eventLoop() override;
     std::filesystem::path getDataDirectory() const override;
+    std::filesystem::path getCacheDirectory() const override;
     void error(const std::string& errorText) const override;
+    void message(const std::string& title, const std::string& text) const override;
     void spawnMainWindow(MainWindow& window, std::string_view className, std::string_view title, std::any arg) override;
     void quit() override;
     std::optional<std::filesystem::path> chooseFile(std::span<const FileFilter> fileFilters, FunctionRef<bool(const std::filesystem::path&)> validator) const override;
+    index_t watchFile(const std::filesystem::path& filepath, std::move_only_function<void()> onChange) override;
+    void unwatchFile(index_t id) override;
+    std::unique_ptr<MappedFile> mapFile(const std::filesystem::path& filepath) const override;
+    std::unique_ptr<FileLock> lockFile(const std::filesystem::path& filepath) const override;
 };